@@ -0,0 +1,563 @@
+/**
+ * \file
+ *
+ * \brief FreeRTOS DMAC memory copy API
+ *
+ * Copyright (c) 2012-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \asf_license_start
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip
+ * software and any derivatives exclusively with Microchip products.
+ * It is your responsibility to comply with third party license terms applicable
+ * to your use of third party software (including open source software) that
+ * may accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES,
+ * WHETHER EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE,
+ * INCLUDING ANY IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY,
+ * AND FITNESS FOR A PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE
+ * LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL
+ * LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND WHATSOEVER RELATED TO THE
+ * SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS BEEN ADVISED OF THE
+ * POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE FULLEST EXTENT
+ * ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN ANY WAY
+ * RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+ * THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * \asf_license_stop
+ *
+ */
+
+/* Standard includes. */
+/*
+ * Support and FAQ: visit <a href="https://www.microchip.com/support/">Microchip Support</a>
+ */
+#include <string.h>
+
+/* ASF includes. */
+#include "freertos_dmac_memcpy.h"
+#include "freertos_peripheral_control_private.h"
+
+/* The most transfers one DMAC buffer transfer can make.  Longer copies are
+split into several buffer transfers by the interrupt handler. */
+#define MAX_DMAC_BUFFER_TRANSFER	(0xfffUL)
+
+/* The sizes freertos_dmac_memcpy_calibrate() times, doubling from the
+smallest, and the number of times each is timed.  The quickest time is used, as
+interrupts can only make a copy slower. */
+#define CALIBRATION_MIN_SIZE		(16UL)
+#define CALIBRATION_MAX_SIZE		(2048UL)
+#define CALIBRATION_REPEATS			(4)
+
+/* The longest a calibration copy is waited for. */
+#define CALIBRATION_BLOCK_TIME		(10UL / portTICK_RATE_MS)
+
+/* A channel used for copies, and the copy in progress on it. */
+typedef struct dmac_memcpy_channel {
+	uint32_t channel;						/*< The DMAC channel number. */
+	volatile bool is_busy;					/*< A copy is in progress. */
+	const uint8_t *source;					/*< Where the next buffer transfer copies from. */
+	uint8_t *destination;					/*< Where the next buffer transfer copies to. */
+	size_t bytes_remaining;					/*< Bytes not yet given to the DMAC. */
+	uint32_t width_shift;					/*< log2 of the transfer width, 0 to 2, set by the alignment of the copy. */
+	xSemaphoreHandle completion_semaphore;	/*< Given at the end of a blocking copy. */
+	xSemaphoreHandle notification_semaphore;	/*< The semaphore to give at the end of the copy in progress. */
+	char name[PERIPHERAL_OBJECT_NAME_LEN];	/*< Name under which completion_semaphore is added to the queue registry. */
+} dmac_memcpy_channel_t;
+
+/* Makes a copy, on the DMAC if use_dmac is true, otherwise as decided by the
+threshold. */
+static status_code_t copy_memory(void *destination, const void *source,
+		size_t len, portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore, bool use_dmac);
+
+/* Returns true if every byte of a block is in SRAM, which the DMAC can
+reach. */
+static bool is_in_sram(const void *address, size_t len);
+
+/* Gives the DMAC the next part of the copy in progress on a channel. */
+static void start_dmac_buffer_transfer(dmac_memcpy_channel_t *copy_channel);
+
+/* Stops a copy that did not complete in the time the task waited. */
+static void abort_copy(dmac_memcpy_channel_t *copy_channel);
+
+/* Called from the DMAC interrupt when a copy channel has completed a buffer
+transfer. */
+static void dmac_memcpy_handler(void *parameter, uint32_t channel_status,
+		portBASE_TYPE *higher_priority_task_woken);
+
+/* Returns the DWT cycle counter, starting it first if necessary. */
+static uint32_t get_cycle_count(void);
+
+static dmac_memcpy_channel_t copy_channels[FREERTOS_DMAC_MEMCPY_CHANNELS] = {
+	{FREERTOS_DMAC_MEMCPY_CHANNEL_0},
+	{FREERTOS_DMAC_MEMCPY_CHANNEL_1}
+};
+
+/* Set once freertos_dmac_memcpy_init() has been called.  Until then every copy
+is made with memcpy(). */
+static bool is_initialised = false;
+
+/* The copy size from which the DMAC is used. */
+static uint32_t copy_threshold = FREERTOS_DMAC_MEMCPY_DEFAULT_THRESHOLD;
+
+/* Read by freertos_dmac_memcpy_get_stats(). */
+static freertos_dmac_memcpy_stats_t copy_stats;
+
+/**
+ * \ingroup freertos_dmac_memcpy_group
+ * \brief Prepare the DMAC channels used for memory copies.
+ *
+ * freertos_dmac_memcpy_init() must be called once, before the scheduler is
+ * started or from a task, before copies can be made by the DMAC.  Copies
+ * requested before then are made with memcpy().  The channels used are
+ * FREERTOS_DMAC_MEMCPY_CHANNEL_0 and FREERTOS_DMAC_MEMCPY_CHANNEL_1, so do not
+ * clash with the SPI driver.
+ *
+ * \param interrupt_priority    The priority of the DMAC interrupt, if it has
+ *     not already been set by another driver that uses the DMAC.
+ *
+ * \return     STATUS_OK.
+ */
+status_code_t freertos_dmac_memcpy_init(uint32_t interrupt_priority)
+{
+	portBASE_TYPE index;
+	dmac_memcpy_channel_t *copy_channel;
+
+	configASSERT(is_initialised == false);
+
+	for (index = 0; index < FREERTOS_DMAC_MEMCPY_CHANNELS; index++) {
+		copy_channel = &(copy_channels[index]);
+
+		vSemaphoreCreateBinary(copy_channel->completion_semaphore);
+		configASSERT(copy_channel->completion_semaphore);
+		xSemaphoreTake(copy_channel->completion_semaphore, 0);
+
+		register_peripheral_control_object(
+				copy_channel->completion_semaphore, copy_channel->name,
+				"DMAC", copy_channel->channel, "copy");
+
+		freertos_dmac_set_channel_handler(copy_channel->channel,
+				dmac_memcpy_handler, copy_channel, interrupt_priority);
+	}
+
+	copy_stats.threshold = copy_threshold;
+	is_initialised = true;
+
+	return STATUS_OK;
+}
+
+/**
+ * \ingroup freertos_dmac_memcpy_group
+ * \brief Start copying a block of memory.
+ *
+ * A copy of at least the threshold size, between SRAM addresses, is given to
+ * a DMAC channel, and freertos_dmac_memcpy_async() returns while it is in
+ * progress.  Any other copy is made with memcpy() before returning, as it is
+ * when both channels are already copying.  Either way notification_semaphore
+ * is given once the data has been copied, so the caller does not need to know
+ * which way the copy was made.
+ *
+ * \param destination    Where to copy to.  Must not be read or written until
+ *     the copy has completed.
+ * \param source    Where to copy from.  Must not be written until the copy
+ *     has completed.
+ * \param len    The number of bytes to copy.
+ * \param block_time_ticks    Only used when notification_semaphore is NULL,
+ *     as the time to wait for the copy to complete.
+ * \param notification_semaphore    Given when the copy completes, from the DMAC
+ *     interrupt for a copy made by the DMAC.  The semaphore must be created
+ *     using the FreeRTOS vSemaphoreCreateBinary() API function before it is
+ *     used as a parameter.  If NULL, the function waits for the copy to
+ *     complete, as freertos_dmac_memcpy().
+ *
+ * \return     ERR_INVALID_ARG is returned if an input parameter is invalid.
+ *     ERR_TIMEOUT is returned if a blocking copy did not complete in
+ *     block_time_ticks.  STATUS_OK is returned if the copy has been made, or
+ *     for an asynchronous copy, has been started.
+ */
+status_code_t freertos_dmac_memcpy_async(void *destination,
+		const void *source, size_t len, portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore)
+{
+	return copy_memory(destination, source, len, block_time_ticks,
+			notification_semaphore, false);
+}
+
+/**
+ * \ingroup freertos_dmac_memcpy_group
+ * \brief Time one copy made with memcpy(), and the same copy made by the DMAC.
+ *
+ * Both times are in CPU cycles, from the DWT cycle counter, and include
+ * everything the calling task waits for.  For the DMAC that is programming the
+ * channel, the copy itself, the completion interrupt and the task being woken.
+ * Must be called from a task, after freertos_dmac_memcpy_init().
+ *
+ * \param len    The number of bytes to copy, up to 2048.  The copies are made
+ *     between two scratch buffers allocated from the FreeRTOS heap.
+ * \param cpu_cycles    Set to the cycles taken by memcpy(), 0 on failure.
+ * \param dmac_cycles    Set to the cycles taken by the DMAC, 0 on failure.
+ */
+void freertos_dmac_memcpy_measure(size_t len, uint32_t *cpu_cycles,
+		uint32_t *dmac_cycles)
+{
+	uint8_t *buffers;
+	uint32_t start_cycles;
+
+	*cpu_cycles = 0;
+	*dmac_cycles = 0;
+
+	if ((is_initialised == false) || (len == 0) ||
+			(len > CALIBRATION_MAX_SIZE)) {
+		return;
+	}
+
+	buffers = (uint8_t *) pvPortMalloc(2 * CALIBRATION_MAX_SIZE);
+	if (buffers == NULL) {
+		return;
+	}
+
+	memset(buffers, 0x5a, CALIBRATION_MAX_SIZE);
+
+	start_cycles = get_cycle_count();
+	memcpy(&(buffers[CALIBRATION_MAX_SIZE]), buffers, len);
+	*cpu_cycles = get_cycle_count() - start_cycles;
+
+	start_cycles = get_cycle_count();
+	if (copy_memory(&(buffers[CALIBRATION_MAX_SIZE]), buffers, len,
+			CALIBRATION_BLOCK_TIME, NULL, true) == STATUS_OK) {
+		*dmac_cycles = get_cycle_count() - start_cycles;
+	}
+
+	vPortFree(buffers);
+}
+
+/**
+ * \ingroup freertos_dmac_memcpy_group
+ * \brief Measure the size from which copies are made by the DMAC, and use it.
+ *
+ * The DMAC's fixed cost is the time it takes to make the smallest copy
+ * measured, which is almost all programming the channel, taking the interrupt
+ * and waking the task.  memcpy() is timed at doubling sizes, and the threshold
+ * is set to the first size at which it takes longer than that.  If memcpy() is
+ * quicker at every size measured, the threshold is extrapolated from the
+ * largest.  Must be called from a task, after freertos_dmac_memcpy_init().
+ *
+ * \return     The new threshold in bytes, or the unchanged threshold if the
+ *     copies could not be timed.
+ */
+uint32_t freertos_dmac_memcpy_calibrate(void)
+{
+	uint32_t len, repeat, cpu_cycles, dmac_cycles;
+	uint32_t dmac_overhead_cycles = UINT32_MAX, best_cpu_cycles = 0;
+	uint32_t threshold = 0;
+
+	for (len = CALIBRATION_MIN_SIZE; len <= CALIBRATION_MAX_SIZE; len *= 2) {
+		best_cpu_cycles = UINT32_MAX;
+
+		for (repeat = 0; repeat < CALIBRATION_REPEATS; repeat++) {
+			freertos_dmac_memcpy_measure(len, &cpu_cycles, &dmac_cycles);
+			if ((cpu_cycles == 0) || (dmac_cycles == 0)) {
+				return copy_threshold;
+			}
+
+			if (cpu_cycles < best_cpu_cycles) {
+				best_cpu_cycles = cpu_cycles;
+			}
+
+			/* The fixed cost is taken from the smallest copy. */
+			if ((len == CALIBRATION_MIN_SIZE) &&
+					(dmac_cycles < dmac_overhead_cycles)) {
+				dmac_overhead_cycles = dmac_cycles;
+			}
+		}
+
+		if (best_cpu_cycles >= dmac_overhead_cycles) {
+			threshold = len;
+			break;
+		}
+	}
+
+	if (threshold == 0) {
+		/* memcpy() takes time in proportion to the size copied. */
+		threshold = (uint32_t) (((uint64_t) CALIBRATION_MAX_SIZE *
+				dmac_overhead_cycles) / best_cpu_cycles);
+	}
+
+	freertos_dmac_memcpy_set_threshold(threshold);
+
+	return threshold;
+}
+
+/**
+ * \ingroup freertos_dmac_memcpy_group
+ * \brief Set the size from which copies are made by the DMAC.
+ *
+ * \param threshold    Copies of at least this many bytes are made by the DMAC.
+ *     0 has the same effect as 1.
+ */
+void freertos_dmac_memcpy_set_threshold(uint32_t threshold)
+{
+	taskENTER_CRITICAL();
+	{
+		copy_threshold = threshold;
+		copy_stats.threshold = threshold;
+	}
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * \ingroup freertos_dmac_memcpy_group
+ * \brief Read the counters kept of the copies made.
+ *
+ * \param stats    Filled in with a copy of the counters.
+ * \param reset    If true the counters, other than the threshold, are cleared
+ *     once they have been copied.
+ */
+void freertos_dmac_memcpy_get_stats(freertos_dmac_memcpy_stats_t *stats,
+		bool reset)
+{
+	taskENTER_CRITICAL();
+	{
+		*stats = copy_stats;
+
+		if (reset == true) {
+			memset(&copy_stats, 0, sizeof(copy_stats));
+			copy_stats.threshold = copy_threshold;
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+
+/*
+ * For internal use only.
+ * Shared by freertos_dmac_memcpy_async() and freertos_dmac_memcpy_measure().
+ * A copy that is not given to the DMAC is made with memcpy() straight away.
+ */
+static status_code_t copy_memory(void *destination, const void *source,
+		size_t len, portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore, bool use_dmac)
+{
+	dmac_memcpy_channel_t *copy_channel = NULL;
+	status_code_t return_value = STATUS_OK;
+	portBASE_TYPE index;
+	uint32_t alignment;
+
+	if ((destination == NULL) || (source == NULL)) {
+		return ERR_INVALID_ARG;
+	}
+
+	if ((is_initialised == true) &&
+			((use_dmac == true) || (len >= copy_threshold)) &&
+			(len > 0) && is_in_sram(destination, len) &&
+			is_in_sram(source, len)) {
+		/* Claim a free channel.  If both are copying, memcpy() completes
+		sooner than waiting for one. */
+		taskENTER_CRITICAL();
+		{
+			for (index = 0; index < FREERTOS_DMAC_MEMCPY_CHANNELS; index++) {
+				if (copy_channels[index].is_busy == false) {
+					copy_channel = &(copy_channels[index]);
+					copy_channel->is_busy = true;
+					copy_stats.dmac_copies++;
+					copy_stats.dmac_bytes += len;
+					break;
+				}
+			}
+
+			if (copy_channel == NULL) {
+				copy_stats.busy_fallbacks++;
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	if (copy_channel == NULL) {
+		memcpy(destination, source, len);
+
+		taskENTER_CRITICAL();
+		{
+			copy_stats.cpu_copies++;
+			copy_stats.cpu_bytes += len;
+		}
+		taskEXIT_CRITICAL();
+
+		if (notification_semaphore != NULL) {
+			xSemaphoreGive(notification_semaphore);
+		}
+	} else {
+		/* Copy in words if both ends and the length allow it. */
+		alignment = (uint32_t) destination | (uint32_t) source | len;
+		if ((alignment & 0x03) == 0) {
+			copy_channel->width_shift = 2;
+		} else if ((alignment & 0x01) == 0) {
+			copy_channel->width_shift = 1;
+		} else {
+			copy_channel->width_shift = 0;
+		}
+
+		copy_channel->source = (const uint8_t *) source;
+		copy_channel->destination = (uint8_t *) destination;
+		copy_channel->bytes_remaining = len;
+
+		/* A blocking copy waits on the channel's own semaphore. */
+		if (notification_semaphore == NULL) {
+			copy_channel->notification_semaphore =
+					copy_channel->completion_semaphore;
+		} else {
+			copy_channel->notification_semaphore = notification_semaphore;
+		}
+
+		/* Ensure the semaphore starts in the expected state. */
+		xSemaphoreTake(copy_channel->notification_semaphore, 0);
+
+		/* Start the channel and catch the end of the copy.  Done in a critical
+		section, as the DMAC interrupt of another channel would otherwise
+		clear the completion flag of a short copy before its interrupt is
+		enabled.  A flag left by an aborted copy is ignored by the handler
+		while the channel is still running. */
+		taskENTER_CRITICAL();
+		{
+			start_dmac_buffer_transfer(copy_channel);
+			DMAC->DMAC_EBCIER = DMAC_EBCIER_BTC0 << copy_channel->channel;
+		}
+		taskEXIT_CRITICAL();
+
+		if (notification_semaphore == NULL) {
+			if (xSemaphoreTake(copy_channel->completion_semaphore,
+					block_time_ticks) != pdPASS) {
+				abort_copy(copy_channel);
+				return_value = ERR_TIMEOUT;
+			}
+		}
+	}
+
+	return return_value;
+}
+
+/*
+ * For internal use only.
+ * SRAM0 is mapped at IRAM0_ADDR, and again just below SRAM1 so the two form
+ * one block, which is where the linker places RAM.
+ */
+static bool is_in_sram(const void *address, size_t len)
+{
+	uint32_t start = (uint32_t) address;
+	uint32_t end = start + len;
+
+	return ((start >= IRAM0_ADDR) && (end <= (IRAM0_ADDR + IRAM0_SIZE))) ||
+			((start >= (IRAM1_ADDR - IRAM0_SIZE)) &&
+			(end <= (IRAM1_ADDR + IRAM1_SIZE)));
+}
+
+/*
+ * For internal use only.
+ * Called by a task starting a copy, or by the DMAC interrupt once the previous
+ * part of the copy has completed, to program the channel with the next
+ * MAX_DMAC_BUFFER_TRANSFER transfers or fewer.
+ */
+static void start_dmac_buffer_transfer(dmac_memcpy_channel_t *copy_channel)
+{
+	DmacCh_num *channel = &(DMAC->DMAC_CH_NUM[copy_channel->channel]);
+	uint32_t transfers, len;
+
+	transfers = copy_channel->bytes_remaining >> copy_channel->width_shift;
+	if (transfers > MAX_DMAC_BUFFER_TRANSFER) {
+		transfers = MAX_DMAC_BUFFER_TRANSFER;
+	}
+	len = transfers << copy_channel->width_shift;
+
+	channel->DMAC_SADDR = (uint32_t) copy_channel->source;
+	channel->DMAC_DADDR = (uint32_t) copy_channel->destination;
+	channel->DMAC_DSCR = 0;
+	channel->DMAC_CTRLA = DMAC_CTRLA_BTSIZE(transfers) |
+			(copy_channel->width_shift << DMAC_CTRLA_SRC_WIDTH_Pos) |
+			(copy_channel->width_shift << DMAC_CTRLA_DST_WIDTH_Pos);
+	channel->DMAC_CTRLB = DMAC_CTRLB_SRC_DSCR_FETCH_DISABLE |
+			DMAC_CTRLB_DST_DSCR_FETCH_DISABLE | DMAC_CTRLB_FC_MEM2MEM_DMA_FC |
+			DMAC_CTRLB_SRC_INCR_INCREMENTING |
+			DMAC_CTRLB_DST_INCR_INCREMENTING;
+	channel->DMAC_CFG = DMAC_CFG_SOD_ENABLE | DMAC_CFG_AHB_PROT(1) |
+			DMAC_CFG_FIFOCFG_ALAP_CFG;
+
+	copy_channel->source += len;
+	copy_channel->destination += len;
+	copy_channel->bytes_remaining -= len;
+
+	DMAC->DMAC_CHER = DMAC_CHER_ENA0 << copy_channel->channel;
+}
+
+/*
+ * For internal use only.
+ * Called by a task whose wait for a blocking copy timed out.  If the copy did
+ * complete after the wait timed out nothing is done.  Otherwise this does not
+ * return until the channel has stopped writing, as the caller may go on to
+ * copy into the same destination with memcpy().
+ */
+static void abort_copy(dmac_memcpy_channel_t *copy_channel)
+{
+	taskENTER_CRITICAL();
+	{
+		if (copy_channel->is_busy == true) {
+			DMAC->DMAC_EBCIDR = DMAC_EBCIDR_BTC0 << copy_channel->channel;
+			DMAC->DMAC_CHDR = DMAC_CHDR_DIS0 << copy_channel->channel;
+
+			/* The channel finishes the chunk it is moving before it stops. */
+			while ((DMAC->DMAC_CHSR & (DMAC_CHSR_ENA0 <<
+					copy_channel->channel)) != 0) {
+			}
+
+			copy_channel->is_busy = false;
+			copy_stats.timeouts++;
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+
+/*
+ * For internal use only.
+ * Called from the DMAC interrupt when a copy channel has completed a buffer
+ * transfer.  The next part of a long copy is started straight away.  Once the
+ * whole copy has completed the channel is freed and the task notified.
+ */
+static void dmac_memcpy_handler(void *parameter, uint32_t channel_status,
+		portBASE_TYPE *higher_priority_task_woken)
+{
+	dmac_memcpy_channel_t *copy_channel = (dmac_memcpy_channel_t *) parameter;
+
+	/* A completion flag left by an aborted copy can be seen while the next
+	copy on the channel is still running. */
+	if (((channel_status & DMAC_EBCISR_BTC0) == 0) ||
+			(copy_channel->is_busy == false) ||
+			((DMAC->DMAC_CHSR & (DMAC_CHSR_ENA0 << copy_channel->channel)) != 0)) {
+		return;
+	}
+
+	if (copy_channel->bytes_remaining > 0) {
+		start_dmac_buffer_transfer(copy_channel);
+	} else {
+		DMAC->DMAC_EBCIDR = DMAC_EBCIDR_BTC0 << copy_channel->channel;
+		copy_channel->is_busy = false;
+
+		xSemaphoreGiveFromISR(copy_channel->notification_semaphore,
+				higher_priority_task_woken);
+	}
+}
+
+/*
+ * For internal use only.
+ * The cycle counter is shared with the profilers, which start it the same
+ * way, so it is never reset here.
+ */
+static uint32_t get_cycle_count(void)
+{
+	if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0) {
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+
+	return DWT->CYCCNT;
+}
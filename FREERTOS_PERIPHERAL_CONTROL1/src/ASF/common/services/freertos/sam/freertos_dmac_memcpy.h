@@ -0,0 +1,184 @@
+/**
+ * \file
+ *
+ * \brief FreeRTOS DMAC memory copy API
+ *
+ * Copyright (c) 2012-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \asf_license_start
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip
+ * software and any derivatives exclusively with Microchip products.
+ * It is your responsibility to comply with third party license terms applicable
+ * to your use of third party software (including open source software) that
+ * may accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES,
+ * WHETHER EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE,
+ * INCLUDING ANY IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY,
+ * AND FITNESS FOR A PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE
+ * LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL
+ * LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND WHATSOEVER RELATED TO THE
+ * SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS BEEN ADVISED OF THE
+ * POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE FULLEST EXTENT
+ * ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN ANY WAY
+ * RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+ * THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * \asf_license_stop
+ *
+ */
+/*
+ * Support and FAQ: visit <a href="https://www.microchip.com/support/">Microchip Support</a>
+ */
+
+#ifndef FREERTOS_DMAC_MEMCPY_INCLUDED
+#define FREERTOS_DMAC_MEMCPY_INCLUDED
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* ASF includes. */
+#include "freertos_peripheral_control.h"
+
+/// @cond 0
+/**INDENT-OFF**/
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**INDENT-ON**/
+/// @endcond
+
+#if SAM3XA
+	/* Copies are made by the general purpose DMAC. */
+#else
+# error Unsupported chip type
+#endif
+
+/**
+ * \defgroup freertos_dmac_memcpy_group FreeRTOS DMAC memory copy
+ * \brief Memory to memory copies made by the DMAC while the calling task is
+ * blocked, so other tasks can use the CPU.
+ * \ingroup freertos_service_group
+ */
+
+/**
+ * \ingroup freertos_dmac_memcpy_group
+ * \brief The copy size, in bytes, from which the DMAC is used until
+ * freertos_dmac_memcpy_calibrate() has measured the cut over point.  Smaller
+ * copies are made with memcpy().
+ */
+#define FREERTOS_DMAC_MEMCPY_DEFAULT_THRESHOLD		256
+
+/**
+ * \ingroup freertos_dmac_memcpy_group
+ * \brief The number of copies that can be in progress on the DMAC at once.
+ * Further copies are made with memcpy() rather than waiting for a channel.
+ */
+#define FREERTOS_DMAC_MEMCPY_CHANNELS				2
+
+/**
+ * \ingroup freertos_dmac_memcpy_group
+ *     ypedef freertos_dmac_memcpy_stats_t
+ * \brief Counters read with freertos_dmac_memcpy_get_stats().
+ */
+typedef struct freertos_dmac_memcpy_stats {
+	uint32_t dmac_copies;		/*< Copies made by the DMAC. */
+	uint32_t dmac_bytes;		/*< Bytes copied by the DMAC. */
+	uint32_t cpu_copies;		/*< Copies made with memcpy(), because they were below the threshold, not in SRAM, or no channel was free. */
+	uint32_t cpu_bytes;			/*< Bytes copied with memcpy(). */
+	uint32_t busy_fallbacks;	/*< Copies over the threshold made with memcpy() because every channel was in use. */
+	uint32_t timeouts;			/*< Blocking copies abandoned because they did not complete in the block time. */
+	uint32_t threshold;			/*< The current cut over size in bytes. */
+} freertos_dmac_memcpy_stats_t;
+
+status_code_t freertos_dmac_memcpy_init(uint32_t interrupt_priority);
+
+status_code_t freertos_dmac_memcpy_async(void *destination,
+		const void *source, size_t len, portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore);
+
+void freertos_dmac_memcpy_measure(size_t len, uint32_t *cpu_cycles,
+		uint32_t *dmac_cycles);
+
+uint32_t freertos_dmac_memcpy_calibrate(void);
+
+void freertos_dmac_memcpy_set_threshold(uint32_t threshold);
+
+void freertos_dmac_memcpy_get_stats(freertos_dmac_memcpy_stats_t *stats,
+		bool reset);
+
+/**
+ * \ingroup freertos_dmac_memcpy_group
+ * \brief Copy a block of memory, and wait for the copy to complete.
+ *
+ * freertos_dmac_memcpy() is the blocking version of
+ * freertos_dmac_memcpy_async().  Copies of at least the threshold size are
+ * made by the DMAC, and other RTOS tasks execute while the copy is in
+ * progress.  Smaller copies are made with memcpy().
+ *
+ * \param destination    Where to copy to.
+ * \param source    Where to copy from.
+ * \param len    The number of bytes to copy.
+ * \param block_time_ticks    The maximum time to wait for the DMAC to complete
+ *     the copy, in RTOS ticks.
+ *
+ * \return     ERR_INVALID_ARG is returned if an input parameter is invalid.
+ *     ERR_TIMEOUT is returned if the copy did not complete in block_time_ticks,
+ *     in which case only part of the data may have been copied.  STATUS_OK is
+ *     returned if the data was copied.
+ */
+#define freertos_dmac_memcpy(destination, source, len, block_time_ticks) freertos_dmac_memcpy_async((destination), (source), (len), (block_time_ticks), (NULL))
+
+/**
+ * \page freertos_dmac_memcpy_quick_start Quick start guide for the FreeRTOS
+ * DMAC memory copy functions
+ *
+ * This is the quick start guide for the \ref freertos_dmac_memcpy_group.
+ *
+ * freertos_dmac_memcpy_init() is called once, before the first copy.  Copies
+ * started before it is called are made with memcpy().
+ *
+ * A copy handed to the DMAC costs the CPU the time to program a channel, and
+ * to take the completion interrupt and wake the calling task, whatever its
+ * size.  While the DMAC copies, the CPU runs other tasks.  Below some size it
+ * is quicker for the CPU to copy the data itself, so smaller copies are made
+ * with memcpy().  freertos_dmac_memcpy_calibrate() times both ways of copying
+ * at a range of sizes, with the DWT cycle counter, and sets the threshold to
+ * the first size at which memcpy() takes longer than the DMAC's fixed cost.
+ *
+ * The DMAC can only reach SRAM, so a copy to or from any other address, such
+ * as a constant string in flash, is made with memcpy() whatever its size.
+ *
+ * \code
+
+	 // Initialise once, then measure the cut over point once the scheduler
+	 // is running.
+	 freertos_dmac_memcpy_init(configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+	 freertos_dmac_memcpy_calibrate();
+
+	 // Copy a block, letting other tasks run until it has been copied.
+	 freertos_dmac_memcpy(destination, source, 2048, max_block_time);
+
+	 // Or start the copy, do something else, then wait for it.
+	 freertos_dmac_memcpy_async(destination, source, 2048, max_block_time,
+	         notification_semaphore);
+	 ...
+	 xSemaphoreTake(notification_semaphore, max_block_time);
+
+\endcode
+ */
+
+/// @cond 0
+/**INDENT-OFF**/
+#ifdef __cplusplus
+}
+#endif
+/**INDENT-ON**/
+/// @endcond
+
+#endif /* FREERTOS_DMAC_MEMCPY_INCLUDED */
@@ -46,6 +46,49 @@
 /* ASF includes. */
 #include "freertos_peripheral_control.h"
 #include "freertos_peripheral_control_private.h"
+#if defined(DMAC)
+#include "pmc.h"
+#include "freertos_dmac_memcpy.h"
+#endif
+
+/* The most ports that can register counters with
+register_peripheral_stats(). */
+#define MAX_REGISTERED_PERIPHERAL_STATS		(8)
+
+/* Every channel's bits in the DMAC interrupt registers. */
+#define MASK_ALL_DMAC_INTERRUPTS			(0x003f3f3fUL)
+
+/* The longest a read waits for the DMAC to copy data out of a circular receive
+buffer before copying it with the CPU instead. */
+#define MAX_RX_COPY_BLOCK_TIME				(10UL / portTICK_RATE_MS)
+
+/* A port's counters, and the name they are listed under. */
+typedef struct registered_peripheral_stats {
+	const char *name;
+	freertos_peripheral_stats_t *stats;
+} registered_peripheral_stats_t;
+
+/* Builds "<peripheral><index> <role>", or "<peripheral><index>" if object_role
+is empty. */
+static void build_peripheral_object_name(char name[PERIPHERAL_OBJECT_NAME_LEN],
+		const char *peripheral_name, portBASE_TYPE peripheral_index,
+		const char *object_role);
+
+/* The counters of each initialised port, in the order the ports were
+initialised. */
+static registered_peripheral_stats_t registered_stats[MAX_REGISTERED_PERIPHERAL_STATS];
+static uint32_t registered_stats_count = 0;
+
+#if defined(DMAC)
+/* The driver function called from the DMAC interrupt for each channel. */
+typedef struct dmac_channel_handler {
+	freertos_dmac_channel_handler_t handler;
+	void *parameter;
+} dmac_channel_handler_t;
+
+static dmac_channel_handler_t dmac_channel_handlers[DMACCH_NUM_NUMBER];
+static bool is_dmac_enabled = false;
+#endif
 
 /*
  * For internal use only.
@@ -93,6 +136,168 @@ bool check_requested_operating_mode(
 	return return_value;
 }
 
+/*
+ * For internal use only.
+ * Add a driver semaphore or mutex to the queue registry, named after the
+ * peripheral that owns it (for example "USART0 Rx"), so it can be found by
+ * kernel aware debuggers and the mutex-stats CLI command.  The registry only
+ * stores a pointer to the name, so name must be persistent.
+ */
+void register_peripheral_control_object(xSemaphoreHandle object,
+		char name[PERIPHERAL_OBJECT_NAME_LEN], const char *peripheral_name,
+		portBASE_TYPE peripheral_index, const char *object_role)
+{
+#if (configQUEUE_REGISTRY_SIZE > 0)
+	if (object != NULL) {
+		build_peripheral_object_name(name, peripheral_name, peripheral_index,
+				object_role);
+		vQueueAddToRegistry(object, name);
+	}
+#else
+	(void) object;
+	(void) name;
+	(void) peripheral_name;
+	(void) peripheral_index;
+	(void) object_role;
+#endif
+}
+
+/*
+ * For internal use only.
+ * Record a port's counters so they can be listed by
+ * freertos_get_peripheral_stats() under the name of the port (for example
+ * "USART0").  Called once, when the port is initialised.  name must be
+ * persistent.
+ */
+void register_peripheral_stats(freertos_peripheral_stats_t *stats,
+		char name[PERIPHERAL_OBJECT_NAME_LEN], const char *peripheral_name,
+		portBASE_TYPE peripheral_index)
+{
+	build_peripheral_object_name(name, peripheral_name, peripheral_index, "");
+
+	configASSERT(registered_stats_count < MAX_REGISTERED_PERIPHERAL_STATS);
+
+	if (registered_stats_count < MAX_REGISTERED_PERIPHERAL_STATS) {
+		taskENTER_CRITICAL();
+		{
+			registered_stats[registered_stats_count].name = name;
+			registered_stats[registered_stats_count].stats = stats;
+			registered_stats_count++;
+		}
+		taskEXIT_CRITICAL();
+	}
+}
+
+/*
+ * For internal use only.
+ * Copy a port's counters into snapshot, and optionally clear them, in one
+ * critical section so the copy is consistent with the interrupt.  The size of
+ * the receive buffer is not cleared.
+ */
+void freertos_copy_peripheral_stats(freertos_peripheral_stats_t *stats,
+		freertos_peripheral_stats_t *snapshot, bool reset)
+{
+	uint32_t rx_buffer_size;
+
+	taskENTER_CRITICAL();
+	{
+		*snapshot = *stats;
+
+		if (reset) {
+			rx_buffer_size = stats->rx_buffer_size;
+			memset(stats, 0, sizeof(*stats));
+			stats->rx_buffer_size = rx_buffer_size;
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+
+/*
+ * For internal use only.
+ * Called by a read or write function as it returns.  bytes is the number of
+ * bytes transferred, and entry_ticks the tick count when the function was
+ * entered.  The time between the two is counted as blocked, as the driver
+ * only takes a small part of a tick when it does not have to wait.
+ */
+void freertos_record_transfer(freertos_peripheral_stats_t *stats,
+		bool is_transmitting, uint32_t bytes, portTickType entry_ticks)
+{
+	uint32_t ticks_in_function = (uint32_t) (xTaskGetTickCount() - entry_ticks);
+
+	/* Tasks on the same port can preempt each other part way through an
+	update. */
+	taskENTER_CRITICAL();
+	{
+		if (is_transmitting) {
+			stats->tx_bytes += bytes;
+			stats->tx_transfers += (bytes > 0) ? 1 : 0;
+			stats->tx_blocked_ticks += ticks_in_function;
+		} else {
+			stats->rx_bytes += bytes;
+			stats->rx_transfers += (bytes > 0) ? 1 : 0;
+			stats->rx_blocked_ticks += ticks_in_function;
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+
+/*
+ * For internal use only.
+ * Called from the receive interrupt to raise the high-water mark of a PDC
+ * controlled circular Rx buffer to the number of bytes now unread, if that is
+ * higher.
+ */
+void freertos_record_rx_buffer_level(freertos_peripheral_stats_t *stats,
+		freertos_pdc_rx_control_t *p_rx_buffer_details,
+		uint32_t next_byte_to_be_written)
+{
+	freertos_iovec_t spans[FREERTOS_RX_SPAN_COUNT];
+	uint32_t bytes_unread;
+
+	bytes_unread = freertos_get_pdc_circular_buffer_spans(p_rx_buffer_details,
+			next_byte_to_be_written, spans);
+
+	if (bytes_unread > stats->rx_buffer_high_water_mark) {
+		stats->rx_buffer_high_water_mark = bytes_unread;
+	}
+}
+
+/**
+ * \ingroup freertos_service_group
+ * \brief Read the counters of one initialised port, for listing the counters
+ * of every port.
+ *
+ * Each USART, UART and TWI port registers its counters when it is initialised,
+ * so walking index up from 0 until false is returned visits every port in the
+ * order they were initialised.  The drivers also have functions that read the
+ * counters of a port from its handle, for example freertos_usart_get_stats().
+ *
+ * \param index    The position of the port, from 0.
+ * \param name    Set to the name of the port, for example "USART0".  Can be
+ *     NULL.
+ * \param stats    Filled in with a copy of the port's counters.
+ * \param reset    If true the counters are cleared once they have been copied.
+ *
+ * \return     true if there is a port at index, otherwise false.
+ */
+bool freertos_get_peripheral_stats(uint32_t index, const char **name,
+		freertos_peripheral_stats_t *stats, bool reset)
+{
+	bool return_value = false;
+
+	if (index < registered_stats_count) {
+		if (name != NULL) {
+			*name = registered_stats[index].name;
+		}
+
+		freertos_copy_peripheral_stats(registered_stats[index].stats, stats,
+				reset);
+		return_value = true;
+	}
+
+	return return_value;
+}
+
 /*
  * For internal use only.
  * Create the FreeRTOS objects necessary to control the peripheral in accordance
@@ -225,9 +430,20 @@ uint32_t freertos_copy_bytes_from_pdc_circular_buffer(
 		xSemaphoreGive(p_rx_buffer_details->rx_event_semaphore);
 	}
 
-	/* Copy the bytes into the user buffer. */
+	/* Copy the bytes into the user buffer.  Large copies are made by the
+	DMAC, while other tasks run.  The copy must be complete before the read
+	pointer is moved, as the space is then given back to the Rx DMA. */
+#if defined(DMAC) && (configUSE_DMAC_MEMCPY == 1)
+	if (freertos_dmac_memcpy(buf,
+			(void *) p_rx_buffer_details->next_byte_to_read,
+			bytes_to_read, MAX_RX_COPY_BLOCK_TIME) != STATUS_OK) {
+		memcpy(buf, (void *) p_rx_buffer_details->next_byte_to_read,
+				bytes_to_read);
+	}
+#else
 	memcpy(buf, (void *) p_rx_buffer_details->next_byte_to_read,
 			bytes_to_read);
+#endif
 
 	/* Move up the read buffer accordingly, wrapping around if it reaches the
 	end of the buffer. */
@@ -258,6 +474,95 @@ uint32_t freertos_copy_bytes_from_pdc_circular_buffer(
 	return bytes_to_read;
 }
 
+/*
+ * For internal use only.
+ * Describe the unread data in a PDC controlled circular Rx buffer, without
+ * copying it, as up to two contiguous spans: the first from the read pointer
+ * up to the write pointer or the end of the buffer, and the second (only if
+ * the data wraps) from the start of the buffer up to the write pointer.  Unused
+ * spans have a length of zero.  Returns the total number of unread bytes.
+ */
+uint32_t freertos_get_pdc_circular_buffer_spans(
+		freertos_pdc_rx_control_t *p_rx_buffer_details,
+		uint32_t next_byte_to_be_written,
+		freertos_iovec_t spans[FREERTOS_RX_SPAN_COUNT])
+{
+	uint32_t next_byte_to_read;
+
+	next_byte_to_read = (uint32_t) p_rx_buffer_details->next_byte_to_read;
+
+	spans[0].data = (const uint8_t *) next_byte_to_read;
+	spans[0].len = 0;
+	spans[1].data = (const uint8_t *)
+			p_rx_buffer_details->rx_buffer_start_address;
+	spans[1].len = 0;
+
+	if (next_byte_to_be_written > next_byte_to_read) {
+		/* The data does not wrap. */
+		spans[0].len = next_byte_to_be_written - next_byte_to_read;
+	} else if ((next_byte_to_be_written < next_byte_to_read) ||
+			(p_rx_buffer_details->rx_pdc_parameters.ul_size == 0)) {
+		/* The write pointer has wrapped around behind the read pointer, or
+		the pointers are equal but the Rx DMA has stopped because the buffer
+		is full.  Data runs from the read pointer to the end of the buffer,
+		then on from the start of the buffer up to the write pointer. */
+		spans[0].len = p_rx_buffer_details->past_rx_buffer_end_address -
+				next_byte_to_read;
+		spans[1].len = next_byte_to_be_written -
+				p_rx_buffer_details->rx_buffer_start_address;
+	}
+
+	return (uint32_t) (spans[0].len + spans[1].len);
+}
+
+/*
+ * For internal use only.
+ * Mark up to bytes_to_consume bytes at the read pointer of a PDC controlled
+ * circular Rx buffer as read, after they have been used in place through the
+ * spans returned by freertos_get_pdc_circular_buffer_spans().  If unread data
+ * remains the Rx event semaphore is given so the next wait for data does not
+ * block.  Returns the number of bytes consumed, which is capped to the number
+ * unread.
+ */
+uint32_t freertos_consume_pdc_circular_buffer(
+		freertos_pdc_rx_control_t *p_rx_buffer_details,
+		uint32_t next_byte_to_be_written, uint32_t bytes_to_consume)
+{
+	freertos_iovec_t spans[FREERTOS_RX_SPAN_COUNT];
+	uint32_t number_of_bytes_available, next_byte_to_read;
+
+	number_of_bytes_available = freertos_get_pdc_circular_buffer_spans(
+			p_rx_buffer_details, next_byte_to_be_written, spans);
+
+	if (bytes_to_consume > number_of_bytes_available) {
+		bytes_to_consume = number_of_bytes_available;
+	} else if (bytes_to_consume != number_of_bytes_available) {
+		/* There are still bytes to read, so there is no need to wait for the
+		interrupt to give the semaphore. */
+		xSemaphoreGive(p_rx_buffer_details->rx_event_semaphore);
+	}
+
+	/* Move up the read pointer, wrapping around if it passes the end of the
+	buffer. */
+	next_byte_to_read = (uint32_t) p_rx_buffer_details->next_byte_to_read +
+			bytes_to_consume;
+
+	if (next_byte_to_read >= p_rx_buffer_details->past_rx_buffer_end_address) {
+		next_byte_to_read -= (p_rx_buffer_details->past_rx_buffer_end_address -
+				p_rx_buffer_details->rx_buffer_start_address);
+	}
+
+	/* The next_byte_to_read pointer is only read by the ISR, so the critical
+	section is probably not needed on 32-bit machines. */
+	taskENTER_CRITICAL();
+	{
+		p_rx_buffer_details->next_byte_to_read = (uint8_t *) next_byte_to_read;
+	}
+	taskEXIT_CRITICAL();
+
+	return bytes_to_consume;
+}
+
 /*
  * For internal use only.
  * If a peripheral access semphore is not defined, just return STATUS_OK and take
@@ -382,3 +687,91 @@ status_code_t freertos_optionally_wait_transfer_completion(
 
 	return return_value;
 }
+
+#if defined(DMAC)
+/*
+ * For internal use only.
+ * Install the function called from the DMAC interrupt when an interrupt of
+ * channel is pending.  Every channel shares the one DMAC interrupt, so the
+ * first call also enables the DMAC and its interrupt, at interrupt_priority.
+ * Drivers enable and disable the interrupts of their own channels in
+ * DMAC_EBCIER and DMAC_EBCIDR, but must never read DMAC_EBCISR, as reading it
+ * clears the status of every channel.
+ */
+void freertos_dmac_set_channel_handler(uint32_t channel,
+		freertos_dmac_channel_handler_t handler, void *parameter,
+		uint32_t interrupt_priority)
+{
+	configASSERT(channel < DMACCH_NUM_NUMBER);
+
+	taskENTER_CRITICAL();
+	{
+		dmac_channel_handlers[channel].handler = handler;
+		dmac_channel_handlers[channel].parameter = parameter;
+
+		if (is_dmac_enabled == false) {
+			pmc_enable_periph_clk(ID_DMAC);
+			DMAC->DMAC_EN = 0;
+			DMAC->DMAC_EBCIDR = MASK_ALL_DMAC_INTERRUPTS;
+			DMAC->DMAC_GCFG = DMAC_GCFG_ARB_CFG_ROUND_ROBIN;
+			DMAC->DMAC_EN = DMAC_EN_ENABLE;
+			configure_interrupt_controller(DMAC_IRQn, interrupt_priority);
+			is_dmac_enabled = true;
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+
+/*
+ * The interrupt handler shared by every DMAC channel.  The status register is
+ * cleared by reading it, so it is read once here and each channel's bits are
+ * passed to the driver using the channel.
+ */
+void DMAC_Handler(void)
+{
+	portBASE_TYPE higher_priority_task_woken = pdFALSE;
+	uint32_t dmac_status, channel_status, channel;
+
+	dmac_status = DMAC->DMAC_EBCISR;
+	dmac_status &= DMAC->DMAC_EBCIMR;
+
+	for (channel = 0; channel < DMACCH_NUM_NUMBER; channel++) {
+		channel_status = (dmac_status >> channel) &
+				FREERTOS_DMAC_CHANNEL_STATUS_MASK;
+
+		if ((channel_status != 0) &&
+				(dmac_channel_handlers[channel].handler != NULL)) {
+			dmac_channel_handlers[channel].handler(
+					dmac_channel_handlers[channel].parameter,
+					channel_status, &higher_priority_task_woken);
+		}
+	}
+
+	portEND_SWITCHING_ISR(higher_priority_task_woken);
+}
+#endif
+
+/*
+ * For internal use only.
+ * Builds the name a port's semaphores, mutexes and counters are registered
+ * under into name.
+ */
+static void build_peripheral_object_name(char name[PERIPHERAL_OBJECT_NAME_LEN],
+		const char *peripheral_name, portBASE_TYPE peripheral_index,
+		const char *object_role)
+{
+	size_t length;
+
+	length = strlen(peripheral_name);
+	configASSERT((length + strlen(object_role) + 3) <=
+			PERIPHERAL_OBJECT_NAME_LEN);
+	configASSERT(peripheral_index < 10);
+
+	/* Build "<peripheral><index> <role>". */
+	memcpy(name, peripheral_name, length);
+	name[length++] = (char) ('0' + peripheral_index);
+	if (object_role[0] != '\0') {
+		name[length++] = ' ';
+	}
+	strcpy(&name[length], object_role);
+}
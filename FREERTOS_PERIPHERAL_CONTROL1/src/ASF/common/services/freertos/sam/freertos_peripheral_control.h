@@ -105,6 +105,9 @@
  * The following functions are provided for the SPI peripheral
  *
  * - freertos_spi_master_init()
+ * - freertos_spi_master_setup_device()
+ * - freertos_spi_select_device()
+ * - freertos_spi_deselect_device()
  * - freertos_spi_write_packet()
  * - freertos_spi_write_packet_async()
  * - freertos_spi_read_packet()
@@ -222,6 +225,10 @@ enum peripheral_operation_mode {
 	//! Valid only for the TWIHS peripheral.
 	TWIHS_I2C_MASTER,
 
+	//! Valid only for USART peripheral.  RS232 with RTS/CTS hardware
+	//! handshaking.
+	USART_RS232_HW_HANDSHAKING,
+
 	//! No other values can be used.
 	NOT_SUPPORTED
 };
@@ -275,6 +282,105 @@ typedef struct freertos_peripheral_options {
 	uint8_t options_flags; 
 } freertos_peripheral_options_t;
 
+/**
+ * \ingroup freertos_service_group
+ * \brief One contiguous region of memory: a segment of a vectored
+ * (scatter-gather) write, for example freertos_usart_writev_async(), or a span
+ * of received data returned by a peek function, for example
+ * freertos_usart_serial_peek().
+ *
+ * Data to be written is read directly by the PDC, so it must be in RAM (not
+ * Flash) and must not be modified until the write has completed.
+ */
+typedef struct freertos_iovec {
+	/** The first byte of the region. */
+	const uint8_t *data;
+
+	/** The number of bytes in the region.  Segments of zero bytes are skipped
+	 * by writes. */
+	size_t len;
+} freertos_iovec_t;
+
+/**
+ * \ingroup freertos_service_group
+ * \brief The number of spans a peek function can return.  Unread data in a
+ * circular receive buffer is contiguous unless it wraps around the end of the
+ * buffer, so it never needs more than two.
+ */
+#define FREERTOS_RX_SPAN_COUNT		2
+
+/**
+ * \ingroup freertos_service_group
+ * \brief Counters kept by a peripheral driver for one port, read with
+ * freertos_usart_get_stats(), freertos_uart_get_stats(),
+ * freertos_twi_get_stats(), freertos_spi_get_stats() or
+ * freertos_get_peripheral_stats().
+ *
+ * The counters run from when the port is initialised, or from when they were
+ * last reset, and wrap at 2^32.  Members that do not apply to a peripheral,
+ * such as NACKs on a UART, stay at zero.
+ */
+typedef struct freertos_peripheral_stats {
+	/** Bytes given to the PDC by writes. */
+	uint32_t tx_bytes;
+
+	/** Bytes returned to tasks by reads. */
+	uint32_t rx_bytes;
+
+	/** Writes that transmitted at least one byte. */
+	uint32_t tx_transfers;
+
+	/** Reads that returned at least one byte. */
+	uint32_t rx_transfers;
+
+	/** Received characters lost because the previous one had not been read. */
+	uint32_t overrun_errors;
+
+	/** Characters received without a valid stop bit. */
+	uint32_t framing_errors;
+
+	/** Characters received with a parity error. */
+	uint32_t parity_errors;
+
+	/** Transfers not acknowledged by the slave (TWI only). */
+	uint32_t nack_errors;
+
+	/** Transfers aborted because another master won the bus (TWI only). */
+	uint32_t arbitration_lost_errors;
+
+	/** Transfers abandoned because the bus did not respond in time: within
+	 * TWI_TIMEOUT_COUNTER polls for the short transfers made without the PDC,
+	 * or within the caller's block time for PDC and DMAC transfers (TWI and
+	 * SPI only). */
+	uint32_t timeout_errors;
+
+	/** The size of the circular receive buffer, 0 if the port does not
+	 * receive through one.  Not cleared by a reset. */
+	uint32_t rx_buffer_size;
+
+	/** The most unread bytes seen in the receive buffer, sampled each time
+	 * the receive interrupt runs. */
+	uint32_t rx_buffer_high_water_mark;
+
+	/** RTOS ticks tasks have spent inside write functions, which is almost
+	 * all time spent blocked waiting for access or for completion. */
+	uint32_t tx_blocked_ticks;
+
+	/** RTOS ticks tasks have spent inside read functions. */
+	uint32_t rx_blocked_ticks;
+
+	/** Runs of the interrupt handler (TWI only). */
+	uint32_t isr_count;
+
+	/** CPU cycles spent in the interrupt handler, measured with the DWT
+	 * cycle counter.  Only counted when configUSE_WAKE_LATENCY_TRACE is 1
+	 * (TWI only). */
+	uint32_t isr_cycles;
+} freertos_peripheral_stats_t;
+
+bool freertos_get_peripheral_stats(uint32_t index, const char **name,
+		freertos_peripheral_stats_t *stats, bool reset);
+
 /// @cond 0
 /**INDENT-OFF**/
 #ifdef __cplusplus
@@ -53,6 +53,7 @@ typedef struct freertos_pdc_rx_control {
 	uint32_t rx_buffer_start_address;		/*< The start of the buffer used to store received bytes. */
 	uint32_t past_rx_buffer_end_address;	/*< One byte past the end of the valid Rx buffer region. */
 	pdc_packet_t rx_pdc_parameters;			/*< Defines the section of the receive buffer currently being used by the PDC. */
+	pdc_packet_t rx_next_pdc_parameters;	/*< The section queued in the PDC next pointer and counter registers, to be used when the current section is full.  ul_size is 0 if none is queued.  Only used by drivers that double buffer reception. */
 	xSemaphoreHandle rx_event_semaphore;	/*< Used to indicate the possible presence of unread data in the Rx buffer. */
 	xSemaphoreHandle rx_access_mutex;		/*< Used for mutual exclusion to the Rx buffer.  Optional. */
 	uint8_t *next_byte_to_read;				/*< Pointer to the next byte that will be read out of the Rx buffer. */
@@ -65,6 +66,10 @@ typedef struct freertos_dma_tx_control {
 	xSemaphoreHandle peripheral_access_sem;						    /*< Used for mutual exclusion to the DMA.  Optional. */
 } freertos_dma_event_control_t;
 
+/* Space for the name under which a driver semaphore or mutex is added to the
+queue registry, for example "USART0 Rx". */
+#define PERIPHERAL_OBJECT_NAME_LEN			(12)
+
 /* Contains identification information required for accessing a peripheral. */
 typedef struct freertos_peripheral_parameters {
 	void *peripheral_base_address;			/*< The base address of the peripheral. */
@@ -73,6 +78,27 @@ typedef struct freertos_peripheral_parameters {
 	enum IRQn peripheral_irq;				/*< The position of the peripheral's interrupt vector. */
 } freertos_pdc_peripheral_parameters_t;
 
+#if defined(DMAC)
+/* The DMAC channels used by the drivers.  The SPI has no PDC on devices that
+have a DMAC, so its transfers use a pair of DMAC channels instead. */
+#define FREERTOS_DMAC_SPI_TX_CHANNEL		(0)
+#define FREERTOS_DMAC_SPI_RX_CHANNEL		(1)
+
+/* The DMAC channels used for memory to memory copies, which have the deepest
+FIFOs. */
+#define FREERTOS_DMAC_MEMCPY_CHANNEL_0		(3)
+#define FREERTOS_DMAC_MEMCPY_CHANNEL_1		(5)
+
+/* The status bits of one channel passed to a freertos_dmac_channel_handler_t,
+moved down to the positions of channel 0. */
+#define FREERTOS_DMAC_CHANNEL_STATUS_MASK	(DMAC_EBCISR_BTC0 | DMAC_EBCISR_CBTC0 | DMAC_EBCISR_ERR0)
+
+/* Called from the DMAC interrupt for a channel with an enabled interrupt
+pending. */
+typedef void (*freertos_dmac_channel_handler_t)(void *parameter,
+		uint32_t channel_status, portBASE_TYPE *higher_priority_task_woken);
+#endif
+
 /* The following functions are for internal use only.  They are described where
 they are implemented. */
 #define freertos_start_pdc_tx(dma_event_control, data, len, pdc_base_address, notification_semaphore) freertos_start_pdc_transfer(dma_event_control, data, len, pdc_base_address, notification_semaphore, true)
@@ -94,6 +120,13 @@ uint32_t freertos_copy_bytes_from_pdc_circular_buffer(
 		freertos_pdc_rx_control_t *p_rx_buffer_details,
 		uint32_t next_byte_to_be_written, uint8_t *buf,
 		uint32_t bytes_to_read);
+uint32_t freertos_get_pdc_circular_buffer_spans(
+		freertos_pdc_rx_control_t *p_rx_buffer_details,
+		uint32_t next_byte_to_be_written,
+		freertos_iovec_t spans[FREERTOS_RX_SPAN_COUNT]);
+uint32_t freertos_consume_pdc_circular_buffer(
+		freertos_pdc_rx_control_t *p_rx_buffer_details,
+		uint32_t next_byte_to_be_written, uint32_t bytes_to_consume);
 status_code_t freertos_obtain_peripheral_access_semphore(
 		freertos_dma_event_control_t *dma_event_control,
 		portTickType *max_block_time_ticks);
@@ -106,6 +139,24 @@ void create_peripheral_control_semaphores(const uint8_t options_flags,
 		freertos_dma_event_control_t *rx_dma_control);
 void configure_interrupt_controller(const enum IRQn peripheral_irq,
 		uint32_t interrupt_priority);
+void register_peripheral_control_object(xSemaphoreHandle object,
+		char name[PERIPHERAL_OBJECT_NAME_LEN], const char *peripheral_name,
+		portBASE_TYPE peripheral_index, const char *object_role);
+void register_peripheral_stats(freertos_peripheral_stats_t *stats,
+		char name[PERIPHERAL_OBJECT_NAME_LEN], const char *peripheral_name,
+		portBASE_TYPE peripheral_index);
+void freertos_copy_peripheral_stats(freertos_peripheral_stats_t *stats,
+		freertos_peripheral_stats_t *snapshot, bool reset);
+void freertos_record_transfer(freertos_peripheral_stats_t *stats,
+		bool is_transmitting, uint32_t bytes, portTickType entry_ticks);
+void freertos_record_rx_buffer_level(freertos_peripheral_stats_t *stats,
+		freertos_pdc_rx_control_t *p_rx_buffer_details,
+		uint32_t next_byte_to_be_written);
+#if defined(DMAC)
+void freertos_dmac_set_channel_handler(uint32_t channel,
+		freertos_dmac_channel_handler_t handler, void *parameter,
+		uint32_t interrupt_priority);
+#endif
 
 /// @cond 0
 /**INDENT-OFF**/
@@ -0,0 +1,826 @@
+/**
+ * \file
+ *
+ * \brief FreeRTOS Peripheral Control API For the SPI
+ *
+ * Copyright (c) 2012-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \asf_license_start
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip
+ * software and any derivatives exclusively with Microchip products.
+ * It is your responsibility to comply with third party license terms applicable
+ * to your use of third party software (including open source software) that
+ * may accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES,
+ * WHETHER EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE,
+ * INCLUDING ANY IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY,
+ * AND FITNESS FOR A PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE
+ * LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL
+ * LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND WHATSOEVER RELATED TO THE
+ * SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS BEEN ADVISED OF THE
+ * POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE FULLEST EXTENT
+ * ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN ANY WAY
+ * RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+ * THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * \asf_license_stop
+ *
+ */
+
+/* Standard includes. */
+/*
+ * Support and FAQ: visit <a href="https://www.microchip.com/support/">Microchip Support</a>
+ */
+#include <string.h>
+
+/* ASF includes. */
+#include "pmc.h"
+#include "freertos_spi_master.h"
+#include "freertos_peripheral_control_private.h"
+
+/* Every bit in the interrupt mask. */
+#define MASK_ALL_INTERRUPTS     (0xffffffffUL)
+
+/* The PCS value that selects no device. */
+#define SPI_NO_CHIP_SELECT      (0x0fUL)
+
+/* Sent while reading. */
+#define SPI_DUMMY_BYTE          (0xff)
+
+/* The most bytes moved by one DMAC buffer transfer.  Longer transfers are
+split into several buffer transfers by the interrupt handler. */
+#define MAX_DMAC_BUFFER_TRANSFER	(0xfffUL)
+
+/* The DMAC hardware handshaking interfaces of SPI0. */
+#define SPI0_DMAC_TX_INTERFACE	(1)
+#define SPI0_DMAC_RX_INTERFACE	(2)
+
+/* Only SPI0 has DMAC handshaking interfaces on the SAM3X. */
+#if defined(SPI0)
+	#define MAX_SPIS                                (1)
+#else
+	#error No SPI peripherals with DMAC support defined
+#endif
+
+/* The DMAC hardware handshaking interfaces of an SPI port. */
+typedef struct spi_dmac_interfaces {
+	uint8_t tx_interface;
+	uint8_t rx_interface;
+} spi_dmac_interfaces_t;
+
+/* Structure to manage a transfer in progress.  The SPI is full duplex, so
+every transfer moves bytes in both directions: a write discards the bytes
+received, and a read sends SPI_DUMMY_BYTE. */
+struct spi_transfer {
+	const uint8_t *tx_data;						/* The next byte to send, NULL when reading. */
+	uint8_t *rx_data;							/* Where to put the next byte received, NULL when writing. */
+	size_t bytes_remaining;						/* Bytes not yet given to the DMAC. */
+	volatile bool is_active;
+	freertos_dma_event_control_t *dma_control;	/* tx_dma_control or rx_dma_control, whichever holds the notification semaphore of the transfer. */
+};
+
+/* Everything the driver holds for one SPI port.  The freertos_spi_if handle
+returned by freertos_spi_master_init() points to the port's context, so the
+driver functions go straight from the handle to the port. */
+typedef struct freertos_spi_context {
+	const freertos_pdc_peripheral_parameters_t *peripheral;	/*< The port's entry in all_spi_definitions[], NULL until the port is initialised. */
+	portBASE_TYPE spi_index;								/*< The position of the port in all_spi_definitions[]. */
+	freertos_dma_event_control_t tx_dma_control;			/*< The access semaphore (shared by Tx and Rx) and the Tx completion semaphore. */
+	freertos_dma_event_control_t rx_dma_control;			/*< The Rx completion semaphore. */
+	xSemaphoreHandle device_mutex;							/*< Held from freertos_spi_select_device() to freertos_spi_deselect_device().  Optional. */
+	uint32_t selected_chip_select;							/*< The NPCS line of the selected device, FREERTOS_SPI_CHIP_SELECTS if none is selected. */
+	struct spi_transfer transfer;							/*< The transfer in progress. */
+	uint8_t tx_dummy;										/*< Sent by the DMAC while reading. */
+	uint8_t rx_dummy;										/*< Overwritten by the DMAC while writing. */
+	freertos_peripheral_stats_t stats;						/*< Read by freertos_spi_get_stats(). */
+	char access_sem_name[PERIPHERAL_OBJECT_NAME_LEN];		/*< Name under which the access semaphore is added to the queue registry, and the counters are listed. */
+	char device_mutex_name[PERIPHERAL_OBJECT_NAME_LEN];	/*< Name under which the device mutex is added to the queue registry. */
+} freertos_spi_context_t;
+
+/* Returns the context a handle points to, or NULL if it is not a valid
+handle. */
+static freertos_spi_context_t *get_spi_context(freertos_spi_if p_spi);
+
+/* Starts a read or write of the selected device, and optionally waits for it
+to complete. */
+static status_code_t transfer_packet(freertos_spi_context_t *context,
+		const uint8_t *tx_data, uint8_t *rx_data, size_t len,
+		portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore);
+
+/* Gives the DMAC the next part of the transfer in progress. */
+static void start_dmac_buffer_transfer(freertos_spi_context_t *context);
+
+/* Stops a transfer that did not complete in the time the task waited. */
+static void abort_transfer(freertos_spi_context_t *context);
+
+/* Called from the DMAC interrupt when the receive channel of a port has
+completed a buffer transfer. */
+static void spi_dmac_rx_handler(void *parameter, uint32_t channel_status,
+		portBASE_TYPE *higher_priority_task_woken);
+
+/* The driver context of each SPI, in the same order as all_spi_definitions[]. */
+static freertos_spi_context_t spi_contexts[MAX_SPIS];
+
+/* Create an array that holds the information required about each defined SPI
+peripheral.  The SPI has no PDC, so the PDC address is not used. */
+static const freertos_pdc_peripheral_parameters_t all_spi_definitions[MAX_SPIS] = {
+	{SPI0, NULL, ID_SPI0, SPI0_IRQn},
+};
+
+/* The DMAC handshaking interfaces of each SPI, in the same order as
+all_spi_definitions[]. */
+static const spi_dmac_interfaces_t all_spi_dmac_interfaces[MAX_SPIS] = {
+	{SPI0_DMAC_TX_INTERFACE, SPI0_DMAC_RX_INTERFACE},
+};
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ * \brief Initializes the FreeRTOS ASF SPI master driver for the specified SPI
+ * port.
+ *
+ * freertos_spi_master_init() is an ASF specific FreeRTOS driver function.  It
+ * must be called before any other ASF specific FreeRTOS driver functions
+ * attempt to access the same SPI port.
+ *
+ * If freertos_driver_parameters->operation_mode equals SPI_MASTER then
+ * freertos_spi_master_init() will configure the SPI port for master mode
+ * operation and enable the peripheral.  If
+ * freertos_driver_parameters->operation_mode equals any other value then
+ * freertos_spi_master_init() will not take any action.
+ *
+ * The SAM3X SPI has no peripheral DMA controller (PDC) channel, so the driver
+ * moves data with a pair of DMAC channels, FREERTOS_DMAC_SPI_TX_CHANNEL and
+ * FREERTOS_DMAC_SPI_RX_CHANNEL, using the SPI's hardware handshaking
+ * interfaces.  The FreeRTOS ASF driver both installs and handles the DMAC
+ * interrupts.  Users do not need to concern themselves with interrupt
+ * handling, and must not install their own interrupt handler.
+ *
+ * \param p_spi    The SPI peripheral being initialized.
+ * \param freertos_driver_parameters    Defines the driver behavior.  See the
+ *    freertos_peripheral_options_t documentation, and the application note that
+ *    accompanies the ASF specific FreeRTOS functions.  If options_flags has
+ *    USE_TX_ACCESS_SEM set, freertos_spi_select_device() gives the calling task
+ *    exclusive use of the bus until it deselects the device.
+ *
+ * \return If the initialization completes successfully then a handle that can
+ *     be used with FreeRTOS SPI read and write functions is returned.  If
+ *     the initialisation fails then NULL is returned.
+ */
+freertos_spi_if freertos_spi_master_init(Spi *p_spi,
+		const freertos_peripheral_options_t *const freertos_driver_parameters)
+{
+	portBASE_TYPE spi_index;
+	freertos_spi_context_t *context;
+	bool is_valid_operating_mode;
+	freertos_spi_if return_value;
+	Spi *spi_base;
+	const enum peripheral_operation_mode valid_operating_modes[] = {SPI_MASTER};
+
+	/* Find the index into the all_spi_definitions array that holds details of
+	the p_spi peripheral. */
+	spi_index = get_pdc_peripheral_details(all_spi_definitions, MAX_SPIS,
+			(void *) p_spi);
+
+	/* Check the requested operating mode is valid for the peripheral. */
+	is_valid_operating_mode = check_requested_operating_mode(
+			freertos_driver_parameters->operation_mode,
+			valid_operating_modes,
+			sizeof(valid_operating_modes) /
+			sizeof(enum peripheral_operation_mode));
+
+	/* Don't do anything unless a valid p_spi pointer was used, and a valid
+	operating mode was requested. */
+	if ((spi_index < MAX_SPIS) && (is_valid_operating_mode == true)) {
+		context = &(spi_contexts[spi_index]);
+
+		/* This function must be called exactly once per supported spi.  Check
+		it has not been called before. */
+		configASSERT(context->peripheral == NULL);
+		context->peripheral = &(all_spi_definitions[spi_index]);
+		context->spi_index = spi_index;
+		context->selected_chip_select = FREERTOS_SPI_CHIP_SELECTS;
+		context->tx_dummy = SPI_DUMMY_BYTE;
+		spi_base = (Spi *) context->peripheral->peripheral_base_address;
+
+		/* Enable the peripheral's clock. */
+		pmc_enable_periph_clk(context->peripheral->peripheral_id);
+
+		/* Ensure everything is disabled before configuration. */
+		spi_base->SPI_IDR = MASK_ALL_INTERRUPTS;
+		spi_base->SPI_CR = SPI_CR_SPIDIS;
+		spi_base->SPI_CR = SPI_CR_SWRST;
+
+		switch (freertos_driver_parameters->operation_mode) {
+		case SPI_MASTER:
+			/* Fixed peripheral select, so the selected device stays selected
+			for every byte the DMAC writes.  Mode fault detection is disabled
+			as there is no other master. */
+			spi_base->SPI_MR = SPI_MR_MSTR | SPI_MR_MODFDIS |
+					SPI_MR_PCS(SPI_NO_CHIP_SELECT);
+			spi_base->SPI_CR = SPI_CR_SPIEN;
+			break;
+
+		default:
+			/* No other modes are currently supported. */
+			break;
+		}
+
+		/* Create any required peripheral access mutexes and transaction complete
+		semaphores.  A transfer always uses both directions, so only a single
+		access mutex is required. */
+		create_peripheral_control_semaphores(
+				freertos_driver_parameters->options_flags,
+				&(context->tx_dma_control),
+				&(context->rx_dma_control));
+
+		/* A thread aware driver also gives a task sole use of the bus while it
+		has a device selected.  A mutex is used so a low priority task that
+		has a device selected inherits the priority of a task waiting for the
+		bus. */
+		if ((freertos_driver_parameters->options_flags & USE_TX_ACCESS_SEM) != 0) {
+			context->device_mutex = xSemaphoreCreateMutex();
+			configASSERT(context->device_mutex);
+		}
+
+		register_peripheral_control_object(
+				context->tx_dma_control.peripheral_access_sem,
+				context->access_sem_name, "SPI", spi_index, "");
+		register_peripheral_control_object(context->device_mutex,
+				context->device_mutex_name, "SPI", spi_index, "CS");
+		register_peripheral_stats(&(context->stats), context->access_sem_name,
+				"SPI", spi_index);
+
+		/* The end of each transfer is signalled by the receive channel, as
+		the last byte has been shifted out once it has been received. */
+		freertos_dmac_set_channel_handler(FREERTOS_DMAC_SPI_RX_CHANNEL,
+				spi_dmac_rx_handler, context,
+				freertos_driver_parameters->interrupt_priority);
+
+		return_value = (freertos_spi_if) context;
+	} else {
+		return_value = NULL;
+	}
+
+	return return_value;
+}
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ * \brief Set the clock, mode and timing used for a device on the SPI bus.
+ *
+ * The settings are held by the SPI for the device's chip select line, so this
+ * is normally called once for each device, after freertos_spi_master_init().
+ * The chip select is kept asserted between bytes and between transfers until
+ * the device is deselected.
+ *
+ * \param p_spi    The handle to the SPI port returned by the
+ *     freertos_spi_master_init() call used to initialise the port.
+ * \param device    The device's chip select line and settings.  The SPCK
+ *     frequency used is the fastest the peripheral clock can be divided down
+ *     to without exceeding device->baud_rate.
+ *
+ * \return     ERR_INVALID_ARG if a parameter is invalid, otherwise STATUS_OK.
+ */
+status_code_t freertos_spi_master_setup_device(freertos_spi_if p_spi,
+		const freertos_spi_device_t *device)
+{
+	freertos_spi_context_t *context;
+	Spi *spi_base;
+	uint32_t divider, chip_select_settings;
+
+	context = get_spi_context(p_spi);
+
+	if ((context == NULL) || (device == NULL) ||
+			(device->chip_select >= FREERTOS_SPI_CHIP_SELECTS) ||
+			(device->baud_rate == 0) || (device->spi_mode > 3)) {
+		return ERR_INVALID_ARG;
+	}
+
+	spi_base = (Spi *) context->peripheral->peripheral_base_address;
+
+	/* Round the divider up, so the device is never clocked too fast. */
+	divider = (sysclk_get_peripheral_hz() + device->baud_rate - 1) /
+			device->baud_rate;
+	if (divider == 0) {
+		divider = 1;
+	} else if (divider > 255) {
+		divider = 255;
+	}
+
+	chip_select_settings = SPI_CSR_SCBR(divider) | SPI_CSR_BITS_8_BIT |
+			SPI_CSR_CSAAT | SPI_CSR_DLYBS(device->delay_before_spck) |
+			SPI_CSR_DLYBCT(device->delay_between_bytes);
+
+	/* The SPI has a clock phase bit that is the inverse of CPHA. */
+	if ((device->spi_mode & 0x02) != 0) {
+		chip_select_settings |= SPI_CSR_CPOL;
+	}
+	if ((device->spi_mode & 0x01) == 0) {
+		chip_select_settings |= SPI_CSR_NCPHA;
+	}
+
+	spi_base->SPI_CSR[device->chip_select] = chip_select_settings;
+
+	return STATUS_OK;
+}
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ * \brief Select a device, so the following reads and writes are made to it as
+ * one transaction.
+ *
+ * The device's chip select line is asserted by the first byte transferred,
+ * and stays asserted until freertos_spi_deselect_device() is called, so a
+ * command and its response can be split across any number of reads and
+ * writes.
+ *
+ * If the port was initialized with USE_TX_ACCESS_SEM set, the calling task
+ * has sole use of the bus until it deselects the device, and other tasks
+ * calling this function wait.
+ *
+ * \param p_spi    The handle to the SPI port returned by the
+ *     freertos_spi_master_init() call used to initialise the port.
+ * \param chip_select    The chip select line of a device set up with
+ *     freertos_spi_master_setup_device().
+ * \param block_time_ticks    The maximum time to wait for another task to
+ *     deselect its device.
+ *
+ * \return     ERR_INVALID_ARG is returned if an input parameter is invalid.
+ *     ERR_TIMEOUT is returned if block_time_ticks passed before the bus could
+ *     be obtained.  STATUS_OK is returned if the device is selected.
+ */
+status_code_t freertos_spi_select_device(freertos_spi_if p_spi,
+		uint32_t chip_select, portTickType block_time_ticks)
+{
+	freertos_spi_context_t *context;
+	Spi *spi_base;
+
+	context = get_spi_context(p_spi);
+
+	if ((context == NULL) || (chip_select >= FREERTOS_SPI_CHIP_SELECTS)) {
+		return ERR_INVALID_ARG;
+	}
+
+	if (context->device_mutex != NULL) {
+		if (xSemaphoreTake(context->device_mutex, block_time_ticks) != pdPASS) {
+			return ERR_TIMEOUT;
+		}
+	}
+
+	/* The previous device was deselected only once its last transfer had
+	completed, so the bus is idle. */
+	spi_base = (Spi *) context->peripheral->peripheral_base_address;
+	spi_base->SPI_MR = (spi_base->SPI_MR & ~SPI_MR_PCS_Msk) |
+			SPI_MR_PCS(~(1UL << chip_select) & SPI_NO_CHIP_SELECT);
+	context->selected_chip_select = chip_select;
+
+	return STATUS_OK;
+}
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ * \brief End the transaction with the selected device, and release the bus.
+ *
+ * If an asynchronous transfer is still in progress this waits for it to
+ * complete before the chip select line is deasserted.  That wait relies on the
+ * access semaphore, so a port initialized without USE_TX_ACCESS_SEM must not
+ * deselect a device until its last transfer has completed.
+ *
+ * \param p_spi    The handle to the SPI port returned by the
+ *     freertos_spi_master_init() call used to initialise the port.
+ * \param block_time_ticks    The maximum time to wait for a transfer in
+ *     progress to complete.
+ *
+ * \return     ERR_INVALID_ARG is returned if an input parameter is invalid or
+ *     no device is selected.  ERR_TIMEOUT is returned if the transfer in
+ *     progress did not complete within block_time_ticks, in which case the
+ *     device stays selected.  STATUS_OK is returned if the device has been
+ *     deselected.
+ */
+status_code_t freertos_spi_deselect_device(freertos_spi_if p_spi,
+		portTickType block_time_ticks)
+{
+	freertos_spi_context_t *context;
+	status_code_t return_value;
+	Spi *spi_base;
+
+	context = get_spi_context(p_spi);
+
+	if ((context == NULL) ||
+			(context->selected_chip_select >= FREERTOS_SPI_CHIP_SELECTS)) {
+		return ERR_INVALID_ARG;
+	}
+
+	/* Wait for the last transfer to the device to complete. */
+	return_value = freertos_obtain_peripheral_access_semphore(
+			&(context->tx_dma_control), &block_time_ticks);
+
+	if (return_value == STATUS_OK) {
+		spi_base = (Spi *) context->peripheral->peripheral_base_address;
+
+		/* The last byte has been received, so is out of the shift register
+		within a bit time. */
+		while ((spi_base->SPI_SR & SPI_SR_TXEMPTY) == 0) {
+		}
+
+		/* Select no device, then end the transfer so the chip select that was
+		kept asserted is released. */
+		spi_base->SPI_MR = (spi_base->SPI_MR & ~SPI_MR_PCS_Msk) |
+				SPI_MR_PCS(SPI_NO_CHIP_SELECT);
+		spi_base->SPI_CR = SPI_CR_LASTXFER;
+		context->selected_chip_select = FREERTOS_SPI_CHIP_SELECTS;
+
+		if (context->tx_dma_control.peripheral_access_sem != NULL) {
+			xSemaphoreGive(context->tx_dma_control.peripheral_access_sem);
+		}
+
+		if (context->device_mutex != NULL) {
+			xSemaphoreGive(context->device_mutex);
+		}
+	}
+
+	return return_value;
+}
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ * \brief Initiate a completely asynchronous multi-byte write to the selected
+ * SPI device.
+ *
+ * freertos_spi_write_packet_async() is an ASF specific FreeRTOS driver function.
+ * It configures the DMAC to transmit data on the SPI port, then returns.
+ * freertos_spi_write_packet_async() does not wait for the transmission to
+ * complete before returning.  The bytes received while writing are discarded.
+ *
+ * freertos_spi_write_packet_async() can only be used if the
+ * freertos_driver_parameters.options_flags parameter passed to the
+ * initialization function had the WAIT_TX_COMPLETE bit clear.
+ * freertos_spi_write_packet() is a version that does not exit until the
+ * transfer is complete, but still allows other RTOS tasks to execute while the
+ * transmission is in progress.
+ *
+ * \param p_spi    The handle to the SPI port returned by the
+ *     freertos_spi_master_init() call used to initialise the port.
+ * \param data    The data to write.  The data must not be modified until the
+ *     transfer has completed.
+ * \param len    The number of bytes to write.
+ * \param block_time_ticks    If the port was initialized with
+ *     USE_TX_ACCESS_SEM set, the driver waits up to block_time_ticks for the
+ *     previous transfer to complete before starting this one.  Other tasks will
+ *     execute during any waiting time.
+ * \param notification_semaphore    Given from the DMAC interrupt when the
+ *     transfer completes, so the calling task can block on it until the data
+ *     has been sent.  The semaphore must be created using the FreeRTOS
+ *     vSemaphoreCreateBinary() API function before it is used as a parameter.
+ *
+ * \return     ERR_INVALID_ARG is returned if an input parameter is invalid or
+ *     no device is selected.  ERR_TIMEOUT is returned if block_time_ticks
+ *     passed before the previous transfer completed.  STATUS_OK is returned
+ *     if the DMAC was successfully configured to perform the write.
+ */
+status_code_t freertos_spi_write_packet_async(freertos_spi_if p_spi,
+		const uint8_t *data, size_t len, portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore)
+{
+	freertos_spi_context_t *context;
+	status_code_t return_value = ERR_INVALID_ARG;
+
+	context = get_spi_context(p_spi);
+
+	if ((context != NULL) && (data != NULL)) {
+		return_value = transfer_packet(context, data, NULL, len,
+				block_time_ticks, notification_semaphore);
+	}
+
+	return return_value;
+}
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ * \brief Initiate a completely asynchronous multi-byte read from the selected
+ * SPI device.
+ *
+ * freertos_spi_read_packet_async() is an ASF specific FreeRTOS driver function.
+ * It configures the DMAC to clock data in from the SPI port, sending 0xff,
+ * then returns.  freertos_spi_read_packet_async() does not wait for the
+ * reception to complete before returning.
+ *
+ * freertos_spi_read_packet_async() can only be used if the
+ * freertos_driver_parameters.options_flags parameter passed to the
+ * initialization function had the WAIT_RX_COMPLETE bit clear.
+ * freertos_spi_read_packet() is a version that does not exit until the
+ * transfer is complete, but still allows other RTOS tasks to execute while the
+ * reception is in progress.
+ *
+ * \param p_spi    The handle to the SPI port returned by the
+ *     freertos_spi_master_init() call used to initialise the port.
+ * \param data    Where to put the data read.
+ * \param len    The number of bytes to read.
+ * \param block_time_ticks    If the port was initialized with
+ *     USE_TX_ACCESS_SEM set, the driver waits up to block_time_ticks for the
+ *     previous transfer to complete before starting this one.  Other tasks will
+ *     execute during any waiting time.
+ * \param notification_semaphore    Given from the DMAC interrupt when the
+ *     transfer completes, so the calling task can block on it until the data
+ *     has been received.  The semaphore must be created using the FreeRTOS
+ *     vSemaphoreCreateBinary() API function before it is used as a parameter.
+ *
+ * \return     ERR_INVALID_ARG is returned if an input parameter is invalid or
+ *     no device is selected.  ERR_TIMEOUT is returned if block_time_ticks
+ *     passed before the previous transfer completed.  STATUS_OK is returned
+ *     if the DMAC was successfully configured to perform the read.
+ */
+status_code_t freertos_spi_read_packet_async(freertos_spi_if p_spi,
+		uint8_t *data, size_t len, portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore)
+{
+	freertos_spi_context_t *context;
+	status_code_t return_value = ERR_INVALID_ARG;
+
+	context = get_spi_context(p_spi);
+
+	if ((context != NULL) && (data != NULL)) {
+		return_value = transfer_packet(context, NULL, data, len,
+				block_time_ticks, notification_semaphore);
+	}
+
+	return return_value;
+}
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ * \brief Read the counters the driver keeps for an SPI port.
+ *
+ * The driver counts the bytes and transfers in each direction, transfers
+ * abandoned because they did not complete within the caller's block time, and
+ * the time tasks have spent in the read and write functions.  The snapshot is
+ * taken in a critical section, so the counters are consistent with each other.
+ *
+ * \param p_spi    The handle to the SPI port returned by the
+ *     freertos_spi_master_init() call used to initialise the port.
+ * \param stats    Filled in with a copy of the counters.
+ * \param reset    If true the counters are cleared once they have been copied.
+ *
+ * \return     ERR_INVALID_ARG if a parameter is invalid, otherwise STATUS_OK.
+ */
+status_code_t freertos_spi_get_stats(freertos_spi_if p_spi,
+		freertos_peripheral_stats_t *stats, bool reset)
+{
+	freertos_spi_context_t *context;
+	status_code_t return_value = ERR_INVALID_ARG;
+
+	context = get_spi_context(p_spi);
+
+	if ((context != NULL) && (stats != NULL)) {
+		freertos_copy_peripheral_stats(&(context->stats), stats, reset);
+		return_value = STATUS_OK;
+	}
+
+	return return_value;
+}
+
+/*
+ * For internal use only.
+ * Returns the driver context that a freertos_spi_if handle points to, or NULL
+ * if the handle is not one returned by freertos_spi_master_init().
+ */
+static freertos_spi_context_t *get_spi_context(freertos_spi_if p_spi)
+{
+	freertos_spi_context_t *context = (freertos_spi_context_t *) p_spi;
+
+	if ((context < &(spi_contexts[0])) ||
+			(context >= &(spi_contexts[MAX_SPIS])) ||
+			(context->peripheral == NULL)) {
+		context = NULL;
+	}
+
+	return context;
+}
+
+/*
+ * For internal use only.
+ * Shared by the read and write functions.  Exactly one of tx_data and rx_data
+ * is NULL.  The access semaphore is taken here and given back by the interrupt
+ * handler once the transfer has completed, so a transfer started while an
+ * asynchronous one is in progress waits for it.
+ */
+static status_code_t transfer_packet(freertos_spi_context_t *context,
+		const uint8_t *tx_data, uint8_t *rx_data, size_t len,
+		portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore)
+{
+	status_code_t return_value;
+	freertos_dma_event_control_t *dma_control;
+	Spi *spi_base = (Spi *) context->peripheral->peripheral_base_address;
+	bool is_transmitting = (tx_data != NULL);
+	portTickType entry_ticks = xTaskGetTickCount();
+	uint32_t bytes_transferred = 0;
+
+	if ((len == 0) ||
+			(context->selected_chip_select >= FREERTOS_SPI_CHIP_SELECTS)) {
+		return ERR_INVALID_ARG;
+	}
+
+	dma_control = (is_transmitting == true) ?
+			&(context->tx_dma_control) : &(context->rx_dma_control);
+
+	return_value = freertos_obtain_peripheral_access_semphore(
+			&(context->tx_dma_control), &block_time_ticks);
+
+	if (return_value == STATUS_OK) {
+		/* Remember which semaphore is to be given at the end of the transfer,
+		as freertos_start_pdc_transfer() does for the PDC drivers, and ensure
+		it starts in the expected state. */
+		if (notification_semaphore != NULL) {
+			dma_control->transaction_complete_notification_semaphore =
+					notification_semaphore;
+		}
+
+		if (dma_control->transaction_complete_notification_semaphore != NULL) {
+			xSemaphoreTake(
+					dma_control->transaction_complete_notification_semaphore,
+					0);
+		}
+
+		context->transfer.tx_data = tx_data;
+		context->transfer.rx_data = rx_data;
+		context->transfer.bytes_remaining = len;
+		context->transfer.dma_control = dma_control;
+		context->transfer.is_active = true;
+
+		/* Discard anything left in the receive register, and clear an
+		overrun flagged by it. */
+		(void) spi_base->SPI_RDR;
+		(void) spi_base->SPI_SR;
+
+		/* Start the channels and catch the end of the transfer, so the access
+		semaphore can be returned and the task notified.  Done in a critical
+		section, as the DMAC interrupt of another channel would otherwise
+		clear the completion flag of a short transfer before its interrupt is
+		enabled.  A flag left by an aborted transfer is ignored by the handler
+		while the receive channel is still running. */
+		taskENTER_CRITICAL();
+		{
+			start_dmac_buffer_transfer(context);
+			DMAC->DMAC_EBCIER = DMAC_EBCIER_BTC0 << FREERTOS_DMAC_SPI_RX_CHANNEL;
+		}
+		taskEXIT_CRITICAL();
+		bytes_transferred = len;
+
+		return_value = freertos_optionally_wait_transfer_completion(
+				dma_control, notification_semaphore, block_time_ticks);
+
+		if (return_value == ERR_TIMEOUT) {
+			abort_transfer(context);
+			bytes_transferred = 0;
+		}
+	}
+
+	freertos_record_transfer(&(context->stats), is_transmitting,
+			bytes_transferred, entry_ticks);
+
+	return return_value;
+}
+
+/*
+ * For internal use only.
+ * Called by a task starting a transfer, or by the DMAC interrupt once the
+ * previous part of the transfer has been received, to program both channels
+ * with the next MAX_DMAC_BUFFER_TRANSFER bytes or fewer.  Both channels have
+ * finished, so can be reprogrammed.
+ */
+static void start_dmac_buffer_transfer(freertos_spi_context_t *context)
+{
+	struct spi_transfer *transfer = &(context->transfer);
+	const spi_dmac_interfaces_t *interfaces =
+			&(all_spi_dmac_interfaces[context->spi_index]);
+	Spi *spi_base = (Spi *) context->peripheral->peripheral_base_address;
+	DmacCh_num *tx_channel = &(DMAC->DMAC_CH_NUM[FREERTOS_DMAC_SPI_TX_CHANNEL]);
+	DmacCh_num *rx_channel = &(DMAC->DMAC_CH_NUM[FREERTOS_DMAC_SPI_RX_CHANNEL]);
+	uint32_t len;
+
+	len = (transfer->bytes_remaining > MAX_DMAC_BUFFER_TRANSFER) ?
+			MAX_DMAC_BUFFER_TRANSFER : transfer->bytes_remaining;
+
+	/* Receive into the buffer, or into rx_dummy when writing. */
+	rx_channel->DMAC_SADDR = (uint32_t) &(spi_base->SPI_RDR);
+	rx_channel->DMAC_DADDR = (transfer->rx_data != NULL) ?
+			(uint32_t) transfer->rx_data : (uint32_t) &(context->rx_dummy);
+	rx_channel->DMAC_DSCR = 0;
+	rx_channel->DMAC_CTRLA = DMAC_CTRLA_BTSIZE(len) |
+			DMAC_CTRLA_SRC_WIDTH_BYTE | DMAC_CTRLA_DST_WIDTH_BYTE;
+	rx_channel->DMAC_CTRLB = DMAC_CTRLB_SRC_DSCR_FETCH_DISABLE |
+			DMAC_CTRLB_DST_DSCR_FETCH_DISABLE | DMAC_CTRLB_FC_PER2MEM_DMA_FC |
+			DMAC_CTRLB_SRC_INCR_FIXED |
+			((transfer->rx_data != NULL) ?
+			DMAC_CTRLB_DST_INCR_INCREMENTING : DMAC_CTRLB_DST_INCR_FIXED);
+	rx_channel->DMAC_CFG = DMAC_CFG_SRC_PER(interfaces->rx_interface) |
+			DMAC_CFG_SRC_H2SEL_HW | DMAC_CFG_SOD_ENABLE |
+			DMAC_CFG_FIFOCFG_ASAP_CFG;
+
+	/* Send from the buffer, or tx_dummy repeatedly when reading. */
+	tx_channel->DMAC_SADDR = (transfer->tx_data != NULL) ?
+			(uint32_t) transfer->tx_data : (uint32_t) &(context->tx_dummy);
+	tx_channel->DMAC_DADDR = (uint32_t) &(spi_base->SPI_TDR);
+	tx_channel->DMAC_DSCR = 0;
+	tx_channel->DMAC_CTRLA = DMAC_CTRLA_BTSIZE(len) |
+			DMAC_CTRLA_SRC_WIDTH_BYTE | DMAC_CTRLA_DST_WIDTH_BYTE;
+	tx_channel->DMAC_CTRLB = DMAC_CTRLB_SRC_DSCR_FETCH_DISABLE |
+			DMAC_CTRLB_DST_DSCR_FETCH_DISABLE | DMAC_CTRLB_FC_MEM2PER_DMA_FC |
+			((transfer->tx_data != NULL) ?
+			DMAC_CTRLB_SRC_INCR_INCREMENTING : DMAC_CTRLB_SRC_INCR_FIXED) |
+			DMAC_CTRLB_DST_INCR_FIXED;
+	tx_channel->DMAC_CFG = DMAC_CFG_DST_PER(interfaces->tx_interface) |
+			DMAC_CFG_DST_H2SEL_HW | DMAC_CFG_SOD_ENABLE |
+			DMAC_CFG_FIFOCFG_ALAP_CFG;
+
+	if (transfer->tx_data != NULL) {
+		transfer->tx_data += len;
+	}
+	if (transfer->rx_data != NULL) {
+		transfer->rx_data += len;
+	}
+	transfer->bytes_remaining -= len;
+
+	/* The receive channel is enabled first, so it is ready for the first byte
+	the transmit channel sends. */
+	DMAC->DMAC_CHER = DMAC_CHER_ENA0 << FREERTOS_DMAC_SPI_RX_CHANNEL;
+	DMAC->DMAC_CHER = DMAC_CHER_ENA0 << FREERTOS_DMAC_SPI_TX_CHANNEL;
+}
+
+/*
+ * For internal use only.
+ * Called by a task whose wait for a transfer timed out, which only happens if
+ * the block time is shorter than the transfer.  If the transfer did complete
+ * after the wait timed out nothing is done.
+ */
+static void abort_transfer(freertos_spi_context_t *context)
+{
+	taskENTER_CRITICAL();
+	{
+		if (context->transfer.is_active == true) {
+			DMAC->DMAC_EBCIDR = DMAC_EBCIDR_BTC0 << FREERTOS_DMAC_SPI_RX_CHANNEL;
+			DMAC->DMAC_CHDR = (DMAC_CHDR_DIS0 << FREERTOS_DMAC_SPI_TX_CHANNEL) |
+					(DMAC_CHDR_DIS0 << FREERTOS_DMAC_SPI_RX_CHANNEL);
+			context->transfer.is_active = false;
+			context->stats.timeout_errors++;
+
+			if (context->tx_dma_control.peripheral_access_sem != NULL) {
+				xSemaphoreGive(context->tx_dma_control.peripheral_access_sem);
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+
+/*
+ * For internal use only.
+ * Called from the DMAC interrupt when the receive channel of a port has
+ * completed a buffer transfer.  The next part of a long transfer is started
+ * straight away.  Once the whole transfer has completed, the access semaphore
+ * is returned and the task notified.
+ */
+static void spi_dmac_rx_handler(void *parameter, uint32_t channel_status,
+		portBASE_TYPE *higher_priority_task_woken)
+{
+	freertos_spi_context_t *context = (freertos_spi_context_t *) parameter;
+	xSemaphoreHandle notification_semaphore;
+
+	/* A completion flag left by an aborted transfer can be seen while the
+	receive channel of the next one is still running. */
+	if (((channel_status & DMAC_EBCISR_BTC0) == 0) ||
+			(context->transfer.is_active == false) ||
+			((DMAC->DMAC_CHSR &
+			(DMAC_CHSR_ENA0 << FREERTOS_DMAC_SPI_RX_CHANNEL)) != 0)) {
+		return;
+	}
+
+	if (context->transfer.bytes_remaining > 0) {
+		start_dmac_buffer_transfer(context);
+	} else {
+		DMAC->DMAC_EBCIDR = DMAC_EBCIDR_BTC0 << FREERTOS_DMAC_SPI_RX_CHANNEL;
+		context->transfer.is_active = false;
+
+		/* If the driver is supporting multi-threading, then return the access
+		semaphore. */
+		if (context->tx_dma_control.peripheral_access_sem != NULL) {
+			xSemaphoreGiveFromISR(context->tx_dma_control.peripheral_access_sem,
+					higher_priority_task_woken);
+		}
+
+		/* If the task supplied a notification semaphore, or is waiting for
+		the transfer to complete, then notify it. */
+		notification_semaphore = context->transfer.dma_control->
+				transaction_complete_notification_semaphore;
+
+		if (notification_semaphore != NULL) {
+			xSemaphoreGiveFromISR(notification_semaphore,
+					higher_priority_task_woken);
+		}
+	}
+}
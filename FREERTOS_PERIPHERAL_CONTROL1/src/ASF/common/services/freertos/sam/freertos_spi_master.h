@@ -0,0 +1,237 @@
+/**
+ * \file
+ *
+ * \brief FreeRTOS Peripheral Control API For the SPI
+ *
+ * Copyright (c) 2012-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \asf_license_start
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip
+ * software and any derivatives exclusively with Microchip products.
+ * It is your responsibility to comply with third party license terms applicable
+ * to your use of third party software (including open source software) that
+ * may accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES,
+ * WHETHER EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE,
+ * INCLUDING ANY IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY,
+ * AND FITNESS FOR A PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE
+ * LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL
+ * LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND WHATSOEVER RELATED TO THE
+ * SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS BEEN ADVISED OF THE
+ * POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE FULLEST EXTENT
+ * ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN ANY WAY
+ * RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+ * THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * \asf_license_stop
+ *
+ */
+/*
+ * Support and FAQ: visit <a href="https://www.microchip.com/support/">Microchip Support</a>
+ */
+
+#ifndef FREERTOS_SPI_MASTER_INCLUDED
+#define FREERTOS_SPI_MASTER_INCLUDED
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* ASF includes. */
+#include "sysclk.h"
+#include "freertos_peripheral_control.h"
+
+/// @cond 0
+/**INDENT-OFF**/
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**INDENT-ON**/
+/// @endcond
+
+#if SAM3XA
+	/* The SAM3X SPI is served by the DMAC. */
+#else
+# error Unsupported chip type
+#endif
+
+/**
+ * \defgroup freertos_spi_peripheral_control_group FreeRTOS SPI peripheral
+ * control
+ * \brief FreeRTOS peripheral control functions for the SPI peripheral
+ * \ingroup freertos_service_group
+ */
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ * \brief The number of chip select (NPCS) lines of an SPI port.
+ */
+#define FREERTOS_SPI_CHIP_SELECTS		4
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ *     ypedef freertos_spi_if
+ * \brief Type returned from a call to freertos_spi_master_init(), and then used
+ * to reference an SPI port in calls to FreeRTOS peripheral control functions.
+ * It points to the driver's context for the port and is not the base address
+ * of the SPI.
+ */
+typedef void *freertos_spi_if;
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ *     ypedef freertos_spi_device_t
+ * \brief The settings of one device on an SPI bus, passed to
+ * freertos_spi_master_setup_device().  The settings are held by the SPI in the
+ * chip select register of the device's NPCS line, so they apply whenever the
+ * device is selected without being set again.
+ */
+typedef struct freertos_spi_device {
+	uint32_t chip_select;					/*< The NPCS line the device is on, 0 to FREERTOS_SPI_CHIP_SELECTS - 1. */
+	uint32_t baud_rate;						/*< The fastest SPCK frequency the device supports, in Hz. */
+	uint8_t spi_mode;						/*< The clock polarity (bit 1) and phase (bit 0), as SPI mode 0 to 3. */
+	uint8_t delay_before_spck;				/*< Peripheral clock cycles from NPCS falling to the first clock edge, 0 for half an SPCK period. */
+	uint8_t delay_between_bytes;			/*< Multiples of 32 peripheral clock cycles between bytes. */
+} freertos_spi_device_t;
+
+freertos_spi_if freertos_spi_master_init(Spi *p_spi,
+		const freertos_peripheral_options_t *const freertos_driver_parameters);
+
+status_code_t freertos_spi_master_setup_device(freertos_spi_if p_spi,
+		const freertos_spi_device_t *device);
+
+status_code_t freertos_spi_select_device(freertos_spi_if p_spi,
+		uint32_t chip_select, portTickType block_time_ticks);
+
+status_code_t freertos_spi_deselect_device(freertos_spi_if p_spi,
+		portTickType block_time_ticks);
+
+status_code_t freertos_spi_write_packet_async(freertos_spi_if p_spi,
+		const uint8_t *data, size_t len, portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore);
+
+status_code_t freertos_spi_read_packet_async(freertos_spi_if p_spi,
+		uint8_t *data, size_t len, portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore);
+
+status_code_t freertos_spi_get_stats(freertos_spi_if p_spi,
+		freertos_peripheral_stats_t *stats, bool reset);
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ * \brief Write a block of data to the selected SPI device, and wait for it to
+ * be sent.
+ *
+ * freertos_spi_write_packet() is the blocking version of
+ * freertos_spi_write_packet_async().  It can only be used if the
+ * freertos_driver_parameters.options_flags parameter passed to the
+ * initialization function had the WAIT_TX_COMPLETE bit set.  Other RTOS tasks
+ * execute while the transmission is in progress.
+ *
+ * \param p_spi    The handle to the SPI port returned by the
+ *     freertos_spi_master_init() call used to initialise the port.
+ * \param data    The data to write.
+ * \param len    The number of bytes to write.
+ * \param block_time_ticks    The maximum time to wait for the port, and then
+ *     for the transfer to complete, in RTOS ticks.
+ *
+ * \return     ERR_INVALID_ARG is returned if an input parameter is invalid or
+ *     no device is selected.  ERR_TIMEOUT is returned if block_time_ticks
+ *     passed before the transfer could start or complete.  STATUS_OK is
+ *     returned if the data was written.
+ */
+#define freertos_spi_write_packet(p_spi, data, len, block_time_ticks) freertos_spi_write_packet_async((p_spi), (data), (len), (block_time_ticks), (NULL))
+
+/**
+ * \ingroup freertos_spi_peripheral_control_group
+ * \brief Read a block of data from the selected SPI device, and wait for it to
+ * be received.
+ *
+ * freertos_spi_read_packet() is the blocking version of
+ * freertos_spi_read_packet_async().  It can only be used if the
+ * freertos_driver_parameters.options_flags parameter passed to the
+ * initialization function had the WAIT_RX_COMPLETE bit set.  Other RTOS tasks
+ * execute while the reception is in progress.
+ *
+ * \param p_spi    The handle to the SPI port returned by the
+ *     freertos_spi_master_init() call used to initialise the port.
+ * \param data    Where to put the data read.
+ * \param len    The number of bytes to read.
+ * \param block_time_ticks    The maximum time to wait for the port, and then
+ *     for the transfer to complete, in RTOS ticks.
+ *
+ * \return     ERR_INVALID_ARG is returned if an input parameter is invalid or
+ *     no device is selected.  ERR_TIMEOUT is returned if block_time_ticks
+ *     passed before the transfer could start or complete.  STATUS_OK is
+ *     returned if the data was read.
+ */
+#define freertos_spi_read_packet(p_spi, data, len, block_time_ticks) freertos_spi_read_packet_async((p_spi), (data), (len), (block_time_ticks), (NULL))
+
+/**
+ * \page freertos_spi_peripheral_control_quick_start Quick start guide for
+ * FreeRTOS SPI peripheral control functions
+ *
+ * This is the quick start guide for the
+ * \ref freertos_spi_peripheral_control_group, with
+ * step-by-step instructions on how to configure and use the service.
+ *
+ * The port is initialised once with freertos_spi_master_init(), then each
+ * device on the bus is described to the driver with
+ * freertos_spi_master_setup_device().
+ *
+ * A device is spoken to between a call to freertos_spi_select_device() and a
+ * call to freertos_spi_deselect_device().  Its chip select stays asserted for
+ * the whole of that time, however many reads and writes are made, so a
+ * command can be written and its response read as one bus transaction.  If
+ * the port was initialised with USE_TX_ACCESS_SEM set, selecting a device also
+ * gives the calling task exclusive use of the bus until it deselects it.
+ *
+ * As with the other FreeRTOS peripheral control drivers, the port is
+ * initialised either for standard mode, where freertos_spi_write_packet() and
+ * freertos_spi_read_packet() wait for the transfer to complete, or for fully
+ * asynchronous mode, where freertos_spi_write_packet_async() and
+ * freertos_spi_read_packet_async() return as soon as the transfer has started
+ * and give a notification semaphore when it completes.
+ *
+ * \code
+
+	 // Initialise SPI0 for standard mode, shared by several tasks.
+	 const freertos_peripheral_options_t driver_options = {
+	     NULL,                                          // No receive buffer.
+	     0,
+	     configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,  // DMAC interrupt priority.
+	     SPI_MASTER,
+	     (USE_TX_ACCESS_SEM | USE_RX_ACCESS_MUTEX | WAIT_TX_COMPLETE | WAIT_RX_COMPLETE)
+	 };
+	 const freertos_spi_device_t flash = {0, 12000000, 0, 0, 0};
+	 const uint8_t read_id = 0x9f;
+	 uint8_t id[3];
+	 freertos_spi_if freertos_spi;
+
+	 freertos_spi = freertos_spi_master_init(SPI0, &driver_options);
+	 freertos_spi_master_setup_device(freertos_spi, &flash);
+
+	 // Write the command, then read the response, with NPCS0 held low.
+	 if (freertos_spi_select_device(freertos_spi, 0, max_block_time) == STATUS_OK) {
+	     freertos_spi_write_packet(freertos_spi, &read_id, 1, max_block_time);
+	     freertos_spi_read_packet(freertos_spi, id, sizeof(id), max_block_time);
+	     freertos_spi_deselect_device(freertos_spi, max_block_time);
+	 }
+
+\endcode
+ */
+
+/// @cond 0
+/**INDENT-OFF**/
+#ifdef __cplusplus
+}
+#endif
+/**INDENT-ON**/
+/// @endcond
+
+#endif /* FREERTOS_SPI_MASTER_INCLUDED */
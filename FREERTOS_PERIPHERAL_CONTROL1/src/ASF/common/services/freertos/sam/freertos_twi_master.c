@@ -41,6 +41,7 @@
 #include "twi_master.h"
 #include "freertos_twi_master.h"
 #include "freertos_peripheral_control_private.h"
+#include "latency_monitor.h"
 #if SAMG55
 #include "flexcom.h"
 #endif
@@ -54,6 +55,10 @@
 #define SR_ERROR_INTERRUPTS     (TWI_SR_NACK | TWI_SR_ARBLST | TWI_SR_OVRE)
 #define IER_ERROR_INTERRUPTS    (TWI_IER_NACK | TWI_IER_ARBLST | TWI_IER_OVRE)
 
+/* Interrupts that move a PDC transfer through its final bytes. */
+#define IDR_TRANSFER_INTERRUPTS (TWI_IDR_ENDTX | TWI_IDR_ENDRX | TWI_IDR_TXRDY | \
+		TWI_IDR_RXRDY | TWI_IDR_TXCOMP)
+
 /* Work out how many TWI ports with PDC supported are present. */
 #if (SAMG55)
 #if defined(PDC_TWI7)
@@ -108,26 +113,82 @@
 #endif
 #endif
 
-/* A common interrupt handler definition used by all the TWI peripherals. */
-static void local_twi_handler(const portBASE_TYPE twi_index);
-
-/* Structures to manage the DMA control for both Rx and Tx transactions. */
-static freertos_dma_event_control_t tx_dma_control[MAX_TWIS];
-static freertos_dma_event_control_t rx_dma_control[MAX_TWIS];
+/* The steps of a PDC transfer.  The PDC moves all but the last byte of a
+write, and all but the last two bytes of a read.  The interrupt handler then
+finishes the transfer one status interrupt at a time, without waiting on the
+status register.  Queued transactions too short for the PDC start part way
+through: a one byte write at TWI_TX_STOP, a two byte read at
+TWI_RX_SECOND_LAST_BYTE and a one byte read at TWI_RX_LAST_BYTE. */
+enum twi_transfer_state {
+	TWI_IDLE = 0,				/* No PDC transfer in progress. */
+	TWI_PDC_TX,					/* Waiting for ENDTX. */
+	TWI_TX_LAST_BYTE,			/* Waiting for TXRDY to send the last byte and the STOP. */
+	TWI_TX_STOP,				/* Waiting for TXRDY to send the STOP after a one byte write. */
+	TWI_PDC_RX,					/* Waiting for ENDRX. */
+	TWI_RX_SECOND_LAST_BYTE,	/* Waiting for RXRDY to send the STOP and read the second last byte. */
+	TWI_RX_LAST_BYTE,			/* Waiting for RXRDY to read the last byte. */
+	TWI_WAIT_COMPLETE			/* Waiting for TXCOMP once the STOP has been sent. */
+};
 
-/* Structure to manage the end of a read transaction */
+/* Structure to manage the end of a transaction */
 struct twi_module {
 	uint8_t *buffer;
 	uint32_t length;
+	volatile enum twi_transfer_state state;
+	freertos_dma_event_control_t *dma_control;	/* tx_dma_control or rx_dma_control, whichever holds the notification semaphore of the transfer. */
+	freertos_twi_transaction_t *transaction;	/* The queued transaction being transferred, NULL for freertos_twi_write_packet_async() and freertos_twi_read_packet_async(). */
+	status_code_t status;						/* The result of the queued transaction, set by the error interrupt. */
 };
 
-/* Structures to manage the DMA control for both Rx and Tx transactions. */
-static struct twi_module twis[MAX_TWIS];
+/* Transactions submitted by freertos_twi_submit_transactions(), linked through
+their next members.  The head is the one on the bus. */
+typedef struct twi_transaction_queue {
+	freertos_twi_transaction_t *head;
+	freertos_twi_transaction_t *tail;
+	bool is_active;								/* The queue owns the bus, and the access semaphore if there is one, until it empties. */
+} twi_transaction_queue_t;
+
+/* Everything the driver holds for one TWI port.  The freertos_twi_if handle
+returned by freertos_twi_master_init() points to the port's context, so the
+driver functions go straight from the handle to the port. */
+typedef struct freertos_twi_context {
+	const freertos_pdc_peripheral_parameters_t *peripheral;	/*< The port's entry in all_twi_definitions[], NULL until the port is initialised. */
+	portBASE_TYPE twi_index;								/*< The position of the port in all_twi_definitions[]. */
+	freertos_dma_event_control_t tx_dma_control;			/*< The access semaphore (shared by Tx and Rx) and the Tx completion semaphore. */
+	freertos_dma_event_control_t rx_dma_control;			/*< The Rx completion semaphore. */
+	struct twi_module transfer;							/*< The transfer in progress, for the bytes sent or received without the PDC. */
+	twi_transaction_queue_t transaction_queue;			/*< Transactions submitted by freertos_twi_submit_transactions(). */
+	freertos_peripheral_stats_t stats;					/*< Read by freertos_twi_get_stats(). */
+	char access_sem_name[PERIPHERAL_OBJECT_NAME_LEN];		/*< Name under which the access semaphore is added to the queue registry, and the counters are listed. */
+} freertos_twi_context_t;
+
+/* Returns the context a handle points to, or NULL if it is not a valid
+handle. */
+static freertos_twi_context_t *get_twi_context(freertos_twi_if p_twi);
+
+/* Stops a PDC transfer that did not complete in the time the task waited. */
+static void abort_transfer(freertos_twi_context_t *context);
+
+/* Stops whatever transfer is on the bus, from a critical section. */
+static void stop_transfer(freertos_twi_context_t *context);
+
+/* Sets the direction, chip and internal address of the next transfer. */
+static void set_transfer_address(Twi *twi_base, const twi_packet_t *p_packet,
+		bool is_read);
+
+/* Starts the transaction at the head of the transaction queue. */
+static void start_queued_transaction(freertos_twi_context_t *context);
+
+/* Reports the end of the transaction at the head of the transaction queue, and
+starts the next one. */
+static void complete_queued_transaction(freertos_twi_context_t *context,
+		portBASE_TYPE *higher_priority_task_woken);
+
+/* A common interrupt handler definition used by all the TWI peripherals. */
+static void local_twi_handler(const portBASE_TYPE twi_index);
 
-/* Used to detect the init function being called after any part of the DMA
-control structure has already been initialized - indicating an error
-condition as init should only be called once per port. */
-static const freertos_dma_event_control_t null_dma_control = {NULL, NULL};
+/* The driver context of each TWI, in the same order as all_twi_definitions[]. */
+static freertos_twi_context_t twi_contexts[MAX_TWIS];
 
 /* Create an array that holds the information required about each defined TWI
  * peripheral. */
@@ -222,6 +283,7 @@ freertos_twi_if freertos_twi_master_init(Twi *p_twi,
 		const freertos_peripheral_options_t *const freertos_driver_parameters)
 {
 	portBASE_TYPE twi_index;
+	freertos_twi_context_t *context;
 	bool is_valid_operating_mode;
 	freertos_twi_if return_value;
 	const enum peripheral_operation_mode valid_operating_modes[] = {TWI_I2C_MASTER};
@@ -241,41 +303,40 @@ freertos_twi_if freertos_twi_master_init(Twi *p_twi,
 	/* Don't do anything unless a valid p_twi pointer was used, and a valid
 	operating mode was requested. */
 	if ((twi_index < MAX_TWIS) && (is_valid_operating_mode == true)) {
+		context = &(twi_contexts[twi_index]);
+
 		/* This function must be called exactly once per supported twi.  Check
 		it has not been called	before. */
-		configASSERT(memcmp((void *)&(tx_dma_control[twi_index]),
-				&null_dma_control,
-				sizeof(null_dma_control)) == 0);
-		configASSERT(memcmp((void *)&(rx_dma_control[twi_index]),
-				&null_dma_control,
-				sizeof(null_dma_control)) == 0);
+		configASSERT(context->peripheral == NULL);
+		context->peripheral = &(all_twi_definitions[twi_index]);
+		context->twi_index = twi_index;
 
 		/* Enable the peripheral's clock. */
 #if (SAMG55)
 		/* Enable the peripheral and set TWI mode. */
-		uint32_t temp = (uint32_t)(all_twi_definitions[twi_index].peripheral_base_address - 0x600);
+		uint32_t temp = (uint32_t)(context->peripheral->peripheral_base_address - 0x600);
 		Flexcom *p_flexcom = (Flexcom *)temp;
 		flexcom_enable(p_flexcom);
 		flexcom_set_opmode(p_flexcom, FLEXCOM_TWI);
 #else
 		pmc_enable_periph_clk(
-				all_twi_definitions[twi_index].peripheral_id);
+				context->peripheral->peripheral_id);
 #endif
 		/* Ensure everything is disabled before configuration. */
 		pdc_disable_transfer(
-				all_twi_definitions[twi_index].pdc_base_address,
+				context->peripheral->pdc_base_address,
 				(PERIPH_PTCR_RXTDIS | PERIPH_PTCR_TXTDIS));
 		twi_disable_interrupt(
-				all_twi_definitions[twi_index].peripheral_base_address,
+				context->peripheral->peripheral_base_address,
 				MASK_ALL_INTERRUPTS);
 		twi_reset(
-				all_twi_definitions[twi_index].peripheral_base_address);
+				context->peripheral->peripheral_base_address);
 
 		switch (freertos_driver_parameters->operation_mode) {
 		case TWI_I2C_MASTER:
 			/* Call the standard ASF init function. */
 			twi_enable_master_mode(
-					all_twi_definitions[twi_index].peripheral_base_address);
+					context->peripheral->peripheral_base_address);
 			break;
 
 		default:
@@ -288,20 +349,25 @@ freertos_twi_if freertos_twi_master_init(Twi *p_twi,
 		mutex is required. */
 		create_peripheral_control_semaphores(
 				freertos_driver_parameters->options_flags,
-				&(tx_dma_control[twi_index]),
-				&(rx_dma_control[twi_index]));
+				&(context->tx_dma_control),
+				&(context->rx_dma_control));
+		register_peripheral_control_object(
+				context->tx_dma_control.peripheral_access_sem,
+				context->access_sem_name, "TWI", twi_index, "");
+		register_peripheral_stats(&(context->stats), context->access_sem_name,
+				"TWI", twi_index);
 
 		/* Error interrupts are always enabled. */
 		twi_enable_interrupt(
-				all_twi_definitions[twi_index].peripheral_base_address,
+				context->peripheral->peripheral_base_address,
 				IER_ERROR_INTERRUPTS);
 
 		/* Configure and enable the TWI interrupt in the interrupt controller. */
 		configure_interrupt_controller(
-				all_twi_definitions[twi_index].peripheral_irq,
+				context->peripheral->peripheral_irq,
 				freertos_driver_parameters->interrupt_priority);
 
-		return_value = (freertos_twi_if) p_twi;
+		return_value = (freertos_twi_if) context;
 	} else {
 		return_value = NULL;
 	}
@@ -379,48 +445,30 @@ status_code_t freertos_twi_write_packet_async(freertos_twi_if p_twi,
 		xSemaphoreHandle notification_semaphore)
 {
 	status_code_t return_value;
-	portBASE_TYPE twi_index;
+	freertos_twi_context_t *context;
 	Twi *twi_base;
-	uint32_t internal_address = 0;
+	portTickType entry_ticks = xTaskGetTickCount();
+	uint32_t bytes_transferred = 0;
 
-	twi_base = (Twi *) p_twi;
-	twi_index = get_pdc_peripheral_details(all_twi_definitions, MAX_TWIS,
-			(void *) twi_base);
+	context = get_twi_context(p_twi);
+
+	/* Don't do anything unless a valid TWI handle was used. */
+	if ((context != NULL) && (p_packet->length > 0)) {
+		twi_base = (Twi *) context->peripheral->peripheral_base_address;
 
-	/* Don't do anything unless a valid TWI pointer was used. */
-	if ((twi_index < MAX_TWIS) && (p_packet->length > 0)) {
 		return_value = freertos_obtain_peripheral_access_semphore(
-				&(tx_dma_control[twi_index]), &block_time_ticks);
+				&(context->tx_dma_control), &block_time_ticks);
 
 		if (return_value == STATUS_OK) {
-			/* Set write mode and slave address. */
-			twi_base->TWI_MMR = 0;
-			twi_base->TWI_MMR = TWI_MMR_DADR(p_packet->chip) |
-					((p_packet->addr_length <<
-					TWI_MMR_IADRSZ_Pos) &
-					TWI_MMR_IADRSZ_Msk);
-
-			/* Set internal address if any. */
-			if (p_packet->addr_length > 0) {
-				internal_address = p_packet->addr[0];
-				if (p_packet->addr_length > 1) {
-					internal_address <<= 8;
-					internal_address |= p_packet->addr[1];
-				}
-
-				if (p_packet->addr_length > 2) {
-					internal_address <<= 8;
-					internal_address |= p_packet->addr[2];
-				}
-			}
-			twi_base->TWI_IADR = internal_address;
+			/* Set write mode, slave address and internal address. */
+			set_transfer_address(twi_base, p_packet, false);
 
 			if (p_packet->length == 1) {
 				uint32_t status;
 				uint32_t timeout_counter = 0;
 				/* Do not handle errors for short packets in interrupt handler */
 				twi_disable_interrupt(
-						all_twi_definitions[twi_index].peripheral_base_address,
+						context->peripheral->peripheral_base_address,
 						IER_ERROR_INTERRUPTS);
 				/* Send start condition */
 				twi_base->TWI_THR = *((uint8_t*)(p_packet->buffer));
@@ -429,10 +477,13 @@ status_code_t freertos_twi_write_packet_async(freertos_twi_if p_twi,
 					if (status & TWI_SR_NACK) {
 						/* Re-enable interrupts */
 						twi_enable_interrupt(
-								all_twi_definitions[twi_index].peripheral_base_address,
+								context->peripheral->peripheral_base_address,
 								IER_ERROR_INTERRUPTS);
 						/* Release semaphore */
-						xSemaphoreGive(tx_dma_control[twi_index].peripheral_access_sem);
+						xSemaphoreGive(context->tx_dma_control.peripheral_access_sem);
+						context->stats.nack_errors++;
+						freertos_record_transfer(&(context->stats), true, 0,
+								entry_ticks);
 						return ERR_BUSY;
 					}
 					if (status & TWI_SR_TXRDY) {
@@ -456,19 +507,36 @@ status_code_t freertos_twi_write_packet_async(freertos_twi_if p_twi,
 
 				/* Re-enable interrupts */
 				twi_enable_interrupt(
-						all_twi_definitions[twi_index].peripheral_base_address,
+						context->peripheral->peripheral_base_address,
 						IER_ERROR_INTERRUPTS);
 				/* Release semaphores */
-				xSemaphoreGive(tx_dma_control[twi_index].peripheral_access_sem);
+				xSemaphoreGive(context->tx_dma_control.peripheral_access_sem);
+
+				if (return_value == STATUS_OK) {
+					bytes_transferred = p_packet->length;
+				} else {
+					context->stats.timeout_errors++;
+				}
 			} else {
 
-				twis[twi_index].buffer = p_packet->buffer;
-				twis[twi_index].length = p_packet->length;
+				context->transfer.buffer = p_packet->buffer;
+				context->transfer.length = p_packet->length;
+				context->transfer.state = TWI_PDC_TX;
+				context->transfer.dma_control = &(context->tx_dma_control);
+				context->transfer.transaction = NULL;
 
-				freertos_start_pdc_tx(&(tx_dma_control[twi_index]),
+				freertos_start_pdc_tx(&(context->tx_dma_control),
 						p_packet->buffer, p_packet->length - 1,
-						all_twi_definitions[twi_index].pdc_base_address,
+						context->peripheral->pdc_base_address,
 						notification_semaphore);
+				bytes_transferred = p_packet->length;
+
+				/* If the task is going to block until the transfer completes,
+				time how long it takes to be woken.  Must be done before ENDTX
+				is enabled. */
+				if (notification_semaphore == NULL) {
+					LAT_RECORD_TASK_WAIT(LAT_PATH_TWI);
+				}
 
 				/* Catch the end of transmission so the access mutex can be
 				returned, and the task notified (if it supplied a notification
@@ -478,11 +546,23 @@ status_code_t freertos_twi_write_packet_async(freertos_twi_if p_twi,
 				twi_enable_interrupt(twi_base, TWI_IER_ENDTX);
 
 				return_value = freertos_optionally_wait_transfer_completion(
-						&(tx_dma_control[twi_index]),
+						&(context->tx_dma_control),
 						notification_semaphore,
 						block_time_ticks);
+
+				if (notification_semaphore == NULL) {
+					LAT_RECORD_TASK_RUN(LAT_PATH_TWI);
+				}
+
+				if (return_value == ERR_TIMEOUT) {
+					abort_transfer(context);
+					bytes_transferred = 0;
+				}
 			}
 		}
+
+		freertos_record_transfer(&(context->stats), true, bytes_transferred,
+				entry_ticks);
 	} else {
 		return_value = ERR_INVALID_ARG;
 	}
@@ -561,52 +641,33 @@ status_code_t freertos_twi_read_packet_async(freertos_twi_if p_twi,
 		xSemaphoreHandle notification_semaphore)
 {
 	status_code_t return_value;
-	portBASE_TYPE twi_index;
+	freertos_twi_context_t *context;
 	Twi *twi_base;
-	uint32_t internal_address = 0;
+	portTickType entry_ticks = xTaskGetTickCount();
+	uint32_t bytes_transferred = 0;
 
-	twi_base = (Twi *) p_twi;
-	twi_index = get_pdc_peripheral_details(all_twi_definitions, MAX_TWIS,
-			(void *) twi_base);
+	context = get_twi_context(p_twi);
+
+	/* Don't do anything unless a valid TWI handle was used. */
+	if ((context != NULL) && (p_packet->length > 0)) {
+		twi_base = (Twi *) context->peripheral->peripheral_base_address;
 
-	/* Don't do anything unless a valid TWI pointer was used. */
-	if ((twi_index < MAX_TWIS) && (p_packet->length > 0)) {
 		/* Because the peripheral is half duplex, there is only one access mutex
 		and the rx uses the tx mutex. */
 		return_value = freertos_obtain_peripheral_access_semphore(
-				&(tx_dma_control[twi_index]), &block_time_ticks);
+				&(context->tx_dma_control), &block_time_ticks);
 
 		if (return_value == STATUS_OK) {
 			/* Ensure Rx is already empty. */
 			twi_read_byte(twi_base);
 
-			/* Set read mode and slave address. */
-			twi_base->TWI_MMR = 0;
-			twi_base->TWI_MMR = TWI_MMR_MREAD | TWI_MMR_DADR(
-					p_packet->chip) |
-					((p_packet->addr_length <<
-					TWI_MMR_IADRSZ_Pos) &
-					TWI_MMR_IADRSZ_Msk);
-
-			/* Set internal address if any. */
-			if (p_packet->addr_length) {
-				internal_address = p_packet->addr [0];
-				if (p_packet->addr_length > 1) {
-					internal_address <<= 8;
-					internal_address |= p_packet->addr[1];
-				}
-
-				if (p_packet->addr_length > 2) {
-					internal_address <<= 8;
-					internal_address |= p_packet->addr[2];
-				}
-			}
-			twi_base->TWI_IADR = internal_address;
+			/* Set read mode, slave address and internal address. */
+			set_transfer_address(twi_base, p_packet, true);
 
 			if (p_packet->length <= 2) {
 				/* Do not handle errors for short packets in interrupt handler */
 				twi_disable_interrupt(
-						all_twi_definitions[twi_index].peripheral_base_address,
+						context->peripheral->peripheral_base_address,
 						IER_ERROR_INTERRUPTS);
 
 				/* Cannot use PDC transfer, use normal transfer */
@@ -629,10 +690,13 @@ status_code_t freertos_twi_read_packet_async(freertos_twi_if p_twi,
 					if (status & TWI_SR_NACK) {
 						/* Re-enable interrupts */
 						twi_enable_interrupt(
-								all_twi_definitions[twi_index].peripheral_base_address,
+								context->peripheral->peripheral_base_address,
 								IER_ERROR_INTERRUPTS);
 						/* Release semaphore */
-						xSemaphoreGive(tx_dma_control[twi_index].peripheral_access_sem);
+						xSemaphoreGive(context->tx_dma_control.peripheral_access_sem);
+						context->stats.nack_errors++;
+						freertos_record_transfer(&(context->stats), false, 0,
+								entry_ticks);
 						return ERR_BUSY;
 					}
 					/* Last byte ? */
@@ -663,18 +727,35 @@ status_code_t freertos_twi_read_packet_async(freertos_twi_if p_twi,
 				}
 				/* Re-enable interrupts */
 				twi_enable_interrupt(
-						all_twi_definitions[twi_index].peripheral_base_address,
+						context->peripheral->peripheral_base_address,
 						IER_ERROR_INTERRUPTS);
 				/* Release semaphores */
-				xSemaphoreGive(tx_dma_control[twi_index].peripheral_access_sem);
+				xSemaphoreGive(context->tx_dma_control.peripheral_access_sem);
+
+				if (return_value == STATUS_OK) {
+					bytes_transferred = p_packet->length;
+				} else {
+					context->stats.timeout_errors++;
+				}
 			} else {
 				/* Start the PDC reception. */
-				twis[twi_index].buffer = p_packet->buffer;
-				twis[twi_index].length = p_packet->length;
-				freertos_start_pdc_rx(&(rx_dma_control[twi_index]),
+				context->transfer.buffer = p_packet->buffer;
+				context->transfer.length = p_packet->length;
+				context->transfer.state = TWI_PDC_RX;
+				context->transfer.dma_control = &(context->rx_dma_control);
+				context->transfer.transaction = NULL;
+				freertos_start_pdc_rx(&(context->rx_dma_control),
 						p_packet->buffer, (p_packet->length)-2,
-						all_twi_definitions[twi_index].pdc_base_address,
+						context->peripheral->pdc_base_address,
 						notification_semaphore);
+				bytes_transferred = p_packet->length;
+
+				/* If the task is going to block until the transfer completes,
+				time how long it takes to be woken.  Must be done before the
+				transfer is started. */
+				if (notification_semaphore == NULL) {
+					LAT_RECORD_TASK_WAIT(LAT_PATH_TWI);
+				}
 
 				/* Start the transfer. */
 				twi_base->TWI_CR = TWI_CR_START;
@@ -687,11 +768,23 @@ status_code_t freertos_twi_read_packet_async(freertos_twi_if p_twi,
 				twi_enable_interrupt(twi_base, TWI_IER_ENDRX);
 
 				return_value = freertos_optionally_wait_transfer_completion(
-						&(rx_dma_control[twi_index]),
+						&(context->rx_dma_control),
 						notification_semaphore,
 						block_time_ticks);
+
+				if (notification_semaphore == NULL) {
+					LAT_RECORD_TASK_RUN(LAT_PATH_TWI);
+				}
+
+				if (return_value == ERR_TIMEOUT) {
+					abort_transfer(context);
+					bytes_transferred = 0;
+				}
 			}
 		}
+
+		freertos_record_transfer(&(context->stats), false, bytes_transferred,
+				entry_ticks);
 	} else {
 		return_value = ERR_INVALID_ARG;
 	}
@@ -699,177 +792,628 @@ status_code_t freertos_twi_read_packet_async(freertos_twi_if p_twi,
 	return return_value;
 }
 
-/*
- * For internal use only.
- * A common TWI interrupt handler that is called for all TWI peripherals.
+/**
+ * \ingroup freertos_twi_peripheral_control_group
+ * \brief Queue a list of transactions on a TWI bus.
+ *
+ * freertos_twi_submit_transactions() appends the transactions to the port's
+ * transaction queue then returns, normally without waiting.  The interrupt
+ * handler starts each transaction as soon as the one before it has sent its
+ * STOP, so transactions from any number of tasks, to any number of chips, run
+ * back to back without the bus going idle while a task is scheduled.
+ *
+ * A read whose packet has an internal address is a combined write-then-read,
+ * with a repeated START between the address bytes and the data, which is how
+ * a register or memory address is set before reading from it.
+ *
+ * The access semaphore (if USE_TX_ACCESS_SEM was set when the port was
+ * initialized) is taken by the first submission to find the queue empty, and
+ * given back by the driver once the queue has emptied again, so submissions
+ * made while the queue is busy are simply appended.
+ * freertos_twi_write_packet_async() and freertos_twi_read_packet_async() wait
+ * until the queue has emptied.
+ *
+ * The interrupt handler never waits for the bus, so a slave holding the clock
+ * low stops the queue, with the access semaphore, until the stuck transaction
+ * is cancelled.  A task that waits for its transactions with a timeout must
+ * therefore call freertos_twi_cancel_transactions() when the wait times out,
+ * and before the array goes out of scope or is reused.
+ *
+ * The FreeRTOS ASF driver both installs and handles the TWI PDC interrupts.
+ * Users do not need to concern themselves with interrupt handling, and must
+ * not install their own interrupt handler.
+ *
+ * \param p_twi    The handle to the TWI port returned by the
+ *     freertos_twi_master_init() call used to initialise the port.
+ * \param transactions    An array of count transactions, run in order.  The
+ *     array, and the buffers it points to, must not be modified until each
+ *     transaction has completed or been cancelled.  The callback and
+ *     notification_semaphore of each transaction are optional.
+ * \param count    The number of transactions in the array.
+ * \param block_time_ticks    The maximum time to wait for exclusive access to
+ *     the TWI if the queue is empty.  Other tasks will execute during any
+ *     waiting time.
+ *
+ * \return     ERR_INVALID_ARG is returned if an input parameter is invalid,
+ *     including a transaction with no data or more than three internal address
+ *     bytes.  ERR_TIMEOUT is returned if block_time_ticks passed before
+ *     exclusive access to the TWI could be obtained.  STATUS_OK is returned if
+ *     the transactions were queued, in which case the status member of each
+ *     one is set when it completes.
  */
-static void local_twi_handler(const portBASE_TYPE twi_index)
+status_code_t freertos_twi_submit_transactions(freertos_twi_if p_twi,
+		freertos_twi_transaction_t *transactions, size_t count,
+		portTickType block_time_ticks)
 {
-	portBASE_TYPE higher_priority_task_woken = pdFALSE;
-	uint32_t twi_status;
-	Twi *twi_port;
-	bool transfer_timeout = false;
+	status_code_t return_value = STATUS_OK;
+	freertos_twi_context_t *context;
+	twi_transaction_queue_t *queue;
+	size_t index;
+	bool is_queued = false, is_access_needed;
 
-	twi_port = all_twi_definitions[twi_index].peripheral_base_address;
+	context = get_twi_context(p_twi);
 
-	twi_status = twi_get_interrupt_status(twi_port);
-	twi_status &= twi_get_interrupt_mask(twi_port);
+	if ((context == NULL) || (transactions == NULL) || (count == 0)) {
+		return ERR_INVALID_ARG;
+	}
 
-	/* Has the PDC completed a transmission? */
-	if ((twi_status & TWI_SR_ENDTX) != 0UL) {
-		/* Disable PDC */
-		pdc_disable_transfer(all_twi_definitions[twi_index].pdc_base_address, PERIPH_PTCR_TXTDIS);
-		twi_disable_interrupt(twi_port, TWI_IDR_ENDTX);
+	for (index = 0; index < count; index++) {
+		if ((transactions[index].packet.length == 0) ||
+				(transactions[index].packet.addr_length > 3)) {
+			return ERR_INVALID_ARG;
+		}
+	}
 
-		uint8_t status;
-		uint32_t timeout_counter = 0;
+	/* Link the transactions, so they are appended to the queue in one step. */
+	for (index = 0; index < count; index++) {
+		transactions[index].status = OPERATION_IN_PROGRESS;
+		transactions[index].next = ((index + 1) < count) ?
+				&(transactions[index + 1]) : NULL;
+	}
 
-		/* Wait for TX ready flag */
-		while (1) {
-			status = twi_port->TWI_SR;
-			if (status & TWI_SR_TXRDY) {
-				break;
-			}
-			/* Check timeout condition. */
-			if (++timeout_counter >= TWI_TIMEOUT_COUNTER) {
-				transfer_timeout = true;
-				break;
-			}
-		}
-		/* Complete the transfer - stop and last byte */
-		twi_port->TWI_CR = TWI_CR_STOP;
-		twi_port->TWI_THR = twis[twi_index].buffer[twis[twi_index].length-1];
-
-		/* Wait for TX complete flag */
-		while (1) {
-			status = twi_port->TWI_SR;
-			if (status & TWI_SR_TXCOMP) {
-				break;
-			}
-			/* Check timeout condition. */
-			if (++timeout_counter >= TWI_TIMEOUT_COUNTER) {
-				transfer_timeout = true;
-				break;
+	queue = &(context->transaction_queue);
+
+	while ((is_queued == false) && (return_value == STATUS_OK)) {
+		is_access_needed = false;
+
+		taskENTER_CRITICAL();
+		{
+			if (queue->is_active == false) {
+				is_access_needed = true;
+			} else {
+				if (queue->head == NULL) {
+					/* The bus has only just been obtained. */
+					queue->head = &(transactions[0]);
+					queue->tail = &(transactions[count - 1]);
+					start_queued_transaction(context);
+				} else {
+					queue->tail->next = &(transactions[0]);
+					queue->tail = &(transactions[count - 1]);
+				}
+
+				is_queued = true;
 			}
 		}
-		/* If the driver is supporting multi-threading, then return the access
-		mutex. */
-		if (tx_dma_control[twi_index].peripheral_access_sem != NULL) {
-			xSemaphoreGiveFromISR(
-					tx_dma_control[twi_index].peripheral_access_sem,
-					&higher_priority_task_woken);
-		}
+		taskEXIT_CRITICAL();
 
-		/* if the sending task supplied a notification semaphore, then
-		notify the task that the transmission has completed. */
-		if (!(timeout_counter >= TWI_TIMEOUT_COUNTER)) {
-			if (tx_dma_control[twi_index]. transaction_complete_notification_semaphore != NULL) {
-				xSemaphoreGiveFromISR(
-						tx_dma_control[twi_index].transaction_complete_notification_semaphore,
-						&higher_priority_task_woken);
+		if (is_access_needed == true) {
+			/* The queue is empty and the bus may be in use by an ordinary
+			read or write, so obtain exclusive access to it first. */
+			return_value = freertos_obtain_peripheral_access_semphore(
+					&(context->tx_dma_control),
+					&block_time_ticks);
+
+			if (return_value == STATUS_OK) {
+				queue->is_active = true;
 			}
 		}
 	}
 
-	/* Has the PDC completed a reception? */
-	if ((twi_status & TWI_SR_ENDRX) != 0UL) {
-		uint32_t timeout_counter = 0;
-		uint32_t status;
-		/* Must handle the two last bytes */
-		/* Disable PDC */
-		pdc_disable_transfer(all_twi_definitions[twi_index].pdc_base_address, PERIPH_PTCR_RXTDIS);
+	return return_value;
+}
 
-		twi_disable_interrupt(twi_port, TWI_IDR_ENDRX);
+/**
+ * \ingroup freertos_twi_peripheral_control_group
+ * \brief Take back queued transactions that have not completed.
+ *
+ * freertos_twi_cancel_transactions() is called by a task that has stopped
+ * waiting for transactions it submitted with
+ * freertos_twi_submit_transactions(), for example because its wait timed out.
+ * Every transaction of the array still in the port's queue is removed from
+ * it, so once the function returns the driver no longer refers to the array
+ * or its buffers, and they can be reused, or go out of scope.
+ *
+ * A cancelled transaction that was waiting its turn gets the status
+ * ERR_ABORTED.  If the transaction on the bus is cancelled, the transfer is
+ * abandoned with a STOP, as for a blocking transfer whose wait timed out, it
+ * gets the status ERR_TIMEOUT, and it is counted as a timeout error.  The
+ * queue then moves on to its next transaction, or gives the access semaphore
+ * back if it has emptied.  The callbacks and notification semaphores of
+ * cancelled transactions are not called or given.  Transactions that had
+ * already completed keep their status.
+ *
+ * \param p_twi    The handle to the TWI port returned by the
+ *     freertos_twi_master_init() call used to initialise the port.
+ * \param transactions    The array passed to freertos_twi_submit_transactions().
+ * \param count    The number of transactions in the array.
+ *
+ * \return     The number of transactions cancelled.
+ */
+size_t freertos_twi_cancel_transactions(freertos_twi_if p_twi,
+		freertos_twi_transaction_t *transactions, size_t count)
+{
+	freertos_twi_context_t *context;
+	twi_transaction_queue_t *queue;
+	freertos_twi_transaction_t *transaction, *previous = NULL, *next;
+	size_t cancelled = 0;
+	bool is_head_cancelled = false;
 
-		/* Wait for RX ready flag */
-		while (1) {
-			status = twi_port->TWI_SR;
-			if (status & TWI_SR_RXRDY) {
-				break;
+	context = get_twi_context(p_twi);
+
+	if ((context == NULL) || (transactions == NULL)) {
+		return 0;
+	}
+
+	queue = &(context->transaction_queue);
+
+	taskENTER_CRITICAL();
+	{
+		for (transaction = queue->head; transaction != NULL;
+				transaction = next) {
+			next = transaction->next;
+
+			if ((transaction < &(transactions[0])) ||
+					(transaction >= &(transactions[count]))) {
+				previous = transaction;
+				continue;
 			}
-			/* Check timeout condition. */
-			if (++timeout_counter >= TWI_TIMEOUT_COUNTER) {
-				break;
+
+			if (transaction == queue->head) {
+				/* The head of the queue is always on the bus. */
+				stop_transfer(context);
+				context->stats.timeout_errors++;
+				transaction->status = ERR_TIMEOUT;
+				is_head_cancelled = true;
+			} else {
+				transaction->status = ERR_ABORTED;
 			}
-		}
-		/* Complete the transfer. */
-		twi_port->TWI_CR = TWI_CR_STOP;
-		/* Read second last data */
-		twis[twi_index].buffer[(twis[twi_index].length)-2] = twi_port->TWI_RHR;
-
-		/* Wait for RX ready flag */
-		while (1) {
-			status = twi_port->TWI_SR;
-			if (status & TWI_SR_RXRDY) {
-				break;
+
+			if (previous == NULL) {
+				queue->head = next;
+			} else {
+				previous->next = next;
 			}
-			/* Check timeout condition. */
-			if (++timeout_counter >= TWI_TIMEOUT_COUNTER) {
-				break;
+
+			if (queue->tail == transaction) {
+				queue->tail = previous;
 			}
+
+			cancelled++;
 		}
 
-		if (!(timeout_counter >= TWI_TIMEOUT_COUNTER)) {
-			/* Read last data */
-			twis[twi_index].buffer[(twis[twi_index].length)-1] = twi_port->TWI_RHR;
-			timeout_counter = 0;
-			/* Wait for TX complete flag before releasing semaphore */
-			while (1) {
-				status = twi_port->TWI_SR;
-				if (status & TWI_SR_TXCOMP) {
-					break;
-				}
-				/* Check timeout condition. */
-				if (++timeout_counter >= TWI_TIMEOUT_COUNTER) {
-					transfer_timeout = true;
-					break;
+		if (is_head_cancelled == true) {
+			if (queue->head != NULL) {
+				start_queued_transaction(context);
+			} else {
+				/* The queue is empty, so give the bus back. */
+				queue->is_active = false;
+
+				if (context->tx_dma_control.peripheral_access_sem != NULL) {
+					xSemaphoreGive(
+							context->tx_dma_control.peripheral_access_sem);
 				}
 			}
 		}
+	}
+	taskEXIT_CRITICAL();
 
-		/* If the driver is supporting multi-threading, then return the access
-		mutex.  NOTE: As the peripheral is half duplex there is only one
-		access mutex, and the reception uses the tx access muted. */
-		if (tx_dma_control[twi_index].peripheral_access_sem != NULL) {
-			xSemaphoreGiveFromISR(
-					tx_dma_control[twi_index].peripheral_access_sem,
-					&higher_priority_task_woken);
-		}
+	return cancelled;
+}
 
-		/* if the receiving task supplied a notification semaphore, then
-		notify the task that the transmission has completed. */
-		if  (!(timeout_counter >= TWI_TIMEOUT_COUNTER)) {
-			if (rx_dma_control[twi_index].transaction_complete_notification_semaphore != NULL) {
-				xSemaphoreGiveFromISR(
-						rx_dma_control[twi_index].transaction_complete_notification_semaphore,
-						&higher_priority_task_woken);
+/**
+ * \ingroup freertos_twi_peripheral_control_group
+ * \brief Read the counters the driver keeps for a TWI port.
+ *
+ * The driver counts the bytes and transfers in each direction, NACKs,
+ * arbitration losses, overruns, and the time tasks have spent in the read and
+ * write functions.  Transfers that did not complete in time are counted as
+ * timeout errors: PDC transfers whose task stopped waiting for them, queued
+ * transactions taken back by freertos_twi_cancel_transactions(), and the one
+ * byte writes and short reads made without the PDC, which poll the status
+ * register at most TWI_TIMEOUT_COUNTER times.  The snapshot is taken in a critical section,
+ * so the counters are consistent with each other.
+ *
+ * \param p_twi    The handle to the TWI port returned by the
+ *     freertos_twi_master_init() call used to initialise the port.
+ * \param stats    Filled in with a copy of the counters.
+ * \param reset    If true the counters are cleared once they have been copied.
+ *
+ * \return     ERR_INVALID_ARG if a parameter is invalid, otherwise STATUS_OK.
+ */
+status_code_t freertos_twi_get_stats(freertos_twi_if p_twi,
+		freertos_peripheral_stats_t *stats, bool reset)
+{
+	freertos_twi_context_t *context;
+	status_code_t return_value = ERR_INVALID_ARG;
+
+	context = get_twi_context(p_twi);
+
+	if ((context != NULL) && (stats != NULL)) {
+		freertos_copy_peripheral_stats(&(context->stats), stats, reset);
+		return_value = STATUS_OK;
+	}
+
+	return return_value;
+}
+
+/*
+ * For internal use only.
+ * Returns the driver context that a freertos_twi_if handle points to, or NULL
+ * if the handle is not one returned by freertos_twi_master_init().  The handle
+ * is checked by its position in twi_contexts[] rather than by searching for a
+ * matching base address.
+ */
+static freertos_twi_context_t *get_twi_context(freertos_twi_if p_twi)
+{
+	freertos_twi_context_t *context = (freertos_twi_context_t *) p_twi;
+
+	if ((context < &(twi_contexts[0])) ||
+			(context >= &(twi_contexts[MAX_TWIS])) ||
+			(context->peripheral == NULL)) {
+		context = NULL;
+	}
+
+	return context;
+}
+
+/*
+ * For internal use only.
+ * Called by a task whose wait for a PDC transfer timed out.  The interrupt
+ * handler never waits for the bus, so a slave holding the clock low would
+ * otherwise leave the transfer, and the access semaphore, held forever.  If the
+ * transfer did complete after the wait timed out nothing is done.
+ */
+static void abort_transfer(freertos_twi_context_t *context)
+{
+	taskENTER_CRITICAL();
+	{
+		if (context->transfer.state != TWI_IDLE) {
+			stop_transfer(context);
+			context->stats.timeout_errors++;
+
+			if (context->tx_dma_control.peripheral_access_sem != NULL) {
+				xSemaphoreGive(context->tx_dma_control.peripheral_access_sem);
 			}
 		}
 	}
+	taskEXIT_CRITICAL();
+}
+
+/*
+ * For internal use only.
+ * Called from a critical section to abandon the transfer on the bus, whether
+ * it is a blocking transfer or a queued transaction.  The PDC and the transfer
+ * interrupts are stopped, and a STOP is requested to release the bus.  The
+ * error interrupts stay enabled, as they are between transfers.
+ */
+static void stop_transfer(freertos_twi_context_t *context)
+{
+	Twi *twi_port = context->peripheral->peripheral_base_address;
+
+	pdc_disable_transfer(context->peripheral->pdc_base_address,
+			PERIPH_PTCR_TXTDIS | PERIPH_PTCR_RXTDIS);
+	twi_disable_interrupt(twi_port, IDR_TRANSFER_INTERRUPTS);
+	twi_port->TWI_CR = TWI_CR_STOP;
+	context->transfer.state = TWI_IDLE;
+	context->transfer.transaction = NULL;
+}
+
+/*
+ * For internal use only.
+ * Sets the direction, chip address and internal address of the next transfer.
+ * The TWI sends the internal address as part of a read by writing it, then
+ * turning the bus around with a repeated START.
+ */
+static void set_transfer_address(Twi *twi_base, const twi_packet_t *p_packet,
+		bool is_read)
+{
+	uint32_t internal_address = 0;
+
+	twi_base->TWI_MMR = 0;
+	twi_base->TWI_MMR = ((is_read == true) ? TWI_MMR_MREAD : 0) |
+			TWI_MMR_DADR(p_packet->chip) |
+			((p_packet->addr_length <<
+			TWI_MMR_IADRSZ_Pos) &
+			TWI_MMR_IADRSZ_Msk);
+
+	/* Set internal address if any. */
+	if (p_packet->addr_length > 0) {
+		internal_address = p_packet->addr[0];
+		if (p_packet->addr_length > 1) {
+			internal_address <<= 8;
+			internal_address |= p_packet->addr[1];
+		}
+
+		if (p_packet->addr_length > 2) {
+			internal_address <<= 8;
+			internal_address |= p_packet->addr[2];
+		}
+	}
+	twi_base->TWI_IADR = internal_address;
+}
+
+/*
+ * For internal use only.
+ * Called from a critical section, or from the TWI interrupt, to start the
+ * transaction at the head of the transaction queue.  Nothing here waits on the
+ * bus, so transfers too short for the PDC are also finished by the interrupt
+ * handler, one status interrupt at a time.
+ */
+static void start_queued_transaction(freertos_twi_context_t *context)
+{
+	freertos_twi_transaction_t *transaction = context->transaction_queue.head;
+	twi_packet_t *p_packet = &(transaction->packet);
+	Twi *twi_base = context->peripheral->peripheral_base_address;
+	Pdc *pdc_base = context->peripheral->pdc_base_address;
+	pdc_packet_t pdc_packet;
+
+	context->transfer.buffer = p_packet->buffer;
+	context->transfer.length = p_packet->length;
+	context->transfer.dma_control = NULL;
+	context->transfer.transaction = transaction;
+	context->transfer.status = STATUS_OK;
+
+	if (transaction->is_read == false) {
+		set_transfer_address(twi_base, p_packet, false);
+
+		if (p_packet->length == 1) {
+			/* Writing the byte starts the transfer. */
+			context->transfer.state = TWI_TX_STOP;
+			twi_base->TWI_THR = context->transfer.buffer[0];
+			twi_enable_interrupt(twi_base, TWI_IER_TXRDY);
+		} else {
+			/* The PDC writing the first byte starts the transfer. */
+			context->transfer.state = TWI_PDC_TX;
+			pdc_packet.ul_addr = (uint32_t) p_packet->buffer;
+			pdc_packet.ul_size = p_packet->length - 1;
+			pdc_disable_transfer(pdc_base, PERIPH_PTCR_TXTDIS);
+			pdc_tx_init(pdc_base, &pdc_packet, NULL);
+			pdc_enable_transfer(pdc_base, PERIPH_PTCR_TXTEN);
+			twi_enable_interrupt(twi_base, TWI_IER_ENDTX);
+		}
+	} else {
+		/* Ensure Rx is already empty. */
+		twi_read_byte(twi_base);
+		set_transfer_address(twi_base, p_packet, true);
+
+		if (p_packet->length == 1) {
+			context->transfer.state = TWI_RX_LAST_BYTE;
+			twi_base->TWI_CR = TWI_CR_START | TWI_CR_STOP;
+			twi_enable_interrupt(twi_base, TWI_IER_RXRDY);
+		} else if (p_packet->length == 2) {
+			context->transfer.state = TWI_RX_SECOND_LAST_BYTE;
+			twi_base->TWI_CR = TWI_CR_START;
+			twi_enable_interrupt(twi_base, TWI_IER_RXRDY);
+		} else {
+			context->transfer.state = TWI_PDC_RX;
+			pdc_packet.ul_addr = (uint32_t) p_packet->buffer;
+			pdc_packet.ul_size = p_packet->length - 2;
+			pdc_disable_transfer(pdc_base, PERIPH_PTCR_RXTDIS);
+			pdc_rx_init(pdc_base, &pdc_packet, NULL);
+			pdc_enable_transfer(pdc_base, PERIPH_PTCR_RXTEN);
+			twi_base->TWI_CR = TWI_CR_START;
+			twi_enable_interrupt(twi_base, TWI_IER_ENDRX);
+		}
+	}
+}
+
+/*
+ * For internal use only.
+ * Called from the TWI interrupt once the transaction at the head of the
+ * transaction queue has sent its STOP, whether or not it succeeded.  The
+ * submitter is notified, and the next transaction is started straight away.
+ * When the queue empties the access semaphore is given back.
+ */
+static void complete_queued_transaction(freertos_twi_context_t *context,
+		portBASE_TYPE *higher_priority_task_woken)
+{
+	twi_transaction_queue_t *queue = &(context->transaction_queue);
+	freertos_twi_transaction_t *transaction = queue->head;
+	freertos_twi_callback_t callback = transaction->callback;
+	xSemaphoreHandle notification_semaphore =
+			transaction->notification_semaphore;
+
+	if (context->transfer.status == STATUS_OK) {
+		if (transaction->is_read == true) {
+			context->stats.rx_bytes += transaction->packet.length;
+			context->stats.rx_transfers++;
+		} else {
+			context->stats.tx_bytes += transaction->packet.length;
+			context->stats.tx_transfers++;
+		}
+	}
 
-	if (((twi_status & SR_ERROR_INTERRUPTS) != 0) || (transfer_timeout == true)) {
+	/* The transaction belongs to the submitter again once its status is set,
+	so it is unlinked first. */
+	queue->head = transaction->next;
+	context->transfer.transaction = NULL;
+	transaction->status = context->transfer.status;
+
+	if (callback != NULL) {
+		callback(transaction, higher_priority_task_woken);
+	}
+
+	if (notification_semaphore != NULL) {
+		xSemaphoreGiveFromISR(notification_semaphore,
+				higher_priority_task_woken);
+	}
+
+	if (queue->head != NULL) {
+		start_queued_transaction(context);
+	} else {
+		/* The queue is empty, so give the bus back. */
+		queue->tail = NULL;
+		queue->is_active = false;
+
+		if (context->tx_dma_control.peripheral_access_sem != NULL) {
+			xSemaphoreGiveFromISR(
+					context->tx_dma_control.peripheral_access_sem,
+					higher_priority_task_woken);
+		}
+	}
+}
+
+/*
+ * For internal use only.
+ * A common TWI interrupt handler that is called for all TWI peripherals.
+ */
+static void local_twi_handler(const portBASE_TYPE twi_index)
+{
+	/* Taken first so the measured ISR time includes the whole handler. */
+	uint32_t isr_entry_cycles = LAT_ISR_ENTRY_STAMP();
+	portBASE_TYPE higher_priority_task_woken = pdFALSE;
+	uint32_t twi_status;
+	Twi *twi_port;
+	freertos_twi_context_t *context = &(twi_contexts[twi_index]);
+
+	twi_port = context->peripheral->peripheral_base_address;
+
+	twi_status = twi_get_interrupt_status(twi_port);
+	twi_status &= twi_get_interrupt_mask(twi_port);
+
+	if ((twi_status & SR_ERROR_INTERRUPTS) != 0) {
 		/* An error occurred in either a transmission or reception.  Abort.
 		Stop the transmission, disable interrupts used by the peripheral, and
 		ensure the peripheral access mutex is made available to tasks.  As this
 		peripheral is half duplex, only the Tx peripheral access mutex exits.*/
+		if ((twi_status & TWI_SR_NACK) != 0) {
+			context->stats.nack_errors++;
+		}
+		if ((twi_status & TWI_SR_ARBLST) != 0) {
+			context->stats.arbitration_lost_errors++;
+		}
+		if ((twi_status & TWI_SR_OVRE) != 0) {
+			context->stats.overrun_errors++;
+		}
 
 		/* Stop the PDC */
-		pdc_disable_transfer(all_twi_definitions[twi_index].pdc_base_address, PERIPH_PTCR_TXTDIS | PERIPH_PTCR_RXTDIS);
+		pdc_disable_transfer(context->peripheral->pdc_base_address, PERIPH_PTCR_TXTDIS | PERIPH_PTCR_RXTDIS);
 
 		if (!(twi_status & TWI_SR_NACK)) {
 			/* Do not send stop if NACK received. Handled by hardware */
 			twi_port->TWI_CR = TWI_CR_STOP;
 		}
+		twi_disable_interrupt(twi_port, IDR_TRANSFER_INTERRUPTS);
+
+		if (context->transfer.transaction != NULL) {
+			/* A queued transaction is completed, with the error, once the
+			STOP has been sent, and the queue then moves on.  The access
+			mutex stays with the queue. */
+			context->transfer.status = ((twi_status & TWI_SR_NACK) != 0) ?
+					ERR_BUSY : ERR_IO_ERROR;
+			context->transfer.state = TWI_WAIT_COMPLETE;
+			twi_enable_interrupt(twi_port, TWI_IER_TXCOMP);
+			twi_status &= TWI_SR_TXCOMP;
+		} else {
+			context->transfer.state = TWI_IDLE;
+			twi_status = 0;
+
+			if (context->tx_dma_control.peripheral_access_sem != NULL) {
+				xSemaphoreGiveFromISR(
+						context->tx_dma_control.peripheral_access_sem,
+						&higher_priority_task_woken);
+			}
+		}
+	}
+
+	/* Has the PDC sent all but the last byte of a write? */
+	if ((twi_status & TWI_SR_ENDTX) != 0UL) {
+		pdc_disable_transfer(context->peripheral->pdc_base_address, PERIPH_PTCR_TXTDIS);
 		twi_disable_interrupt(twi_port, TWI_IDR_ENDTX);
+
+		/* The last byte is written with the STOP once the holding register
+		is free. */
+		context->transfer.state = TWI_TX_LAST_BYTE;
+		twi_enable_interrupt(twi_port, TWI_IER_TXRDY);
+	}
+
+	if ((twi_status & TWI_SR_TXRDY) != 0UL) {
+		twi_disable_interrupt(twi_port, TWI_IDR_TXRDY);
+
+		if (context->transfer.state == TWI_TX_LAST_BYTE) {
+			/* Complete the transfer - stop and last byte */
+			twi_port->TWI_CR = TWI_CR_STOP;
+			twi_port->TWI_THR = context->transfer.buffer[context->transfer.length-1];
+		} else {
+			/* The only byte of a queued write has moved to the shift
+			register. */
+			twi_port->TWI_CR = TWI_CR_STOP;
+		}
+
+		context->transfer.state = TWI_WAIT_COMPLETE;
+		twi_enable_interrupt(twi_port, TWI_IER_TXCOMP);
+	}
+
+	/* Has the PDC received all but the last two bytes of a read? */
+	if ((twi_status & TWI_SR_ENDRX) != 0UL) {
+		pdc_disable_transfer(context->peripheral->pdc_base_address, PERIPH_PTCR_RXTDIS);
 		twi_disable_interrupt(twi_port, TWI_IDR_ENDRX);
 
-		if (tx_dma_control[twi_index].peripheral_access_sem != NULL) {
-			xSemaphoreGiveFromISR(
-					tx_dma_control[twi_index].peripheral_access_sem,
-					&higher_priority_task_woken);
+		/* The last two bytes are read one RXRDY interrupt at a time. */
+		context->transfer.state = TWI_RX_SECOND_LAST_BYTE;
+		twi_enable_interrupt(twi_port, TWI_IER_RXRDY);
+	}
+
+	if ((twi_status & TWI_SR_RXRDY) != 0UL) {
+		if (context->transfer.state == TWI_RX_SECOND_LAST_BYTE) {
+			/* Request the STOP before reading the second last byte, so it
+			follows the last byte. */
+			twi_port->TWI_CR = TWI_CR_STOP;
+			context->transfer.buffer[(context->transfer.length)-2] = twi_port->TWI_RHR;
+			context->transfer.state = TWI_RX_LAST_BYTE;
+		} else {
+			/* Read last data, then wait for the STOP to be sent before
+			releasing the semaphore. */
+			context->transfer.buffer[(context->transfer.length)-1] = twi_port->TWI_RHR;
+			twi_disable_interrupt(twi_port, TWI_IDR_RXRDY);
+			context->transfer.state = TWI_WAIT_COMPLETE;
+			twi_enable_interrupt(twi_port, TWI_IER_TXCOMP);
 		}
 	}
 
+	/* Has the STOP that ends a write or read been sent? */
+	if ((twi_status & TWI_SR_TXCOMP) != 0UL) {
+		twi_disable_interrupt(twi_port, TWI_IDR_TXCOMP);
+		context->transfer.state = TWI_IDLE;
+
+		if (context->transfer.transaction != NULL) {
+			/* The queue keeps the access mutex, and starts its next
+			transaction. */
+			complete_queued_transaction(context, &higher_priority_task_woken);
+		} else {
+			/* If the driver is supporting multi-threading, then return the
+			access mutex.  NOTE: As the peripheral is half duplex there is only
+			one access mutex, and the reception uses the tx access muted. */
+			if (context->tx_dma_control.peripheral_access_sem != NULL) {
+				xSemaphoreGiveFromISR(
+						context->tx_dma_control.peripheral_access_sem,
+						&higher_priority_task_woken);
+			}
+
+			/* if the task supplied a notification semaphore, then notify the
+			task that the transfer has completed. */
+			if (context->transfer.dma_control->transaction_complete_notification_semaphore != NULL) {
+				LAT_RECORD_GIVE_FROM_ISR(LAT_PATH_TWI, isr_entry_cycles);
+				xSemaphoreGiveFromISR(
+						context->transfer.dma_control->transaction_complete_notification_semaphore,
+						&higher_priority_task_woken);
+			}
+		}
+	}
+
+	context->stats.isr_count++;
+	context->stats.isr_cycles += LAT_ISR_ELAPSED_CYCLES(isr_entry_cycles);
+
 	/* If giving a semaphore caused a task to unblock, and the unblocked task
 	has a priority equal to or higher than the currently running task (the task
 	this ISR interrupted), then higher_priority_task_woken will have
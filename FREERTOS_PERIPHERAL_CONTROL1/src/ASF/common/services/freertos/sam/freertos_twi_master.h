@@ -76,9 +76,49 @@ extern "C" {
  *     ypedef freertos_twi_if
  * \brief Type returned from a call to freertos_twi_master_init(), and then used
  * to reference a TWI port in calls to FreeRTOS peripheral control functions.
+ * It points to the driver's context for the port and is not the base address
+ * of the TWI.
  */
 typedef void *freertos_twi_if;
 
+struct freertos_twi_transaction;
+
+/**
+ * \ingroup freertos_twi_peripheral_control_group
+ *     ypedef freertos_twi_callback_t
+ * \brief Function called by the driver when a queued transaction completes.
+ * It is called from the TWI interrupt, so must only use the FromISR FreeRTOS
+ * API functions, passing them higher_priority_task_woken.
+ */
+typedef void (*freertos_twi_callback_t)(
+		struct freertos_twi_transaction *transaction,
+		portBASE_TYPE *higher_priority_task_woken);
+
+/**
+ * \ingroup freertos_twi_peripheral_control_group
+ *     ypedef freertos_twi_transaction_t
+ * \brief One transaction queued by freertos_twi_submit_transactions().
+ *
+ * A write sends the packet's internal address bytes followed by its buffer.
+ * A read with an internal address is a combined write-then-read: the address
+ * bytes are written, then a repeated START turns the bus around to read the
+ * buffer without releasing it.  The TWI sends up to three internal address
+ * bytes in this way.
+ *
+ * The structure belongs to the driver from the time it is submitted until
+ * its callback has been called or its notification semaphore given, or until
+ * it is cancelled with freertos_twi_cancel_transactions().
+ */
+typedef struct freertos_twi_transaction {
+	twi_packet_t packet;								/*< The chip, internal address, buffer and length. */
+	bool is_read;										/*< true to read into packet.buffer, false to write it. */
+	freertos_twi_callback_t callback;					/*< If not NULL, called from the interrupt when the transaction completes. */
+	xSemaphoreHandle notification_semaphore;			/*< If not NULL, given from the interrupt when the transaction completes. */
+	void *callback_parameter;							/*< Not used by the driver. */
+	volatile status_code_t status;						/*< OPERATION_IN_PROGRESS until the transaction completes, then STATUS_OK, ERR_BUSY if the chip did not acknowledge, or ERR_IO_ERROR.  ERR_TIMEOUT or ERR_ABORTED if it was cancelled on or waiting for the bus. */
+	struct freertos_twi_transaction *next;				/*< Used by the driver. */
+} freertos_twi_transaction_t;
+
 freertos_twi_if freertos_twi_master_init(Twi *p_twi,
 		const freertos_peripheral_options_t *const freertos_driver_parameters);
 
@@ -90,6 +130,16 @@ status_code_t freertos_twi_read_packet_async(freertos_twi_if p_twi,
 		twi_packet_t *p_packet, portTickType block_time_ticks,
 		xSemaphoreHandle notification_semaphore);
 
+status_code_t freertos_twi_submit_transactions(freertos_twi_if p_twi,
+		freertos_twi_transaction_t *transactions, size_t count,
+		portTickType block_time_ticks);
+
+size_t freertos_twi_cancel_transactions(freertos_twi_if p_twi,
+		freertos_twi_transaction_t *transactions, size_t count);
+
+status_code_t freertos_twi_get_stats(freertos_twi_if p_twi,
+		freertos_peripheral_stats_t *stats, bool reset);
+
 /**
  * \ingroup freertos_twi_peripheral_control_group
  * \brief Initiate a multi-byte write operation on an TWI peripheral.
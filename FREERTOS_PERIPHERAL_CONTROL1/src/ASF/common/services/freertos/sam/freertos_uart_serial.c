@@ -71,16 +71,34 @@ enum buffer_operations {
 	data_removed
 };
 
+/* Everything the driver holds for one UART port.  The freertos_uart_if handle
+returned by freertos_uart_serial_init() points to the port's context, so the
+driver functions go straight from the handle to the port. */
+typedef struct freertos_uart_context {
+	const freertos_pdc_peripheral_parameters_t *peripheral;	/*< The port's entry in all_uart_definitions[], NULL until the port is initialised. */
+	portBASE_TYPE uart_index;								/*< The position of the port in all_uart_definitions[]. */
+	freertos_pdc_rx_control_t rx_buffer_definition;		/*< The Rx circular buffer and the PDC's position within it. */
+	freertos_dma_event_control_t tx_dma_control;			/*< Tx access and completion semaphores. */
+	freertos_peripheral_stats_t stats;					/*< Read by freertos_uart_get_stats(). */
+	char tx_access_sem_name[PERIPHERAL_OBJECT_NAME_LEN];	/*< Names under which the access semaphore and mutex are added to the queue registry, and the counters are listed. */
+	char rx_access_mutex_name[PERIPHERAL_OBJECT_NAME_LEN];
+	char stats_name[PERIPHERAL_OBJECT_NAME_LEN];
+} freertos_uart_context_t;
+
+/* Returns the context a handle points to, or NULL if it is not a valid
+handle. */
+static freertos_uart_context_t *get_uart_context(freertos_uart_if p_uart);
+
 /* Configures the Rx DMA to receive data into free space within the Rx buffer. */
-static void configure_rx_dma(uint32_t uart_index,
+static void configure_rx_dma(freertos_uart_context_t *context,
 		enum buffer_operations operation_performed);
 
 /* A common interrupt handler called by all the UART peripherals. */
 static void local_uart_handler(const portBASE_TYPE uart_index);
 
-/* Structures to manage the DMA control for both Rx and Tx transactions. */
-static freertos_pdc_rx_control_t rx_buffer_definitions[MAX_UARTS];
-static freertos_dma_event_control_t tx_dma_control[MAX_UARTS];
+/* The driver context of each UART, in the same order as
+all_uart_definitions[]. */
+static freertos_uart_context_t uart_contexts[MAX_UARTS];
 
 /* Create an array that holds the information required about each defined
 UART. */
@@ -143,6 +161,7 @@ freertos_uart_if freertos_uart_serial_init(Uart *p_uart,
 		const freertos_peripheral_options_t *const freertos_driver_parameters)
 {
 	portBASE_TYPE uart_index;
+	freertos_uart_context_t *context;
 	bool is_valid_operating_mode;
 	freertos_uart_if return_value;
 	const enum peripheral_operation_mode valid_operating_modes[] = {UART_RS232};
@@ -163,19 +182,23 @@ freertos_uart_if freertos_uart_serial_init(Uart *p_uart,
 	/* Don't do anything unless a valid p_uart pointer was used, and a valid
 	operating mode was requested. */
 	if ((uart_index < MAX_UARTS) && (is_valid_operating_mode == true)) {
+		context = &(uart_contexts[uart_index]);
+
 		/* This function must be called exactly once per supported UART.  Check it
 		has not been called	before. */
-		configASSERT(rx_buffer_definitions[uart_index].next_byte_to_read == NULL);
+		configASSERT(context->peripheral == NULL);
+		context->peripheral = &(all_uart_definitions[uart_index]);
+		context->uart_index = uart_index;
 
 		/* Disable everything before enabling the clock. */
 		uart_disable_tx(p_uart);
 		uart_disable_rx(p_uart);
-		pdc_disable_transfer(all_uart_definitions[uart_index].pdc_base_address,
+		pdc_disable_transfer(context->peripheral->pdc_base_address,
 				(PERIPH_PTCR_RXTDIS | PERIPH_PTCR_TXTDIS));
 
 		/* Enable the peripheral clock in the PMC. */
 		pmc_enable_periph_clk(
-				all_uart_definitions[uart_index].peripheral_id);
+				context->peripheral->peripheral_id);
 
 		switch (freertos_driver_parameters->operation_mode) {
 		case UART_RS232:
@@ -197,8 +220,13 @@ freertos_uart_if freertos_uart_serial_init(Uart *p_uart,
 		created	separately. */
 		create_peripheral_control_semaphores(
 				freertos_driver_parameters->options_flags,
-				&(tx_dma_control[uart_index]),
+				&(context->tx_dma_control),
 				NULL /* The rx structures are not created in this function. */);
+		register_peripheral_control_object(
+				context->tx_dma_control.peripheral_access_sem,
+				context->tx_access_sem_name, "UART", uart_index, "Tx");
+		register_peripheral_stats(&(context->stats), context->stats_name,
+				"UART", uart_index);
 
 		/* Is the driver also going to receive? */
 		if (freertos_driver_parameters->receive_buffer != NULL) {
@@ -215,40 +243,46 @@ freertos_uart_if freertos_uart_serial_init(Uart *p_uart,
 			semaphore was a binary semaphore, it would then be 'taken' even
 			though, unknown to the reading task, unread and therefore available
 			data remained at the beginning of the buffer. */
-			rx_buffer_definitions[uart_index].rx_event_semaphore =
+			context->rx_buffer_definition.rx_event_semaphore =
 					xSemaphoreCreateCounting(portMAX_DELAY, 0);
-			configASSERT(rx_buffer_definitions[uart_index].rx_event_semaphore);
+			configASSERT(context->rx_buffer_definition.rx_event_semaphore);
 
 			/* The receive buffer is currently empty, so the DMA has control
 			over the entire buffer. */
-			rx_buffer_definitions[uart_index].rx_pdc_parameters.ul_addr =
+			context->rx_buffer_definition.rx_pdc_parameters.ul_addr =
 					(uint32_t)freertos_driver_parameters->receive_buffer;
-			rx_buffer_definitions[uart_index].rx_pdc_parameters.ul_size =
+			context->rx_buffer_definition.rx_pdc_parameters.ul_size =
 					freertos_driver_parameters->receive_buffer_size;
 			pdc_rx_init(
-					all_uart_definitions[uart_index].pdc_base_address,
-					&(rx_buffer_definitions[uart_index].rx_pdc_parameters),
+					context->peripheral->pdc_base_address,
+					&(context->rx_buffer_definition.rx_pdc_parameters),
 					NULL);
 
 			/* Set the next byte to read to the start of the buffer as no data
 			has yet been read. */
-			rx_buffer_definitions[uart_index].next_byte_to_read =
+			context->rx_buffer_definition.next_byte_to_read =
 					freertos_driver_parameters->receive_buffer;
 
 			/* Remember the limits of entire buffer. */
-			rx_buffer_definitions[uart_index].rx_buffer_start_address =
-					rx_buffer_definitions[uart_index].rx_pdc_parameters.ul_addr;
-			rx_buffer_definitions[uart_index].past_rx_buffer_end_address =
-					rx_buffer_definitions[uart_index].rx_buffer_start_address +
+			context->rx_buffer_definition.rx_buffer_start_address =
+					context->rx_buffer_definition.rx_pdc_parameters.ul_addr;
+			context->rx_buffer_definition.past_rx_buffer_end_address =
+					context->rx_buffer_definition.rx_buffer_start_address +
+					freertos_driver_parameters->receive_buffer_size;
+			context->stats.rx_buffer_size =
 					freertos_driver_parameters->receive_buffer_size;
 
 			/* If the rx driver is to be thread aware, create an access control
 			mutex. */
 			if ((freertos_driver_parameters->options_flags &
 					USE_RX_ACCESS_MUTEX) != 0) {
-				rx_buffer_definitions[uart_index].rx_access_mutex =
+				context->rx_buffer_definition.rx_access_mutex =
 					xSemaphoreCreateMutex();
-				configASSERT(rx_buffer_definitions[uart_index].rx_access_mutex);
+				configASSERT(context->rx_buffer_definition.rx_access_mutex);
+				register_peripheral_control_object(
+						context->rx_buffer_definition.rx_access_mutex,
+						context->rx_access_mutex_name, "UART", uart_index,
+						"Rx");
 			}
 
 			/* Catch the DMA running out of Rx space, and gaps in the
@@ -258,30 +292,30 @@ freertos_uart_if freertos_uart_serial_init(Uart *p_uart,
 
 			/* The Rx DMA is running all the time, so enable it now. */
 			pdc_enable_transfer(
-					all_uart_definitions[uart_index].pdc_base_address,
+					context->peripheral->pdc_base_address,
 					PERIPH_PTCR_RXTEN);
 		} else {
 			/* next_byte_to_read is used to check to see if this function
 			has been called before, so it must be set to something, even if
 			it is not going to be used.  The value it is set to is not
 			important, provided it is not zero (NULL). */
-			rx_buffer_definitions[uart_index].next_byte_to_read = RX_NOT_USED;
+			context->rx_buffer_definition.next_byte_to_read = RX_NOT_USED;
 		}
 
 		/* Configure and enable the UART interrupt in the interrupt controller. */
-		configure_interrupt_controller(all_uart_definitions[uart_index].peripheral_irq,
+		configure_interrupt_controller(context->peripheral->peripheral_irq,
 				freertos_driver_parameters->interrupt_priority);
 
 		/* Error interrupts are always enabled. */
 		uart_enable_interrupt(
-				all_uart_definitions[uart_index].peripheral_base_address,
+				context->peripheral->peripheral_base_address,
 				IER_ERROR_INTERRUPTS);
 
 		/* Finally, enable the receiver and transmitter. */
 		uart_enable_tx(p_uart);
 		uart_enable_rx(p_uart);
 
-		return_value = (freertos_uart_if) p_uart;
+		return_value = (freertos_uart_if) context;
 	} else {
 		return_value = NULL;
 	}
@@ -358,25 +392,26 @@ status_code_t freertos_uart_write_packet_async(freertos_uart_if p_uart,
 		xSemaphoreHandle notification_semaphore)
 {
 	status_code_t return_value;
-	portBASE_TYPE uart_index;
+	freertos_uart_context_t *context;
 	Uart *uart_base;
+	portTickType entry_ticks = xTaskGetTickCount();
+	size_t bytes_started = 0;
 
-	uart_base = (Uart *) p_uart;
-	uart_index = get_pdc_peripheral_details(all_uart_definitions,
-			MAX_UARTS,
-			(void *) uart_base);
+	context = get_uart_context(p_uart);
 
-	/* Don't do anything unless a valid UART pointer was used. */
-	if (uart_index < MAX_UARTS) {
+	/* Don't do anything unless a valid UART handle was used. */
+	if (context != NULL) {
+		uart_base = (Uart *) context->peripheral->peripheral_base_address;
 		return_value = freertos_obtain_peripheral_access_semphore(
-				&(tx_dma_control[uart_index]),
+				&(context->tx_dma_control),
 				&block_time_ticks);
 
 		if (return_value == STATUS_OK) {
-			freertos_start_pdc_tx(&(tx_dma_control[uart_index]),
+			freertos_start_pdc_tx(&(context->tx_dma_control),
 					data, len,
-					all_uart_definitions[uart_index].pdc_base_address,
+					context->peripheral->pdc_base_address,
 					notification_semaphore);
+			bytes_started = len;
 
 			/* Catch the end of transmission so the access mutex can be
 			returned, and the task notified (if it supplied a notification
@@ -386,10 +421,13 @@ status_code_t freertos_uart_write_packet_async(freertos_uart_if p_uart,
 			uart_enable_interrupt(uart_base, UART_IER_ENDTX);
 
 			return_value = freertos_optionally_wait_transfer_completion(
-					&(tx_dma_control[uart_index]),
+					&(context->tx_dma_control),
 					notification_semaphore,
 					block_time_ticks);
 		}
+
+		freertos_record_transfer(&(context->stats), true, bytes_started,
+				entry_ticks);
 	} else {
 		return_value = ERR_INVALID_ARG;
 	}
@@ -450,36 +488,34 @@ status_code_t freertos_uart_write_packet_async(freertos_uart_if p_uart,
 uint32_t freertos_uart_serial_read_packet(freertos_uart_if p_uart,
 		uint8_t *data, uint32_t len, portTickType block_time_ticks)
 {
-	portBASE_TYPE uart_index, attempt_read;
-	Uart *uart_base;
+	portBASE_TYPE attempt_read;
+	freertos_uart_context_t *context;
 	xTimeOutType time_out_definition;
+	portTickType entry_ticks = xTaskGetTickCount();
 	uint32_t bytes_read = 0;
 
-	uart_base = (Uart *) p_uart;
-	uart_index = get_pdc_peripheral_details(all_uart_definitions,
-			MAX_UARTS,
-			(void *) uart_base);
-
-	/* It is possible to initialise the peripheral to only use Tx and not Rx.
-	Check that Rx has been initialised. */
-	configASSERT(rx_buffer_definitions[uart_index].next_byte_to_read);
-	configASSERT(rx_buffer_definitions[uart_index].next_byte_to_read !=
-			RX_NOT_USED);
+	context = get_uart_context(p_uart);
 
 	/* Only do anything if the UART is valid. */
-	if (uart_index < MAX_UARTS) {
+	if (context != NULL) {
+		/* It is possible to initialise the peripheral to only use Tx and not
+		Rx.  Check that Rx has been initialised. */
+		configASSERT(context->rx_buffer_definition.next_byte_to_read);
+		configASSERT(context->rx_buffer_definition.next_byte_to_read !=
+				RX_NOT_USED);
+
 		/* Must not request more bytes than will fit in the buffer. */
 		if (len <=
-				(rx_buffer_definitions[uart_index].past_rx_buffer_end_address
-				- rx_buffer_definitions[uart_index].rx_buffer_start_address)) {
+				(context->rx_buffer_definition.past_rx_buffer_end_address
+				- context->rx_buffer_definition.rx_buffer_start_address)) {
 			/* Remember the time on entry. */
 			vTaskSetTimeOutState(&time_out_definition);
 
 			/* If an Rx mutex is in use, attempt to obtain it. */
-			if (rx_buffer_definitions[uart_index].rx_access_mutex != NULL) {
+			if (context->rx_buffer_definition.rx_access_mutex != NULL) {
 				/* Attempt to obtain the mutex. */
 				attempt_read = xSemaphoreTake(
-						rx_buffer_definitions[uart_index].rx_access_mutex,
+						context->rx_buffer_definition.rx_access_mutex,
 						block_time_ticks);
 
 				if (attempt_read == pdTRUE) {
@@ -491,7 +527,7 @@ uint32_t freertos_uart_serial_read_packet(freertos_uart_if p_uart,
 
 						/* The port is not going to be used, so return the
 						mutex now. */
-						xSemaphoreGive(rx_buffer_definitions[uart_index].rx_access_mutex);
+						xSemaphoreGive(context->rx_buffer_definition.rx_access_mutex);
 					}
 				}
 			} else {
@@ -501,14 +537,14 @@ uint32_t freertos_uart_serial_read_packet(freertos_uart_if p_uart,
 			if (attempt_read == pdTRUE) {
 				do {
 					/* Wait until data is available. */
-					xSemaphoreTake(rx_buffer_definitions[uart_index].rx_event_semaphore,
+					xSemaphoreTake(context->rx_buffer_definition.rx_event_semaphore,
 							block_time_ticks);
 
 					/* Copy as much data as is available, up to however much
 					a maximum of the total number of requested bytes. */
 					bytes_read += freertos_copy_bytes_from_pdc_circular_buffer(
-							&(rx_buffer_definitions[uart_index]),
-							all_uart_definitions[uart_index].pdc_base_address->PERIPH_RPR,
+							&(context->rx_buffer_definition),
+							context->peripheral->pdc_base_address->PERIPH_RPR,
 							&(data[bytes_read]),
 							(len - bytes_read));
 
@@ -519,8 +555,8 @@ uint32_t freertos_uart_serial_read_packet(freertos_uart_if p_uart,
 					if (bytes_read > 0) {
 						taskENTER_CRITICAL();
 						{
-							if(rx_buffer_definitions[uart_index].rx_pdc_parameters.ul_size == 0UL) {
-								configure_rx_dma(uart_index, data_removed);
+							if(context->rx_buffer_definition.rx_pdc_parameters.ul_size == 0UL) {
+								configure_rx_dma(context, data_removed);
 							}
 						}
 						taskEXIT_CRITICAL();
@@ -532,27 +568,82 @@ uint32_t freertos_uart_serial_read_packet(freertos_uart_if p_uart,
 						&time_out_definition,
 						&block_time_ticks) == pdFALSE));
 
-				if (rx_buffer_definitions[uart_index].rx_access_mutex != NULL) {
+				if (context->rx_buffer_definition.rx_access_mutex != NULL) {
 					/* Return the mutex. */
-					xSemaphoreGive(rx_buffer_definitions[uart_index].rx_access_mutex);
+					xSemaphoreGive(context->rx_buffer_definition.rx_access_mutex);
 				}
 			}
 		}
+
+		freertos_record_transfer(&(context->stats), false, bytes_read,
+				entry_ticks);
 	}
 
 	return bytes_read;
 }
 
+/**
+ * \ingroup freertos_uart_peripheral_control_group
+ * \brief Read the counters the driver keeps for a UART port.
+ *
+ * The driver counts the bytes and transfers in each direction, receive errors
+ * by type, the most unread bytes the receive buffer has held, and the time
+ * tasks have spent in the read and write functions.  The snapshot is taken in
+ * a critical section, so the counters are consistent with each other.
+ *
+ * \param p_uart    The handle to the UART port returned by the
+ *     freertos_uart_serial_init() call used to initialise the port.
+ * \param stats    Filled in with a copy of the counters.
+ * \param reset    If true the counters are cleared once they have been copied.
+ *
+ * \return     ERR_INVALID_ARG if a parameter is invalid, otherwise STATUS_OK.
+ */
+status_code_t freertos_uart_get_stats(freertos_uart_if p_uart,
+		freertos_peripheral_stats_t *stats, bool reset)
+{
+	freertos_uart_context_t *context;
+	status_code_t return_value = ERR_INVALID_ARG;
+
+	context = get_uart_context(p_uart);
+
+	if ((context != NULL) && (stats != NULL)) {
+		freertos_copy_peripheral_stats(&(context->stats), stats, reset);
+		return_value = STATUS_OK;
+	}
+
+	return return_value;
+}
+
+/*
+ * For internal use only.
+ * Returns the driver context that a freertos_uart_if handle points to, or NULL
+ * if the handle is not one returned by freertos_uart_serial_init().  The handle
+ * is checked by its position in uart_contexts[] rather than by searching for a
+ * matching base address.
+ */
+static freertos_uart_context_t *get_uart_context(freertos_uart_if p_uart)
+{
+	freertos_uart_context_t *context = (freertos_uart_context_t *) p_uart;
+
+	if ((context < &(uart_contexts[0])) ||
+			(context >= &(uart_contexts[MAX_UARTS])) ||
+			(context->peripheral == NULL)) {
+		context = NULL;
+	}
+
+	return context;
+}
+
 /*
  * For internal use only.
  * Configures the Rx DMA to receive data into free space within the Rx buffer.
  */
-static void configure_rx_dma(uint32_t uart_index,
+static void configure_rx_dma(freertos_uart_context_t *context,
 		enum buffer_operations operation_performed)
 {
 	freertos_pdc_rx_control_t *rx_buffer_definition;
 
-	rx_buffer_definition = &(rx_buffer_definitions[uart_index]);
+	rx_buffer_definition = &(context->rx_buffer_definition);
 
 	/* How much space is there between the start of the DMA buffer and the
 	current read pointer?  */
@@ -592,20 +683,20 @@ static void configure_rx_dma(uint32_t uart_index,
 		as remaining.  First clear any characters that might already be in the
 		registers. */
 		pdc_rx_init(
-				all_uart_definitions[uart_index].pdc_base_address, &rx_buffer_definition->rx_pdc_parameters,
+				context->peripheral->pdc_base_address, &rx_buffer_definition->rx_pdc_parameters,
 				NULL);
 		pdc_enable_transfer(
-				all_uart_definitions[uart_index].pdc_base_address,
+				context->peripheral->pdc_base_address,
 				PERIPH_PTCR_RXTEN);
 		uart_enable_interrupt(
-				all_uart_definitions[uart_index].peripheral_base_address,
+				context->peripheral->peripheral_base_address,
 				UART_IER_ENDRX | UART_IER_RXRDY);
 	} else {
 		/* The write pointer has reached the read pointer.  There is no
 		more room so the DMA is not re-enabled until a read has created
 		space. */
 		uart_disable_interrupt(
-				all_uart_definitions[uart_index].peripheral_base_address,
+				context->peripheral->peripheral_base_address,
 				UART_IDR_ENDRX | UART_IDR_RXRDY);
 	}
 }
@@ -618,34 +709,35 @@ static void local_uart_handler(const portBASE_TYPE uart_index)
 {
 	portBASE_TYPE higher_priority_task_woken = pdFALSE;
 	uint32_t uart_status;
+	freertos_uart_context_t *context = &(uart_contexts[uart_index]);
 	freertos_pdc_rx_control_t *rx_buffer_definition;
 
 	uart_status = uart_get_status(
-			all_uart_definitions[uart_index].peripheral_base_address);
+			context->peripheral->peripheral_base_address);
 	uart_status &= uart_get_interrupt_mask(
-			all_uart_definitions[uart_index].peripheral_base_address);
+			context->peripheral->peripheral_base_address);
 
-	rx_buffer_definition = &(rx_buffer_definitions[uart_index]);
+	rx_buffer_definition = &(context->rx_buffer_definition);
 
 	/* Has the PDC completed a transmission? */
 	if ((uart_status & UART_SR_ENDTX) != 0UL) {
 		uart_disable_interrupt(
-				all_uart_definitions[uart_index].peripheral_base_address,
+				context->peripheral->peripheral_base_address,
 				UART_IDR_ENDTX);
 
 		/* If the driver is supporting multi-threading, then return the access
 		mutex. */
-		if (tx_dma_control[uart_index].peripheral_access_sem != NULL) {
+		if (context->tx_dma_control.peripheral_access_sem != NULL) {
 			xSemaphoreGiveFromISR(
-					tx_dma_control[uart_index].peripheral_access_sem,
+					context->tx_dma_control.peripheral_access_sem,
 					&higher_priority_task_woken);
 		}
 
 		/* if the sending task supplied a notification semaphore, then
 		notify the task that the transmission has completed. */
-		if (tx_dma_control[uart_index].transaction_complete_notification_semaphore != NULL) {
+		if (context->tx_dma_control.transaction_complete_notification_semaphore != NULL) {
 			xSemaphoreGiveFromISR(
-					tx_dma_control[uart_index].transaction_complete_notification_semaphore,
+					context->tx_dma_control.transaction_complete_notification_semaphore,
 					&higher_priority_task_woken);
 		}
 	}
@@ -673,7 +765,10 @@ static void local_uart_handler(const portBASE_TYPE uart_index)
 
 		/* Reset the Rx DMA to receive data into whatever free space remains in
 		the Rx buffer. */
-		configure_rx_dma(uart_index, data_added);
+		configure_rx_dma(context, data_added);
+		freertos_record_rx_buffer_level(&(context->stats),
+				rx_buffer_definition,
+				context->peripheral->pdc_base_address->PERIPH_RPR);
 
 		if (rx_buffer_definition->rx_event_semaphore != NULL) {
 			/* Notify that new data is available. */
@@ -693,6 +788,10 @@ static void local_uart_handler(const portBASE_TYPE uart_index)
 	if (uart_status == 0UL) {
 		/* Character has been placed into the Rx buffer. */
 		if (rx_buffer_definition->rx_event_semaphore != NULL) {
+			freertos_record_rx_buffer_level(&(context->stats),
+					rx_buffer_definition,
+					context->peripheral->pdc_base_address->PERIPH_RPR);
+
 			/* Notify that new data is available. */
 			xSemaphoreGiveFromISR(
 					rx_buffer_definition->rx_event_semaphore,
@@ -703,11 +802,21 @@ static void local_uart_handler(const portBASE_TYPE uart_index)
 	if ((uart_status & SR_ERROR_INTERRUPTS) != 0) {
 		/* An error occurred in either a transmission or reception.  Abort, and
 		ensure the peripheral access mutex is made available to tasks. */
+		if ((uart_status & UART_SR_OVRE) != 0) {
+			context->stats.overrun_errors++;
+		}
+		if ((uart_status & UART_SR_FRAME) != 0) {
+			context->stats.framing_errors++;
+		}
+		if ((uart_status & UART_SR_PARE) != 0) {
+			context->stats.parity_errors++;
+		}
+
 		uart_reset_status(
-				all_uart_definitions[uart_index].peripheral_base_address);
-		if (tx_dma_control[uart_index].peripheral_access_sem != NULL) {
+				context->peripheral->peripheral_base_address);
+		if (context->tx_dma_control.peripheral_access_sem != NULL) {
 			xSemaphoreGiveFromISR(
-					tx_dma_control[uart_index].peripheral_access_sem,
+					context->tx_dma_control.peripheral_access_sem,
 					&higher_priority_task_woken);
 		}
 	}
@@ -75,7 +75,8 @@ extern "C" {
  *     ypedef freertos_uart_if
  * \brief Type returned from a call to freertos_uart_serial_init(), and then
  * used to reference a UART port in calls to FreeRTOS peripheral control
- * functions.
+ * functions.  It points to the driver's context for the port and is not the
+ * base address of the UART.
  */
 typedef void *freertos_uart_if;
 
@@ -90,6 +91,9 @@ status_code_t freertos_uart_write_packet_async(freertos_uart_if p_uart,
 uint32_t freertos_uart_serial_read_packet(freertos_uart_if p_uart,
 		uint8_t *data, uint32_t len, portTickType block_time_ticks);
 
+status_code_t freertos_uart_get_stats(freertos_uart_if p_uart,
+		freertos_peripheral_stats_t *stats, bool reset);
+
 /**
  * \ingroup freertos_uart_peripheral_control_group
  * \brief Initiate a multi-byte write operation on an UART peripheral.
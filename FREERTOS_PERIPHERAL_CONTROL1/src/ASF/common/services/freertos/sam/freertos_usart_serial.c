@@ -41,6 +41,7 @@
 #include "serial.h"
 #include "freertos_usart_serial.h"
 #include "freertos_peripheral_control_private.h"
+#include "latency_monitor.h"
 #if (SAMG55)
 #include "flexcom.h"
 #endif
@@ -60,6 +61,11 @@ initialised and therefore should not be used. */
 Equivalent to times 5 then divide by 1000. */
 #define BITS_PER_5_MS               (200UL)
 
+/* The number of segments that can be waiting to be transmitted by
+freertos_usart_writev_async() on each port, including the (up to) two the PDC
+is working on. */
+#define TX_DESCRIPTOR_QUEUE_LENGTH  (8UL)
+
 /* Work out how many USARTS are present. */
 #if defined(PDC_USART7)
 	#define MAX_USARTS                              (8)
@@ -89,16 +95,88 @@ enum buffer_operations {
 	data_removed
 };
 
+/* One segment waiting to be transmitted, or being transmitted, by the PDC. */
+typedef struct tx_descriptor {
+	pdc_packet_t pdc_packet;
+	xSemaphoreHandle notification_semaphore;	/*< Given when the segment has been sent.  Only set on the last segment of a write. */
+} tx_descriptor_t;
+
+/* Segments written by freertos_usart_writev_async().  The counts run freely
+and are used modulo TX_DESCRIPTOR_QUEUE_LENGTH.  Segments from completed up to
+started are with the PDC (at most two, in the current and next registers), and
+segments from started up to queued are waiting. */
+typedef struct tx_descriptor_queue {
+	tx_descriptor_t descriptors[TX_DESCRIPTOR_QUEUE_LENGTH];
+	uint32_t queued;
+	uint32_t started;
+	uint32_t completed;
+	bool is_active;								/*< The queue owns the PDC, and the Tx access semaphore if there is one, until it empties. */
+	xSemaphoreHandle space_semaphore;			/*< Given each time a segment completes, for writers waiting for space. */
+} tx_descriptor_queue_t;
+
+/* Everything the driver holds for one USART port.  The freertos_usart_if handle
+returned by freertos_usart_serial_init() points to the port's context, so the
+driver functions go straight from the handle to the port. */
+typedef struct freertos_usart_context {
+	const freertos_pdc_peripheral_parameters_t *peripheral;	/*< The port's entry in all_usart_definitions[], NULL until the port is initialised. */
+	portBASE_TYPE usart_index;								/*< The position of the port in all_usart_definitions[]. */
+	freertos_pdc_rx_control_t rx_buffer_definition;		/*< The Rx circular buffer and the PDC's position within it. */
+	freertos_dma_event_control_t tx_dma_control;			/*< Tx access and completion semaphores. */
+	tx_descriptor_queue_t tx_descriptor_queue;			/*< Segments written by freertos_usart_writev_async(). */
+	volatile bool rx_line_idle;							/*< Set by the receive timeout interrupt when the line has been idle for the time set by freertos_usart_set_rx_idle_timeout(), and cleared by the reader. */
+	bool end_read_on_idle;								/*< Whether freertos_usart_serial_read_packet() returns as soon as the line goes idle, rather than waiting for all the requested bytes. */
+	bool is_rx_flow_controlled;							/*< The port uses RTS/CTS hardware handshaking. */
+	uint32_t rx_high_watermark;							/*< The PDC is not given space that would take the unread bytes above this.  With hardware handshaking the USART deasserts RTS when the PDC stops.  The buffer size if the port is not flow controlled. */
+	uint32_t rx_low_watermark;							/*< A PDC stopped by the high watermark is only restarted, asserting RTS again, once the unread bytes are at or below this. */
+	freertos_peripheral_stats_t stats;					/*< Read by freertos_usart_get_stats(). */
+	char tx_access_sem_name[PERIPHERAL_OBJECT_NAME_LEN];	/*< Names under which the access semaphore and mutex are added to the queue registry, and the counters are listed. */
+	char rx_access_mutex_name[PERIPHERAL_OBJECT_NAME_LEN];
+	char stats_name[PERIPHERAL_OBJECT_NAME_LEN];
+} freertos_usart_context_t;
+
+/* Returns the context a handle points to, or NULL if it is not a valid
+handle. */
+static freertos_usart_context_t *get_usart_context(freertos_usart_if p_usart);
+
 /* Configures the Rx DMA to receive data into free space within the Rx buffer. */
-static void configure_rx_dma(uint32_t usart_index,
+static void configure_rx_dma(freertos_usart_context_t *context,
 		enum buffer_operations operation_performed);
 
+/* Returns the number of unread bytes in the Rx buffer once everything before
+write_address has been received. */
+static uint32_t get_rx_bytes_unread(
+		freertos_pdc_rx_control_t *rx_buffer_definition,
+		uint32_t write_address, bool is_full_if_equal);
+
+/* Limits a section of the Rx buffer so the unread bytes stay within the high
+watermark. */
+static uint32_t cap_rx_section_size(freertos_usart_context_t *context,
+		uint32_t section_size, uint32_t bytes_unread);
+
+/* Works out the section of the Rx buffer the PDC can move on to when the
+current section is full. */
+static void set_next_rx_segment(freertos_usart_context_t *context);
+
+/* Queues more Rx buffer space with the PDC after a task has read data out. */
+static void extend_rx_dma(freertos_usart_context_t *context);
+
+/* Moves the Rx DMA on when the PDC has filled the current section. */
+static void rx_segment_complete(freertos_usart_context_t *context);
+
+/* Gives the PDC as many queued Tx segments as it can hold. */
+static void feed_tx_dma(freertos_usart_context_t *context,
+		portBASE_TYPE *higher_priority_task_woken);
+
+/* Moves the Tx DMA on when the PDC has sent its current segment. */
+static void tx_segment_complete(freertos_usart_context_t *context,
+		portBASE_TYPE *higher_priority_task_woken);
+
 /* A common interrupt handler called by all the USART peripherals. */
 static void local_usart_handler(const portBASE_TYPE usart_index);
 
-/* Structures to manage the DMA control for both Rx and Tx transactions. */
-static freertos_pdc_rx_control_t rx_buffer_definitions[MAX_USARTS];
-static freertos_dma_event_control_t tx_dma_control[MAX_USARTS];
+/* The driver context of each USART, in the same order as
+all_usart_definitions[]. */
+static freertos_usart_context_t usart_contexts[MAX_USARTS];
 
 /* Create an array that holds the information required about each defined
 USART. */
@@ -166,8 +244,13 @@ static const freertos_pdc_peripheral_parameters_t all_usart_definitions[MAX_USAR
  *
  * If freertos_driver_parameters->operation_mode equals USART_RS232 then
  * freertos_usart_serial_init() will configure the USART port for standard RS232
- * operation.  If freertos_driver_parameters->operation_mode equals any other
- * value then freertos_usart_serial_init() will not take any action.
+ * operation.  If it equals USART_RS232_HW_HANDSHAKING then the port is
+ * configured for RS232 with RTS/CTS flow control: the transmitter waits while
+ * CTS is deasserted, and RTS is deasserted while the receive buffer is above
+ * its high watermark (see freertos_usart_set_rx_flow_control_watermarks()).
+ * The RTS and CTS pins must be configured for the USART by the board
+ * initialisation.  If freertos_driver_parameters->operation_mode equals any
+ * other value then freertos_usart_serial_init() will not take any action.
  *
  * Other ASF USART functions can be called after freertos_usart_serial_init()
  * has completed successfully.
@@ -196,9 +279,11 @@ freertos_usart_if freertos_usart_serial_init(Usart *p_usart,
 		const freertos_peripheral_options_t *const freertos_driver_parameters)
 {
 	portBASE_TYPE usart_index;
+	freertos_usart_context_t *context;
 	bool is_valid_operating_mode;
 	freertos_usart_if return_value;
-	const enum peripheral_operation_mode valid_operating_modes[] = {USART_RS232};
+	const enum peripheral_operation_mode valid_operating_modes[] = {USART_RS232,
+			USART_RS232_HW_HANDSHAKING};
 
 	/* Find the index into the all_usart_definitions array that holds details of
 	the p_usart peripheral. */
@@ -216,26 +301,30 @@ freertos_usart_if freertos_usart_serial_init(Usart *p_usart,
 	/* Don't do anything unless a valid p_usart pointer was used, and a valid
 	operating mode was requested. */
 	if ((usart_index < MAX_USARTS) && (is_valid_operating_mode == true)) {
+		context = &(usart_contexts[usart_index]);
+
 		/* This function must be called exactly once per supported USART.  Check it
 		has not been called	before. */
-		configASSERT(rx_buffer_definitions[usart_index].next_byte_to_read == NULL);
+		configASSERT(context->peripheral == NULL);
+		context->peripheral = &(all_usart_definitions[usart_index]);
+		context->usart_index = usart_index;
 
 		/* Disable everything before enabling the clock. */
 		usart_disable_tx(p_usart);
 		usart_disable_rx(p_usart);
-		pdc_disable_transfer(all_usart_definitions[usart_index].pdc_base_address,
+		pdc_disable_transfer(context->peripheral->pdc_base_address,
 				(PERIPH_PTCR_RXTDIS | PERIPH_PTCR_TXTDIS));
 
 #if (SAMG55)
 		/* Enable the peripheral and set USART mode. */
-		uint32_t temp = (uint32_t)all_usart_definitions[usart_index].peripheral_base_address - 0x200;
+		uint32_t temp = (uint32_t)context->peripheral->peripheral_base_address - 0x200;
 		Flexcom *p_flexcom = (Flexcom *)temp;
 		flexcom_enable(p_flexcom);
 		flexcom_set_opmode(p_flexcom, FLEXCOM_USART);
 #else
 		/* Enable the peripheral clock in the PMC. */
 		pmc_enable_periph_clk(
-				all_usart_definitions[usart_index].peripheral_id);
+				context->peripheral->peripheral_id);
 #endif
 
 		switch (freertos_driver_parameters->operation_mode) {
@@ -245,6 +334,14 @@ freertos_usart_if freertos_usart_serial_init(Usart *p_usart,
 					sysclk_get_cpu_hz());
 			break;
 
+		case USART_RS232_HW_HANDSHAKING:
+			/* The transmitter waits while CTS is deasserted, and RTS is
+			deasserted while the Rx PDC has no buffer space. */
+			usart_init_hw_handshaking(p_usart, uart_parameters,
+					sysclk_get_cpu_hz());
+			context->is_rx_flow_controlled = true;
+			break;
+
 		default:
 			/* Other modes are not currently supported. */
 			break;
@@ -259,8 +356,19 @@ freertos_usart_if freertos_usart_serial_init(Usart *p_usart,
 		created	separately. */
 		create_peripheral_control_semaphores(
 				freertos_driver_parameters->options_flags,
-				&(tx_dma_control[usart_index]),
+				&(context->tx_dma_control),
 				NULL /* The rx structures are not created in this function. */);
+		register_peripheral_control_object(
+				context->tx_dma_control.peripheral_access_sem,
+				context->tx_access_sem_name, "USART", usart_index, "Tx");
+		register_peripheral_stats(&(context->stats), context->stats_name,
+				"USART", usart_index);
+
+		/* Used by vectored writes waiting for room in the descriptor
+		queue. */
+		vSemaphoreCreateBinary(
+				context->tx_descriptor_queue.space_semaphore);
+		configASSERT(context->tx_descriptor_queue.space_semaphore);
 
 		/* Is the driver also going to receive? */
 		if (freertos_driver_parameters->receive_buffer != NULL) {
@@ -277,47 +385,70 @@ freertos_usart_if freertos_usart_serial_init(Usart *p_usart,
 			semaphore was a binary semaphore, it would then be 'taken' even
 			though, unknown to the reading task, unread and therefore available
 			data remained at the beginning of the buffer. */
-			rx_buffer_definitions[usart_index].rx_event_semaphore =
+			context->rx_buffer_definition.rx_event_semaphore =
 					xSemaphoreCreateCounting(portMAX_DELAY, 0);
-			configASSERT(rx_buffer_definitions[usart_index].rx_event_semaphore);
+			configASSERT(context->rx_buffer_definition.rx_event_semaphore);
 
 			/* Set the timeout to 5ms, then start waiting for a character (the
 			timeout is not started until characters have started to	be
-			received). */
+			received).  freertos_usart_set_rx_idle_timeout() can change it
+			later. */
 			usart_set_rx_timeout(p_usart,
 					(uart_parameters->baudrate / BITS_PER_5_MS));
 			usart_start_rx_timeout(p_usart);
 
+			/* With flow control, stop the sender when the buffer is three
+			quarters full, and restart it when it is down to a quarter.
+			freertos_usart_set_rx_flow_control_watermarks() can change this
+			later.  Without flow control the whole buffer can be filled. */
+			if (context->is_rx_flow_controlled) {
+				context->rx_low_watermark =
+						freertos_driver_parameters->receive_buffer_size / 4;
+				context->rx_high_watermark =
+						freertos_driver_parameters->receive_buffer_size -
+						context->rx_low_watermark;
+			} else {
+				context->rx_high_watermark =
+						freertos_driver_parameters->receive_buffer_size;
+				context->rx_low_watermark = context->rx_high_watermark;
+			}
+
 			/* The receive buffer is currently empty, so the DMA has control
-			over the entire buffer. */
-			rx_buffer_definitions[usart_index].rx_pdc_parameters.ul_addr =
+			over the entire buffer, up to the high watermark. */
+			context->rx_buffer_definition.rx_pdc_parameters.ul_addr =
 					(uint32_t)freertos_driver_parameters->receive_buffer;
-			rx_buffer_definitions[usart_index].rx_pdc_parameters.ul_size =
-					freertos_driver_parameters->receive_buffer_size;
+			context->rx_buffer_definition.rx_pdc_parameters.ul_size =
+					context->rx_high_watermark;
 			pdc_rx_init(
-					all_usart_definitions[usart_index].pdc_base_address,
-					&(rx_buffer_definitions[usart_index].rx_pdc_parameters),
+					context->peripheral->pdc_base_address,
+					&(context->rx_buffer_definition.rx_pdc_parameters),
 					NULL);
 
 			/* Set the next byte to read to the start of the buffer as no data
 			has yet been read. */
-			rx_buffer_definitions[usart_index].next_byte_to_read =
+			context->rx_buffer_definition.next_byte_to_read =
 					freertos_driver_parameters->receive_buffer;
 
 			/* Remember the limits of entire buffer. */
-			rx_buffer_definitions[usart_index].rx_buffer_start_address =
-					rx_buffer_definitions[usart_index].rx_pdc_parameters.ul_addr;
-			rx_buffer_definitions[usart_index].past_rx_buffer_end_address =
-					rx_buffer_definitions[usart_index].rx_buffer_start_address +
+			context->rx_buffer_definition.rx_buffer_start_address =
+					context->rx_buffer_definition.rx_pdc_parameters.ul_addr;
+			context->rx_buffer_definition.past_rx_buffer_end_address =
+					context->rx_buffer_definition.rx_buffer_start_address +
+					freertos_driver_parameters->receive_buffer_size;
+			context->stats.rx_buffer_size =
 					freertos_driver_parameters->receive_buffer_size;
 
 			/* If the rx driver is to be thread aware, create an access control
 			mutex. */
 			if ((freertos_driver_parameters->options_flags &
 					USE_RX_ACCESS_MUTEX) != 0) {
-				rx_buffer_definitions[usart_index].rx_access_mutex =
+				context->rx_buffer_definition.rx_access_mutex =
 					xSemaphoreCreateMutex();
-				configASSERT(rx_buffer_definitions[usart_index].rx_access_mutex);
+				configASSERT(context->rx_buffer_definition.rx_access_mutex);
+				register_peripheral_control_object(
+						context->rx_buffer_definition.rx_access_mutex,
+						context->rx_access_mutex_name, "USART", usart_index,
+						"Rx");
 			}
 
 			/* Catch the DMA running out of Rx space, and gaps in the
@@ -327,30 +458,30 @@ freertos_usart_if freertos_usart_serial_init(Usart *p_usart,
 
 			/* The Rx DMA is running all the time, so enable it now. */
 			pdc_enable_transfer(
-					all_usart_definitions[usart_index].pdc_base_address,
+					context->peripheral->pdc_base_address,
 					PERIPH_PTCR_RXTEN);
 		} else {
 			/* next_byte_to_read is used to check to see if this function
 			has been called before, so it must be set to something, even if
 			it is not going to be used.  The value it is set to is not
 			important, provided it is not zero (NULL). */
-			rx_buffer_definitions[usart_index].next_byte_to_read = RX_NOT_USED;
+			context->rx_buffer_definition.next_byte_to_read = RX_NOT_USED;
 		}
 
 		/* Configure and enable the USART interrupt in the interrupt controller. */
-		configure_interrupt_controller(all_usart_definitions[usart_index].peripheral_irq,
+		configure_interrupt_controller(context->peripheral->peripheral_irq,
 				freertos_driver_parameters->interrupt_priority);
 
 		/* Error interrupts are always enabled. */
 		usart_enable_interrupt(
-				all_usart_definitions[usart_index].peripheral_base_address,
+				context->peripheral->peripheral_base_address,
 				IER_ERROR_INTERRUPTS);
 
 		/* Finally, enable the receiver and transmitter. */
 		usart_enable_tx(p_usart);
 		usart_enable_rx(p_usart);
 
-		return_value = (freertos_usart_if) p_usart;
+		return_value = (freertos_usart_if) context;
 	} else {
 		return_value = NULL;
 	}
@@ -427,25 +558,33 @@ status_code_t freertos_usart_write_packet_async(freertos_usart_if p_usart,
 		xSemaphoreHandle notification_semaphore)
 {
 	status_code_t return_value;
-	portBASE_TYPE usart_index;
+	freertos_usart_context_t *context;
 	Usart *usart_base;
+	portTickType entry_ticks = xTaskGetTickCount();
+	size_t bytes_started = 0;
 
-	usart_base = (Usart *) p_usart;
-	usart_index = get_pdc_peripheral_details(all_usart_definitions,
-			MAX_USARTS,
-			(void *) usart_base);
+	context = get_usart_context(p_usart);
 
-	/* Don't do anything unless a valid USART pointer was used. */
-	if (usart_index < MAX_USARTS) {
+	/* Don't do anything unless a valid USART handle was used. */
+	if (context != NULL) {
+		usart_base = (Usart *) context->peripheral->peripheral_base_address;
 		return_value = freertos_obtain_peripheral_access_semphore(
-				&(tx_dma_control[usart_index]),
+				&(context->tx_dma_control),
 				&block_time_ticks);
 
 		if (return_value == STATUS_OK) {
-			freertos_start_pdc_tx(&(tx_dma_control[usart_index]),
+			freertos_start_pdc_tx(&(context->tx_dma_control),
 					data, len,
-					all_usart_definitions[usart_index].pdc_base_address,
+					context->peripheral->pdc_base_address,
 					notification_semaphore);
+			bytes_started = len;
+
+			/* If the task is going to block until the transmission completes,
+			time how long it takes to be woken once the PDC finishes.  This
+			must be done before ENDTX is enabled. */
+			if (notification_semaphore == NULL) {
+				LAT_RECORD_TASK_WAIT(LAT_PATH_USART_TX);
+			}
 
 			/* Catch the end of transmission so the access mutex can be
 			returned, and the task notified (if it supplied a notification
@@ -455,10 +594,17 @@ status_code_t freertos_usart_write_packet_async(freertos_usart_if p_usart,
 			usart_enable_interrupt(usart_base, US_IER_ENDTX);
 
 			return_value = freertos_optionally_wait_transfer_completion(
-					&(tx_dma_control[usart_index]),
+					&(context->tx_dma_control),
 					notification_semaphore,
 					block_time_ticks);
+
+			if (notification_semaphore == NULL) {
+				LAT_RECORD_TASK_RUN(LAT_PATH_USART_TX);
+			}
 		}
+
+		freertos_record_transfer(&(context->stats), true, bytes_started,
+				entry_ticks);
 	} else {
 		return_value = ERR_INVALID_ARG;
 	}
@@ -466,6 +612,152 @@ status_code_t freertos_usart_write_packet_async(freertos_usart_if p_usart,
 	return return_value;
 }
 
+/**
+ * \ingroup freertos_usart_peripheral_control_group
+ * \brief Initiate a completely asynchronous vectored (scatter-gather) write
+ * operation on a USART peripheral.
+ *
+ * freertos_usart_writev_async() queues each segment in iov with the driver
+ * then returns, normally without waiting.  The driver keeps up to two segments
+ * in the PDC current and next registers, so consecutive segments, and
+ * consecutive writes, are transmitted back to back with no gap between them.
+ * Further segments wait in a queue of TX_DESCRIPTOR_QUEUE_LENGTH descriptors
+ * per port.
+ *
+ * The Tx access semaphore (if USE_TX_ACCESS_SEM was set when the port was
+ * initialized) is taken by the first write to find the queue empty, and given
+ * back by the driver once the queue has emptied again, so writes made while
+ * the queue is busy are simply appended.  freertos_usart_write_packet() and
+ * freertos_usart_write_packet_async() wait until the queue has emptied.
+ *
+ * The FreeRTOS ASF driver both installs and handles the USART PDC interrupts.
+ * Users do not need to concern themselves with interrupt handling, and must
+ * not install their own interrupt handler.
+ *
+ * \param p_usart    The handle to the USART peripheral returned by the
+ *     freertos_usart_serial_init() call used to initialise the peripheral.
+ * \param iov    The segments to transmit, in order.  The data is read by the
+ *     PDC, so it must be in RAM and must not be modified until the write has
+ *     completed.  The iov array itself can be reused as soon as the function
+ *     returns.
+ * \param iovcnt    The number of segments in iov.  The segments that are not
+ *     empty must fit in the descriptor queue (TX_DESCRIPTOR_QUEUE_LENGTH).
+ * \param block_time_ticks    The maximum time to wait for exclusive access to
+ *     the USART if the queue is empty, or for room in the queue if it is not.
+ *     Other tasks will execute during any waiting time.
+ * \param notification_semaphore    If not NULL, given by the PDC interrupt
+ *     when the last segment of this write has been transmitted, so the calling
+ *     task knows the data can be reused.
+ *
+ * \return     ERR_INVALID_ARG is returned if an input parameter is invalid.
+ *     ERR_TIMEOUT is returned if block_time_ticks passed before the write could
+ *     be queued.  STATUS_OK is returned if the write was queued.
+ */
+status_code_t freertos_usart_writev_async(freertos_usart_if p_usart,
+		const freertos_iovec_t *iov, size_t iovcnt,
+		portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore)
+{
+	status_code_t return_value = STATUS_OK;
+	freertos_usart_context_t *context;
+	portBASE_TYPE higher_priority_task_woken = pdFALSE;
+	tx_descriptor_queue_t *tx_queue;
+	tx_descriptor_t *descriptor = NULL;
+	xTimeOutType time_out_definition;
+	portTickType entry_ticks = xTaskGetTickCount();
+	size_t segment, segment_count = 0, bytes_queued = 0;
+	bool is_queued = false, is_access_needed;
+
+	context = get_usart_context(p_usart);
+
+	if ((context == NULL) || ((iov == NULL) && (iovcnt > 0))) {
+		return ERR_INVALID_ARG;
+	}
+
+	tx_queue = &(context->tx_descriptor_queue);
+
+	for (segment = 0; segment < iovcnt; segment++) {
+		if (iov[segment].len > 0) {
+			segment_count++;
+			bytes_queued += iov[segment].len;
+		}
+	}
+
+	if (segment_count > TX_DESCRIPTOR_QUEUE_LENGTH) {
+		return ERR_INVALID_ARG;
+	}
+
+	if (segment_count == 0) {
+		/* Nothing to send, so the write has already completed. */
+		if (notification_semaphore != NULL) {
+			xSemaphoreGive(notification_semaphore);
+		}
+		return STATUS_OK;
+	}
+
+	vTaskSetTimeOutState(&time_out_definition);
+
+	while ((is_queued == false) && (return_value == STATUS_OK)) {
+		is_access_needed = false;
+
+		taskENTER_CRITICAL();
+		{
+			if (tx_queue->is_active == false) {
+				is_access_needed = true;
+			} else if ((TX_DESCRIPTOR_QUEUE_LENGTH -
+					(tx_queue->queued - tx_queue->completed)) >= segment_count) {
+				for (segment = 0; segment < iovcnt; segment++) {
+					if (iov[segment].len > 0) {
+						descriptor = &(tx_queue->descriptors[tx_queue->queued %
+								TX_DESCRIPTOR_QUEUE_LENGTH]);
+						descriptor->pdc_packet.ul_addr = (uint32_t) iov[segment].data;
+						descriptor->pdc_packet.ul_size = (uint32_t) iov[segment].len;
+						descriptor->notification_semaphore = NULL;
+						tx_queue->queued++;
+					}
+				}
+
+				/* Only the end of the write is notified. */
+				descriptor->notification_semaphore = notification_semaphore;
+
+				feed_tx_dma(context, &higher_priority_task_woken);
+				is_queued = true;
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		if (is_access_needed == true) {
+			/* The queue is empty and the transmitter may be in use by an
+			ordinary write, so obtain exclusive access to it first. */
+			return_value = freertos_obtain_peripheral_access_semphore(
+					&(context->tx_dma_control),
+					&block_time_ticks);
+
+			if (return_value == STATUS_OK) {
+				tx_queue->is_active = true;
+			}
+		} else if (is_queued == false) {
+			/* Wait for the PDC to finish a segment and make room. */
+			if ((xSemaphoreTake(tx_queue->space_semaphore,
+					block_time_ticks) != pdPASS) ||
+					(xTaskCheckForTimeOut(&time_out_definition,
+					&block_time_ticks) == pdTRUE)) {
+				return_value = ERR_TIMEOUT;
+			}
+		}
+	}
+
+	freertos_record_transfer(&(context->stats), true,
+			(is_queued == true) ? bytes_queued : 0, entry_ticks);
+
+	/* A segment may have completed while the queue was being fed. */
+	if (higher_priority_task_woken != pdFALSE) {
+		taskYIELD();
+	}
+
+	return return_value;
+}
+
 /**
  * \ingroup freertos_usart_peripheral_control_group
  * \brief Initiate a completely multi-byte read operation on a USART peripheral.
@@ -519,36 +811,35 @@ status_code_t freertos_usart_write_packet_async(freertos_usart_if p_usart,
 uint32_t freertos_usart_serial_read_packet(freertos_usart_if p_usart,
 		uint8_t *data, uint32_t len, portTickType block_time_ticks)
 {
-	portBASE_TYPE usart_index, attempt_read;
-	Usart *usart_base;
+	portBASE_TYPE attempt_read;
+	freertos_usart_context_t *context;
 	xTimeOutType time_out_definition;
+	portTickType entry_ticks = xTaskGetTickCount();
 	uint32_t bytes_read = 0;
+	bool is_frame_complete = false;
 
-	usart_base = (Usart *) p_usart;
-	usart_index = get_pdc_peripheral_details(all_usart_definitions,
-			MAX_USARTS,
-			(void *) usart_base);
-
-	/* It is possible to initialise the peripheral to only use Tx and not Rx.
-	Check that Rx has been initialised. */
-	configASSERT(rx_buffer_definitions[usart_index].next_byte_to_read);
-	configASSERT(rx_buffer_definitions[usart_index].next_byte_to_read !=
-			RX_NOT_USED);
+	context = get_usart_context(p_usart);
 
 	/* Only do anything if the USART is valid. */
-	if (usart_index < MAX_USARTS) {
+	if (context != NULL) {
+		/* It is possible to initialise the peripheral to only use Tx and not
+		Rx.  Check that Rx has been initialised. */
+		configASSERT(context->rx_buffer_definition.next_byte_to_read);
+		configASSERT(context->rx_buffer_definition.next_byte_to_read !=
+				RX_NOT_USED);
+
 		/* Must not request more bytes than will fit in the buffer. */
 		if (len <=
-				(rx_buffer_definitions[usart_index].past_rx_buffer_end_address
-				- rx_buffer_definitions[usart_index].rx_buffer_start_address)) {
+				(context->rx_buffer_definition.past_rx_buffer_end_address
+				- context->rx_buffer_definition.rx_buffer_start_address)) {
 			/* Remember the time on entry. */
 			vTaskSetTimeOutState(&time_out_definition);
 
 			/* If an Rx mutex is in use, attempt to obtain it. */
-			if (rx_buffer_definitions[usart_index].rx_access_mutex != NULL) {
+			if (context->rx_buffer_definition.rx_access_mutex != NULL) {
 				/* Attempt to obtain the mutex. */
 				attempt_read = xSemaphoreTake(
-						rx_buffer_definitions[usart_index].rx_access_mutex,
+						context->rx_buffer_definition.rx_access_mutex,
 						block_time_ticks);
 
 				if (attempt_read == pdTRUE) {
@@ -560,7 +851,7 @@ uint32_t freertos_usart_serial_read_packet(freertos_usart_if p_usart,
 
 						/* The port is not going to be used, so return the
 						mutex now. */
-						xSemaphoreGive(rx_buffer_definitions[usart_index].rx_access_mutex);
+						xSemaphoreGive(context->rx_buffer_definition.rx_access_mutex);
 					}
 				}
 			} else {
@@ -568,60 +859,451 @@ uint32_t freertos_usart_serial_read_packet(freertos_usart_if p_usart,
 			}
 
 			if (attempt_read == pdTRUE) {
+				/* An idle line seen before any unread data arrived does not
+				end the frame about to be read. */
+				taskENTER_CRITICAL();
+				{
+					if ((uint32_t) context->rx_buffer_definition.next_byte_to_read ==
+							context->peripheral->pdc_base_address->PERIPH_RPR) {
+						context->rx_line_idle = false;
+					}
+				}
+				taskEXIT_CRITICAL();
+
 				do {
 					/* Wait until data is available. */
-					xSemaphoreTake(rx_buffer_definitions[usart_index].rx_event_semaphore,
+					LAT_RECORD_TASK_WAIT(LAT_PATH_USART_RX);
+					xSemaphoreTake(context->rx_buffer_definition.rx_event_semaphore,
 							block_time_ticks);
+					LAT_RECORD_TASK_RUN(LAT_PATH_USART_RX);
+
+					/* Note whether the line has gone idle before copying, so
+					the bytes copied include everything received before it
+					did. */
+					if (context->end_read_on_idle) {
+						taskENTER_CRITICAL();
+						{
+							is_frame_complete = context->rx_line_idle;
+							context->rx_line_idle = false;
+						}
+						taskEXIT_CRITICAL();
+					}
 
 					/* Copy as much data as is available, up to however much
 					a maximum of the total number of requested bytes. */
 					bytes_read += freertos_copy_bytes_from_pdc_circular_buffer(
-							&(rx_buffer_definitions[usart_index]),
-							all_usart_definitions[usart_index].pdc_base_address->PERIPH_RPR,
+							&(context->rx_buffer_definition),
+							context->peripheral->pdc_base_address->PERIPH_RPR,
 							&(data[bytes_read]),
 							(len - bytes_read));
 
 					/* The Rx DMA will have stopped if the Rx buffer had become
 					full before this read operation.  If bytes were removed by
 					this read then there is guaranteed to be space in the Rx
-					buffer and the Rx DMA can be restarted. */
+					buffer and the Rx DMA can be restarted, or if it is still
+					running, the freed space can be queued behind the current
+					section. */
 					if (bytes_read > 0) {
 						taskENTER_CRITICAL();
 						{
-							if(rx_buffer_definitions[usart_index].rx_pdc_parameters.ul_size == 0UL) {
-								configure_rx_dma(usart_index, data_removed);
-							}
+							extend_rx_dma(context);
 						}
 						taskEXIT_CRITICAL();
 					}
 
-				  /* Until all the requested bytes are received, or the function
-				  runs out of time. */
-				} while ((bytes_read < len) && (xTaskCheckForTimeOut(
-						&time_out_definition,
+					/* The frame is only complete once everything received
+					before the line went idle has been copied out, which may
+					not be the case if the copy stopped at the end of the
+					circular buffer. */
+					if (is_frame_complete &&
+							((bytes_read == 0) ||
+							((uint32_t) context->rx_buffer_definition.next_byte_to_read !=
+							context->peripheral->pdc_base_address->PERIPH_RPR))) {
+						is_frame_complete = false;
+					}
+
+				  /* Until all the requested bytes are received, the line goes
+				  idle after a frame (if requested), or the function runs out
+				  of time. */
+				} while ((bytes_read < len) && (is_frame_complete == false) &&
+						(xTaskCheckForTimeOut(&time_out_definition,
 						&block_time_ticks) == pdFALSE));
 
-				if (rx_buffer_definitions[usart_index].rx_access_mutex != NULL) {
+				if (context->rx_buffer_definition.rx_access_mutex != NULL) {
 					/* Return the mutex. */
-					xSemaphoreGive(rx_buffer_definitions[usart_index].rx_access_mutex);
+					xSemaphoreGive(context->rx_buffer_definition.rx_access_mutex);
 				}
 			}
 		}
+
+		freertos_record_transfer(&(context->stats), false, bytes_read,
+				entry_ticks);
 	}
 
 	return bytes_read;
 }
 
+/**
+ * \ingroup freertos_usart_peripheral_control_group
+ * \brief Set how long the receive line must be idle before a reading task is
+ * woken.
+ *
+ * freertos_usart_serial_read_packet() is woken when the PDC fills the section
+ * of the receive buffer it was given, or when no character has been received
+ * for the receive timeout.  freertos_usart_serial_init() sets the timeout to
+ * 5ms.  A shorter timeout lets short frames, such as CLI key presses or
+ * protocol packets, reach the reader sooner, at the cost of more interrupts
+ * when characters arrive with gaps between them.
+ *
+ * The timeout only starts after a character has been received, so an idle
+ * line does not cause repeated interrupts.
+ *
+ * \param p_usart    The handle to the USART port returned by the
+ *     freertos_usart_serial_init() call used to initialise the port.  The port
+ *     must have been initialised with a receive buffer.
+ * \param idle_bit_periods    The number of bit periods the line must be idle,
+ *     for example 20 for two characters at 8N1.  0 disables the timeout, so the
+ *     reader is only woken as the buffer fills.  Values larger than the USART
+ *     can hold are capped.
+ * \param end_read_on_idle_line    If true, freertos_usart_serial_read_packet()
+ *     returns as soon as the line goes idle after receiving at least one byte,
+ *     even if fewer bytes than requested were received, so each read returns
+ *     (at most) one frame.  If false it waits for the requested number of
+ *     bytes or its block time as usual.
+ *
+ * \return     ERR_INVALID_ARG if p_usart is not a USART port that receives,
+ *     otherwise STATUS_OK.
+ */
+status_code_t freertos_usart_set_rx_idle_timeout(freertos_usart_if p_usart,
+		uint32_t idle_bit_periods, bool end_read_on_idle_line)
+{
+	freertos_usart_context_t *context;
+	Usart *usart_base;
+	status_code_t return_value;
+
+	context = get_usart_context(p_usart);
+
+	if ((context != NULL) &&
+			(context->rx_buffer_definition.next_byte_to_read != NULL) &&
+			(context->rx_buffer_definition.next_byte_to_read != RX_NOT_USED)) {
+		usart_base = (Usart *) context->peripheral->peripheral_base_address;
+
+		if (idle_bit_periods > US_RTOR_TO_Msk) {
+			idle_bit_periods = US_RTOR_TO_Msk;
+		}
+
+		taskENTER_CRITICAL();
+		{
+			context->end_read_on_idle = end_read_on_idle_line;
+			context->rx_line_idle = false;
+
+			/* Writing 0 disables the timeout.  Otherwise wait for the next
+			character before starting it again. */
+			usart_set_rx_timeout(usart_base, idle_bit_periods);
+			if (idle_bit_periods > 0UL) {
+				usart_start_rx_timeout(usart_base);
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		return_value = STATUS_OK;
+	} else {
+		return_value = ERR_INVALID_ARG;
+	}
+
+	return return_value;
+}
+
+/**
+ * \ingroup freertos_usart_peripheral_control_group
+ * \brief Set the receive buffer levels at which a flow controlled USART port
+ * stops and restarts the sender.
+ *
+ * A port initialised in the USART_RS232_HW_HANDSHAKING mode deasserts RTS
+ * when the unread bytes in the receive buffer reach the high watermark, and
+ * asserts it again once a reader has brought them down to the low watermark.
+ * The USART drives RTS itself: the driver stops the receive PDC at the high
+ * watermark, and the USART deasserts RTS whenever the PDC has no buffer space.
+ * The buffer space above the high watermark is never used.  A character still
+ * arriving after RTS is deasserted is held in the USART receive holding
+ * register until the PDC restarts, so the sender must stop within one
+ * character of RTS being deasserted or characters are lost as overruns.  A
+ * high watermark below the buffer size only bounds how many unread bytes the
+ * buffer holds; it does not absorb characters in flight.
+ * freertos_usart_serial_init() sets the watermarks to three quarters and one
+ * quarter of the receive buffer.
+ *
+ * New watermarks apply from the next time bytes are read or Rx buffer space is
+ * given to the PDC.
+ *
+ * \param p_usart    The handle to the USART port returned by the
+ *     freertos_usart_serial_init() call used to initialise the port.  The port
+ *     must use hardware handshaking and have a receive buffer.
+ * \param high_watermark    The number of unread bytes at which RTS is
+ *     deasserted.  Must be between 1 and the size of the receive buffer.
+ * \param low_watermark    The number of unread bytes at or below which RTS is
+ *     asserted again.  Must be less than high_watermark.
+ *
+ * \return     ERR_INVALID_ARG if a parameter is invalid, otherwise STATUS_OK.
+ */
+status_code_t freertos_usart_set_rx_flow_control_watermarks(
+		freertos_usart_if p_usart, uint32_t high_watermark,
+		uint32_t low_watermark)
+{
+	freertos_usart_context_t *context;
+	status_code_t return_value = ERR_INVALID_ARG;
+
+	context = get_usart_context(p_usart);
+
+	if ((context != NULL) && (context->is_rx_flow_controlled) &&
+			(context->rx_buffer_definition.next_byte_to_read != RX_NOT_USED) &&
+			(high_watermark > 0) && (low_watermark < high_watermark) &&
+			(high_watermark <=
+			(context->rx_buffer_definition.past_rx_buffer_end_address -
+			context->rx_buffer_definition.rx_buffer_start_address))) {
+		taskENTER_CRITICAL();
+		{
+			context->rx_high_watermark = high_watermark;
+			context->rx_low_watermark = low_watermark;
+		}
+		taskEXIT_CRITICAL();
+
+		return_value = STATUS_OK;
+	}
+
+	return return_value;
+}
+
+/**
+ * \ingroup freertos_usart_peripheral_control_group
+ * \brief Wait for received data and return it in place, without copying it.
+ *
+ * freertos_usart_serial_read_packet() copies received bytes out of the PDC
+ * circular receive buffer.  freertos_usart_serial_peek() instead returns
+ * where the unread bytes are in the receive buffer, so a parser can work on
+ * them where they are.  The unread bytes are contiguous unless they wrap
+ * around the end of the buffer, so they are returned as up to
+ * FREERTOS_RX_SPAN_COUNT spans, in order.  The bytes stay in the buffer, and
+ * are returned again by the next peek, until they are released with
+ * freertos_usart_serial_consume().  The PDC does not write over unread bytes,
+ * so the spans stay valid until then, but the longer bytes are left unread
+ * the less space the PDC has to receive into.
+ *
+ * If the port was initialised with the USE_RX_ACCESS_MUTEX option the mutex
+ * is taken by a peek that returns data, and given back by the following call
+ * to freertos_usart_serial_consume(), so the same task must make both calls.
+ *
+ * \param p_usart    The handle to the USART port returned by the
+ *     freertos_usart_serial_init() call used to initialise the port.  The port
+ *     must have been initialised with a receive buffer.
+ * \param spans    Filled in with the unread data.  The second span is only
+ *     used if the data wraps, otherwise its length is zero.
+ * \param block_time_ticks    The maximum time to wait for the Rx access mutex
+ *     (if one is used) and for at least one byte to be received.  Other tasks
+ *     will execute during any waiting time.
+ *
+ * \return     The total number of unread bytes in the spans.  0 is returned
+ *     if nothing was received in time, or if p_usart is not valid.
+ */
+uint32_t freertos_usart_serial_peek(freertos_usart_if p_usart,
+		freertos_iovec_t spans[FREERTOS_RX_SPAN_COUNT],
+		portTickType block_time_ticks)
+{
+	freertos_usart_context_t *context;
+	freertos_pdc_rx_control_t *rx_buffer_definition;
+	xTimeOutType time_out_definition;
+	portTickType entry_ticks = xTaskGetTickCount();
+	uint32_t bytes_available = 0;
+
+	context = get_usart_context(p_usart);
+
+	spans[0].len = 0;
+	spans[1].len = 0;
+
+	if (context == NULL) {
+		return 0;
+	}
+
+	rx_buffer_definition = &(context->rx_buffer_definition);
+
+	/* It is possible to initialise the peripheral to only use Tx and not Rx.
+	Check that Rx has been initialised. */
+	configASSERT(rx_buffer_definition->next_byte_to_read);
+	configASSERT(rx_buffer_definition->next_byte_to_read != RX_NOT_USED);
+
+	vTaskSetTimeOutState(&time_out_definition);
+
+	/* If an Rx mutex is in use, attempt to obtain it.  It is only kept if
+	data is returned. */
+	if (rx_buffer_definition->rx_access_mutex != NULL) {
+		if (xSemaphoreTake(rx_buffer_definition->rx_access_mutex,
+				block_time_ticks) != pdTRUE) {
+			freertos_record_transfer(&(context->stats), false, 0,
+					entry_ticks);
+			return 0;
+		}
+
+		if (xTaskCheckForTimeOut(&time_out_definition,
+				&block_time_ticks) == pdTRUE) {
+			xSemaphoreGive(rx_buffer_definition->rx_access_mutex);
+			freertos_record_transfer(&(context->stats), false, 0,
+					entry_ticks);
+			return 0;
+		}
+	}
+
+	do {
+		bytes_available = freertos_get_pdc_circular_buffer_spans(
+				rx_buffer_definition,
+				context->peripheral->pdc_base_address->PERIPH_RPR,
+				spans);
+
+		/* Take the event given for the data, or wait for some if there is
+		none.  The semaphore is given again by
+		freertos_usart_serial_consume() if data is left unread. */
+		LAT_RECORD_TASK_WAIT(LAT_PATH_USART_RX);
+		xSemaphoreTake(rx_buffer_definition->rx_event_semaphore,
+				(bytes_available > 0) ? 0 : block_time_ticks);
+		LAT_RECORD_TASK_RUN(LAT_PATH_USART_RX);
+	} while ((bytes_available == 0) && (xTaskCheckForTimeOut(
+			&time_out_definition, &block_time_ticks) == pdFALSE));
+
+	if ((bytes_available == 0) &&
+			(rx_buffer_definition->rx_access_mutex != NULL)) {
+		xSemaphoreGive(rx_buffer_definition->rx_access_mutex);
+	}
+
+	/* Only the time is counted here.  The bytes are counted as they are
+	consumed. */
+	freertos_record_transfer(&(context->stats), false, 0, entry_ticks);
+
+	return bytes_available;
+}
+
+/**
+ * \ingroup freertos_usart_peripheral_control_group
+ * \brief Release received bytes returned by freertos_usart_serial_peek().
+ *
+ * The oldest len bytes are removed from the receive buffer, and the space they
+ * used is given back to the PDC.  Fewer bytes than were peeked can be released,
+ * for example when a parser has found the end of one message but not the
+ * next, in which case the rest are returned again by the next peek.
+ *
+ * Must only be called after freertos_usart_serial_peek() has returned data,
+ * and by the same task.
+ *
+ * \param p_usart    The handle to the USART port returned by the
+ *     freertos_usart_serial_init() call used to initialise the port.
+ * \param len    The number of bytes to release, from the start of the first
+ *     span.  Capped to the number of unread bytes.  0 is valid, and just ends
+ *     the peek.
+ *
+ * \return     ERR_INVALID_ARG if p_usart is not valid, otherwise STATUS_OK.
+ */
+status_code_t freertos_usart_serial_consume(freertos_usart_if p_usart,
+		uint32_t len)
+{
+	freertos_usart_context_t *context;
+	freertos_pdc_rx_control_t *rx_buffer_definition;
+	uint32_t bytes_consumed;
+
+	context = get_usart_context(p_usart);
+
+	if (context == NULL) {
+		return ERR_INVALID_ARG;
+	}
+
+	rx_buffer_definition = &(context->rx_buffer_definition);
+
+	configASSERT(rx_buffer_definition->next_byte_to_read);
+	configASSERT(rx_buffer_definition->next_byte_to_read != RX_NOT_USED);
+
+	bytes_consumed = freertos_consume_pdc_circular_buffer(rx_buffer_definition,
+			context->peripheral->pdc_base_address->PERIPH_RPR, len);
+	freertos_record_transfer(&(context->stats), false, bytes_consumed,
+			xTaskGetTickCount());
+
+	if (bytes_consumed > 0) {
+		/* Give the freed space to the PDC, restarting it if the buffer had
+		filled. */
+		taskENTER_CRITICAL();
+		{
+			extend_rx_dma(context);
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	if (rx_buffer_definition->rx_access_mutex != NULL) {
+		xSemaphoreGive(rx_buffer_definition->rx_access_mutex);
+	}
+
+	return STATUS_OK;
+}
+
+/**
+ * \ingroup freertos_usart_peripheral_control_group
+ * \brief Read the counters the driver keeps for a USART port.
+ *
+ * The driver counts the bytes and transfers in each direction, receive errors
+ * by type, the most unread bytes the receive buffer has held, and the time
+ * tasks have spent in the read and write functions.  The snapshot is taken in
+ * a critical section, so the counters are consistent with each other.  The
+ * counters of every port are also listed by freertos_get_peripheral_stats().
+ *
+ * \param p_usart    The handle to the USART port returned by the
+ *     freertos_usart_serial_init() call used to initialise the port.
+ * \param stats    Filled in with a copy of the counters.
+ * \param reset    If true the counters are cleared once they have been copied,
+ *     so the next snapshot covers only what happens after this one.
+ *
+ * \return     ERR_INVALID_ARG if a parameter is invalid, otherwise STATUS_OK.
+ */
+status_code_t freertos_usart_get_stats(freertos_usart_if p_usart,
+		freertos_peripheral_stats_t *stats, bool reset)
+{
+	freertos_usart_context_t *context;
+	status_code_t return_value = ERR_INVALID_ARG;
+
+	context = get_usart_context(p_usart);
+
+	if ((context != NULL) && (stats != NULL)) {
+		freertos_copy_peripheral_stats(&(context->stats), stats, reset);
+		return_value = STATUS_OK;
+	}
+
+	return return_value;
+}
+
+/*
+ * For internal use only.
+ * Returns the driver context that a freertos_usart_if handle points to, or NULL
+ * if the handle is not one returned by freertos_usart_serial_init().  The
+ * handle is checked by its position in usart_contexts[] rather than by
+ * searching for a matching base address.
+ */
+static freertos_usart_context_t *get_usart_context(freertos_usart_if p_usart)
+{
+	freertos_usart_context_t *context = (freertos_usart_context_t *) p_usart;
+
+	if ((context < &(usart_contexts[0])) ||
+			(context >= &(usart_contexts[MAX_USARTS])) ||
+			(context->peripheral == NULL)) {
+		context = NULL;
+	}
+
+	return context;
+}
+
 /*
  * For internal use only.
  * Configures the Rx DMA to receive data into free space within the Rx buffer.
  */
-static void configure_rx_dma(uint32_t usart_index,
+static void configure_rx_dma(freertos_usart_context_t *context,
 		enum buffer_operations operation_performed)
 {
 	freertos_pdc_rx_control_t *rx_buffer_definition;
 
-	rx_buffer_definition = &(rx_buffer_definitions[usart_index]);
+	rx_buffer_definition = &(context->rx_buffer_definition);
 
 	/* How much space is there between the start of the DMA buffer and the
 	current read pointer?  */
@@ -656,65 +1338,428 @@ static void configure_rx_dma(uint32_t usart_index,
 			rx_buffer_definition->rx_pdc_parameters.ul_size) <=
 			rx_buffer_definition->past_rx_buffer_end_address);
 
+	/* Don't let the unread data go over the high watermark. */
+	rx_buffer_definition->rx_pdc_parameters.ul_size = cap_rx_section_size(
+			context, rx_buffer_definition->rx_pdc_parameters.ul_size,
+			get_rx_bytes_unread(rx_buffer_definition,
+			rx_buffer_definition->rx_pdc_parameters.ul_addr,
+			(operation_performed == data_added)));
+
 	if (rx_buffer_definition->rx_pdc_parameters.ul_size > 0) {
 		/* Restart the DMA to receive into whichever space was calculated
-		as remaining.  First clear any characters that might already be in the
+		as remaining, with any space after that queued in the next buffer
+		registers.  First clear any characters that might already be in the
 		registers. */
+		set_next_rx_segment(context);
 		pdc_rx_init(
-				all_usart_definitions[usart_index].pdc_base_address, &rx_buffer_definition->rx_pdc_parameters,
-				NULL);
+				context->peripheral->pdc_base_address, &rx_buffer_definition->rx_pdc_parameters,
+				&rx_buffer_definition->rx_next_pdc_parameters);
 		pdc_enable_transfer(
-				all_usart_definitions[usart_index].pdc_base_address,
+				context->peripheral->pdc_base_address,
 				PERIPH_PTCR_RXTEN);
 		usart_enable_interrupt(
-				all_usart_definitions[usart_index].peripheral_base_address, US_IER_ENDRX |
+				context->peripheral->peripheral_base_address, US_IER_ENDRX |
 				US_IER_TIMEOUT);
 	} else {
-		/* The write pointer has reached the read pointer.  There is no
-		more room so the DMA is not re-enabled until a read has created
-		space. */
+		/* The write pointer has reached the read pointer, or the high
+		watermark.  There is no more room so the DMA is not re-enabled until
+		a read has created space.  With hardware handshaking the USART
+		deasserts RTS while the PDC is stopped. */
+		rx_buffer_definition->rx_next_pdc_parameters.ul_size = 0UL;
 		usart_disable_interrupt(
-				all_usart_definitions[usart_index].peripheral_base_address, US_IER_ENDRX |
+				context->peripheral->peripheral_base_address, US_IER_ENDRX |
 				US_IER_TIMEOUT);
 	}
 }
 
+/*
+ * For internal use only.
+ * Works out the section of the Rx buffer that follows the section the PDC is
+ * currently filling, up to the read pointer or the end of the buffer.  The
+ * result is not written to the PDC.
+ */
+static void set_next_rx_segment(freertos_usart_context_t *context)
+{
+	freertos_pdc_rx_control_t *rx_buffer_definition;
+	uint32_t next_address, next_byte_to_read;
+
+	rx_buffer_definition = &(context->rx_buffer_definition);
+
+	next_address = rx_buffer_definition->rx_pdc_parameters.ul_addr +
+			rx_buffer_definition->rx_pdc_parameters.ul_size;
+
+	if (next_address >= rx_buffer_definition->past_rx_buffer_end_address) {
+		next_address = rx_buffer_definition->rx_buffer_start_address;
+	}
+
+	next_byte_to_read = (uint32_t) rx_buffer_definition->next_byte_to_read;
+	rx_buffer_definition->rx_next_pdc_parameters.ul_addr = next_address;
+
+	if (next_byte_to_read == next_address) {
+		/* The current section ends at the read pointer, so the buffer will be
+		full when it is. */
+		rx_buffer_definition->rx_next_pdc_parameters.ul_size = 0UL;
+	} else if (next_byte_to_read > next_address) {
+		rx_buffer_definition->rx_next_pdc_parameters.ul_size =
+				next_byte_to_read - next_address;
+	} else {
+		rx_buffer_definition->rx_next_pdc_parameters.ul_size =
+				rx_buffer_definition->past_rx_buffer_end_address - next_address;
+	}
+
+	/* The unread data will reach next_address before the PDC starts on the
+	section, so that is as far as it can go within the high watermark. */
+	rx_buffer_definition->rx_next_pdc_parameters.ul_size = cap_rx_section_size(
+			context, rx_buffer_definition->rx_next_pdc_parameters.ul_size,
+			get_rx_bytes_unread(rx_buffer_definition, next_address, true));
+}
+
+/*
+ * For internal use only.
+ * Returns the number of unread bytes in the Rx buffer once everything before
+ * write_address has been received.  If write_address equals the read pointer
+ * the buffer is either full or empty, as given by is_full_if_equal.
+ */
+static uint32_t get_rx_bytes_unread(
+		freertos_pdc_rx_control_t *rx_buffer_definition,
+		uint32_t write_address, bool is_full_if_equal)
+{
+	uint32_t next_byte_to_read, bytes_unread;
+
+	next_byte_to_read = (uint32_t) rx_buffer_definition->next_byte_to_read;
+
+	if (write_address > next_byte_to_read) {
+		bytes_unread = write_address - next_byte_to_read;
+	} else if ((write_address < next_byte_to_read) || is_full_if_equal) {
+		bytes_unread = (rx_buffer_definition->past_rx_buffer_end_address -
+				next_byte_to_read) + (write_address -
+				rx_buffer_definition->rx_buffer_start_address);
+	} else {
+		bytes_unread = 0;
+	}
+
+	return bytes_unread;
+}
+
+/*
+ * For internal use only.
+ * Returns section_size, reduced if necessary so that filling the section does
+ * not take the unread bytes above the high watermark.  Without flow control
+ * the high watermark is the size of the buffer, so the section is never
+ * reduced.
+ */
+static uint32_t cap_rx_section_size(freertos_usart_context_t *context,
+		uint32_t section_size, uint32_t bytes_unread)
+{
+	uint32_t space_below_watermark = 0;
+
+	if (bytes_unread < context->rx_high_watermark) {
+		space_below_watermark = context->rx_high_watermark - bytes_unread;
+	}
+
+	if (section_size > space_below_watermark) {
+		section_size = space_below_watermark;
+	}
+
+	return section_size;
+}
+
+/*
+ * For internal use only.
+ * Called from a critical section after a task has read bytes out of the Rx
+ * buffer.  If the Rx DMA stopped because the buffer was full, or the unread
+ * bytes reached the high watermark, it is restarted once the unread bytes are
+ * down to the low watermark.  If it is still running, but nothing is queued behind the current section,
+ * the space just freed is queued in the next buffer registers so the PDC moves
+ * straight on to it.
+ */
+static void extend_rx_dma(freertos_usart_context_t *context)
+{
+	freertos_pdc_rx_control_t *rx_buffer_definition;
+	Pdc *pdc_base_address;
+
+	rx_buffer_definition = &(context->rx_buffer_definition);
+	pdc_base_address = context->peripheral->pdc_base_address;
+
+	if (rx_buffer_definition->rx_pdc_parameters.ul_size == 0UL) {
+		/* Restart the stopped PDC once the reader has brought the unread
+		bytes down to the low watermark.  Bytes have just been read, so equal
+		pointers mean the buffer is empty. */
+		if (get_rx_bytes_unread(rx_buffer_definition,
+				rx_buffer_definition->rx_pdc_parameters.ul_addr, false) <=
+				context->rx_low_watermark) {
+			configure_rx_dma(context, data_removed);
+		}
+	} else if ((rx_buffer_definition->rx_next_pdc_parameters.ul_size == 0UL) &&
+			(pdc_base_address->PERIPH_RCR != 0UL)) {
+		/* If the counter has already reached zero the ENDRX interrupt is
+		pending and will queue the space instead.  Writing the next counter
+		would clear ENDRX before the interrupt saw it. */
+		set_next_rx_segment(context);
+
+		if (rx_buffer_definition->rx_next_pdc_parameters.ul_size > 0UL) {
+			pdc_rx_init(pdc_base_address, NULL,
+					&rx_buffer_definition->rx_next_pdc_parameters);
+
+			/* If the current section filled between the check above and the
+			write, the PDC loads the next section as soon as it is written,
+			and the write has cleared ENDRX.  Do the interrupt's work here. */
+			if (pdc_base_address->PERIPH_RNCR == 0UL) {
+				rx_segment_complete(context);
+				xSemaphoreGive(rx_buffer_definition->rx_event_semaphore);
+			}
+		}
+	}
+}
+
+/*
+ * For internal use only.
+ * Called from the ENDRX interrupt, or from a critical section, once the PDC has
+ * filled the section of the Rx buffer it was given.  If a next section was
+ * queued the PDC has already moved on to it without missing a byte, and only
+ * the section after that needs to be queued.  Otherwise the PDC has stopped
+ * and is restarted on whatever space remains.
+ *
+ * Every path ends by writing a PDC counter register, which clears ENDRX, or by
+ * disabling the ENDRX interrupt.  The counters are checked after each write in
+ * case the PDC finished another section meanwhile.
+ */
+static void rx_segment_complete(freertos_usart_context_t *context)
+{
+	freertos_pdc_rx_control_t *rx_buffer_definition;
+	Pdc *pdc_base_address;
+	bool is_more_to_do;
+
+	rx_buffer_definition = &(context->rx_buffer_definition);
+	pdc_base_address = context->peripheral->pdc_base_address;
+
+	do {
+		if (rx_buffer_definition->rx_next_pdc_parameters.ul_size == 0UL) {
+			/* Nothing was queued so the PDC has stopped.  Move the DMA buffer
+			start address up to the end of the previously defined buffer,
+			wrapping back to the start if the end of the buffer has been
+			reached, then reset the Rx DMA to receive data into whatever free
+			space remains in the Rx buffer. */
+			rx_buffer_definition->rx_pdc_parameters.ul_addr +=
+					rx_buffer_definition->rx_pdc_parameters.ul_size;
+
+			if (rx_buffer_definition->rx_pdc_parameters.ul_addr >=
+					rx_buffer_definition->past_rx_buffer_end_address) {
+				rx_buffer_definition->rx_pdc_parameters.ul_addr =
+						rx_buffer_definition->rx_buffer_start_address;
+			}
+
+			configure_rx_dma(context, data_added);
+			is_more_to_do = false;
+		} else {
+			/* The PDC is now filling the section that was queued. */
+			rx_buffer_definition->rx_pdc_parameters =
+					rx_buffer_definition->rx_next_pdc_parameters;
+			rx_buffer_definition->rx_next_pdc_parameters.ul_size = 0UL;
+
+			if (pdc_base_address->PERIPH_RCR == 0UL) {
+				/* That section is already full too. */
+				is_more_to_do = true;
+			} else {
+				/* Queue the space after it.  The write is made even when
+				there is no space, as writing the counter clears ENDRX. */
+				set_next_rx_segment(context);
+				pdc_rx_init(pdc_base_address, NULL,
+						&rx_buffer_definition->rx_next_pdc_parameters);
+
+				if (rx_buffer_definition->rx_next_pdc_parameters.ul_size > 0UL) {
+					/* A zero next counter means the PDC took the section
+					straight away, so the current one has filled. */
+					is_more_to_do = (pdc_base_address->PERIPH_RNCR == 0UL);
+				} else {
+					is_more_to_do = (pdc_base_address->PERIPH_RCR == 0UL);
+				}
+			}
+		}
+	} while (is_more_to_do);
+}
+
+/*
+ * For internal use only.
+ * Called from a critical section, or from the ENDTX interrupt, to give queued
+ * Tx segments to the PDC.  If the PDC is idle it is started with up to two
+ * segments.  If it is sending one segment the next is put in the next pointer
+ * and counter registers, so the PDC moves straight on to it.
+ */
+static void feed_tx_dma(freertos_usart_context_t *context,
+		portBASE_TYPE *higher_priority_task_woken)
+{
+	tx_descriptor_queue_t *tx_queue;
+	Pdc *pdc_base_address;
+	pdc_packet_t *next_packet = NULL;
+	uint32_t segments_in_pdc;
+
+	tx_queue = &(context->tx_descriptor_queue);
+	pdc_base_address = context->peripheral->pdc_base_address;
+	segments_in_pdc = tx_queue->started - tx_queue->completed;
+
+	if (tx_queue->started == tx_queue->queued) {
+		/* Nothing is waiting. */
+		return;
+	}
+
+	if (segments_in_pdc == 0) {
+		if ((tx_queue->queued - tx_queue->started) > 1) {
+			next_packet = &(tx_queue->descriptors[(tx_queue->started + 1) %
+					TX_DESCRIPTOR_QUEUE_LENGTH].pdc_packet);
+		}
+
+		pdc_tx_init(pdc_base_address,
+				&(tx_queue->descriptors[tx_queue->started %
+				TX_DESCRIPTOR_QUEUE_LENGTH].pdc_packet),
+				next_packet);
+		tx_queue->started += (next_packet != NULL) ? 2 : 1;
+
+		pdc_enable_transfer(pdc_base_address, PERIPH_PTCR_TXTEN);
+		usart_enable_interrupt(
+				context->peripheral->peripheral_base_address,
+				US_IER_ENDTX);
+	} else if ((segments_in_pdc == 1) &&
+			(pdc_base_address->PERIPH_TCR != 0UL)) {
+		/* If the counter has already reached zero the ENDTX interrupt is
+		pending and will start the PDC again instead.  Writing the next
+		counter would clear ENDTX before the interrupt saw it. */
+		pdc_tx_init(pdc_base_address, NULL,
+				&(tx_queue->descriptors[tx_queue->started %
+				TX_DESCRIPTOR_QUEUE_LENGTH].pdc_packet));
+		tx_queue->started++;
+
+		/* If the current segment finished between the check above and the
+		write, the PDC loads the next segment as soon as it is written, and
+		the write has cleared ENDTX.  Do the interrupt's work here. */
+		if (pdc_base_address->PERIPH_TNCR == 0UL) {
+			tx_segment_complete(context, higher_priority_task_woken);
+		}
+	}
+}
+
+/*
+ * For internal use only.
+ * Called from the ENDTX interrupt, or from feed_tx_dma(), once the PDC has sent
+ * the oldest segment given to it.  The writer of the segment is notified if it
+ * was the last of a write, and the next waiting segment is queued with the PDC.
+ * When the queue empties the ENDTX interrupt is disabled and the Tx access
+ * semaphore is given back.
+ *
+ * Every path ends by writing a PDC counter register, which clears ENDTX, or by
+ * disabling the ENDTX interrupt.  The counters are checked after each write in
+ * case the PDC finished another segment meanwhile.
+ */
+static void tx_segment_complete(freertos_usart_context_t *context,
+		portBASE_TYPE *higher_priority_task_woken)
+{
+	tx_descriptor_queue_t *tx_queue;
+	tx_descriptor_t *descriptor;
+	Pdc *pdc_base_address;
+	bool is_more_to_do;
+
+	tx_queue = &(context->tx_descriptor_queue);
+	pdc_base_address = context->peripheral->pdc_base_address;
+
+	do {
+		is_more_to_do = false;
+
+		descriptor = &(tx_queue->descriptors[tx_queue->completed %
+				TX_DESCRIPTOR_QUEUE_LENGTH]);
+		tx_queue->completed++;
+
+		if (descriptor->notification_semaphore != NULL) {
+			LAT_RECORD_GIVE_FROM_ISR(LAT_PATH_USART_TX, LAT_ISR_ENTRY_STAMP());
+			xSemaphoreGiveFromISR(descriptor->notification_semaphore,
+					higher_priority_task_woken);
+		}
+
+		xSemaphoreGiveFromISR(tx_queue->space_semaphore,
+				higher_priority_task_woken);
+
+		if (tx_queue->started != tx_queue->completed) {
+			/* The PDC has moved on to the segment that was in the next
+			registers. */
+			if (pdc_base_address->PERIPH_TCR == 0UL) {
+				/* That segment has been sent too. */
+				is_more_to_do = true;
+			} else if (tx_queue->started != tx_queue->queued) {
+				pdc_tx_init(pdc_base_address, NULL,
+						&(tx_queue->descriptors[tx_queue->started %
+						TX_DESCRIPTOR_QUEUE_LENGTH].pdc_packet));
+				tx_queue->started++;
+
+				/* A zero next counter means the PDC took the segment
+				straight away, so the current one has been sent. */
+				is_more_to_do = (pdc_base_address->PERIPH_TNCR == 0UL);
+			} else {
+				/* Nothing is waiting.  Writing the counter clears ENDTX. */
+				pdc_base_address->PERIPH_TNCR = 0UL;
+				is_more_to_do = (pdc_base_address->PERIPH_TCR == 0UL);
+			}
+		} else if (tx_queue->started != tx_queue->queued) {
+			/* The PDC stopped, but more has been queued since. */
+			feed_tx_dma(context, higher_priority_task_woken);
+		} else {
+			/* The queue is empty, so give the transmitter back. */
+			usart_disable_interrupt(
+					context->peripheral->peripheral_base_address,
+					US_IER_ENDTX);
+			tx_queue->is_active = false;
+
+			if (context->tx_dma_control.peripheral_access_sem != NULL) {
+				xSemaphoreGiveFromISR(
+						context->tx_dma_control.peripheral_access_sem,
+						higher_priority_task_woken);
+			}
+		}
+	} while (is_more_to_do);
+}
+
 /*
  * For internal use only.
  * A common USART interrupt handler that is called for all USART peripherals.
  */
 static void local_usart_handler(const portBASE_TYPE usart_index)
 {
+	/* Taken first so the measured ISR time includes the whole handler. */
+	uint32_t isr_entry_cycles = LAT_ISR_ENTRY_STAMP();
 	portBASE_TYPE higher_priority_task_woken = pdFALSE;
 	uint32_t usart_status;
+	freertos_usart_context_t *context = &(usart_contexts[usart_index]);
 	freertos_pdc_rx_control_t *rx_buffer_definition;
 
 	usart_status = usart_get_status(
-			all_usart_definitions[usart_index].peripheral_base_address);
+			context->peripheral->peripheral_base_address);
 	usart_status &= usart_get_interrupt_mask(
-			all_usart_definitions[usart_index].peripheral_base_address);
+			context->peripheral->peripheral_base_address);
 
-	rx_buffer_definition = &(rx_buffer_definitions[usart_index]);
+	rx_buffer_definition = &(context->rx_buffer_definition);
 
 	/* Has the PDC completed a transmission? */
-	if ((usart_status & US_CSR_ENDTX) != 0UL) {
+	if (((usart_status & US_CSR_ENDTX) != 0UL) &&
+			(context->tx_descriptor_queue.is_active == true)) {
+		/* A segment of a vectored write. */
+		tx_segment_complete(context, &higher_priority_task_woken);
+	} else if ((usart_status & US_CSR_ENDTX) != 0UL) {
 		usart_disable_interrupt(
-				all_usart_definitions[usart_index].peripheral_base_address,
+				context->peripheral->peripheral_base_address,
 				US_IER_ENDTX);
 
 		/* If the driver is supporting multi-threading, then return the access
 		mutex. */
-		if (tx_dma_control[usart_index].peripheral_access_sem != NULL) {
+		if (context->tx_dma_control.peripheral_access_sem != NULL) {
 			xSemaphoreGiveFromISR(
-					tx_dma_control[usart_index].peripheral_access_sem,
+					context->tx_dma_control.peripheral_access_sem,
 					&higher_priority_task_woken);
 		}
 
 		/* if the sending task supplied a notification semaphore, then
 		notify the task that the transmission has completed. */
-		if (tx_dma_control[usart_index].transaction_complete_notification_semaphore != NULL) {
+		if (context->tx_dma_control.transaction_complete_notification_semaphore != NULL) {
+			LAT_RECORD_GIVE_FROM_ISR(LAT_PATH_USART_TX, isr_entry_cycles);
 			xSemaphoreGiveFromISR(
-					tx_dma_control[usart_index].transaction_complete_notification_semaphore,
+					context->tx_dma_control.transaction_complete_notification_semaphore,
 					&higher_priority_task_woken);
 		}
 	}
@@ -726,26 +1771,17 @@ static void local_usart_handler(const portBASE_TYPE usart_index)
 		configASSERT(rx_buffer_definition->next_byte_to_read !=
 				RX_NOT_USED);
 
-		/* Out of DMA buffer, configure the next buffer.  Start by moving
-		the DMA buffer start address up to the end of the previously defined
-		buffer. */
-		rx_buffer_definition->rx_pdc_parameters.ul_addr +=
-				rx_buffer_definition->rx_pdc_parameters.ul_size;
-
-		/* If the end of the buffer has been reached, wrap back to the start. */
-		if (rx_buffer_definition->rx_pdc_parameters.ul_addr >=
-				rx_buffer_definition->past_rx_buffer_end_address)
-		{
-			rx_buffer_definition->rx_pdc_parameters.ul_addr =
-					rx_buffer_definition->rx_buffer_start_address;
-		}
-
-		/* Reset the Rx DMA to receive data into whatever free space remains in
-		the Rx buffer. */
-		configure_rx_dma(usart_index, data_added);
+		/* Out of DMA buffer.  The PDC will already have moved on to the
+		next buffer if one was queued; queue the one after it, or restart the
+		PDC if it stopped. */
+		rx_segment_complete(context);
+		freertos_record_rx_buffer_level(&(context->stats),
+				rx_buffer_definition,
+				context->peripheral->pdc_base_address->PERIPH_RPR);
 
 		if (rx_buffer_definition->rx_event_semaphore != NULL) {
 			/* Notify that new data is available. */
+			LAT_RECORD_GIVE_FROM_ISR(LAT_PATH_USART_RX, isr_entry_cycles);
 			xSemaphoreGiveFromISR(
 					rx_buffer_definition->rx_event_semaphore,
 					&higher_priority_task_woken);
@@ -753,13 +1789,20 @@ static void local_usart_handler(const portBASE_TYPE usart_index)
 	}
 
 	if ((usart_status & US_IER_TIMEOUT) != 0UL) {
-		/* More characters have been placed into the Rx buffer.
+		/* More characters have been placed into the Rx buffer, and the line
+		has since been idle for the time set by
+		freertos_usart_set_rx_idle_timeout(), so they form a complete frame.
 
 		Restart the timeout after more data has been received. */
-		usart_start_rx_timeout(all_usart_definitions[usart_index].peripheral_base_address);
+		usart_start_rx_timeout(context->peripheral->peripheral_base_address);
+		context->rx_line_idle = true;
+		freertos_record_rx_buffer_level(&(context->stats),
+				rx_buffer_definition,
+				context->peripheral->pdc_base_address->PERIPH_RPR);
 
 		if (rx_buffer_definition->rx_event_semaphore != NULL) {
 			/* Notify that new data is available. */
+			LAT_RECORD_GIVE_FROM_ISR(LAT_PATH_USART_RX, isr_entry_cycles);
 			xSemaphoreGiveFromISR(
 					rx_buffer_definition->rx_event_semaphore,
 					&higher_priority_task_woken);
@@ -769,11 +1812,22 @@ static void local_usart_handler(const portBASE_TYPE usart_index)
 	if ((usart_status & SR_ERROR_INTERRUPTS) != 0) {
 		/* An error occurred in either a transmission or reception.  Abort, and
 		ensure the peripheral access mutex is made available to tasks. */
+		if ((usart_status & US_CSR_OVRE) != 0) {
+			context->stats.overrun_errors++;
+		}
+		if ((usart_status & US_CSR_FRAME) != 0) {
+			context->stats.framing_errors++;
+		}
+		if ((usart_status & US_CSR_PARE) != 0) {
+			context->stats.parity_errors++;
+		}
+
 		usart_reset_status(
-				all_usart_definitions[usart_index].peripheral_base_address);
-		if (tx_dma_control[usart_index].peripheral_access_sem != NULL) {
+				context->peripheral->peripheral_base_address);
+		if ((context->tx_dma_control.peripheral_access_sem != NULL) &&
+				(context->tx_descriptor_queue.is_active == false)) {
 			xSemaphoreGiveFromISR(
-					tx_dma_control[usart_index].peripheral_access_sem,
+					context->tx_dma_control.peripheral_access_sem,
 					&higher_priority_task_woken);
 		}
 	}
@@ -75,7 +75,8 @@ extern "C" {
  *     ypedef freertos_usart_if
  * \brief Type returned from a call to freertos_usart_serial_init(), and then
  * used to reference a USART port in calls to FreeRTOS peripheral control
- * functions.
+ * functions.  It points to the driver's context for the port and is not the
+ * base address of the USART.
  */
 typedef void *freertos_usart_if;
 
@@ -90,6 +91,28 @@ status_code_t freertos_usart_write_packet_async(freertos_usart_if p_usart,
 uint32_t freertos_usart_serial_read_packet(freertos_usart_if p_usart,
 		uint8_t *data, uint32_t len, portTickType block_time_ticks);
 
+status_code_t freertos_usart_set_rx_idle_timeout(freertos_usart_if p_usart,
+		uint32_t idle_bit_periods, bool end_read_on_idle_line);
+
+status_code_t freertos_usart_set_rx_flow_control_watermarks(
+		freertos_usart_if p_usart, uint32_t high_watermark,
+		uint32_t low_watermark);
+
+uint32_t freertos_usart_serial_peek(freertos_usart_if p_usart,
+		freertos_iovec_t spans[FREERTOS_RX_SPAN_COUNT],
+		portTickType block_time_ticks);
+
+status_code_t freertos_usart_serial_consume(freertos_usart_if p_usart,
+		uint32_t len);
+
+status_code_t freertos_usart_writev_async(freertos_usart_if p_usart,
+		const freertos_iovec_t *iov, size_t iovcnt,
+		portTickType block_time_ticks,
+		xSemaphoreHandle notification_semaphore);
+
+status_code_t freertos_usart_get_stats(freertos_usart_if p_usart,
+		freertos_peripheral_stats_t *stats, bool reset);
+
 /**
  * \ingroup freertos_usart_peripheral_control_group
  * \brief Initiate a multi-byte write operation on an USART peripheral.
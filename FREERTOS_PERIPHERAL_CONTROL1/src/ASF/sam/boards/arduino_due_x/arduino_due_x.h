@@ -495,6 +495,8 @@
  * USART0
  * - \ref PIN_USART0_RXD
  * - \ref PIN_USART0_TXD
+ * - \ref PIN_USART0_CTS
+ * - \ref PIN_USART0_RTS
  */
 /* ------------------------------------------------------------------------ */
 /* USART0                                                                   */
@@ -511,6 +513,18 @@
 #define PIN_USART0_TXD_IDX        (PIO_PA11_IDX)
 #define PIN_USART0_TXD_FLAGS      (PIO_PERIPH_A | PIO_DEFAULT)
 
+/*! USART0 pin CTS  (labeled 22) */
+#define PIN_USART0_CTS\
+	{PIO_PB26A_CTS0, PIOB, ID_PIOB, PIO_PERIPH_A, PIO_DEFAULT}
+#define PIN_USART0_CTS_IDX        (PIO_PB26_IDX)
+#define PIN_USART0_CTS_FLAGS      (PIO_PERIPH_A | PIO_DEFAULT)
+
+/*! USART0 pin RTS  (labeled 2, shared with TIOA0) */
+#define PIN_USART0_RTS\
+	{PIO_PB25A_RTS0, PIOB, ID_PIOB, PIO_PERIPH_A, PIO_DEFAULT}
+#define PIN_USART0_RTS_IDX        (PIO_PB25_IDX)
+#define PIN_USART0_RTS_FLAGS      (PIO_PERIPH_A | PIO_DEFAULT)
+
 /**
  * \file
  * USART1
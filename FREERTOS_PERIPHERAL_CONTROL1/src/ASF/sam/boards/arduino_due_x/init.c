@@ -161,6 +161,16 @@ void board_init(void)
 	gpio_configure_pin(PIN_USART0_TXD_IDX, PIN_USART0_TXD_FLAGS);
 #endif
 
+#ifdef CONF_BOARD_USART_CTS
+	/* Configure USART CTS pin */
+	gpio_configure_pin(PIN_USART0_CTS_IDX, PIN_USART0_CTS_FLAGS);
+#endif
+
+#ifdef CONF_BOARD_USART_RTS
+	/* Configure USART RTS pin */
+	gpio_configure_pin(PIN_USART0_RTS_IDX, PIN_USART0_RTS_FLAGS);
+#endif
+
 #ifdef CONF_BOARD_USB_PORT
 	/* Configure USB_ID (UOTGID) pin */
 	gpio_configure_pin(USB_ID_GPIO, USB_ID_FLAGS);
@@ -0,0 +1,726 @@
+/**
+ *
+ * \file
+ *
+ * \brief FreeRTOS SPI serial flash test task
+ *
+ *
+ * Copyright (c) 2012-2018 Microchip Technology Inc. and its subsidiaries.
+ *
+ * \asf_license_start
+ *
+ * \page License
+ *
+ * Subject to your compliance with these terms, you may use Microchip
+ * software and any derivatives exclusively with Microchip products.
+ * It is your responsibility to comply with third party license terms applicable
+ * to your use of third party software (including open source software) that
+ * may accompany Microchip software.
+ *
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES,
+ * WHETHER EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE,
+ * INCLUDING ANY IMPLIED WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY,
+ * AND FITNESS FOR A PARTICULAR PURPOSE. IN NO EVENT WILL MICROCHIP BE
+ * LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, INCIDENTAL OR CONSEQUENTIAL
+ * LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND WHATSOEVER RELATED TO THE
+ * SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS BEEN ADVISED OF THE
+ * POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE FULLEST EXTENT
+ * ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN ANY WAY
+ * RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+ * THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * \asf_license_stop
+ *
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* Atmel library includes. */
+#include <freertos_spi_master.h>
+
+/* Demo includes. */
+#include "demo-tasks.h"
+
+#if (defined confINCLUDE_SPI_FLASH_TASK)
+
+/*-----------------------------------------------------------*/
+
+/* The NPCS line the flash is on, and the fastest clock it is run at. */
+#define FLASH_CHIP_SELECT       0
+#define SPI_CLOCK_HZ            20000000
+
+/* The part of the flash used by the test, and the flash geometry. */
+#define FLASH_TEST_SIZE         8192
+#define FLASH_PAGE_SIZE         256
+#define FLASH_SECTOR_SIZE       4096
+
+/* The sequential read benchmark reads the test area BENCHMARK_PASSES times,
+each pass as a single read command whose data is collected READ_CHUNK_SIZE
+bytes at a time. */
+#define READ_CHUNK_SIZE         1024
+#define BENCHMARK_PASSES        16
+
+/* The commands common to the 25 series serial flash devices. */
+#define FLASH_WRITE_STATUS      0x01
+#define FLASH_PAGE_PROGRAM      0x02
+#define FLASH_READ              0x03
+#define FLASH_WRITE_DISABLE     0x04
+#define FLASH_READ_STATUS       0x05
+#define FLASH_WRITE_ENABLE      0x06
+#define FLASH_FAST_READ         0x0b
+#define FLASH_SECTOR_ERASE      0x20
+#define FLASH_READ_ID           0x9f
+
+/* Status register bits. */
+#define FLASH_STATUS_BUSY       0x01
+#define FLASH_STATUS_WEL        0x02
+
+/* The longest a page program or sector erase is waited for. */
+#define MAX_BUSY_TIME           (500 / portTICK_RATE_MS)
+
+/* The JEDEC ID, page program time and sector erase time of the simulated
+flash used when the task is not given an SPI port. */
+#define SIM_MANUFACTURER_ID     0xef
+#define SIM_DEVICE_ID_1         0x40
+#define SIM_DEVICE_ID_2         0x16
+#define SIM_PROGRAM_TICKS       (2 / portTICK_RATE_MS)
+#define SIM_ERASE_TICKS         (45 / portTICK_RATE_MS)
+
+/*-----------------------------------------------------------*/
+
+/* A RAM model of a serial flash the size of the test area.  It interprets the
+same command bytes as the real device, and keeps the same rules: programming
+only clears bits, program and erase need the write enable latch set, and only
+the status register can be read while the device is busy. */
+typedef struct sim_flash {
+	uint8_t memory[FLASH_TEST_SIZE];
+	uint8_t command;				/* The command of the current transaction, 0 if it is being ignored. */
+	uint32_t address;				/* The next address read or programmed. */
+	uint32_t id_index;				/* The next byte of the JEDEC ID. */
+	bool is_write_enabled;
+	bool is_busy;
+	portTickType busy_start_ticks;
+	portTickType busy_ticks;
+} sim_flash_t;
+
+/*
+ * Function that implements the task.  The task erases and programs the test
+ * area of the flash with a known pattern, then repeatedly reads it back
+ * sequentially, checking the data and measuring the read throughput.
+ */
+static void spi_flash_task(void *pvParameters);
+
+/*
+ * Select the flash and send a command.  The device stays selected for the data
+ * that follows, until flash_end() is called.
+ */
+static void flash_begin(const uint8_t *command, size_t len);
+
+/* Send data to the selected flash, and wait for it to be sent. */
+static void flash_write(const uint8_t *data, size_t len);
+
+/*
+ * Start reading data from the selected flash.  When the asynchronous API is
+ * used the read is still in progress when this returns, and flash_wait()
+ * must be called before the data is used or another transfer started.
+ */
+static void flash_start_read(uint8_t *data, size_t len);
+
+/* Wait for a read started by flash_start_read() to complete. */
+static void flash_wait(void);
+
+/* Deselect the flash, ending the command. */
+static void flash_end(void);
+
+/* Send a single byte command that has no data. */
+static void flash_command(uint8_t command);
+
+/* Send a command followed by a 24-bit address. */
+static void flash_begin_addressed(uint8_t command, uint32_t address);
+
+/* Wait for a program or erase to complete. */
+static void wait_until_ready(void);
+
+/* The value the test writes at an address. */
+static uint8_t pattern_byte(uint32_t address);
+
+/* The simulated flash's versions of flash_begin(), flash_write(),
+flash_start_read() and flash_end(). */
+static void sim_flash_begin(const uint8_t *command, size_t len);
+static void sim_flash_write(const uint8_t *data, size_t len);
+static void sim_flash_read(uint8_t *data, size_t len);
+static void sim_flash_end(void);
+static bool is_sim_flash_busy(void);
+
+/* Two buffers, so the asynchronous API can read one while the other is being
+checked. */
+static uint8_t data_buffer[2][READ_CHUNK_SIZE];
+
+/* The flash model, only used if the task is not given an SPI port. */
+static sim_flash_t sim_flash;
+
+/* The SPI port the flash is on, or NULL if the simulated flash is used. */
+static freertos_spi_if freertos_spi = NULL;
+
+/* Used to latch errors found during the execution of the example. */
+static uint32_t error_detected = pdFALSE;
+
+/* flash_test_passed is set to pdPASS once the test area has been programmed
+and read back without an error being latched in error_detected.  This is used
+by other tasks to determine if the test was successful or not. */
+static uint32_t flash_test_passed = pdFALSE;
+
+/* The sequential read throughput measured by the last benchmark, in bytes per
+second. */
+static uint32_t flash_read_throughput = 0;
+
+/* If spi_use_asynchronous_api is set to pdTRUE, then the example will use the
+fully asynchronous FreeRTOS API.  Otherwise the example will use the blocking
+FreeRTOS API (other tasks will execute while the application task is blocked). */
+static portBASE_TYPE spi_use_asynchronous_api;
+
+/* The notification semaphore is only created and used when the fully
+asynchronous FreeRTOS API is used. */
+static xSemaphoreHandle spi_notification_semaphore = NULL;
+
+/*-----------------------------------------------------------*/
+
+void create_spi_flash_test_task(Spi *spi_base, uint16_t stack_depth_words,
+		unsigned portBASE_TYPE task_priority,
+		portBASE_TYPE set_asynchronous_api)
+{
+	/* The flash settings: mode 0, and the default chip select timings. */
+	const freertos_spi_device_t flash_device = {
+		FLASH_CHIP_SELECT,
+		SPI_CLOCK_HZ,
+		0,
+		0,
+		0
+	};
+
+	/* blocking_driver_options is used if set_asynchronous_api is passed in
+	as 0. */
+	const freertos_peripheral_options_t blocking_driver_options = {
+		NULL,											/* This peripheral does not need a receive buffer, so this parameter is just set to NULL. */
+		0,												/* There is no Rx buffer, so the rx buffer size is not used. */
+		configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,	/* The priority used by the DMAC interrupt. */
+		SPI_MASTER,										/* Communicating with the flash requires the SPI to be configured as a master. */
+		(USE_TX_ACCESS_SEM | USE_RX_ACCESS_MUTEX | WAIT_TX_COMPLETE | WAIT_RX_COMPLETE)	/* The blocking driver is to be used, so WAIT_TX_COMPLETE and WAIT_RX_COMPLETE are set. */
+	};
+
+	/* asynchronous_driver_options is used if set_asynchronous_api is passed
+	in as 1. */
+	const freertos_peripheral_options_t asynchronous_driver_options = {
+		NULL,											/* This peripheral does not need a receive buffer, so this parameter is just set to NULL. */
+		0,												/* There is no Rx buffer, so the rx buffer size is not used. */
+		configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,	/* The priority used by the DMAC interrupt. */
+		SPI_MASTER,										/* Communicating with the flash requires the SPI to be configured as a master. */
+		(USE_TX_ACCESS_SEM | USE_RX_ACCESS_MUTEX)		/* The asynchronous driver is to be used, so WAIT_TX_COMPLETE and WAIT_RX_COMPLETE are not set. */
+	};
+
+	/* Remember if the asynchronous or blocking API is being used. */
+	spi_use_asynchronous_api = set_asynchronous_api;
+
+	/* Without an SPI port the task tests the simulated flash, which starts
+	erased and with the write enable latch clear. */
+	if (spi_base == NULL) {
+		memset(sim_flash.memory, 0xff, sizeof(sim_flash.memory));
+	} else {
+		/* The freertos_peripheral_options_t structure used to initialize the
+		FreeRTOS driver differs depending on the spi_use_asynchronous_api
+		setting. */
+		if (spi_use_asynchronous_api == pdFALSE) {
+			/* Initialize the FreeRTOS driver for blocking operation.  The
+			peripheral clock is configured in this function call. */
+			freertos_spi = freertos_spi_master_init(spi_base,
+					&blocking_driver_options);
+		} else {
+			/* Initialize the FreeRTOS driver for asynchronous operation.  The
+			peripheral clock is configured in this function call. */
+			freertos_spi = freertos_spi_master_init(spi_base,
+					&asynchronous_driver_options);
+
+			/* Asynchronous operation requires a notification semaphore.
+			First, create the semaphore. */
+			vSemaphoreCreateBinary(spi_notification_semaphore);
+
+			/* Check the semaphore was created. */
+			configASSERT(spi_notification_semaphore);
+
+			/* Then set the semaphore into the correct initial state. */
+			xSemaphoreTake(spi_notification_semaphore, 0);
+		}
+
+		/* Check the port was initialized successfully. */
+		configASSERT(freertos_spi);
+
+		/* Configure the clock and mode used for the flash.  Do this after
+		calling freertos_spi_master_init(). */
+		if (freertos_spi_master_setup_device(freertos_spi,
+				&flash_device) != STATUS_OK) {
+			error_detected = pdTRUE;
+		}
+	}
+
+	/* Create the task as described above. */
+	xTaskCreate(spi_flash_task, (const signed char *const) "SPIFlash",
+			stack_depth_words, NULL, task_priority, NULL);
+}
+
+/*-----------------------------------------------------------*/
+
+static void spi_flash_task(void *pvParameters)
+{
+	uint8_t id[3];
+	uint8_t unprotect_command[2];
+	uint32_t address, chunk, pass;
+	size_t index;
+	uint8_t *chunk_data;
+	portTickType start_ticks, elapsed_ticks;
+	const uint32_t chunks_per_pass = FLASH_TEST_SIZE / READ_CHUNK_SIZE;
+	const portTickType delay_between_benchmarks = 1000 / portTICK_RATE_MS;
+
+	/* Remove compile time warnings about unused parameters. */
+	(void) pvParameters;
+
+	/* Check a flash is answering.  A missing device reads as all 0s or all
+	1s. */
+	id[0] = FLASH_READ_ID;
+	flash_begin(id, 1);
+	flash_start_read(id, sizeof(id));
+	flash_wait();
+	flash_end();
+	if ((id[0] == 0x00) || (id[0] == 0xff)) {
+		error_detected = pdTRUE;
+	}
+
+	/* Clear the block protection bits so the test area can be written. */
+	unprotect_command[0] = FLASH_WRITE_STATUS;
+	unprotect_command[1] = 0x00;
+	flash_command(FLASH_WRITE_ENABLE);
+	flash_begin(unprotect_command, sizeof(unprotect_command));
+	flash_end();
+	wait_until_ready();
+
+	/* Erase the test area, one sector at a time. */
+	for (address = 0; address < FLASH_TEST_SIZE; address += FLASH_SECTOR_SIZE) {
+		flash_command(FLASH_WRITE_ENABLE);
+		flash_begin_addressed(FLASH_SECTOR_ERASE, address);
+		flash_end();
+		wait_until_ready();
+	}
+
+	/* Program the pattern, one page at a time. */
+	for (address = 0; address < FLASH_TEST_SIZE; address += FLASH_PAGE_SIZE) {
+		for (index = 0; index < FLASH_PAGE_SIZE; index++) {
+			data_buffer[0][index] = pattern_byte(address + index);
+		}
+
+		flash_command(FLASH_WRITE_ENABLE);
+		flash_begin_addressed(FLASH_PAGE_PROGRAM, address);
+		flash_write(data_buffer[0], FLASH_PAGE_SIZE);
+		flash_end();
+		wait_until_ready();
+	}
+
+	/* Reading does not wear the flash, so the benchmark is repeated for as
+	long as the task runs. */
+	for (;;) {
+		start_ticks = xTaskGetTickCount();
+
+		for (pass = 0; pass < BENCHMARK_PASSES; pass++) {
+			flash_begin_addressed(FLASH_READ, 0);
+			flash_start_read(data_buffer[0], READ_CHUNK_SIZE);
+
+			for (chunk = 0; chunk < chunks_per_pass; chunk++) {
+				flash_wait();
+
+				/* With the asynchronous API the next chunk is read into the
+				other buffer while this one is checked. */
+				if ((chunk + 1) < chunks_per_pass) {
+					flash_start_read(data_buffer[(chunk + 1) & 0x01],
+							READ_CHUNK_SIZE);
+				}
+
+				/* Each chunk holds different values, so stale data left in a
+				buffer by the previous chunk is detected. */
+				chunk_data = data_buffer[chunk & 0x01];
+				address = chunk * READ_CHUNK_SIZE;
+				for (index = 0; index < READ_CHUNK_SIZE; index++) {
+					if (chunk_data[index] != pattern_byte(address + index)) {
+						error_detected = pdTRUE;
+					}
+				}
+			}
+
+			flash_end();
+		}
+
+		elapsed_ticks = xTaskGetTickCount() - start_ticks;
+		if (elapsed_ticks == 0) {
+			elapsed_ticks = 1;
+		}
+
+		flash_read_throughput = (BENCHMARK_PASSES * FLASH_TEST_SIZE *
+				configTICK_RATE_HZ) / elapsed_ticks;
+
+		if (error_detected == pdFALSE) {
+			flash_test_passed = pdTRUE;
+		} else {
+			flash_test_passed = pdFALSE;
+		}
+
+		vTaskDelay(delay_between_benchmarks);
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void flash_begin(const uint8_t *command, size_t len)
+{
+	const portTickType max_block_time_ticks = 200UL / portTICK_RATE_MS;
+
+	if (freertos_spi == NULL) {
+		sim_flash_begin(command, len);
+	} else {
+		/* The chip select stays asserted until flash_end(), so the command and
+		its data form one transaction. */
+		if (freertos_spi_select_device(freertos_spi, FLASH_CHIP_SELECT,
+				max_block_time_ticks) != STATUS_OK) {
+			error_detected = pdTRUE;
+		}
+
+		flash_write(command, len);
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void flash_write(const uint8_t *data, size_t len)
+{
+	const portTickType max_block_time_ticks = 200UL / portTICK_RATE_MS;
+
+	if (freertos_spi == NULL) {
+		sim_flash_write(data, len);
+	} else if (spi_use_asynchronous_api == pdFALSE) {
+		/* The blocking API is being used.  Other tasks will execute while the
+		write operation is in progress. */
+		if (freertos_spi_write_packet(freertos_spi, data, len,
+				max_block_time_ticks) != STATUS_OK) {
+			error_detected = pdTRUE;
+		}
+	} else {
+		/* The fully asynchronous API is being used.  The notification semaphore
+		is used to indicate when the SPI transfer is complete. */
+		if (freertos_spi_write_packet_async(freertos_spi, data, len,
+				max_block_time_ticks,
+				spi_notification_semaphore) != STATUS_OK) {
+			error_detected = pdTRUE;
+		}
+
+		/* Commands and page data are short, so there is nothing else to do
+		while they are sent. */
+		flash_wait();
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void flash_start_read(uint8_t *data, size_t len)
+{
+	const portTickType max_block_time_ticks = 200UL / portTICK_RATE_MS;
+
+	if (freertos_spi == NULL) {
+		sim_flash_read(data, len);
+	} else if (spi_use_asynchronous_api == pdFALSE) {
+		/* The blocking API is being used.  Other tasks will execute while the
+		read operation is in progress. */
+		if (freertos_spi_read_packet(freertos_spi, data, len,
+				max_block_time_ticks) != STATUS_OK) {
+			error_detected = pdTRUE;
+		}
+	} else {
+		/* The fully asynchronous API is being used.  The notification semaphore
+		is given when the data has been received. */
+		if (freertos_spi_read_packet_async(freertos_spi, data, len,
+				max_block_time_ticks,
+				spi_notification_semaphore) != STATUS_OK) {
+			error_detected = pdTRUE;
+		}
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void flash_wait(void)
+{
+	const portTickType max_block_time_ticks = 200UL / portTICK_RATE_MS;
+
+	/* Only an asynchronous transfer can still be in progress.  Other tasks
+	will execute if this call causes this task to enter the Blocked state. */
+	if ((freertos_spi != NULL) && (spi_use_asynchronous_api != pdFALSE)) {
+		if (xSemaphoreTake(spi_notification_semaphore,
+				max_block_time_ticks) != pdPASS) {
+			error_detected = pdTRUE;
+		}
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void flash_end(void)
+{
+	const portTickType max_block_time_ticks = 200UL / portTICK_RATE_MS;
+
+	if (freertos_spi == NULL) {
+		sim_flash_end();
+	} else {
+		if (freertos_spi_deselect_device(freertos_spi,
+				max_block_time_ticks) != STATUS_OK) {
+			error_detected = pdTRUE;
+		}
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void flash_command(uint8_t command)
+{
+	flash_begin(&command, 1);
+	flash_end();
+}
+
+/*-----------------------------------------------------------*/
+
+static void flash_begin_addressed(uint8_t command, uint32_t address)
+{
+	uint8_t command_bytes[4];
+
+	command_bytes[0] = command;
+	command_bytes[1] = (uint8_t) ((address >> 16) & 0xff);
+	command_bytes[2] = (uint8_t) ((address >> 8) & 0xff);
+	command_bytes[3] = (uint8_t) (address & 0xff);
+
+	flash_begin(command_bytes, sizeof(command_bytes));
+}
+
+/*-----------------------------------------------------------*/
+
+static void wait_until_ready(void)
+{
+	uint8_t status = FLASH_READ_STATUS;
+	portTickType start_ticks = xTaskGetTickCount();
+
+	/* Poll the busy bit, letting other tasks run between polls, rather than
+	waiting for the longest program or erase time. */
+	for (;;) {
+		flash_begin(&status, 1);
+		flash_start_read(&status, 1);
+		flash_wait();
+		flash_end();
+
+		if ((status & FLASH_STATUS_BUSY) == 0) {
+			break;
+		}
+
+		if ((xTaskGetTickCount() - start_ticks) > MAX_BUSY_TIME) {
+			error_detected = pdTRUE;
+			break;
+		}
+
+		status = FLASH_READ_STATUS;
+		vTaskDelay(1);
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t pattern_byte(uint32_t address)
+{
+	return (uint8_t) ((address * 7) + (address >> 8));
+}
+
+/*-----------------------------------------------------------*/
+
+static void sim_flash_begin(const uint8_t *command, size_t len)
+{
+	sim_flash.command = command[0];
+	sim_flash.id_index = 0;
+
+	/* A busy device ignores everything but a status read. */
+	if (is_sim_flash_busy() && (sim_flash.command != FLASH_READ_STATUS)) {
+		sim_flash.command = 0;
+	}
+
+	switch (sim_flash.command) {
+	case FLASH_WRITE_ENABLE:
+		sim_flash.is_write_enabled = true;
+		break;
+
+	case FLASH_WRITE_DISABLE:
+		sim_flash.is_write_enabled = false;
+		break;
+
+	case FLASH_READ:
+	case FLASH_PAGE_PROGRAM:
+	case FLASH_SECTOR_ERASE:
+	case FLASH_FAST_READ:
+		/* Fast read is also followed by a dummy byte. */
+		if (len < ((sim_flash.command == FLASH_FAST_READ) ? 5 : 4)) {
+			sim_flash.command = 0;
+		} else {
+			sim_flash.address = (((uint32_t) command[1] << 16) |
+					((uint32_t) command[2] << 8) | command[3]) %
+					FLASH_TEST_SIZE;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void sim_flash_write(const uint8_t *data, size_t len)
+{
+	size_t index;
+	uint32_t page_start;
+
+	if ((sim_flash.command == FLASH_PAGE_PROGRAM) &&
+			(sim_flash.is_write_enabled == true)) {
+		/* Programming wraps around within the page, and can only clear
+		bits. */
+		page_start = sim_flash.address & ~(FLASH_PAGE_SIZE - 1);
+		for (index = 0; index < len; index++) {
+			sim_flash.memory[page_start + ((sim_flash.address + index) &
+					(FLASH_PAGE_SIZE - 1))] &= data[index];
+		}
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void sim_flash_read(uint8_t *data, size_t len)
+{
+	const uint8_t id[3] = {SIM_MANUFACTURER_ID, SIM_DEVICE_ID_1, SIM_DEVICE_ID_2};
+	size_t index;
+
+	for (index = 0; index < len; index++) {
+		switch (sim_flash.command) {
+		case FLASH_READ:
+		case FLASH_FAST_READ:
+			/* Reading continues past the end of the device from the start. */
+			data[index] = sim_flash.memory[sim_flash.address];
+			sim_flash.address = (sim_flash.address + 1) % FLASH_TEST_SIZE;
+			break;
+
+		case FLASH_READ_STATUS:
+			data[index] = (is_sim_flash_busy() ? FLASH_STATUS_BUSY : 0) |
+					(sim_flash.is_write_enabled ? FLASH_STATUS_WEL : 0);
+			break;
+
+		case FLASH_READ_ID:
+			data[index] = (sim_flash.id_index < sizeof(id)) ?
+					id[sim_flash.id_index++] : 0x00;
+			break;
+
+		default:
+			/* Nothing drives the data line. */
+			data[index] = 0xff;
+			break;
+		}
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+static void sim_flash_end(void)
+{
+	uint32_t sector_start;
+
+	/* Programs and erases start when the device is deselected, and clear the
+	write enable latch. */
+	if (sim_flash.is_write_enabled == true) {
+		switch (sim_flash.command) {
+		case FLASH_PAGE_PROGRAM:
+			sim_flash.is_busy = true;
+			sim_flash.busy_ticks = SIM_PROGRAM_TICKS;
+			break;
+
+		case FLASH_SECTOR_ERASE:
+			sector_start = sim_flash.address & ~(FLASH_SECTOR_SIZE - 1);
+			memset(&(sim_flash.memory[sector_start]), 0xff,
+					FLASH_SECTOR_SIZE);
+			sim_flash.is_busy = true;
+			sim_flash.busy_ticks = SIM_ERASE_TICKS;
+			break;
+
+		case FLASH_WRITE_STATUS:
+			sim_flash.is_write_enabled = false;
+			break;
+
+		default:
+			break;
+		}
+
+		if (sim_flash.is_busy == true) {
+			sim_flash.busy_start_ticks = xTaskGetTickCount();
+			sim_flash.is_write_enabled = false;
+		}
+	}
+
+	sim_flash.command = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool is_sim_flash_busy(void)
+{
+	if ((sim_flash.is_busy == true) &&
+			((xTaskGetTickCount() - sim_flash.busy_start_ticks) >=
+			sim_flash.busy_ticks)) {
+		sim_flash.is_busy = false;
+	}
+
+	return sim_flash.is_busy;
+}
+
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE did_spi_flash_test_pass(void)
+{
+	portBASE_TYPE return_value;
+	const portTickType twenty_five_seconds = 25000 / portTICK_RATE_MS;
+
+	if (flash_test_passed == pdTRUE) {
+		return_value = pdPASS;
+	} else {
+		/* Ensure enough time has passed for the flash test to fail or stall
+		before returning an error. */
+		if (xTaskGetTickCount() > twenty_five_seconds) {
+			return_value = pdFAIL;
+		} else {
+			return_value = pdPASS;
+		}
+	}
+
+	return return_value;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t get_spi_flash_read_throughput(void)
+{
+	return flash_read_throughput;
+}
+
+/*-----------------------------------------------------------*/
+
+#endif
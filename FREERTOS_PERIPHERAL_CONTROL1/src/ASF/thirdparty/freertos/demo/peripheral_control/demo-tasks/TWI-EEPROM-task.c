@@ -34,6 +34,8 @@
  */
 
 /* Standard includes. */
+#include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 
 /* Kernel includes. */
@@ -44,6 +46,10 @@
 /* Atmel library includes. */
 #include <freertos_twi_master.h>
 
+/* System includes. */
+#include "eeprom_cache.h"
+#include "kv_store.h"
+
 /* Demo includes. */
 #include "demo-tasks.h"
 
@@ -58,25 +64,44 @@
 #define TOTAL_EEPROM_SIZE       65536
 
 /* The size of each page in the EEPROM. */
-#define PAGE_SIZE               128
+#define PAGE_SIZE               EEP_PAGE_SIZE
+
+/* The top of the EEPROM holds a key-value store of settings, which the test
+pattern does not overwrite. */
+#define SETTINGS_SIZE           (2 * KVS_SEGMENT_SIZE)
+#define SETTINGS_ADDRESS        (TOTAL_EEPROM_SIZE - SETTINGS_SIZE)
 
-/* The maximum time the EEPROM takes to commit its RAM buffer. */
-#define INTERNAL_WRITE_DELAY    (7 / portTICK_RATE_MS)
+/* The settings keys.  The test counts how many times it has been run, and how
+many of those runs passed, across resets. */
+#define SETTING_TEST_RUNS       0
+#define SETTING_TEST_PASSES     1
 
 /*-----------------------------------------------------------*/
 
 /*
- * Function that implements the task.  The task fills an EEPROM with a known
- * pattern, then reads back from the EEPROM to ensure the data read back matches
- * that written.
+ * Function that implements the task.  The task fills the EEPROM below the
+ * settings store with a known pattern, then reads back from the EEPROM to
+ * ensure the data read back matches that written.
  */
 static void twi_eeprom_task(void *pvParameters);
 
 /*
  * Write the data held in data_buffer to the page passed in as the function
- * parameter.  The entire page is written.
+ * parameter, through the EEPROM page cache.  The entire page is written.
+ */
+static void write_page_to_eeprom(uint16_t page);
+
+/*
+ * Write every page still held in the EEPROM page cache to the EEPROM, and wait
+ * for the EEPROM to finish programming the last one.
+ */
+static void flush_eeprom(void);
+
+/*
+ * Add one to the count held in the settings store under the key passed in as
+ * the function parameter, and write it through to the EEPROM.
  */
-static void write_page_to_eeprom(freertos_twi_if freertos_twi, uint16_t page);
+static void increment_setting(uint16_t key);
 
 /*
  * Read EEPROM data from the page passed in the function parameter into
@@ -88,6 +113,15 @@ static void read_page_from_eeprom(freertos_twi_if freertos_twi,
 /* A buffer large enough to hold a complete page of data. */
 static uint8_t data_buffer[PAGE_SIZE];
 
+/* Pages are written through a write-back cache.  It finds the end of each
+page's write cycle by polling the EEPROM for an acknowledge, rather than
+sleeping for the worst-case write time after every page. */
+static EEP_TwiDevice_t eeprom_device;
+static EEP_Cache_t eeprom_cache;
+
+/* The settings store, in the same EEPROM, behind the same cache. */
+static KVS_Store_t settings_store;
+
 /* Used to latch errors found during the execution of the example. */
 static uint32_t error_detected = pdFALSE;
 
@@ -112,6 +146,8 @@ void create_twi_eeprom_test_task(Twi *twi_base, uint16_t stack_depth_words,
 		portBASE_TYPE set_asynchronous_api)
 {
 	freertos_twi_if freertos_twi;
+	EEP_Bus_t eeprom_bus;
+	bool eeprom_cache_ready;
 
 	/* blocking_driver_options is used if set_asynchronous_api is passed in
 	as 0. */
@@ -167,6 +203,13 @@ void create_twi_eeprom_test_task(Twi *twi_base, uint16_t stack_depth_words,
 	freertos_twi_master_init(). */
 	twi_set_speed(twi_base, TWI_CLOCK_HZ, sysclk_get_cpu_hz());
 
+	/* Put the page cache in front of the EEPROM.  With the asynchronous API
+	the cache waits on the same notification semaphore as the task. */
+	eeprom_cache_ready = EEP_InitTwiBus(&eeprom_bus, &eeprom_device,
+			freertos_twi, BOARD_AT24C_ADDRESS, twi_notification_semaphore) &&
+			EEP_Init(&eeprom_cache, &eeprom_bus, TOTAL_EEPROM_SIZE);
+	configASSERT(eeprom_cache_ready);
+
 	/* Create the task as described above. */
 	xTaskCreate(twi_eeprom_task, (const signed char *const) "Tx",
 			stack_depth_words, (void *) freertos_twi, task_priority,
@@ -179,19 +222,31 @@ static void twi_eeprom_task(void *pvParameters)
 {
 	freertos_twi_if freertos_twi;
 	portBASE_TYPE page;
-	const portBASE_TYPE max_page = TOTAL_EEPROM_SIZE / PAGE_SIZE;
+	const portBASE_TYPE max_page = SETTINGS_ADDRESS / PAGE_SIZE;
 	size_t byte_in_page;
 	uint8_t byte_value;
 
 	/* The already open TWI port is passed in as the task parameter. */
 	freertos_twi = (freertos_twi_if) pvParameters;
 
+	/* Open the settings store, which is created the first time the test runs
+	on this EEPROM, and count this run. */
+	if (KVS_Init(&settings_store, &eeprom_cache, SETTINGS_ADDRESS,
+			SETTINGS_SIZE) == false) {
+		error_detected = pdTRUE;
+	}
+
+	increment_setting(SETTING_TEST_RUNS);
+
 	/* Fill the EEPROM with 0xaa, one page at a time. */
 	memset(data_buffer, 0xaa, PAGE_SIZE);
 	for (page = 0; page < max_page; page++) {
-		write_page_to_eeprom(freertos_twi, page);
+		write_page_to_eeprom(page);
 	}
 
+	/* Make sure every page has reached the EEPROM before reading it back. */
+	flush_eeprom();
+
 	/* Check that the data is read back from the EEPROM as 0xaa.  First make
 	 * sure that the buffer contains a value other than 0xaa to be sure that
 	 * it
@@ -212,9 +267,12 @@ static void twi_eeprom_task(void *pvParameters)
 	/* Fill the EEPROM with 0x55, one page at a time. */
 	memset(data_buffer, 0x55, PAGE_SIZE);
 	for (page = 0; page < max_page; page++) {
-		write_page_to_eeprom(freertos_twi, page);
+		write_page_to_eeprom(page);
 	}
 
+	/* Make sure every page has reached the EEPROM before reading it back. */
+	flush_eeprom();
+
 	/* Check that the data is read back from the EEPROM as 0x55.  First make
 	sure that the buffer contains a value other than 0x55 to be sure that it
 	does not coincidentally already hold the expected data. */
@@ -241,9 +299,12 @@ static void twi_eeprom_task(void *pvParameters)
 			byte_value++;
 		}
 
-		write_page_to_eeprom(freertos_twi, page);
+		write_page_to_eeprom(page);
 	}
 
+	/* Make sure every page has reached the EEPROM before reading it back. */
+	flush_eeprom();
+
 	/* Check each byte read back matches that expected once more. */
 	byte_value = 0;
 	for (page = 0; page < max_page; page++) {
@@ -264,6 +325,7 @@ static void twi_eeprom_task(void *pvParameters)
 	/* Complete.  To prevent wearing out the EEPROM, the task does not iterate,
 	but instead deletes itself. */
 	if (error_detected == pdFALSE) {
+		increment_setting(SETTING_TEST_PASSES);
 		eeprom_test_passed = pdTRUE;
 	}
 
@@ -274,55 +336,47 @@ static void twi_eeprom_task(void *pvParameters)
 
 /*-----------------------------------------------------------*/
 
-static void write_page_to_eeprom(freertos_twi_if freertos_twi, uint16_t page)
+static void write_page_to_eeprom(uint16_t page)
 {
-	twi_packet_t write_parameters;
-	uint16_t calculated_address;
 	const portTickType max_block_time_ticks = 200UL / portTICK_RATE_MS;
 
-	write_parameters.chip = BOARD_AT24C_ADDRESS;
-	write_parameters.buffer = data_buffer;
-	write_parameters.length = PAGE_SIZE;
-
-	/* The internal EEPROM address being written to is calculated from the page
-	number. */
-	calculated_address = page * PAGE_SIZE;
-	write_parameters.addr[0] = (uint8_t) ((calculated_address >> 8) & 0xff);
-	write_parameters.addr[1] = (uint8_t) (calculated_address & 0xff);
-	write_parameters.addr_length = 2;
+	/* The page is copied into the cache, and only written to the EEPROM when
+	the cache needs the space, or is flushed.  Before writing a page the cache
+	polls the EEPROM until it has finished programming the previous one. */
+	if (EEP_Write(&eeprom_cache, page * PAGE_SIZE, data_buffer, PAGE_SIZE,
+			max_block_time_ticks) == false) {
+		error_detected = pdTRUE;
+	}
+}
 
-	if (twi_use_asynchronous_api == pdFALSE) {
-		/* The blocking API is being used.  Other tasks will execute while the
-		write operation is in progress. */
-		if (freertos_twi_write_packet(freertos_twi, &write_parameters,
-				max_block_time_ticks) != STATUS_OK) {
-			error_detected = pdTRUE;
-		}
-	} else {
-		/* The fully asynchronous API is being used.  The notification semaphore
-		is used to indicate when the TWI transfer is complete. */
-		if (freertos_twi_write_packet_async(freertos_twi,
-				&write_parameters, max_block_time_ticks,
-				twi_notification_semaphore) != STATUS_OK) {
-			error_detected = pdTRUE;
-		}
+/*-----------------------------------------------------------*/
 
-		/* ... other processing can be done here while the TWI write is in
-		progress ... */
+static void flush_eeprom(void)
+{
+	const portTickType max_block_time_ticks = 200UL / portTICK_RATE_MS;
 
-		/* Ensure the transaction is complete before proceeding further.  Other
-		tasks will execute if this call causes this task to enter the Blocked
-		state. */
-		if (xSemaphoreTake(twi_notification_semaphore,
-				max_block_time_ticks) != pdPASS) {
-			error_detected = pdTRUE;
-		}
+	if (EEP_Flush(&eeprom_cache, max_block_time_ticks) == false) {
+		error_detected = pdTRUE;
 	}
+}
 
-	/* Wait for the EEPROM to complete programming its internal memory.
-	Note this is a very crude way of doing this, the EEPROM status
-	register could be polled to determine when it was finished. */
-	vTaskDelay(INTERNAL_WRITE_DELAY);
+/*-----------------------------------------------------------*/
+
+static void increment_setting(uint16_t key)
+{
+	const portTickType max_block_time_ticks = 200UL / portTICK_RATE_MS;
+	uint32_t count = 0;
+
+	/* A missing key is a count of zero. */
+	(void) KVS_Get(&settings_store, key, &count, sizeof(count), NULL,
+			max_block_time_ticks);
+	count++;
+
+	if ((KVS_Set(&settings_store, key, &count, sizeof(count),
+			max_block_time_ticks) == false) ||
+			(KVS_Sync(&settings_store, max_block_time_ticks) == false)) {
+		error_detected = pdTRUE;
+	}
 }
 
 /*-----------------------------------------------------------*/
@@ -34,6 +34,7 @@
 
 /* Standard includes. */
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 
 /* FreeRTOS includes. */
@@ -52,6 +53,9 @@
 /* Demo includes. */
 #include "demo-tasks.h"
 
+/* System includes. */
+#include "log_ring.h"
+
 #if (defined confINCLUDE_UART_CLI)
 
 /* Dimensions the buffer into which input characters are placed. */
@@ -64,6 +68,9 @@
 /* Baud rate to use. */
 #define CLI_BAUD_RATE           115200
 
+/* Stack size of the task that sends the log to the UART. */
+#define LOG_DRAIN_STACK_DEPTH   (configMINIMAL_STACK_SIZE * 2)
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -109,6 +116,11 @@ void create_uart_cli_task(Uart *uart_base, uint16_t stack_depth_words,
 			&driver_options);
 	configASSERT(freertos_uart);
 
+#if (configUSE_LOG_RING == 1)
+	/* The log is sent to the same UART, between the console's own writes. */
+	LOG_StartDrain(freertos_uart, LOG_DRAIN_STACK_DEPTH, tskIDLE_PRIORITY);
+#endif
+
 	/* Register the default CLI commands. */
 	vRegisterCLICommands();
 
@@ -237,6 +249,13 @@ static void uart_command_console_task(void *pvParameters)
 
 void uart_cli_output(const uint8_t *message_string)
 {
+#if (configUSE_LOG_RING == 1)
+	/* create_uart_cli_task() started the log drain on this UART, so the
+	message can be queued there instead of waiting for the transmitter.  A
+	message can be as long as a command reply, so it is split across as many
+	log messages as it needs. */
+	(void) LOG_WriteLong(message_string, strlen((const char *) message_string));
+#else
 	const portTickType max_block_time_ticks = 200UL / portTICK_RATE_MS;
 
 	/* The UART is configured to use a mutex on Tx, so can be safely written
@@ -245,6 +264,7 @@ void uart_cli_output(const uint8_t *message_string)
 		freertos_uart_write_packet(cli_uart, message_string,
 				strlen((const char *) message_string), max_block_time_ticks);
 	}
+#endif
 }
 
 /*-----------------------------------------------------------*/
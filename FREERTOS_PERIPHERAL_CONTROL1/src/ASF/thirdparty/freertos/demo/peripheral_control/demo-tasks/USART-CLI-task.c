@@ -63,6 +63,10 @@
 /* Baud rate to use. */
 #define CLI_BAUD_RATE           115200
 
+/* Wake the console task once the line has been idle for two characters (8N1),
+rather than the driver's default of 5ms, so key presses are echoed promptly. */
+#define CLI_RX_IDLE_BIT_PERIODS (20)
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -112,6 +116,9 @@ void create_usart_cli_task(Usart *usart_base, uint16_t stack_depth_words,
 			&driver_options);
 	configASSERT(freertos_usart);
 
+	freertos_usart_set_rx_idle_timeout(freertos_usart,
+			CLI_RX_IDLE_BIT_PERIODS, false);
+
 	/* Register the default CLI commands. */
 	vRegisterCLICommands();
 
@@ -49,6 +49,19 @@
 
 #if (defined confINCLUDE_USART_ECHO_TASKS)
 
+#if (defined confUSART_ECHO_FLOW_CONTROL)
+	#include "conf_board.h"
+	#if !(defined CONF_BOARD_USART_CTS) || !(defined CONF_BOARD_USART_RTS)
+		#error confUSART_ECHO_FLOW_CONTROL needs CONF_BOARD_USART_CTS and CONF_BOARD_USART_RTS defined in conf_board.h
+	#endif
+
+	/* RS232 operation with RTS/CTS flow control. */
+	#define USART_ECHO_MODE		USART_RS232_HW_HANDSHAKING
+#else
+	/* RS232 operation. */
+	#define USART_ECHO_MODE		USART_RS232
+#endif
+
 /* The size of the buffer used to receive characters from the USART driver.
  * This equals the length of the longest string used in this file. */
 #define RX_BUFFER_SIZE          (79)
@@ -61,7 +74,10 @@
  * Tasks used to develop the USART drivers.  One task sends out a series of
  * strings, the other task expects to receive the same series of strings.  An
  * error is latched if any characters are missing.  A loopback connector is
- * required to ensure the transmitted characters are also received.
+ * required to ensure the transmitted characters are also received.  If
+ * confUSART_ECHO_FLOW_CONTROL is defined the port uses RTS/CTS flow control,
+ * so the connector must also link RTS to CTS, which stops the Tx task rather
+ * than losing characters if the Rx task falls behind.
  */
 static void usart_echo_tx_task(void *pvParameters);
 static void usart_echo_rx_task(void *pvParameters);
@@ -209,7 +225,7 @@ void create_usart_echo_test_tasks(Usart *usart_base,
 		receive_buffer,								/* The buffer used internally by the USART driver to store incoming characters. */
 		RX_BUFFER_SIZE,									/* The size of the buffer provided to the USART driver to store incoming characters. */
 		configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,	/* The priority used by the USART interrupts. */
-		USART_RS232,									/* Configure the USART for RS232 operation. */
+		USART_ECHO_MODE,								/* Configure the USART for RS232 operation, with RTS/CTS flow control if confUSART_ECHO_FLOW_CONTROL is defined. */
 		(USE_TX_ACCESS_SEM | USE_RX_ACCESS_MUTEX)
 	};
 
@@ -248,6 +264,8 @@ static void usart_echo_tx_task(void *pvParameters)
 	xSemaphoreHandle notification_semaphore;
 	unsigned portBASE_TYPE string_index;
 	status_code_t returned_status;
+	freertos_iovec_t segments[2];
+	size_t length;
 
 	/* Check the strings being sent fit in the buffers provided. */
 	for(string_index = 0; string_index < sizeof(echo_strings) / sizeof(uint8_t *); string_index++)
@@ -275,10 +293,16 @@ static void usart_echo_tx_task(void *pvParameters)
 		strcpy((char *) local_buffer,
 				(const char *) echo_strings[string_index]);
 
-		/* Start send. */
-		returned_status = freertos_usart_write_packet_async(usart_port,
-				local_buffer, strlen((char *) local_buffer),
-				time_out_definition, notification_semaphore);
+		/* Start send.  The string is sent as two segments of one vectored
+		write, which the driver transmits back to back.  The first segment
+		of a one character string is empty, and is skipped. */
+		length = strlen((char *) local_buffer);
+		segments[0].data = local_buffer;
+		segments[0].len = length / 2;
+		segments[1].data = &local_buffer[length / 2];
+		segments[1].len = length - (length / 2);
+		returned_status = freertos_usart_writev_async(usart_port,
+				segments, 2, time_out_definition, notification_semaphore);
 		configASSERT(returned_status == STATUS_OK);
 
 		/* The async version of the write function is being used, so wait for
@@ -300,34 +324,59 @@ static void usart_echo_tx_task(void *pvParameters)
 static void usart_echo_rx_task(void *pvParameters)
 {
 	freertos_usart_if usart_port;
-	static uint8_t rx_buffer[RX_BUFFER_SIZE];
-	uint32_t received;
+	freertos_iovec_t spans[FREERTOS_RX_SPAN_COUNT];
+	const uint8_t *expected;
+	uint32_t expected_length, received, consumed, available, span;
+	uint32_t compare_length;
 	unsigned portBASE_TYPE string_index;
 
 	/* The (already open) USART port is passed in as the task parameter. */
 	usart_port = (freertos_usart_if)pvParameters;
 
 	string_index = 0;
+	received = 0;
 
 	for (;;) {
-		memset(rx_buffer, 0x00, sizeof(rx_buffer));
+		/* Wait for data, and check it where the driver received it rather
+		than copying it out.  Only the bytes of the string expected are
+		consumed, so any of the next string stay to be peeked again. */
+		expected = echo_strings[string_index];
+		expected_length = strlen((const char *) expected);
 
-		received = freertos_usart_serial_read_packet(usart_port, rx_buffer,
-				strlen((const char *) echo_strings[string_index]),
+		available = freertos_usart_serial_peek(usart_port, spans,
 				portMAX_DELAY);
+		if (available == 0) {
+			continue;
+		}
+
+		consumed = 0;
+		for (span = 0; (span < FREERTOS_RX_SPAN_COUNT) &&
+				(received < expected_length); span++) {
+			compare_length = expected_length - received;
+			if (compare_length > spans[span].len) {
+				compare_length = spans[span].len;
+			}
+
+			/* Ensure the bytes received are those expected. */
+			configASSERT(memcmp(spans[span].data, &expected[received],
+					compare_length) == 0);
+			received += compare_length;
+			consumed += compare_length;
+		}
 
-		/* Ensure the string received is that expected. */
-		configASSERT(received == strlen((const char *) echo_strings[string_index]));
-		configASSERT(strcmp((const char *) rx_buffer, (const char *) echo_strings[string_index]) == 0);
+		freertos_usart_serial_consume(usart_port, consumed);
 
-		/* Increment a loop counter as an indication that this task is still
-		actually receiving strings. */
-		rx_task_loops++;
+		if (received == expected_length) {
+			/* Increment a loop counter as an indication that this task is
+			still actually receiving strings. */
+			rx_task_loops++;
+			received = 0;
 
-		/* Expect the next string the next time around. */
-		string_index++;
-		if (string_index >= (sizeof(echo_strings) / sizeof(uint8_t *))) {
-			string_index = 0;
+			/* Expect the next string the next time around. */
+			string_index++;
+			if (string_index >= (sizeof(echo_strings) / sizeof(uint8_t *))) {
+				string_index = 0;
+			}
 		}
 	}
 }
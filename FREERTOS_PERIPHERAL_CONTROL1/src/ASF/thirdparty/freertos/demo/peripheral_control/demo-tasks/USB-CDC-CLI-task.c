@@ -35,6 +35,7 @@
 
 /* Standard includes. */
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 
 /* FreeRTOS includes. */
@@ -52,6 +53,7 @@
 
 /* Demo includes. */
 #include "demo-tasks.h"
+#include "latency_monitor.h"
 
 /* Semaphore used to signal the arrival of new data. */
 static xSemaphoreHandle cdc_new_data_semaphore = NULL;
@@ -142,7 +144,9 @@ static void usb_cdc_command_console_task(void *pvParameters)
 
 	for (;;) {
 		/* Wait for new data. */
+		LAT_RECORD_TASK_WAIT(LAT_PATH_CDC_RX);
 		xSemaphoreTake(cdc_new_data_semaphore, portMAX_DELAY);
+		LAT_RECORD_TASK_RUN(LAT_PATH_CDC_RX);
 
 		/* Ensure mutually exclusive access is obtained as other tasks can write
 		to the CLI. */
@@ -270,6 +274,9 @@ bool cli_cdc_enable(uint8_t port)
 
 void cli_cdc_rx_notify(uint8_t port)
 {
+	/* This is a callback from the USB interrupt, so the ISR time measured
+	for this path excludes the USB stack's own processing. */
+	uint32_t isr_entry_cycles = LAT_ISR_ENTRY_STAMP();
 	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
 	(void) port;
@@ -277,6 +284,7 @@ void cli_cdc_rx_notify(uint8_t port)
 	/* Sanity check the event semaphore before giving it to indicate to the
 	 * task that data is available. */
 	configASSERT(cdc_new_data_semaphore);
+	LAT_RECORD_GIVE_FROM_ISR(LAT_PATH_CDC_RX, isr_entry_cycles);
 	xSemaphoreGiveFromISR(cdc_new_data_semaphore,
 			&xHigherPriorityTaskWoken);
 	portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
@@ -42,5 +42,11 @@
 #define confINCLUDE_USART_ECHO_TASKS
 //#define confINCLUDE_USART_CLI
 #define confINCLUDE_CDC_CLI
+#define confINCLUDE_SPI_FLASH_TASK
+
+/* Uncomment to run the USART echo tasks with RTS/CTS flow control.  The loopback
+connector must then also link RTS to CTS, and CONF_BOARD_USART_CTS and
+CONF_BOARD_USART_RTS must be defined in conf_board.h. */
+//#define confUSART_ECHO_FLOW_CONTROL
 
 #endif/* CONF_EXAMPLE_H */
@@ -711,6 +711,26 @@ extern "C" {
 	#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
 #endif
 
+#ifndef configUSE_MUTEX_PROFILER
+	#define configUSE_MUTEX_PROFILER 0
+#endif
+
+#if ( configUSE_MUTEX_PROFILER == 1 )
+
+	#ifndef configMUTEX_PROFILER_GET_TIME
+		#if ( configGENERATE_RUN_TIME_STATS == 1 ) && defined( portGET_RUN_TIME_COUNTER_VALUE )
+			#define configMUTEX_PROFILER_GET_TIME() portGET_RUN_TIME_COUNTER_VALUE()
+		#else
+			#error If configUSE_MUTEX_PROFILER is set to 1 then configMUTEX_PROFILER_GET_TIME must be defined to return a free running 32-bit time stamp.
+		#endif
+	#endif
+
+#endif /* configUSE_MUTEX_PROFILER */
+
+#ifndef configUSE_QUEUE_HIGH_WATER_MARK
+	#define configUSE_QUEUE_HIGH_WATER_MARK 0
+#endif
+
 #ifndef configUSE_MALLOC_FAILED_HOOK
 	#define configUSE_MALLOC_FAILED_HOOK 0
 #endif
@@ -1071,6 +1091,23 @@ typedef struct xSTATIC_QUEUE
 		uint8_t ucDummy9;
 	#endif
 
+	#if ( configUSE_MUTEX_PROFILER == 1 )
+		struct
+		{
+			uint32_t ulDummy10[ 4 ];
+			uint64_t ullDummy11;
+			uint32_t ulDummy12[ 2 ];
+			uint64_t ullDummy13;
+			uint32_t ulDummy14;
+		} xDummy10;
+		uint32_t ulDummy15;
+		BaseType_t xDummy16;
+	#endif
+
+	#if ( configUSE_QUEUE_HIGH_WATER_MARK == 1 )
+		UBaseType_t uxDummy17;
+	#endif
+
 } StaticQueue_t;
 typedef StaticQueue_t StaticSemaphore_t;
 
@@ -60,6 +60,26 @@ typedef void * QueueSetHandle_t;
  */
 typedef void * QueueSetMemberHandle_t;
 
+#if ( configUSE_MUTEX_PROFILER == 1 )
+	/*
+	 * Contention statistics gathered for each mutex and semaphore when
+	 * configUSE_MUTEX_PROFILER is set to 1.  Times are in the units of
+	 * configMUTEX_PROFILER_GET_TIME().  Obtained with xQueueGetMutexProfile().
+	 */
+	typedef struct xMUTEX_PROFILE
+	{
+		uint32_t ulTakes;			/*< Successful takes. */
+		uint32_t ulContendedTakes;	/*< Takes, successful or not, that found the mutex or semaphore unavailable. */
+		uint32_t ulTimeouts;		/*< Takes that failed because the block time expired. */
+		uint32_t ulInheritances;	/*< Times a task blocking on the mutex raised the priority of the holder. */
+		uint64_t ullTotalWaitTime;	/*< Total time spent waiting by contended takes. */
+		uint32_t ulMaxWaitTime;		/*< Longest time spent waiting by a single take. */
+		uint32_t ulHolds;			/*< Number of hold times measured (mutexes and binary semaphores only). */
+		uint64_t ullTotalHoldTime;	/*< Total time from a take to the matching give. */
+		uint32_t ulMaxHoldTime;		/*< Longest time from a take to the matching give. */
+	} MutexProfile_t;
+#endif
+
 /* For internal use only. */
 #define	queueSEND_TO_BACK		( ( BaseType_t ) 0 )
 #define	queueSEND_TO_FRONT		( ( BaseType_t ) 1 )
@@ -866,6 +886,87 @@ BaseType_t xQueuePeekFromISR( QueueHandle_t xQueue, void * const pvBuffer ) PRIV
  */
 BaseType_t xQueueReceive( QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
 
+/**
+ * queue. h
+ * <pre>
+ size_t xQueueReceiveMultiple(
+								QueueHandle_t xQueue,
+								void *pvBuffer,
+								size_t xMaxItems,
+								TickType_t xTicksToWait
+							);</pre>
+ *
+ * Receive up to xMaxItems items from a queue in a single operation.  The
+ * items are copied into consecutive elements of pvBuffer, oldest first.
+ *
+ * The calling task blocks for at most xTicksToWait until at least one item is
+ * available, then removes as many items as are available (up to xMaxItems)
+ * within a single critical section.  One task waiting to send is unblocked
+ * for each item removed, and at most one context switch is requested, so the
+ * per-item cost of a consumer that drains a queue is much lower than calling
+ * xQueueReceive() once per item.
+ *
+ * Must not be used on a mutex or semaphore.
+ *
+ * @param xQueue The handle to the queue from which the items are to be
+ * received.
+ *
+ * @param pvBuffer Pointer to the buffer into which the received items will
+ * be copied.  It must be large enough to hold xMaxItems items.
+ *
+ * @param xMaxItems The maximum number of items to receive.
+ *
+ * @param xTicksToWait The maximum amount of time the task should block
+ * waiting for the first item should the queue be empty at the time of the
+ * call.  Setting xTicksToWait to 0 will cause the function to return
+ * immediately if the queue is empty.
+ *
+ * @return The number of items received, which is 0 if the call timed out.
+ *
+ * \defgroup xQueueReceiveMultiple xQueueReceiveMultiple
+ * \ingroup QueueManagement
+ */
+size_t xQueueReceiveMultiple( QueueHandle_t xQueue, void * const pvBuffer, const size_t xMaxItems, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * queue. h
+ * <pre>
+ size_t xQueueSendMultiple(
+							 QueueHandle_t xQueue,
+							 const void *pvItemsToQueue,
+							 size_t xItemCount,
+							 TickType_t xTicksToWait
+						 );</pre>
+ *
+ * Post xItemCount items, held in consecutive elements of pvItemsToQueue, to
+ * the back of a queue.
+ *
+ * Each time there is space in the queue as many of the remaining items as
+ * will fit are copied within a single critical section, one task waiting to
+ * receive is unblocked for each item posted, and at most one context switch
+ * is requested.  If the queue becomes full the calling task blocks until
+ * there is space again, for at most xTicksToWait in total.
+ *
+ * Must not be used on a mutex or semaphore.
+ *
+ * @param xQueue The handle to the queue on which the items are to be posted.
+ *
+ * @param pvItemsToQueue A pointer to the first of the items to post.
+ *
+ * @param xItemCount The number of items to post.
+ *
+ * @param xTicksToWait The maximum amount of time the task should block
+ * waiting for space to become available on the queue.  Setting xTicksToWait
+ * to 0 posts as many items as currently fit and returns immediately.
+ *
+ * @return The number of items posted.  This is less than xItemCount if the
+ * call timed out.
+ *
+ * \defgroup xQueueSendMultiple xQueueSendMultiple
+ * \ingroup QueueManagement
+ */
+size_t xQueueSendMultiple( QueueHandle_t xQueue, const void * const pvItemsToQueue, const size_t xItemCount, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
 /**
  * queue. h
  * <pre>UBaseType_t uxQueueMessagesWaiting( const QueueHandle_t xQueue );</pre>
@@ -1391,6 +1492,27 @@ BaseType_t xQueueIsQueueEmptyFromISR( const QueueHandle_t xQueue ) PRIVILEGED_FU
 BaseType_t xQueueIsQueueFullFromISR( const QueueHandle_t xQueue ) PRIVILEGED_FUNCTION;
 UBaseType_t uxQueueMessagesWaitingFromISR( const QueueHandle_t xQueue ) PRIVILEGED_FUNCTION;
 
+/**
+ * queue. h
+ * <pre>UBaseType_t uxQueueGetHighWaterMark( const QueueHandle_t xQueue );</pre>
+ *
+ * Return the largest number of items the queue has held at any one time since
+ * it was created.  For a semaphore this is the largest count it has reached.
+ * configUSE_QUEUE_HIGH_WATER_MARK must be set to 1 in FreeRTOSConfig.h for
+ * this function to be available.  Can be called from an interrupt.
+ *
+ * @param xQueue A handle to the queue being queried.
+ *
+ * @return The most items the queue has held.  If this reaches the length of
+ * the queue then a send may have had to wait for space.
+ *
+ * \defgroup uxQueueGetHighWaterMark uxQueueGetHighWaterMark
+ * \ingroup QueueManagement
+ */
+#if( configUSE_QUEUE_HIGH_WATER_MARK == 1 )
+	UBaseType_t uxQueueGetHighWaterMark( const QueueHandle_t xQueue ) PRIVILEGED_FUNCTION;
+#endif
+
 /*
  * The functions defined above are for passing data to and from tasks.  The
  * functions below are the equivalents for passing data to and from
@@ -1486,6 +1608,53 @@ BaseType_t xQueueGiveMutexRecursive( QueueHandle_t pxMutex ) PRIVILEGED_FUNCTION
 	const char *pcQueueGetName( QueueHandle_t xQueue ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
 #endif
 
+/*
+ * Walks the queue registry, for example to list every registered queue.
+ *
+ * @param uxIndex The registry slot to read, from 0 to
+ * configQUEUE_REGISTRY_SIZE - 1.
+ *
+ * @param ppcQueueName Set to the name of the queue in the slot.  Can be NULL.
+ *
+ * @return The handle of the queue in the slot, or NULL if the slot is unused.
+ */
+#if( configQUEUE_REGISTRY_SIZE > 0 )
+	QueueHandle_t xQueueGetRegistryEntry( UBaseType_t uxIndex, const char **ppcQueueName ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+#endif
+
+/*
+ * Take a snapshot of the contention statistics of a mutex or semaphore.
+ * configUSE_MUTEX_PROFILER must be set to 1 in FreeRTOSConfig.h for this
+ * function to be available.
+ *
+ * Every call to xSemaphoreTake() updates the take, contention, timeout and wait
+ * time counts.  For mutexes and binary semaphores the time from a successful
+ * take to the next give is recorded as the hold time.  For a binary semaphore
+ * used for signalling rather than locking the hold time is simply the time
+ * between events.  Takes and gives from interrupts are not profiled, other
+ * than a give ending a hold time.
+ *
+ * @param xQueue The handle of the mutex or semaphore.
+ *
+ * @param pxProfile Filled in with the statistics.
+ *
+ * @return pdPASS if xQueue is a mutex or semaphore, otherwise pdFAIL.
+ */
+#if( configUSE_MUTEX_PROFILER == 1 )
+	BaseType_t xQueueGetMutexProfile( QueueHandle_t xQueue, MutexProfile_t * const pxProfile ) PRIVILEGED_FUNCTION;
+#endif
+
+/*
+ * Clear the contention statistics of a mutex or semaphore.
+ * configUSE_MUTEX_PROFILER must be set to 1 in FreeRTOSConfig.h for this
+ * function to be available.
+ *
+ * @param xQueue The handle of the mutex or semaphore.
+ */
+#if( configUSE_MUTEX_PROFILER == 1 )
+	void vQueueResetMutexProfile( QueueHandle_t xQueue ) PRIVILEGED_FUNCTION;
+#endif
+
 /*
  * Generic version of the function used to creaet a queue using dynamic memory
  * allocation.  This is called by other functions and macros that create other
@@ -34,6 +34,11 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
+/* Critical section profiler hooks (System/critical_profiler.h). */
+#include <stdbool.h>
+#include <stdint.h>
+#include "critical_profiler.h"
+
 /* For backward compatibility, ensure configKERNEL_INTERRUPT_PRIORITY is
 defined.  The value should also ensure backward compatibility.
 FreeRTOS.org versions prior to V4.4.0 did not include this definition. */
@@ -364,6 +369,12 @@ void vPortEnterCritical( void )
 	portDISABLE_INTERRUPTS();
 	uxCriticalNesting++;
 
+	/* Time the outermost critical section only, charged to the caller. */
+	if( uxCriticalNesting == 1 )
+	{
+		CSP_RECORD_ENTER();
+	}
+
 	/* This is not the interrupt safe version of the enter critical function so
 	assert() if it is being called from an interrupt context.  Only API
 	functions that end in "FromISR" can be used in an interrupt.  Only assert if
@@ -382,6 +393,7 @@ void vPortExitCritical( void )
 	uxCriticalNesting--;
 	if( uxCriticalNesting == 0 )
 	{
+		CSP_RECORD_EXIT();
 		portENABLE_INTERRUPTS();
 	}
 }
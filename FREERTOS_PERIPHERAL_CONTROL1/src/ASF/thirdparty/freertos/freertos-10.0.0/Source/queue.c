@@ -121,6 +121,16 @@ typedef struct QueueDefinition
 		uint8_t ucQueueType;
 	#endif
 
+	#if ( configUSE_MUTEX_PROFILER == 1 )
+		MutexProfile_t xProfile;	/*< Contention statistics, only gathered when the structure is used as a mutex or semaphore. */
+		uint32_t ulTakeTime;		/*< When a mutex or binary semaphore was last taken, used to time how long it is held. */
+		BaseType_t xIsHeld;			/*< pdTRUE between a profiled take and the matching give. */
+	#endif
+
+	#if ( configUSE_QUEUE_HIGH_WATER_MARK == 1 )
+		UBaseType_t uxHighWaterMark;	/*< The largest number of items the queue has held since it was created. */
+	#endif
+
 } xQUEUE;
 
 /* The old xQUEUE name is maintained above then typedefed to the new Queue_t
@@ -214,6 +224,20 @@ static void prvInitialiseNewQueue( const UBaseType_t uxQueueLength, const UBaseT
 	static void prvInitialiseMutex( Queue_t *pxNewQueue ) PRIVILEGED_FUNCTION;
 #endif
 
+#if ( configUSE_MUTEX_PROFILER == 1 )
+	/*
+	 * Update the contention statistics of a mutex or semaphore when a call to
+	 * xQueueSemaphoreTake() completes.  Called from a critical section.
+	 */
+	static void prvProfileTakeComplete( Queue_t * const pxQueue, const BaseType_t xTaken, const BaseType_t xContended, const uint32_t ulWaitStartTime ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Update the hold time statistics of a mutex or binary semaphore when it
+	 * is given back.  Called from a critical section.
+	 */
+	static void prvProfileGive( Queue_t * const pxQueue ) PRIVILEGED_FUNCTION;
+#endif
+
 #if( configUSE_MUTEXES == 1 )
 	/*
 	 * If a task waiting for a mutex causes the mutex holder to inherit a
@@ -245,6 +269,21 @@ static void prvInitialiseNewQueue( const UBaseType_t uxQueueLength, const UBaseT
 	taskEXIT_CRITICAL()
 /*-----------------------------------------------------------*/
 
+/*
+ * Macro to record the number of items in a queue if it is the most the queue
+ * has held.  Called from a critical section each time an item is added.
+ */
+#if ( configUSE_QUEUE_HIGH_WATER_MARK == 1 )
+	#define prvUpdateHighWaterMark( pxQueue )								\
+		if( ( pxQueue )->uxMessagesWaiting > ( pxQueue )->uxHighWaterMark )	\
+		{																	\
+			( pxQueue )->uxHighWaterMark = ( pxQueue )->uxMessagesWaiting;	\
+		}
+#else
+	#define prvUpdateHighWaterMark( pxQueue )
+#endif /* configUSE_QUEUE_HIGH_WATER_MARK */
+/*-----------------------------------------------------------*/
+
 BaseType_t xQueueGenericReset( QueueHandle_t xQueue, BaseType_t xNewQueue )
 {
 Queue_t * const pxQueue = ( Queue_t * ) xQueue;
@@ -444,6 +483,20 @@ static void prvInitialiseNewQueue( const UBaseType_t uxQueueLength, const UBaseT
 	}
 	#endif /* configUSE_QUEUE_SETS */
 
+	#if ( configUSE_MUTEX_PROFILER == 1 )
+	{
+		( void ) memset( ( void * ) &( pxNewQueue->xProfile ), 0x00, sizeof( pxNewQueue->xProfile ) );
+		pxNewQueue->ulTakeTime = 0UL;
+		pxNewQueue->xIsHeld = pdFALSE;
+	}
+	#endif /* configUSE_MUTEX_PROFILER */
+
+	#if ( configUSE_QUEUE_HIGH_WATER_MARK == 1 )
+	{
+		pxNewQueue->uxHighWaterMark = ( UBaseType_t ) 0U;
+	}
+	#endif /* configUSE_QUEUE_HIGH_WATER_MARK */
+
 	traceQUEUE_CREATE( pxNewQueue );
 }
 /*-----------------------------------------------------------*/
@@ -681,6 +734,7 @@ static void prvInitialiseNewQueue( const UBaseType_t uxQueueLength, const UBaseT
 		if( xHandle != NULL )
 		{
 			( ( Queue_t * ) xHandle )->uxMessagesWaiting = uxInitialCount;
+			prvUpdateHighWaterMark( ( ( Queue_t * ) xHandle ) );
 
 			traceCREATE_COUNTING_SEMAPHORE();
 		}
@@ -709,6 +763,7 @@ static void prvInitialiseNewQueue( const UBaseType_t uxQueueLength, const UBaseT
 		if( xHandle != NULL )
 		{
 			( ( Queue_t * ) xHandle )->uxMessagesWaiting = uxInitialCount;
+			prvUpdateHighWaterMark( ( ( Queue_t * ) xHandle ) );
 
 			traceCREATE_COUNTING_SEMAPHORE();
 		}
@@ -921,6 +976,173 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 }
 /*-----------------------------------------------------------*/
 
+size_t xQueueSendMultiple( QueueHandle_t xQueue, const void * const pvItemsToQueue, const size_t xItemCount, TickType_t xTicksToWait )
+{
+BaseType_t xEntryTimeSet = pdFALSE, xYieldRequired;
+TimeOut_t xTimeOut;
+Queue_t * const pxQueue = ( Queue_t * ) xQueue;
+const uint8_t *pucNextItem = ( const uint8_t * ) pvItemsToQueue;
+size_t xItemsSent = 0;
+UBaseType_t uxSpaces, uxToCopy, uxCopied;
+
+	configASSERT( pxQueue );
+	configASSERT( pxQueue->uxItemSize != ( UBaseType_t ) 0U );
+	configASSERT( !( ( pvItemsToQueue == NULL ) && ( xItemCount != ( size_t ) 0 ) ) );
+	#if ( ( INCLUDE_xTaskGetSchedulerState == 1 ) || ( configUSE_TIMERS == 1 ) )
+	{
+		configASSERT( !( ( xTaskGetSchedulerState() == taskSCHEDULER_SUSPENDED ) && ( xTicksToWait != 0 ) ) );
+	}
+	#endif
+
+	while( xItemsSent < xItemCount )
+	{
+		taskENTER_CRITICAL();
+		{
+			uxSpaces = pxQueue->uxLength - pxQueue->uxMessagesWaiting;
+
+			if( uxSpaces > ( UBaseType_t ) 0 )
+			{
+				/* Copy as many of the remaining items as fit in one go. */
+				uxToCopy = uxSpaces;
+				if( ( size_t ) uxToCopy > ( xItemCount - xItemsSent ) )
+				{
+					uxToCopy = ( UBaseType_t ) ( xItemCount - xItemsSent );
+				}
+
+				xYieldRequired = pdFALSE;
+
+				for( uxCopied = 0; uxCopied < uxToCopy; uxCopied++ )
+				{
+					traceQUEUE_SEND( pxQueue );
+					( void ) prvCopyDataToQueue( pxQueue, pucNextItem, queueSEND_TO_BACK );
+					pucNextItem += pxQueue->uxItemSize;
+
+					#if ( configUSE_QUEUE_SETS == 1 )
+					{
+						/* Each item posted to a queue that is a member of a
+						set is also posted to the set. */
+						if( pxQueue->pxQueueSetContainer != NULL )
+						{
+							if( prvNotifyQueueSetContainer( pxQueue, queueSEND_TO_BACK ) != pdFALSE )
+							{
+								xYieldRequired = pdTRUE;
+							}
+						}
+						else if( listLIST_IS_EMPTY( &( pxQueue->xTasksWaitingToReceive ) ) == pdFALSE )
+						{
+							if( xTaskRemoveFromEventList( &( pxQueue->xTasksWaitingToReceive ) ) != pdFALSE )
+							{
+								xYieldRequired = pdTRUE;
+							}
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
+					}
+					#else /* configUSE_QUEUE_SETS */
+					{
+						/* Unblock one waiting receiver per item posted. */
+						if( listLIST_IS_EMPTY( &( pxQueue->xTasksWaitingToReceive ) ) == pdFALSE )
+						{
+							if( xTaskRemoveFromEventList( &( pxQueue->xTasksWaitingToReceive ) ) != pdFALSE )
+							{
+								xYieldRequired = pdTRUE;
+							}
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
+					}
+					#endif /* configUSE_QUEUE_SETS */
+				}
+
+				xItemsSent += ( size_t ) uxToCopy;
+
+				/* Yield at most once for the whole batch.  Yes it is ok to do
+				this from within the critical section - the kernel takes care
+				of that. */
+				if( xYieldRequired != pdFALSE )
+				{
+					queueYIELD_IF_USING_PREEMPTION();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				if( xItemsSent >= xItemCount )
+				{
+					taskEXIT_CRITICAL();
+					break;
+				}
+			}
+
+			if( xTicksToWait == ( TickType_t ) 0 )
+			{
+				/* The queue is full and no block time is specified (or the
+				block time has expired) so leave now. */
+				taskEXIT_CRITICAL();
+				traceQUEUE_SEND_FAILED( pxQueue );
+				break;
+			}
+			else if( xEntryTimeSet == pdFALSE )
+			{
+				/* The queue is full and a block time was specified so
+				configure the timeout structure. */
+				vTaskInternalSetTimeOutState( &xTimeOut );
+				xEntryTimeSet = pdTRUE;
+			}
+			else
+			{
+				/* Entry time was already set. */
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		/* Interrupts and other tasks can send to and receive from the queue
+		now the critical section has been exited. */
+
+		vTaskSuspendAll();
+		prvLockQueue( pxQueue );
+
+		/* Update the timeout state to see if it has expired yet. */
+		if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE )
+		{
+			if( prvIsQueueFull( pxQueue ) != pdFALSE )
+			{
+				traceBLOCKING_ON_QUEUE_SEND( pxQueue );
+				vTaskPlaceOnEventList( &( pxQueue->xTasksWaitingToSend ), xTicksToWait );
+				prvUnlockQueue( pxQueue );
+
+				if( xTaskResumeAll() == pdFALSE )
+				{
+					portYIELD_WITHIN_API();
+				}
+			}
+			else
+			{
+				/* Try again. */
+				prvUnlockQueue( pxQueue );
+				( void ) xTaskResumeAll();
+			}
+		}
+		else
+		{
+			/* The timeout has expired.  Loop back once more with no block
+			time to post whatever now fits. */
+			prvUnlockQueue( pxQueue );
+			( void ) xTaskResumeAll();
+			xTicksToWait = ( TickType_t ) 0;
+		}
+	}
+
+	return xItemsSent;
+}
+/*-----------------------------------------------------------*/
+
 BaseType_t xQueueGenericSendFromISR( QueueHandle_t xQueue, const void * const pvItemToQueue, BaseType_t * const pxHigherPriorityTaskWoken, const BaseType_t xCopyPosition )
 {
 BaseType_t xReturn;
@@ -1130,7 +1352,14 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 			can be assumed there is no mutex holder and no need to determine if
 			priority disinheritance is needed.  Simply increase the count of
 			messages (semaphores) available. */
+			#if ( configUSE_MUTEX_PROFILER == 1 )
+			{
+				prvProfileGive( pxQueue );
+			}
+			#endif /* configUSE_MUTEX_PROFILER */
+
 			pxQueue->uxMessagesWaiting = uxMessagesWaiting + ( UBaseType_t ) 1;
+			prvUpdateHighWaterMark( pxQueue );
 
 			/* The event list is not altered if the queue is locked.  This will
 			be done when the queue is unlocked later. */
@@ -1379,6 +1608,169 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 }
 /*-----------------------------------------------------------*/
 
+size_t xQueueReceiveMultiple( QueueHandle_t xQueue, void * const pvBuffer, const size_t xMaxItems, TickType_t xTicksToWait )
+{
+BaseType_t xEntryTimeSet = pdFALSE, xYieldRequired;
+TimeOut_t xTimeOut;
+Queue_t * const pxQueue = ( Queue_t * ) xQueue;
+uint8_t *pucNextItem = ( uint8_t * ) pvBuffer;
+UBaseType_t uxToCopy, uxCopied;
+
+	configASSERT( pxQueue );
+	configASSERT( pxQueue->uxItemSize != ( UBaseType_t ) 0U );
+	configASSERT( !( ( pvBuffer == NULL ) && ( xMaxItems != ( size_t ) 0 ) ) );
+	#if ( ( INCLUDE_xTaskGetSchedulerState == 1 ) || ( configUSE_TIMERS == 1 ) )
+	{
+		configASSERT( !( ( xTaskGetSchedulerState() == taskSCHEDULER_SUSPENDED ) && ( xTicksToWait != 0 ) ) );
+	}
+	#endif
+
+	if( xMaxItems == ( size_t ) 0 )
+	{
+		return 0;
+	}
+
+	/* This function relaxes the coding standard somewhat to allow return
+	statements within the function itself.  This is done in the interest
+	of execution time efficiency. */
+
+	for( ;; )
+	{
+		taskENTER_CRITICAL();
+		{
+			const UBaseType_t uxMessagesWaiting = pxQueue->uxMessagesWaiting;
+
+			if( uxMessagesWaiting > ( UBaseType_t ) 0 )
+			{
+				/* Data available, remove as many items as are wanted. */
+				uxToCopy = uxMessagesWaiting;
+				if( ( size_t ) uxToCopy > xMaxItems )
+				{
+					uxToCopy = ( UBaseType_t ) xMaxItems;
+				}
+
+				xYieldRequired = pdFALSE;
+
+				for( uxCopied = 0; uxCopied < uxToCopy; uxCopied++ )
+				{
+					prvCopyDataFromQueue( pxQueue, pucNextItem );
+					traceQUEUE_RECEIVE( pxQueue );
+					pucNextItem += pxQueue->uxItemSize;
+
+					/* There is now space in the queue, unblock one task
+					waiting to post to the queue per item removed. */
+					if( listLIST_IS_EMPTY( &( pxQueue->xTasksWaitingToSend ) ) == pdFALSE )
+					{
+						if( xTaskRemoveFromEventList( &( pxQueue->xTasksWaitingToSend ) ) != pdFALSE )
+						{
+							xYieldRequired = pdTRUE;
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+
+				pxQueue->uxMessagesWaiting = uxMessagesWaiting - uxToCopy;
+
+				/* Yield at most once for the whole batch. */
+				if( xYieldRequired != pdFALSE )
+				{
+					queueYIELD_IF_USING_PREEMPTION();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				taskEXIT_CRITICAL();
+				return ( size_t ) uxToCopy;
+			}
+			else
+			{
+				if( xTicksToWait == ( TickType_t ) 0 )
+				{
+					/* The queue was empty and no block time is specified (or
+					the block time has expired) so leave now. */
+					taskEXIT_CRITICAL();
+					traceQUEUE_RECEIVE_FAILED( pxQueue );
+					return 0;
+				}
+				else if( xEntryTimeSet == pdFALSE )
+				{
+					/* The queue was empty and a block time was specified so
+					configure the timeout structure. */
+					vTaskInternalSetTimeOutState( &xTimeOut );
+					xEntryTimeSet = pdTRUE;
+				}
+				else
+				{
+					/* Entry time was already set. */
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		/* Interrupts and other tasks can send to and receive from the queue
+		now the critical section has been exited. */
+
+		vTaskSuspendAll();
+		prvLockQueue( pxQueue );
+
+		/* Update the timeout state to see if it has expired yet. */
+		if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE )
+		{
+			/* The timeout has not expired.  If the queue is still empty place
+			the task on the list of tasks waiting to receive from the queue. */
+			if( prvIsQueueEmpty( pxQueue ) != pdFALSE )
+			{
+				traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue );
+				vTaskPlaceOnEventList( &( pxQueue->xTasksWaitingToReceive ), xTicksToWait );
+				prvUnlockQueue( pxQueue );
+				if( xTaskResumeAll() == pdFALSE )
+				{
+					portYIELD_WITHIN_API();
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				/* The queue contains data again.  Loop back to try and read the
+				data. */
+				prvUnlockQueue( pxQueue );
+				( void ) xTaskResumeAll();
+			}
+		}
+		else
+		{
+			/* Timed out.  If there is no data in the queue exit, otherwise loop
+			back and attempt to read the data. */
+			prvUnlockQueue( pxQueue );
+			( void ) xTaskResumeAll();
+
+			if( prvIsQueueEmpty( pxQueue ) != pdFALSE )
+			{
+				traceQUEUE_RECEIVE_FAILED( pxQueue );
+				return 0;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
 BaseType_t xQueueSemaphoreTake( QueueHandle_t xQueue, TickType_t xTicksToWait )
 {
 BaseType_t xEntryTimeSet = pdFALSE;
@@ -1389,6 +1781,11 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 	BaseType_t xInheritanceOccurred = pdFALSE;
 #endif
 
+#if ( configUSE_MUTEX_PROFILER == 1 )
+	BaseType_t xContended = pdFALSE;
+	uint32_t ulWaitStartTime = 0UL;
+#endif
+
 	/* Check the queue pointer is not NULL. */
 	configASSERT( ( pxQueue ) );
 
@@ -1441,6 +1838,12 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 				}
 				#endif /* configUSE_MUTEXES */
 
+				#if ( configUSE_MUTEX_PROFILER == 1 )
+				{
+					prvProfileTakeComplete( pxQueue, pdTRUE, xContended, ulWaitStartTime );
+				}
+				#endif /* configUSE_MUTEX_PROFILER */
+
 				/* Check to see if other tasks are blocked waiting to give the
 				semaphore, and if so, unblock the highest priority such task. */
 				if( listLIST_IS_EMPTY( &( pxQueue->xTasksWaitingToSend ) ) == pdFALSE )
@@ -1464,6 +1867,18 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 			}
 			else
 			{
+				#if ( configUSE_MUTEX_PROFILER == 1 )
+				{
+					/* Time the wait from the first time the semaphore was
+					found to be unavailable. */
+					if( xContended == pdFALSE )
+					{
+						xContended = pdTRUE;
+						ulWaitStartTime = configMUTEX_PROFILER_GET_TIME();
+					}
+				}
+				#endif /* configUSE_MUTEX_PROFILER */
+
 				if( xTicksToWait == ( TickType_t ) 0 )
 				{
 					/* For inheritance to have occurred there must have been an
@@ -1475,6 +1890,12 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 					}
 					#endif /* configUSE_MUTEXES */
 
+					#if ( configUSE_MUTEX_PROFILER == 1 )
+					{
+						prvProfileTakeComplete( pxQueue, pdFALSE, xContended, ulWaitStartTime );
+					}
+					#endif /* configUSE_MUTEX_PROFILER */
+
 					/* The semaphore count was 0 and no block time is specified
 					(or the block time has expired) so exit now. */
 					taskEXIT_CRITICAL();
@@ -1521,6 +1942,15 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 						taskENTER_CRITICAL();
 						{
 							xInheritanceOccurred = xTaskPriorityInherit( ( void * ) pxQueue->pxMutexHolder );
+
+							#if ( configUSE_MUTEX_PROFILER == 1 )
+							{
+								if( xInheritanceOccurred != pdFALSE )
+								{
+									pxQueue->xProfile.ulInheritances++;
+								}
+							}
+							#endif /* configUSE_MUTEX_PROFILER */
 						}
 						taskEXIT_CRITICAL();
 					}
@@ -1586,6 +2016,16 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 				}
 				#endif /* configUSE_MUTEXES */
 
+				#if ( configUSE_MUTEX_PROFILER == 1 )
+				{
+					taskENTER_CRITICAL();
+					{
+						prvProfileTakeComplete( pxQueue, pdFALSE, xContended, ulWaitStartTime );
+					}
+					taskEXIT_CRITICAL();
+				}
+				#endif /* configUSE_MUTEX_PROFILER */
+
 				traceQUEUE_RECEIVE_FAILED( pxQueue );
 				return errQUEUE_EMPTY;
 			}
@@ -1939,6 +2379,23 @@ UBaseType_t uxReturn;
 } /*lint !e818 Pointer cannot be declared const as xQueue is a typedef not pointer. */
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_QUEUE_HIGH_WATER_MARK == 1 )
+
+	UBaseType_t uxQueueGetHighWaterMark( const QueueHandle_t xQueue )
+	{
+	UBaseType_t uxReturn;
+
+		configASSERT( xQueue );
+
+		/* A single word read, so no critical section is needed. */
+		uxReturn = ( ( Queue_t * ) xQueue )->uxHighWaterMark;
+
+		return uxReturn;
+	} /*lint !e818 Pointer cannot be declared const as xQueue is a typedef not pointer. */
+
+#endif /* configUSE_QUEUE_HIGH_WATER_MARK */
+/*-----------------------------------------------------------*/
+
 void vQueueDelete( QueueHandle_t xQueue )
 {
 Queue_t * const pxQueue = ( Queue_t * ) xQueue;
@@ -2049,6 +2506,12 @@ UBaseType_t uxMessagesWaiting;
 
 	if( pxQueue->uxItemSize == ( UBaseType_t ) 0 )
 	{
+		#if ( configUSE_MUTEX_PROFILER == 1 )
+		{
+			prvProfileGive( pxQueue );
+		}
+		#endif /* configUSE_MUTEX_PROFILER */
+
 		#if ( configUSE_MUTEXES == 1 )
 		{
 			if( pxQueue->uxQueueType == queueQUEUE_IS_MUTEX )
@@ -2112,6 +2575,7 @@ UBaseType_t uxMessagesWaiting;
 	}
 
 	pxQueue->uxMessagesWaiting = uxMessagesWaiting + ( UBaseType_t ) 1;
+	prvUpdateHighWaterMark( pxQueue );
 
 	return xReturn;
 }
@@ -2623,8 +3087,6 @@ BaseType_t xReturn;
 				/* Store the information on this queue. */
 				xQueueRegistry[ ux ].pcQueueName = pcQueueName;
 				xQueueRegistry[ ux ].xHandle = xQueue;
-
-				traceQUEUE_REGISTRY_ADD( xQueue, pcQueueName );
 				break;
 			}
 			else
@@ -2632,6 +3094,10 @@ BaseType_t xReturn;
 				mtCOVERAGE_TEST_MARKER();
 			}
 		}
+
+		/* Traced even when this registry is full, so a trace recorder with its
+		own table can still name the queue. */
+		traceQUEUE_REGISTRY_ADD( xQueue, pcQueueName );
 	}
 
 #endif /* configQUEUE_REGISTRY_SIZE */
@@ -2697,6 +3163,171 @@ BaseType_t xReturn;
 #endif /* configQUEUE_REGISTRY_SIZE */
 /*-----------------------------------------------------------*/
 
+#if ( configQUEUE_REGISTRY_SIZE > 0 )
+
+	QueueHandle_t xQueueGetRegistryEntry( UBaseType_t uxIndex, const char **ppcQueueName ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+	{
+	QueueHandle_t xReturn = NULL;
+
+		if( uxIndex < ( UBaseType_t ) configQUEUE_REGISTRY_SIZE )
+		{
+			taskENTER_CRITICAL();
+			{
+				if( xQueueRegistry[ uxIndex ].pcQueueName != NULL )
+				{
+					xReturn = xQueueRegistry[ uxIndex ].xHandle;
+
+					if( ppcQueueName != NULL )
+					{
+						*ppcQueueName = xQueueRegistry[ uxIndex ].pcQueueName;
+					}
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			taskEXIT_CRITICAL();
+		}
+
+		return xReturn;
+	}
+
+#endif /* configQUEUE_REGISTRY_SIZE */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_MUTEX_PROFILER == 1 )
+
+	BaseType_t xQueueGetMutexProfile( QueueHandle_t xQueue, MutexProfile_t * const pxProfile )
+	{
+	Queue_t * const pxQueue = ( Queue_t * ) xQueue;
+	BaseType_t xReturn = pdFAIL;
+
+		configASSERT( pxQueue );
+		configASSERT( pxProfile );
+
+		/* Only mutexes and semaphores are profiled. */
+		if( pxQueue->uxItemSize == ( UBaseType_t ) 0 )
+		{
+			taskENTER_CRITICAL();
+			{
+				*pxProfile = pxQueue->xProfile;
+			}
+			taskEXIT_CRITICAL();
+
+			xReturn = pdPASS;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		return xReturn;
+	}
+
+#endif /* configUSE_MUTEX_PROFILER */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_MUTEX_PROFILER == 1 )
+
+	void vQueueResetMutexProfile( QueueHandle_t xQueue )
+	{
+	Queue_t * const pxQueue = ( Queue_t * ) xQueue;
+
+		configASSERT( pxQueue );
+
+		taskENTER_CRITICAL();
+		{
+			( void ) memset( ( void * ) &( pxQueue->xProfile ), 0x00, sizeof( pxQueue->xProfile ) );
+		}
+		taskEXIT_CRITICAL();
+	}
+
+#endif /* configUSE_MUTEX_PROFILER */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_MUTEX_PROFILER == 1 )
+
+	static void prvProfileTakeComplete( Queue_t * const pxQueue, const BaseType_t xTaken, const BaseType_t xContended, const uint32_t ulWaitStartTime )
+	{
+	MutexProfile_t * const pxProfile = &( pxQueue->xProfile );
+	const uint32_t ulNow = configMUTEX_PROFILER_GET_TIME();
+	uint32_t ulWaitTime;
+
+		if( xContended != pdFALSE )
+		{
+			/* The semaphore was not available when first tried, so the caller
+			waited (or would have had to wait). */
+			ulWaitTime = ulNow - ulWaitStartTime;
+			pxProfile->ulContendedTakes++;
+			pxProfile->ullTotalWaitTime += ulWaitTime;
+
+			if( ulWaitTime > pxProfile->ulMaxWaitTime )
+			{
+				pxProfile->ulMaxWaitTime = ulWaitTime;
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		if( xTaken != pdFALSE )
+		{
+			pxProfile->ulTakes++;
+
+			/* Hold times are only meaningful where a single holder owns the
+			semaphore, so counting semaphores are not timed. */
+			if( pxQueue->uxLength == ( UBaseType_t ) 1 )
+			{
+				pxQueue->ulTakeTime = ulNow;
+				pxQueue->xIsHeld = pdTRUE;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			pxProfile->ulTimeouts++;
+		}
+	}
+
+#endif /* configUSE_MUTEX_PROFILER */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_MUTEX_PROFILER == 1 )
+
+	static void prvProfileGive( Queue_t * const pxQueue )
+	{
+	MutexProfile_t * const pxProfile = &( pxQueue->xProfile );
+	uint32_t ulHoldTime;
+
+		/* Gives that do not follow a profiled take, such as the give that
+		initialises a binary semaphore, are not timed. */
+		if( pxQueue->xIsHeld != pdFALSE )
+		{
+			ulHoldTime = configMUTEX_PROFILER_GET_TIME() - pxQueue->ulTakeTime;
+			pxQueue->xIsHeld = pdFALSE;
+
+			pxProfile->ulHolds++;
+			pxProfile->ullTotalHoldTime += ulHoldTime;
+
+			if( ulHoldTime > pxProfile->ulMaxHoldTime )
+			{
+				pxProfile->ulMaxHoldTime = ulHoldTime;
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+#endif /* configUSE_MUTEX_PROFILER */
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_TIMERS == 1 )
 
 	void vQueueWaitForMessageRestricted( QueueHandle_t xQueue, TickType_t xTicksToWait, const BaseType_t xWaitIndefinitely )
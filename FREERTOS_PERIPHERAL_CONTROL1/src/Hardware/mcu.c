@@ -7,11 +7,25 @@
  */
 
 
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Baud rate of the programming port UART the log is sent to
+#define LOG_UART_BAUD_RATE (115200u)
+
+// Stack size of the task that sends the log to the UART
+#define LOG_DRAIN_STACK_DEPTH ( configMINIMAL_STACK_SIZE * 2 )
+
+// Number of reset types RSTC_SR can report
+#define RESET_TYPE_COUNT (8u)
+
+
 /*------------------------------------------------------------
                           Includes
 -------------------------------------------------------------*/
 // standard includes
 #include "stdbool.h"
+#include "stdio.h"
 
 /* Kernel includes. */
 #include "FreeRTOS.h"
@@ -25,6 +39,42 @@
 
 /* ASF includes. */
 #include "sysclk.h"
+#include "freertos_dmac_memcpy.h"
+
+// system includes
+#include "binary_log.h"
+#include "critical_profiler.h"
+#include "latency_monitor.h"
+#include "log_ring.h"
+#include "tickless_idle.h"
+
+
+#if ( configUSE_BINARY_LOG == 1 )
+/*------------------------------------------------------------
+                      Local Variables
+-------------------------------------------------------------*/
+// Names of the RSTC_SR reset types.  String constants, so the binary log can
+// keep pointers to them.
+static const char *const resetTypeNames[ RESET_TYPE_COUNT ] =
+{
+    "power-up",
+    "backup mode wake-up",
+    "watchdog",
+    "software",
+    "NRST pin",
+    "unknown",
+    "unknown",
+    "unknown"
+};
+#endif
+
+
+#if ( configUSE_LOG_RING == 1 ) && !( defined confINCLUDE_UART_CLI )
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static void prvStartLogDrain( void );
+#endif
 
 
 /*------------------------------------------------------------
@@ -45,4 +95,87 @@ void MCU_Init( void )
 
     // Perform any initialization required by the partest LED IO functions.
     vParTestInitialise();
-}
\ No newline at end of file
+
+#if ( configUSE_TICKLESS_IDLE == 2 )
+    // Start the Real-Time Timer used to keep time while the tick is suppressed.
+    TLI_Init();
+#endif
+
+#if ( configUSE_WAKE_LATENCY_TRACE == 1 )
+    // Start the cycle counter used to time interrupt-to-task wake-ups.
+    LAT_Init();
+#endif
+
+#if ( configUSE_CRITICAL_SECTION_PROFILER == 1 )
+    // Start the cycle counter used to time critical sections.
+    CSP_Init();
+#endif
+
+#if ( configUSE_MUTEX_PROFILER == 1 )
+    // Start the cycle counter used to time mutex and semaphore waits.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+#if ( configUSE_DMAC_MEMCPY == 1 )
+    // Prepare the DMAC channels used for large memory copies.
+    freertos_dmac_memcpy_init( configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY );
+#endif
+
+#if ( configUSE_LOG_RING == 1 )
+    // Empty the log ring so anything can log from here on.
+    LOG_Init();
+#endif
+
+#if ( configUSE_LOG_RING == 1 ) && !( defined confINCLUDE_UART_CLI )
+    // Without the UART command console nothing else uses the programming port,
+    // so send the log there.  The console starts the drain itself.
+    prvStartLogDrain();
+#endif
+
+#if ( configUSE_LOG_RING == 1 )
+    // printf() writes to the log, which is sent once the drain task runs.
+    printf( "\r\nFreeRTOS peripheral control, built " __DATE__ " " __TIME__ "\r\n" );
+#endif
+
+#if ( configUSE_BINARY_LOG == 1 )
+    // Start the task that formats binary log records into the log ring; it
+    // needs room for snprintf().
+    ( void ) BLOG_Init( configMINIMAL_STACK_SIZE * 3, tskIDLE_PRIORITY );
+
+    // Record why the processor was reset; formatted once the task runs.
+    ( void ) BLOG_1( BLOG_ID_RESET_CAUSE,
+                     BLOG_STRING( resetTypeNames[ ( RSTC->RSTC_SR & RSTC_SR_RSTTYP_Msk ) >> RSTC_SR_RSTTYP_Pos ] ) );
+#endif
+}
+
+
+#if ( configUSE_LOG_RING == 1 ) && !( defined confINCLUDE_UART_CLI )
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static void prvStartLogDrain( void )
+{
+    // Transmit only, and the drain task is the only writer.
+    const freertos_peripheral_options_t driverOptions =
+    {
+        NULL,
+        0u,
+        configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY,
+        UART_RS232,
+        USE_TX_ACCESS_SEM
+    };
+    sam_uart_opt_t uartSettings;
+    freertos_uart_if uart;
+
+    uartSettings.ul_mck = sysclk_get_peripheral_hz();
+    uartSettings.ul_baudrate = LOG_UART_BAUD_RATE;
+    uartSettings.ul_mode = UART_MR_PAR_NO;
+
+    uart = freertos_uart_serial_init( UART, &uartSettings, &driverOptions );
+
+    ( void ) LOG_StartDrain( uart, LOG_DRAIN_STACK_DEPTH, tskIDLE_PRIORITY );
+}
+#endif
@@ -0,0 +1,215 @@
+/*
+ * @file binary_log.c
+ *
+ * @brief Deferred-formatting binary log
+ *
+ * BLOG_Log() copies a fixed size record into the lock-free ring and nothing
+ * else.  The formatting task is the ring's only consumer: it formats the record
+ * with the snprintf() call log_formats.h gives for its ID, and appends the text
+ * to the non-blocking log.  As with the text log, the task polls, because a
+ * producer running above configMAX_SYSCALL_INTERRUPT_PRIORITY cannot signal it.
+ */
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+#define BLOG_TASK_NAME "BLog"
+
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+#include "stdio.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+// system includes
+#include "lockfree_ring.h"
+#include "log_ring.h"
+
+// this file's header
+#include "binary_log.h"
+
+
+#if ( configUSE_BINARY_LOG == 1 )
+
+#if ( configUSE_LOG_RING != 1 )
+    #error "The binary log is formatted into the text log, so needs configUSE_LOG_RING set to 1"
+#endif
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+// One ring slot
+typedef struct
+{
+    uint32_t id;
+    BLOG_Arg_t args[ BLOG_MAX_ARGS ];
+} BLOG_Record_t;
+
+
+/*------------------------------------------------------------
+                      Local Variables
+-------------------------------------------------------------*/
+static LFR_Ring_t ring;
+static uint32_t ringSequence[ BLOG_RING_SLOTS ];
+static uint8_t ringStorage[ LFR_STORAGE_SIZE( BLOG_RING_SLOTS, sizeof( BLOG_Record_t ) ) ];
+
+// Written by producers in any context, so only changed with LFR_AtomicAdd().
+static volatile uint32_t recordsLogged = 0u;
+static volatile uint32_t recordsDropped = 0u;
+
+// Only written by the formatting task.
+static uint32_t recordsFormatted = 0u;
+static uint32_t ringHighWater = 0u;
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static void prvFormatTask( void *ptrParameters );
+static void prvFormatRecord( const BLOG_Record_t *ptrRecord, char *ptrMessage, const size_t size );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+bool BLOG_Init( const uint16_t stackDepth, const UBaseType_t priority )
+{
+    bool isValid = LFR_Init( &ring,
+                             ringSequence,
+                             ringStorage,
+                             BLOG_RING_SLOTS,
+                             sizeof( BLOG_Record_t ) );
+
+    if( isValid )
+    {
+        isValid = ( xTaskCreate( prvFormatTask,
+                                 BLOG_TASK_NAME,
+                                 stackDepth,
+                                 NULL,
+                                 priority,
+                                 NULL ) == pdPASS );
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool BLOG_Log( const BLOG_FormatId_t id,
+               const BLOG_Arg_t arg0,
+               const BLOG_Arg_t arg1,
+               const BLOG_Arg_t arg2,
+               const BLOG_Arg_t arg3 )
+{
+    BLOG_Record_t record;
+    bool isAdded;
+
+    record.id = ( uint32_t )id;
+    record.args[ 0 ] = arg0;
+    record.args[ 1 ] = arg1;
+    record.args[ 2 ] = arg2;
+    record.args[ 3 ] = arg3;
+
+    isAdded = LFR_Push( &ring, &record );
+
+    LFR_AtomicAdd( isAdded ? &recordsLogged : &recordsDropped, 1u );
+
+    return isAdded;
+}
+
+
+/*-----------------------------------------------------------*/
+bool BLOG_GetStats( BLOG_Stats_t *ptrStats )
+{
+    bool isValid = ( ptrStats != NULL );
+
+    if( isValid )
+    {
+        ptrStats->recordsLogged = recordsLogged;
+        ptrStats->recordsDropped = recordsDropped;
+        ptrStats->recordsFormatted = recordsFormatted;
+        ptrStats->ringHighWater = ringHighWater;
+    }
+
+    return isValid;
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static void prvFormatTask( void *ptrParameters )
+{
+    static char message[ BLOG_MAX_MESSAGE_SIZE ];
+    BLOG_Record_t record;
+    uint32_t count;
+
+    ( void ) ptrParameters;
+
+    for( ;; )
+    {
+        count = LFR_GetCount( &ring );
+        if( count > ringHighWater )
+        {
+            ringHighWater = count;
+        }
+
+        while( LFR_Pop( &ring, &record ) )
+        {
+            prvFormatRecord( &record, message, sizeof( message ) );
+
+            // a full text log counts the drop itself
+            ( void ) LOG_Print( message );
+            recordsFormatted++;
+        }
+
+        vTaskDelay( BLOG_FORMAT_PERIOD_TICKS );
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvFormatRecord( const BLOG_Record_t *ptrRecord, char *ptrMessage, const size_t size )
+{
+    // Each entry of log_formats.h becomes a case with its own snprintf() call,
+    // so the format strings are literals the compiler checks.
+    #define BLOG_UL( n )    ( ( unsigned long )ptrRecord->args[ n ].value )
+    #define BLOG_L( n )     ( ( long )ptrRecord->args[ n ].value )
+    #define BLOG_STR( n )   ( ptrRecord->args[ n ].ptrString )
+    #define BLOG_FORMAT_CASE( id, ... ) \
+        case id:                        \
+            ( void ) snprintf( ptrMessage, size, __VA_ARGS__ ); \
+            break;
+
+    switch( ptrRecord->id )
+    {
+        BLOG_FORMATS( BLOG_FORMAT_CASE )
+
+        default:
+            ( void ) snprintf( ptrMessage,
+                               size,
+                               "[blog: unknown format %lu]\r\n",
+                               ( unsigned long )ptrRecord->id );
+            break;
+    }
+
+    #undef BLOG_UL
+    #undef BLOG_L
+    #undef BLOG_STR
+    #undef BLOG_FORMAT_CASE
+}
+
+#endif /* configUSE_BINARY_LOG */
@@ -0,0 +1,137 @@
+/*
+ * @file binary_log.h
+ *
+ * @brief Header file for the deferred-formatting binary log
+ *
+ * A log call stores only a format ID (see log_formats.h) and its arguments as
+ * raw 32-bit values, in a lock-free ring (see lockfree_ring.h), so it costs a
+ * few dozen cycles instead of the hundreds taken by sprintf().  Like the ring,
+ * it never blocks or masks interrupts, and can be called from any task or
+ * interrupt.  If the ring is full the record is dropped and counted.
+ *
+ * A low priority task formats the records later, and appends the text to the
+ * non-blocking log (see log_ring.h), which sends it to the UART.
+ */
+#ifndef BINARY_LOG_H_
+#define BINARY_LOG_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before binary_log.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before binary_log.h"
+#endif
+
+#ifndef INC_FREERTOS_H
+    #error "Must include FreeRTOS.h before binary_log.h"
+#endif
+
+#include "log_formats.h"
+
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Most arguments stored with one record
+#define BLOG_MAX_ARGS (4u)
+
+// Number of records the ring holds, a power of two
+#define BLOG_RING_SLOTS (32u)
+
+// Longest formatted message, including the null terminator
+#define BLOG_MAX_MESSAGE_SIZE (128u)
+
+// How often the formatting task looks for new records while the ring is empty
+#define BLOG_FORMAT_PERIOD_TICKS ( 20u / portTICK_RATE_MS )
+
+// Make a record argument from an integer, or from a string constant
+#define BLOG_VALUE( x )                 ( ( BLOG_Arg_t ){ .value = ( uint32_t )( x ) } )
+#define BLOG_STRING( s )                ( ( BLOG_Arg_t ){ .ptrString = ( s ) } )
+
+// Log a record with 0 to BLOG_MAX_ARGS arguments, each made with BLOG_VALUE()
+// or BLOG_STRING()
+#define BLOG_0( id )                    BLOG_Log( ( id ), BLOG_VALUE( 0u ), BLOG_VALUE( 0u ), BLOG_VALUE( 0u ), BLOG_VALUE( 0u ) )
+#define BLOG_1( id, a )                 BLOG_Log( ( id ), ( a ), BLOG_VALUE( 0u ), BLOG_VALUE( 0u ), BLOG_VALUE( 0u ) )
+#define BLOG_2( id, a, b )              BLOG_Log( ( id ), ( a ), ( b ), BLOG_VALUE( 0u ), BLOG_VALUE( 0u ) )
+#define BLOG_3( id, a, b, c )           BLOG_Log( ( id ), ( a ), ( b ), ( c ), BLOG_VALUE( 0u ) )
+#define BLOG_4( id, a, b, c, d )        BLOG_Log( ( id ), ( a ), ( b ), ( c ), ( d ) )
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+#define BLOG_ENUM_ENTRY( id, ... ) id,
+
+// Format IDs, numbered in the order of log_formats.h
+typedef enum
+{
+    BLOG_FORMATS( BLOG_ENUM_ENTRY )
+    BLOG_NUM_FORMATS
+} BLOG_FormatId_t;
+
+// One record argument, 32 bits either way
+typedef union
+{
+    uint32_t value;
+    const char *ptrString;          // a string constant, for %s
+} BLOG_Arg_t;
+
+typedef struct
+{
+    uint32_t recordsLogged;         // records added to the ring
+    uint32_t recordsDropped;        // records not added because the ring was full
+    uint32_t recordsFormatted;      // records formatted and passed to the text log
+    uint32_t ringHighWater;         // most records found in the ring by the formatting task
+} BLOG_Stats_t;
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function BLOG_Init
+ *
+ * @brief Initialize the empty record ring and create the formatting task.  May
+ *        be called before the scheduler is started, and must be called before
+ *        anything is logged.
+ *
+ * @param stackDepth - stack size of the formatting task, in words
+ * @param priority - priority of the formatting task, normally tskIDLE_PRIORITY
+ *
+ * @return bool - true if the formatting task was created, false otherwise
+ */
+bool BLOG_Init( const uint16_t stackDepth, const UBaseType_t priority );
+
+/**
+ * @function BLOG_Log
+ *
+ * @brief Add a record to the log without formatting it.  Normally called
+ *        through BLOG_0() to BLOG_4().  Safe to call from any task or
+ *        interrupt, including interrupts above
+ *        configMAX_SYSCALL_INTERRUPT_PRIORITY.
+ *
+ * @param id - the format ID, from log_formats.h
+ * @param arg0 - arg3 - the arguments of the format string
+ *
+ * @return bool - true if the record was added, false if it was dropped
+ */
+bool BLOG_Log( const BLOG_FormatId_t id,
+               const BLOG_Arg_t arg0,
+               const BLOG_Arg_t arg1,
+               const BLOG_Arg_t arg2,
+               const BLOG_Arg_t arg3 );
+
+/**
+ * @function BLOG_GetStats
+ *
+ * @brief Get a snapshot of the binary log statistics
+ *
+ * @param ptrStats - filled in with the statistics
+ *
+ * @return bool - true if ptrStats was valid, false otherwise
+ */
+bool BLOG_GetStats( BLOG_Stats_t *ptrStats );
+
+#endif /* BINARY_LOG_H_ */
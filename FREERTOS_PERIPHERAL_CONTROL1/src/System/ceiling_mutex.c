@@ -0,0 +1,427 @@
+/*
+ * @file ceiling_mutex.c
+ *
+ * @brief Immediate priority ceiling mutex and blocking analysis
+ *
+ * The underlying binary semaphore is only ever contended if a holder blocks
+ * (for example on a driver transfer) while it holds the mutex; otherwise the
+ * ceiling priority alone keeps the other users from running.  A binary
+ * semaphore rather than a FreeRTOS mutex is used so that priority inheritance
+ * never interferes with the ceiling.
+ */
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+#include "string.h"
+
+// hardware includes
+#include "compiler.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+// this file's header
+#include "ceiling_mutex.h"
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef struct
+{
+    const PCM_Mutex_t *ptrMutex;    // NULL when the record is unused
+    TaskHandle_t task;
+    UBaseType_t taskPriority;       // priority of the task when it took the mutex
+    uint32_t maxHoldCycles;
+} PCM_HoldRecord_t;
+
+typedef struct
+{
+    TaskHandle_t task;              // NULL when the entry is unused
+    UBaseType_t basePriority;       // base priority before the outermost take
+    uint32_t depth;                 // ceiling mutexes the task holds
+} PCM_Holding_t;
+
+
+/*------------------------------------------------------------
+                      Local Variables
+-------------------------------------------------------------*/
+// written from task context inside critical sections
+static PCM_HoldRecord_t holdRecords[ PCM_MAX_HOLD_RECORDS ];
+static uint32_t droppedHoldCount = 0u;
+
+// one entry per task holding a ceiling mutex, claimed inside critical sections
+static PCM_Holding_t holdingTasks[ PCM_MAX_HOLDING_TASKS ];
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static void prvRecordHold( const PCM_Mutex_t *ptrMutex,
+                           const TaskHandle_t task,
+                           const UBaseType_t taskPriority,
+                           const uint32_t holdCycles );
+static PCM_Holding_t *prvEnterHolding( const TaskHandle_t task, const UBaseType_t basePriority );
+static void prvLeaveHolding( const TaskHandle_t task );
+static UBaseType_t prvGetBasePriority( const TaskHandle_t task, const UBaseType_t basePriority );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+bool PCM_Create( PCM_Mutex_t *ptrMutex,
+                 const char *ptrName,
+                 const UBaseType_t ceiling )
+{
+    bool isValid = ( ptrMutex != NULL ) && ( ceiling < configMAX_PRIORITIES );
+
+    if( isValid )
+    {
+        memset( ptrMutex, 0, sizeof( *ptrMutex ) );
+        ptrMutex->ptrName = ptrName;
+        ptrMutex->ceiling = ceiling;
+
+        // binary semaphores are created empty
+        ptrMutex->handle = xSemaphoreCreateBinary();
+        isValid = ( ptrMutex->handle != NULL );
+
+        if( isValid )
+        {
+            ( void ) xSemaphoreGive( ptrMutex->handle );
+
+            // hold times are measured with the DWT cycle counter
+            CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+            DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        }
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool PCM_Take( PCM_Mutex_t *ptrMutex, const TickType_t timeoutTicks )
+{
+    TaskStatus_t status;
+    PCM_Holding_t *ptrHolding;
+    bool isRaised = false;
+    bool isTaken;
+
+    configASSERT( ptrMutex );
+
+    // The base priority leaves out any priority inherited through a FreeRTOS
+    // mutex, but includes the ceiling of any outer ceiling mutex, as the
+    // ceiling is set with vTaskPrioritySet().
+    vTaskGetInfo( NULL, &status, pdFALSE, eInvalid );
+
+    // the task's own priority is kept from its outermost take
+    ptrHolding = prvEnterHolding( status.xHandle, status.uxBasePriority );
+    if( ptrHolding == NULL )
+    {
+        return false;
+    }
+
+    if( status.uxBasePriority < ptrMutex->ceiling )
+    {
+        // Raise first: once at the ceiling no other user of the mutex can
+        // run, so the take below normally succeeds without blocking.
+        vTaskPrioritySet( NULL, ptrMutex->ceiling );
+        isRaised = true;
+    }
+
+    if( ptrHolding->basePriority > ptrMutex->ceiling )
+    {
+        // The ceiling is set too low for this task; the blocking analysis
+        // no longer holds, but the semaphore still provides mutual exclusion.
+        ptrMutex->ceilingViolations++;
+    }
+
+    isTaken = ( xSemaphoreTake( ptrMutex->handle, timeoutTicks ) == pdTRUE );
+
+    if( isTaken )
+    {
+        ptrMutex->holder = status.xHandle;
+        ptrMutex->holderPriority = ptrHolding->basePriority;
+        ptrMutex->restorePriority = status.uxBasePriority;
+        ptrMutex->takeCycles = DWT->CYCCNT;
+    }
+    else
+    {
+        if( isRaised )
+        {
+            vTaskPrioritySet( NULL, status.uxBasePriority );
+        }
+
+        prvLeaveHolding( status.xHandle );
+    }
+
+    return isTaken;
+}
+
+
+/*-----------------------------------------------------------*/
+void PCM_Give( PCM_Mutex_t *ptrMutex )
+{
+    uint32_t holdCycles;
+    UBaseType_t priority;
+    TaskHandle_t task;
+
+    configASSERT( ptrMutex );
+    configASSERT( ptrMutex->holder == xTaskGetCurrentTaskHandle() );
+
+    holdCycles = DWT->CYCCNT - ptrMutex->takeCycles;
+    priority = ptrMutex->restorePriority;
+    task = ptrMutex->holder;
+
+    prvRecordHold( ptrMutex, task, ptrMutex->holderPriority, holdCycles );
+
+    ptrMutex->holder = NULL;
+    ( void ) xSemaphoreGive( ptrMutex->handle );
+
+    // Drop back only after the give, so any user that was waiting on the
+    // semaphore is ready before this task loses the ceiling.  A nested give
+    // drops back to the ceiling of the outer mutex.
+    if( priority < ptrMutex->ceiling )
+    {
+        vTaskPrioritySet( NULL, priority );
+    }
+
+    prvLeaveHolding( task );
+}
+
+
+/*-----------------------------------------------------------*/
+uint32_t PCM_GetBlockingReport( PCM_Blocking_t *ptrReport, const uint32_t maxEntries )
+{
+    TaskStatus_t *ptrTasks;
+    UBaseType_t numTasks;
+    uint32_t numEntries = 0u;
+    uint32_t task;
+    uint32_t record;
+    PCM_Blocking_t *ptrEntry;
+    const PCM_HoldRecord_t *ptrRecord;
+
+    if( ( ptrReport == NULL ) || ( maxEntries == 0u ) )
+    {
+        return 0u;
+    }
+
+    // Take a snapshot of the tasks; a little extra room covers tasks created
+    // between the two calls.
+    numTasks = uxTaskGetNumberOfTasks() + 2u;
+    ptrTasks = pvPortMalloc( numTasks * sizeof( TaskStatus_t ) );
+
+    if( ptrTasks == NULL )
+    {
+        return 0u;
+    }
+
+    numTasks = uxTaskGetSystemState( ptrTasks, numTasks, NULL );
+
+    vTaskSuspendAll();
+    {
+        for( task = 0u; ( task < numTasks ) && ( numEntries < maxEntries ); task++ )
+        {
+            ptrEntry = &ptrReport[ numEntries++ ];
+            ptrEntry->ptrTaskName = ptrTasks[ task ].pcTaskName;
+            ptrEntry->priority = prvGetBasePriority( ptrTasks[ task ].xHandle,
+                                                     ptrTasks[ task ].uxBasePriority );
+            ptrEntry->blockingCycles = 0u;
+            ptrEntry->ptrCause = NULL;
+
+            // A task can be blocked by any lower priority task holding a
+            // mutex whose ceiling would stop this task from running.
+            for( record = 0u; record < PCM_MAX_HOLD_RECORDS; record++ )
+            {
+                ptrRecord = &holdRecords[ record ];
+
+                if( ( ptrRecord->ptrMutex != NULL ) &&
+                    ( ptrRecord->taskPriority < ptrEntry->priority ) &&
+                    ( ptrRecord->ptrMutex->ceiling >= ptrEntry->priority ) &&
+                    ( ptrRecord->maxHoldCycles > ptrEntry->blockingCycles ) )
+                {
+                    ptrEntry->blockingCycles = ptrRecord->maxHoldCycles;
+                    ptrEntry->ptrCause = ptrRecord->ptrMutex;
+                }
+            }
+        }
+    }
+    ( void ) xTaskResumeAll();
+
+    vPortFree( ptrTasks );
+
+    return numEntries;
+}
+
+
+/*-----------------------------------------------------------*/
+uint32_t PCM_GetDroppedHoldCount( void )
+{
+    return droppedHoldCount;
+}
+
+
+/*-----------------------------------------------------------*/
+void PCM_ResetHoldTimes( void )
+{
+    taskENTER_CRITICAL();
+    {
+        memset( holdRecords, 0, sizeof( holdRecords ) );
+        droppedHoldCount = 0u;
+    }
+    taskEXIT_CRITICAL();
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static void prvRecordHold( const PCM_Mutex_t *ptrMutex,
+                           const TaskHandle_t task,
+                           const UBaseType_t taskPriority,
+                           const uint32_t holdCycles )
+{
+    PCM_HoldRecord_t *ptrFree = NULL;
+    PCM_HoldRecord_t *ptrRecord = NULL;
+    uint32_t record;
+
+    taskENTER_CRITICAL();
+    {
+        for( record = 0u; record < PCM_MAX_HOLD_RECORDS; record++ )
+        {
+            if( ( holdRecords[ record ].ptrMutex == ptrMutex ) &&
+                ( holdRecords[ record ].task == task ) )
+            {
+                ptrRecord = &holdRecords[ record ];
+                break;
+            }
+
+            if( ( ptrFree == NULL ) && ( holdRecords[ record ].ptrMutex == NULL ) )
+            {
+                ptrFree = &holdRecords[ record ];
+            }
+        }
+
+        if( ( ptrRecord == NULL ) && ( ptrFree != NULL ) )
+        {
+            ptrRecord = ptrFree;
+            ptrRecord->ptrMutex = ptrMutex;
+            ptrRecord->task = task;
+            ptrRecord->maxHoldCycles = 0u;
+        }
+
+        if( ptrRecord == NULL )
+        {
+            droppedHoldCount++;
+        }
+        else
+        {
+            // the task's priority can be changed between takes
+            ptrRecord->taskPriority = taskPriority;
+
+            if( holdCycles > ptrRecord->maxHoldCycles )
+            {
+                ptrRecord->maxHoldCycles = holdCycles;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+
+/*-----------------------------------------------------------*/
+static PCM_Holding_t *prvEnterHolding( const TaskHandle_t task, const UBaseType_t basePriority )
+{
+    PCM_Holding_t *ptrFree = NULL;
+    PCM_Holding_t *ptrHolding = NULL;
+    uint32_t entry;
+
+    taskENTER_CRITICAL();
+    {
+        for( entry = 0u; entry < PCM_MAX_HOLDING_TASKS; entry++ )
+        {
+            if( holdingTasks[ entry ].task == task )
+            {
+                ptrHolding = &holdingTasks[ entry ];
+                break;
+            }
+
+            if( ( ptrFree == NULL ) && ( holdingTasks[ entry ].task == NULL ) )
+            {
+                ptrFree = &holdingTasks[ entry ];
+            }
+        }
+
+        // the outermost take records the priority to charge blocking at
+        if( ( ptrHolding == NULL ) && ( ptrFree != NULL ) )
+        {
+            ptrHolding = ptrFree;
+            ptrHolding->task = task;
+            ptrHolding->basePriority = basePriority;
+            ptrHolding->depth = 0u;
+        }
+
+        if( ptrHolding != NULL )
+        {
+            ptrHolding->depth++;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return ptrHolding;
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvLeaveHolding( const TaskHandle_t task )
+{
+    uint32_t entry;
+
+    taskENTER_CRITICAL();
+    {
+        for( entry = 0u; entry < PCM_MAX_HOLDING_TASKS; entry++ )
+        {
+            if( holdingTasks[ entry ].task == task )
+            {
+                holdingTasks[ entry ].depth--;
+                if( holdingTasks[ entry ].depth == 0u )
+                {
+                    holdingTasks[ entry ].task = NULL;
+                }
+                break;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+
+/*-----------------------------------------------------------*/
+static UBaseType_t prvGetBasePriority( const TaskHandle_t task, const UBaseType_t basePriority )
+{
+    UBaseType_t priority = basePriority;
+    uint32_t entry;
+
+    // a task holding a ceiling mutex has its base priority raised to the ceiling
+    for( entry = 0u; entry < PCM_MAX_HOLDING_TASKS; entry++ )
+    {
+        if( holdingTasks[ entry ].task == task )
+        {
+            priority = holdingTasks[ entry ].basePriority;
+            break;
+        }
+    }
+
+    return priority;
+}
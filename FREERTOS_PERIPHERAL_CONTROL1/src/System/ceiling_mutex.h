@@ -0,0 +1,165 @@
+/*
+ * @file ceiling_mutex.h
+ *
+ * @brief Header file for the immediate priority ceiling mutex
+ *
+ * A task that takes a ceiling mutex is raised at once to the mutex's ceiling
+ * priority, which must be at least the priority of every task that uses the
+ * mutex, and drops back when it gives the mutex.  While the mutex is held no
+ * other user of it can run, so a task is blocked at most once, by one critical
+ * section of a lower priority task, and inheritance never chains through
+ * nested mutexes.
+ *
+ * The time each task holds each mutex is measured with the DWT cycle counter,
+ * and PCM_GetBlockingReport() turns those times into the worst-case blocking
+ * term of every task for response time analysis:
+ *
+ *     B(task) = longest hold by a lower priority task of any mutex whose
+ *               ceiling is at or above the priority of task
+ *
+ * Nested ceiling mutexes must be given in the reverse order they were taken.
+ * The priority a task had before its outermost take is kept for as long as it
+ * holds any ceiling mutex, so nested takes are checked against, and blocking
+ * is charged at, the task's own priority rather than an outer ceiling.
+ */
+#ifndef CEILING_MUTEX_H_
+#define CEILING_MUTEX_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before ceiling_mutex.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before ceiling_mutex.h"
+#endif
+
+#ifndef INC_FREERTOS_H
+    #error "Must include FreeRTOS.h before ceiling_mutex.h"
+#endif
+
+#include "task.h"
+#include "semphr.h"
+
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Number of distinct (task, mutex) pairs whose hold times can be tracked
+#define PCM_MAX_HOLD_RECORDS (24u)
+
+// Number of tasks that can hold ceiling mutexes at the same time
+#define PCM_MAX_HOLDING_TASKS (8u)
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+// Ceiling mutex control block.  Allocated by the caller; the members are
+// private to ceiling_mutex.c.
+typedef struct
+{
+    SemaphoreHandle_t handle;
+    const char *ptrName;
+    UBaseType_t ceiling;
+
+    TaskHandle_t holder;
+    UBaseType_t holderPriority;     // base priority of the holder before its outermost take
+    UBaseType_t restorePriority;    // priority the holder drops back to when it gives
+    uint32_t takeCycles;
+    uint32_t ceilingViolations;     // takes by tasks above the ceiling (a configuration error)
+} PCM_Mutex_t;
+
+// One line of the blocking report
+typedef struct
+{
+    const char *ptrTaskName;        // points into the task, valid while the task exists
+    UBaseType_t priority;
+    uint32_t blockingCycles;        // worst-case blocking seen so far, 0 if none
+    const PCM_Mutex_t *ptrCause;    // the mutex responsible, NULL if none
+} PCM_Blocking_t;
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function PCM_Create
+ *
+ * @brief Create a ceiling mutex
+ *
+ * @param ptrMutex - mutex control block to initialize
+ * @param ptrName - name shown in the blocking report, must be persistent
+ * @param ceiling - priority the holder runs at, >= the priority of every user
+ *
+ * @return bool - true if the mutex was created, false otherwise
+ */
+bool PCM_Create( PCM_Mutex_t *ptrMutex,
+                 const char *ptrName,
+                 const UBaseType_t ceiling );
+
+/**
+ * @function PCM_Take
+ *
+ * @brief Raise the calling task to the ceiling priority and take the mutex.
+ *        Must not be called from an interrupt.
+ *
+ * @param ptrMutex - the mutex
+ * @param timeoutTicks - maximum time to wait if the mutex is held by a task
+ *                       that blocked while holding it
+ *
+ * @return bool - true if the mutex was taken, false otherwise (the priority of
+ *                the calling task is left unchanged).  Also false if
+ *                PCM_MAX_HOLDING_TASKS other tasks already hold ceiling mutexes.
+ */
+bool PCM_Take( PCM_Mutex_t *ptrMutex, const TickType_t timeoutTicks );
+
+/**
+ * @function PCM_Give
+ *
+ * @brief Give the mutex and restore the priority the calling task had before
+ *        it was taken.  Must be called by the task holding the mutex.
+ *
+ * @param ptrMutex - the mutex
+ *
+ * @return void (no return value)
+ */
+void PCM_Give( PCM_Mutex_t *ptrMutex );
+
+/**
+ * @function PCM_GetBlockingReport
+ *
+ * @brief Compute the worst-case blocking of every task from the hold times
+ *        measured so far
+ *
+ * @param ptrReport - array filled in with one entry per task
+ * @param maxEntries - number of entries in ptrReport
+ *
+ * @return uint32_t - the number of entries filled in
+ */
+uint32_t PCM_GetBlockingReport( PCM_Blocking_t *ptrReport, const uint32_t maxEntries );
+
+/**
+ * @function PCM_GetDroppedHoldCount
+ *
+ * @brief Get the number of hold times not recorded because every hold record
+ *        was in use.  If not 0 the blocking report may be too optimistic.
+ *
+ * @param void
+ *
+ * @return uint32_t - the number of hold times dropped
+ */
+uint32_t PCM_GetDroppedHoldCount( void );
+
+/**
+ * @function PCM_ResetHoldTimes
+ *
+ * @brief Forget every hold time measured so far
+ *
+ * @param void
+ *
+ * @return void (no return value)
+ */
+void PCM_ResetHoldTimes( void );
+
+#endif /* CEILING_MUTEX_H_ */
@@ -0,0 +1,218 @@
+/*
+ * @file critical_profiler.c
+ *
+ * @brief Critical section profiler
+ *
+ * Every function here that updates the profile runs with interrupts masked,
+ * either inside the critical section being timed or under
+ * portSET_INTERRUPT_MASK_FROM_ISR(), which does not itself get profiled.
+ */
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+#define SITE_INDEX_MASK ( CSP_MAX_SITES - 1u )
+#define HASH_MULTIPLIER (2654435761u)
+
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+#include "string.h"
+
+// hardware includes
+#include "compiler.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+// this file's header
+#include "critical_profiler.h"
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t callSite;      // 0 when the slot is unused
+    uint32_t count;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+} CSP_SiteData_t;
+
+
+/*------------------------------------------------------------
+                      Local Variables
+-------------------------------------------------------------*/
+static CSP_SiteData_t sites[ CSP_MAX_SITES ];
+static uint32_t droppedCount = 0u;
+
+// the critical section currently open
+static uint32_t entryCallSite = 0u;
+static uint32_t entryCycles = 0u;
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static CSP_SiteData_t *prvFindSite( const uint32_t callSite );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+void CSP_Init( void )
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    CSP_Reset();
+}
+
+
+/*-----------------------------------------------------------*/
+void CSP_Reset( void )
+{
+    UBaseType_t savedMask = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    memset( sites, 0, sizeof( sites ) );
+    droppedCount = 0u;
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( savedMask );
+}
+
+
+/*-----------------------------------------------------------*/
+void CSP_RecordEnter( const uint32_t callSite )
+{
+    entryCallSite = callSite;
+    entryCycles = DWT->CYCCNT;
+}
+
+
+/*-----------------------------------------------------------*/
+void CSP_RecordExit( void )
+{
+    uint32_t cycles = DWT->CYCCNT - entryCycles;
+    CSP_SiteData_t *ptrSite = prvFindSite( entryCallSite );
+
+    if( ptrSite == NULL )
+    {
+        droppedCount++;
+    }
+    else
+    {
+        ptrSite->count++;
+        ptrSite->totalCycles += cycles;
+
+        if( cycles > ptrSite->maxCycles )
+        {
+            ptrSite->maxCycles = cycles;
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+uint32_t CSP_GetTopSites( CSP_Site_t *ptrSites, const uint32_t maxSites )
+{
+    static CSP_SiteData_t snapshot[ CSP_MAX_SITES ];
+    UBaseType_t savedMask;
+    uint32_t numSites = 0u;
+    uint32_t index;
+    uint32_t insert;
+    CSP_Site_t site;
+
+    if( ptrSites == NULL )
+    {
+        return 0u;
+    }
+
+    // copy the table out so the sort does not hold interrupts masked
+    savedMask = portSET_INTERRUPT_MASK_FROM_ISR();
+    memcpy( snapshot, sites, sizeof( snapshot ) );
+    portCLEAR_INTERRUPT_MASK_FROM_ISR( savedMask );
+
+    // insertion sort into the caller's array, keeping only the longest
+    for( index = 0u; index < CSP_MAX_SITES; index++ )
+    {
+        if( snapshot[ index ].callSite == 0u )
+        {
+            continue;
+        }
+
+        site.callSite = snapshot[ index ].callSite;
+        site.count = snapshot[ index ].count;
+        site.maxCycles = snapshot[ index ].maxCycles;
+        site.avgCycles = ( uint32_t )( snapshot[ index ].totalCycles / snapshot[ index ].count );
+
+        insert = numSites;
+        while( ( insert > 0u ) && ( ptrSites[ insert - 1u ].maxCycles < site.maxCycles ) )
+        {
+            if( insert < maxSites )
+            {
+                ptrSites[ insert ] = ptrSites[ insert - 1u ];
+            }
+            insert--;
+        }
+
+        if( insert < maxSites )
+        {
+            ptrSites[ insert ] = site;
+
+            if( numSites < maxSites )
+            {
+                numSites++;
+            }
+        }
+    }
+
+    return numSites;
+}
+
+
+/*-----------------------------------------------------------*/
+uint32_t CSP_GetDroppedCount( void )
+{
+    return droppedCount;
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static CSP_SiteData_t *prvFindSite( const uint32_t callSite )
+{
+    uint32_t index = ( callSite * HASH_MULTIPLIER ) >> 24;
+    uint32_t probe;
+    CSP_SiteData_t *ptrSite;
+
+    // open addressing with linear probing; entries are never removed
+    for( probe = 0u; probe < CSP_MAX_SITES; probe++ )
+    {
+        ptrSite = &sites[ ( index + probe ) & SITE_INDEX_MASK ];
+
+        if( ptrSite->callSite == callSite )
+        {
+            return ptrSite;
+        }
+
+        if( ptrSite->callSite == 0u )
+        {
+            ptrSite->callSite = callSite;
+            return ptrSite;
+        }
+    }
+
+    return NULL;
+}
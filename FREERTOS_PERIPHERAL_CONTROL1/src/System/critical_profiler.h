@@ -0,0 +1,134 @@
+/*
+ * @file critical_profiler.h
+ *
+ * @brief Header file for the critical section profiler
+ *
+ * When configUSE_CRITICAL_SECTION_PROFILER is 1 the port's vPortEnterCritical()
+ * and vPortExitCritical() time every outermost taskENTER_CRITICAL() /
+ * taskEXIT_CRITICAL() pair with the DWT cycle counter.  The time is charged to
+ * the code that entered the critical section, identified by its return
+ * address, so the call sites that keep interrupts masked the longest can be
+ * found (look the addresses up with addr2line or the .map file).
+ *
+ * Interrupt masks taken with portSET_INTERRUPT_MASK_FROM_ISR() do not go
+ * through the port functions and are not profiled.
+ */
+#ifndef CRITICAL_PROFILER_H_
+#define CRITICAL_PROFILER_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before critical_profiler.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before critical_profiler.h"
+#endif
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Number of distinct call sites that can be tracked.  Must be a power of two.
+#define CSP_MAX_SITES (32u)
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t callSite;      // address of the code that entered the critical section
+    uint32_t count;
+    uint32_t maxCycles;
+    uint32_t avgCycles;
+} CSP_Site_t;
+
+
+/*------------------------------------------------------------
+                      Instrumentation Hooks
+-------------------------------------------------------------*/
+// Used by the port layer so the instrumentation compiles away when
+// configUSE_CRITICAL_SECTION_PROFILER is 0.
+#if ( configUSE_CRITICAL_SECTION_PROFILER == 1 )
+    #define CSP_RECORD_ENTER()      CSP_RecordEnter( ( uint32_t ) __builtin_return_address( 0 ) )
+    #define CSP_RECORD_EXIT()       CSP_RecordExit()
+#else
+    #define CSP_RECORD_ENTER()
+    #define CSP_RECORD_EXIT()
+#endif
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function CSP_Init
+ *
+ * @brief Enable the DWT cycle counter and clear the profile
+ *
+ * @param void
+ *
+ * @return void (no return value)
+ */
+void CSP_Init( void );
+
+/**
+ * @function CSP_Reset
+ *
+ * @brief Clear the profile of every call site
+ *
+ * @param void
+ *
+ * @return void (no return value)
+ */
+void CSP_Reset( void );
+
+/**
+ * @function CSP_RecordEnter
+ *
+ * @brief Called by the port with interrupts masked when the outermost critical
+ *        section is entered
+ *
+ * @param callSite - return address of the code entering the critical section
+ *
+ * @return void (no return value)
+ */
+void CSP_RecordEnter( const uint32_t callSite );
+
+/**
+ * @function CSP_RecordExit
+ *
+ * @brief Called by the port, before interrupts are unmasked, when the outermost
+ *        critical section is left
+ *
+ * @param void
+ *
+ * @return void (no return value)
+ */
+void CSP_RecordExit( void );
+
+/**
+ * @function CSP_GetTopSites
+ *
+ * @brief Get the call sites with the longest critical sections, longest first
+ *
+ * @param ptrSites - array filled in with the call sites
+ * @param maxSites - number of entries in ptrSites
+ *
+ * @return uint32_t - the number of entries filled in
+ */
+uint32_t CSP_GetTopSites( CSP_Site_t *ptrSites, const uint32_t maxSites );
+
+/**
+ * @function CSP_GetDroppedCount
+ *
+ * @brief Get the number of critical sections not recorded because the call
+ *        site table was full
+ *
+ * @param void
+ *
+ * @return uint32_t - the number of critical sections dropped
+ */
+uint32_t CSP_GetDroppedCount( void );
+
+#endif /* CRITICAL_PROFILER_H_ */
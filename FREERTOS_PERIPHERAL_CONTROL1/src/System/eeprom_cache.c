@@ -0,0 +1,689 @@
+/*
+ * @file eeprom_cache.c
+ *
+ * @brief EEPROM write-back page cache with ACK polling
+ *
+ * A line holds one contiguous run of dirty bytes within a page.  A write that
+ * touches or overlaps the run extends it.  A write that leaves a gap first
+ * reads the gap from the device, so the run stays contiguous and the line is
+ * still written back with a single page write.
+ *
+ * Reads are not cached.  They go to the device, with any dirty bytes of the
+ * page laid over the top, unless they fall entirely within a dirty run.
+ */
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+#include "string.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+// this file's header
+#include "eeprom_cache.h"
+
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Bytes of memory address sent before the data by an AT24C256/AT24C512
+#define AT24C_ADDRESS_LENGTH (2u)
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static EEP_Line_t *prvFindLine( EEP_Cache_t *ptrCache, const uint32_t pageAddress );
+static EEP_Line_t *prvAllocateLine( EEP_Cache_t *ptrCache, const uint32_t pageAddress );
+static bool prvWriteBack( EEP_Cache_t *ptrCache, EEP_Line_t *ptrLine );
+static bool prvWaitReady( EEP_Cache_t *ptrCache );
+static bool prvDeviceRead( EEP_Cache_t *ptrCache, const uint32_t address, uint8_t *ptrData, const uint32_t length );
+static bool prvMergeWrite( EEP_Cache_t *ptrCache, EEP_Line_t *ptrLine, const uint32_t offset, const uint8_t *ptrData, const uint32_t length );
+
+static bool prvTwiRead( void *ptrDevice, const uint32_t address, uint8_t *ptrData, const uint32_t length );
+static bool prvTwiWrite( void *ptrDevice, const uint32_t address, const uint8_t *ptrData, const uint32_t length );
+static bool prvTwiPoll( void *ptrDevice );
+static bool prvTwiTransfer( EEP_TwiDevice_t *ptrTwi, twi_packet_t *ptrPacket, const bool isRead );
+static bool prvSimRead( void *ptrDevice, const uint32_t address, uint8_t *ptrData, const uint32_t length );
+static bool prvSimWrite( void *ptrDevice, const uint32_t address, const uint8_t *ptrData, const uint32_t length );
+static bool prvSimPoll( void *ptrDevice );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+bool EEP_InitTwiBus( EEP_Bus_t *ptrBus,
+                     EEP_TwiDevice_t *ptrDevice,
+                     freertos_twi_if twi,
+                     const uint8_t chipAddress,
+                     SemaphoreHandle_t notificationSemaphore )
+{
+    // check parameters are valid
+    bool isValid = ( ptrBus != NULL );
+    isValid = isValid && ( ptrDevice != NULL );
+    isValid = isValid && ( twi != NULL );
+
+    if( isValid )
+    {
+        ptrDevice->twi = twi;
+        ptrDevice->chipAddress = chipAddress;
+        ptrDevice->blockTicks = EEP_WRITE_CYCLE_TIMEOUT_TICKS;
+        ptrDevice->notificationSemaphore = notificationSemaphore;
+
+        ptrBus->ptrRead = prvTwiRead;
+        ptrBus->ptrWrite = prvTwiWrite;
+        ptrBus->ptrPoll = prvTwiPoll;
+        ptrBus->ptrDevice = ptrDevice;
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool EEP_InitSimBus( EEP_Bus_t *ptrBus,
+                     EEP_SimDevice_t *ptrDevice,
+                     uint8_t *ptrMemory,
+                     const uint32_t size,
+                     const TickType_t writeCycleTicks )
+{
+    // check parameters are valid
+    bool isValid = ( ptrBus != NULL );
+    isValid = isValid && ( ptrDevice != NULL );
+    isValid = isValid && ( ptrMemory != NULL );
+    isValid = isValid && ( size >= EEP_PAGE_SIZE );
+    isValid = isValid && ( ( size % EEP_PAGE_SIZE ) == 0u );
+
+    if( isValid )
+    {
+        ptrDevice->ptrMemory = ptrMemory;
+        ptrDevice->size = size;
+        ptrDevice->writeCycleTicks = writeCycleTicks;
+        ptrDevice->writeStartTicks = 0u;
+        ptrDevice->isWriting = false;
+
+        ptrBus->ptrRead = prvSimRead;
+        ptrBus->ptrWrite = prvSimWrite;
+        ptrBus->ptrPoll = prvSimPoll;
+        ptrBus->ptrDevice = ptrDevice;
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool EEP_Init( EEP_Cache_t *ptrCache, const EEP_Bus_t *ptrBus, const uint32_t size )
+{
+    // check parameters are valid
+    bool isValid = ( ptrCache != NULL );
+    isValid = isValid && ( ptrBus != NULL );
+    isValid = isValid && ( size >= EEP_PAGE_SIZE );
+    isValid = isValid && ( ( size % EEP_PAGE_SIZE ) == 0u );
+
+    if( isValid )
+    {
+        memset( ptrCache, 0, sizeof( *ptrCache ) );
+        ptrCache->bus = *ptrBus;
+        ptrCache->size = size;
+
+        ptrCache->mutex = xSemaphoreCreateMutex();
+        isValid = ( ptrCache->mutex != NULL );
+    }
+
+    if( isValid )
+    {
+        vQueueAddToRegistry( ptrCache->mutex, "EEPROM" );
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool EEP_Read( EEP_Cache_t *ptrCache,
+               const uint32_t address,
+               uint8_t *ptrData,
+               const uint32_t length,
+               const TickType_t timeoutTicks )
+{
+    uint32_t done = 0u;
+    uint32_t chunkAddress;
+    uint32_t offset;
+    uint32_t chunk;
+    uint32_t first;
+    uint32_t last;
+    EEP_Line_t *ptrLine;
+
+    // check parameters are valid
+    bool isValid = ( ptrCache != NULL );
+    isValid = isValid && ( ptrData != NULL );
+    isValid = isValid && ( address < ptrCache->size );
+    isValid = isValid && ( length <= ( ptrCache->size - address ) );
+
+    if( !isValid || ( xSemaphoreTake( ptrCache->mutex, timeoutTicks ) != pdTRUE ) )
+    {
+        return false;
+    }
+
+    // One page at a time, as each page may have its own line.
+    while( isValid && ( done < length ) )
+    {
+        chunkAddress = address + done;
+        offset = chunkAddress % EEP_PAGE_SIZE;
+        chunk = EEP_PAGE_SIZE - offset;
+        if( chunk > ( length - done ) )
+        {
+            chunk = length - done;
+        }
+
+        ptrLine = prvFindLine( ptrCache, chunkAddress - offset );
+
+        if( ( ptrLine != NULL ) &&
+            ( offset >= ptrLine->dirtyStart ) &&
+            ( ( offset + chunk ) <= ptrLine->dirtyEnd ) )
+        {
+            memcpy( &ptrData[ done ], &ptrLine->data[ offset ], chunk );
+            ptrCache->stats.readHits++;
+        }
+        else
+        {
+            isValid = prvDeviceRead( ptrCache, chunkAddress, &ptrData[ done ], chunk );
+            ptrCache->stats.readMisses++;
+
+            // lay the newer bytes still in the cache over the device's
+            if( isValid && ( ptrLine != NULL ) )
+            {
+                first = ( offset > ptrLine->dirtyStart ) ? offset : ptrLine->dirtyStart;
+                last = ( ( offset + chunk ) < ptrLine->dirtyEnd ) ? ( offset + chunk ) : ptrLine->dirtyEnd;
+
+                if( first < last )
+                {
+                    memcpy( &ptrData[ done + first - offset ], &ptrLine->data[ first ], last - first );
+                }
+            }
+        }
+
+        done += chunk;
+    }
+
+    ( void ) xSemaphoreGive( ptrCache->mutex );
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool EEP_Write( EEP_Cache_t *ptrCache,
+                const uint32_t address,
+                const uint8_t *ptrData,
+                const uint32_t length,
+                const TickType_t timeoutTicks )
+{
+    uint32_t done = 0u;
+    uint32_t chunkAddress;
+    uint32_t offset;
+    uint32_t chunk;
+    EEP_Line_t *ptrLine;
+
+    // check parameters are valid
+    bool isValid = ( ptrCache != NULL );
+    isValid = isValid && ( ptrData != NULL );
+    isValid = isValid && ( address < ptrCache->size );
+    isValid = isValid && ( length <= ( ptrCache->size - address ) );
+
+    if( !isValid || ( xSemaphoreTake( ptrCache->mutex, timeoutTicks ) != pdTRUE ) )
+    {
+        return false;
+    }
+
+    ptrCache->stats.writes++;
+
+    while( isValid && ( done < length ) )
+    {
+        chunkAddress = address + done;
+        offset = chunkAddress % EEP_PAGE_SIZE;
+        chunk = EEP_PAGE_SIZE - offset;
+        if( chunk > ( length - done ) )
+        {
+            chunk = length - done;
+        }
+
+        ptrLine = prvFindLine( ptrCache, chunkAddress - offset );
+        if( ptrLine == NULL )
+        {
+            ptrLine = prvAllocateLine( ptrCache, chunkAddress - offset );
+        }
+
+        isValid = ( ptrLine != NULL ) &&
+                  prvMergeWrite( ptrCache, ptrLine, offset, &ptrData[ done ], chunk );
+
+        if( isValid )
+        {
+            ptrCache->stats.bytesWritten += chunk;
+        }
+
+        done += chunk;
+    }
+
+    if( !isValid )
+    {
+        ptrCache->stats.failures++;
+    }
+
+    ( void ) xSemaphoreGive( ptrCache->mutex );
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool EEP_Flush( EEP_Cache_t *ptrCache, const TickType_t timeoutTicks )
+{
+    uint32_t index;
+    bool isFlushed = ( ptrCache != NULL );
+
+    if( !isFlushed || ( xSemaphoreTake( ptrCache->mutex, timeoutTicks ) != pdTRUE ) )
+    {
+        return false;
+    }
+
+    for( index = 0u; index < EEP_CACHE_PAGES; index++ )
+    {
+        if( !prvWriteBack( ptrCache, &ptrCache->lines[ index ] ) )
+        {
+            isFlushed = false;
+        }
+    }
+
+    // the data is only safe once the last write cycle is over
+    isFlushed = prvWaitReady( ptrCache ) && isFlushed;
+
+    ( void ) xSemaphoreGive( ptrCache->mutex );
+
+    return isFlushed;
+}
+
+
+/*-----------------------------------------------------------*/
+void EEP_GetStats( EEP_Cache_t *ptrCache, EEP_Stats_t *ptrStats, const bool doReset )
+{
+    configASSERT( ptrCache );
+    configASSERT( ptrStats );
+
+    taskENTER_CRITICAL();
+    {
+        *ptrStats = ptrCache->stats;
+
+        if( doReset )
+        {
+            memset( &ptrCache->stats, 0, sizeof( ptrCache->stats ) );
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static EEP_Line_t *prvFindLine( EEP_Cache_t *ptrCache, const uint32_t pageAddress )
+{
+    uint32_t index;
+    EEP_Line_t *ptrLine = NULL;
+
+    for( index = 0u; index < EEP_CACHE_PAGES; index++ )
+    {
+        if( ptrCache->lines[ index ].isValid &&
+            ( ptrCache->lines[ index ].pageAddress == pageAddress ) )
+        {
+            ptrLine = &ptrCache->lines[ index ];
+            ptrLine->lastUse = ++ptrCache->useCount;
+            break;
+        }
+    }
+
+    return ptrLine;
+}
+
+
+/*-----------------------------------------------------------*/
+static EEP_Line_t *prvAllocateLine( EEP_Cache_t *ptrCache, const uint32_t pageAddress )
+{
+    uint32_t index;
+    EEP_Line_t *ptrLine = &ptrCache->lines[ 0 ];
+
+    // a free line, or failing that the least recently used
+    for( index = 0u; index < EEP_CACHE_PAGES; index++ )
+    {
+        if( !ptrCache->lines[ index ].isValid )
+        {
+            ptrLine = &ptrCache->lines[ index ];
+            break;
+        }
+
+        if( ptrCache->lines[ index ].lastUse < ptrLine->lastUse )
+        {
+            ptrLine = &ptrCache->lines[ index ];
+        }
+    }
+
+    if( !prvWriteBack( ptrCache, ptrLine ) )
+    {
+        return NULL;
+    }
+
+    ptrLine->pageAddress = pageAddress;
+    ptrLine->dirtyStart = 0u;
+    ptrLine->dirtyEnd = 0u;
+    ptrLine->isValid = true;
+    ptrLine->lastUse = ++ptrCache->useCount;
+
+    return ptrLine;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvWriteBack( EEP_Cache_t *ptrCache, EEP_Line_t *ptrLine )
+{
+    uint32_t length;
+    bool isWritten = true;
+
+    if( ptrLine->isValid && ( ptrLine->dirtyEnd > ptrLine->dirtyStart ) )
+    {
+        length = ptrLine->dirtyEnd - ptrLine->dirtyStart;
+
+        // The device ignores a write while the previous page is programming,
+        // so this is where the write cycle started last time is waited for.
+        isWritten = prvWaitReady( ptrCache ) &&
+                    ptrCache->bus.ptrWrite( ptrCache->bus.ptrDevice,
+                                            ptrLine->pageAddress + ptrLine->dirtyStart,
+                                            &ptrLine->data[ ptrLine->dirtyStart ],
+                                            length );
+
+        if( isWritten )
+        {
+            ptrCache->isWriteCycleActive = true;
+            ptrCache->stats.pageWrites++;
+            ptrCache->stats.bytesWrittenBack += length;
+        }
+        else
+        {
+            // keep the data so a later flush can try again
+            ptrCache->stats.failures++;
+            return false;
+        }
+    }
+
+    ptrLine->isValid = false;
+
+    return isWritten;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvWaitReady( EEP_Cache_t *ptrCache )
+{
+    TickType_t startTicks;
+    TickType_t waitedTicks = 0u;
+    bool isReady = !ptrCache->isWriteCycleActive;
+
+    if( !isReady )
+    {
+        startTicks = xTaskGetTickCount();
+
+        while( !isReady && ( waitedTicks <= EEP_WRITE_CYCLE_TIMEOUT_TICKS ) )
+        {
+            isReady = ptrCache->bus.ptrPoll( ptrCache->bus.ptrDevice );
+
+            if( !isReady )
+            {
+                ptrCache->stats.busyPolls++;
+
+                // Sleep a tick between polls rather than yield, so lower
+                // priority tasks can run and the bus is not flooded with polls
+                // while the mutex is held.
+                vTaskDelay( 1u );
+            }
+
+            waitedTicks = xTaskGetTickCount() - startTicks;
+        }
+
+        ptrCache->stats.busyTicks += waitedTicks;
+        ptrCache->isWriteCycleActive = !isReady;
+    }
+
+    return isReady;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvDeviceRead( EEP_Cache_t *ptrCache, const uint32_t address, uint8_t *ptrData, const uint32_t length )
+{
+    bool isRead = prvWaitReady( ptrCache ) &&
+                  ptrCache->bus.ptrRead( ptrCache->bus.ptrDevice, address, ptrData, length );
+
+    if( !isRead )
+    {
+        ptrCache->stats.failures++;
+    }
+
+    return isRead;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvMergeWrite( EEP_Cache_t *ptrCache, EEP_Line_t *ptrLine, const uint32_t offset, const uint8_t *ptrData, const uint32_t length )
+{
+    uint32_t end = offset + length;
+    bool isMerged = true;
+
+    if( ptrLine->dirtyEnd == ptrLine->dirtyStart )
+    {
+        ptrLine->dirtyStart = ( uint16_t ) offset;
+        ptrLine->dirtyEnd = ( uint16_t ) end;
+    }
+    else
+    {
+        // fill any gap from the device so the dirty bytes stay contiguous
+        if( offset > ptrLine->dirtyEnd )
+        {
+            isMerged = prvDeviceRead( ptrCache,
+                                      ptrLine->pageAddress + ptrLine->dirtyEnd,
+                                      &ptrLine->data[ ptrLine->dirtyEnd ],
+                                      offset - ptrLine->dirtyEnd );
+            ptrCache->stats.gapReads++;
+        }
+        else if( end < ptrLine->dirtyStart )
+        {
+            isMerged = prvDeviceRead( ptrCache,
+                                      ptrLine->pageAddress + end,
+                                      &ptrLine->data[ end ],
+                                      ptrLine->dirtyStart - end );
+            ptrCache->stats.gapReads++;
+        }
+
+        if( isMerged )
+        {
+            if( offset < ptrLine->dirtyStart )
+            {
+                ptrLine->dirtyStart = ( uint16_t ) offset;
+            }
+
+            if( end > ptrLine->dirtyEnd )
+            {
+                ptrLine->dirtyEnd = ( uint16_t ) end;
+            }
+        }
+    }
+
+    if( isMerged )
+    {
+        memcpy( &ptrLine->data[ offset ], ptrData, length );
+    }
+
+    return isMerged;
+}
+
+
+/*------------------------------------------------------------
+                      AT24C on a TWI port
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static bool prvTwiRead( void *ptrDevice, const uint32_t address, uint8_t *ptrData, const uint32_t length )
+{
+    EEP_TwiDevice_t *ptrTwi = ptrDevice;
+    twi_packet_t packet;
+
+    packet.chip = ptrTwi->chipAddress;
+    packet.addr[ 0 ] = ( uint8_t ) ( ( address >> 8 ) & 0xffu );
+    packet.addr[ 1 ] = ( uint8_t ) ( address & 0xffu );
+    packet.addr_length = AT24C_ADDRESS_LENGTH;
+    packet.buffer = ptrData;
+    packet.length = length;
+
+    return prvTwiTransfer( ptrTwi, &packet, true );
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvTwiWrite( void *ptrDevice, const uint32_t address, const uint8_t *ptrData, const uint32_t length )
+{
+    EEP_TwiDevice_t *ptrTwi = ptrDevice;
+    twi_packet_t packet;
+
+    packet.chip = ptrTwi->chipAddress;
+    packet.addr[ 0 ] = ( uint8_t ) ( ( address >> 8 ) & 0xffu );
+    packet.addr[ 1 ] = ( uint8_t ) ( address & 0xffu );
+    packet.addr_length = AT24C_ADDRESS_LENGTH;
+    packet.buffer = ( void * ) ptrData;
+    packet.length = length;
+
+    return prvTwiTransfer( ptrTwi, &packet, false );
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvTwiPoll( void *ptrDevice )
+{
+    EEP_TwiDevice_t *ptrTwi = ptrDevice;
+    twi_packet_t packet;
+    uint8_t data;
+
+    // A current address read of one byte.  The driver cannot send an address
+    // with no data, and a read leaves nothing half written if it is acknowledged.
+    packet.chip = ptrTwi->chipAddress;
+    packet.addr_length = 0u;
+    packet.buffer = &data;
+    packet.length = 1u;
+
+    // one byte is read by polling, so the transfer is over when the call returns
+    return ( freertos_twi_read_packet( ptrTwi->twi, &packet, ptrTwi->blockTicks ) == STATUS_OK );
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvTwiTransfer( EEP_TwiDevice_t *ptrTwi, twi_packet_t *ptrPacket, const bool isRead )
+{
+    SemaphoreHandle_t semaphore = ptrTwi->notificationSemaphore;
+    status_code_t status;
+    bool isPdcTransfer;
+
+    if( isRead )
+    {
+        status = freertos_twi_read_packet_async( ptrTwi->twi, ptrPacket, ptrTwi->blockTicks, semaphore );
+    }
+    else
+    {
+        status = freertos_twi_write_packet_async( ptrTwi->twi, ptrPacket, ptrTwi->blockTicks, semaphore );
+    }
+
+    // An asynchronous port returns once a PDC transfer has started, and gives
+    // the semaphore when it ends, unless the chip did not acknowledge.  Writes
+    // of one byte and reads of up to two are made by polling, and are over
+    // when the call returns.
+    isPdcTransfer = ( ptrPacket->length > ( isRead ? 2u : 1u ) );
+
+    if( ( status == STATUS_OK ) && ( semaphore != NULL ) && isPdcTransfer &&
+        ( xSemaphoreTake( semaphore, ptrTwi->blockTicks ) != pdTRUE ) )
+    {
+        status = ERR_TIMEOUT;
+    }
+
+    return ( status == STATUS_OK );
+}
+
+
+/*------------------------------------------------------------
+                       Simulated AT24C
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static bool prvSimRead( void *ptrDevice, const uint32_t address, uint8_t *ptrData, const uint32_t length )
+{
+    EEP_SimDevice_t *ptrSim = ptrDevice;
+    uint32_t index;
+    bool isAcknowledged = prvSimPoll( ptrDevice );
+
+    if( isAcknowledged )
+    {
+        // sequential reads roll over at the end of the memory
+        for( index = 0u; index < length; index++ )
+        {
+            ptrData[ index ] = ptrSim->ptrMemory[ ( address + index ) % ptrSim->size ];
+        }
+    }
+
+    return isAcknowledged;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvSimWrite( void *ptrDevice, const uint32_t address, const uint8_t *ptrData, const uint32_t length )
+{
+    EEP_SimDevice_t *ptrSim = ptrDevice;
+    uint32_t pageAddress = ( address % ptrSim->size ) - ( address % EEP_PAGE_SIZE );
+    uint32_t index;
+    bool isAcknowledged = prvSimPoll( ptrDevice );
+
+    if( isAcknowledged )
+    {
+        // page writes roll over at the end of the page
+        for( index = 0u; index < length; index++ )
+        {
+            ptrSim->ptrMemory[ pageAddress + ( ( address + index ) % EEP_PAGE_SIZE ) ] = ptrData[ index ];
+        }
+
+        ptrSim->writeStartTicks = xTaskGetTickCount();
+        ptrSim->isWriting = true;
+    }
+
+    return isAcknowledged;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvSimPoll( void *ptrDevice )
+{
+    EEP_SimDevice_t *ptrSim = ptrDevice;
+
+    if( ptrSim->isWriting &&
+        ( ( xTaskGetTickCount() - ptrSim->writeStartTicks ) >= ptrSim->writeCycleTicks ) )
+    {
+        ptrSim->isWriting = false;
+    }
+
+    return !ptrSim->isWriting;
+}
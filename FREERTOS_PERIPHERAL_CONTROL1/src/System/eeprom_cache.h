@@ -0,0 +1,253 @@
+/*
+ * @file eeprom_cache.h
+ *
+ * @brief Header file for the EEPROM write-back page cache
+ *
+ * Writes are merged in RAM, one cache line per EEPROM page, and each line is
+ * written to the device as a single page write when it is evicted or flushed.
+ * Many small writes to the same page therefore cost one write cycle instead of
+ * one each.
+ *
+ * The end of a write cycle is found by ACK polling: the device does not
+ * acknowledge its address until the cycle is over.  The poll is left until the
+ * device is next needed, so the cache carries on merging writes while the
+ * device programs the previous page, rather than sleeping for the worst-case
+ * write time after every page.
+ *
+ * The device is reached through an EEP_Bus_t, filled in by EEP_InitTwiBus()
+ * for an AT24C on a FreeRTOS TWI port, or by EEP_InitSimBus() for a simulated
+ * AT24C held in RAM, so the same code can be exercised without the hardware.
+ */
+#ifndef EEPROM_CACHE_H_
+#define EEPROM_CACHE_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before eeprom_cache.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before eeprom_cache.h"
+#endif
+
+#ifndef INC_FREERTOS_H
+    #error "Must include FreeRTOS.h before eeprom_cache.h"
+#endif
+
+#include "semphr.h"
+#include "freertos_twi_master.h"
+
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Page size of the AT24C256/AT24C512
+#define EEP_PAGE_SIZE (128u)
+
+// Number of pages that can hold merged writes at once
+#define EEP_CACHE_PAGES (4u)
+
+// Longest an AT24C may take to finish a write cycle (5ms), with margin
+#define EEP_WRITE_CYCLE_TIMEOUT_TICKS ( 20u / portTICK_RATE_MS )
+
+// TWI address of an AT24C with its address pins tied low
+#define EEP_AT24C_ADDRESS (0x50u)
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+// Access to the device.  Each function returns false if the device did not
+// acknowledge, which is the case while it is busy with a write cycle.
+typedef struct
+{
+    bool (*ptrRead)( void *ptrDevice, const uint32_t address, uint8_t *ptrData, const uint32_t length );
+    bool (*ptrWrite)( void *ptrDevice, const uint32_t address, const uint8_t *ptrData, const uint32_t length );  // all within one page
+    bool (*ptrPoll)( void *ptrDevice );                                                                        // address the device once
+    void *ptrDevice;
+} EEP_Bus_t;
+
+// An AT24C on a FreeRTOS TWI port, for EEP_InitTwiBus()
+typedef struct
+{
+    freertos_twi_if twi;
+    uint8_t chipAddress;
+    TickType_t blockTicks;                      // longest wait for the TWI port
+    SemaphoreHandle_t notificationSemaphore;    // NULL if the port waits for each transfer itself
+} EEP_TwiDevice_t;
+
+// A simulated AT24C, for EEP_InitSimBus().  Like the real device it wraps
+// writes within a page and ignores its address while a write cycle runs.
+typedef struct
+{
+    uint8_t *ptrMemory;
+    uint32_t size;
+    TickType_t writeCycleTicks;
+    TickType_t writeStartTicks;
+    bool isWriting;
+} EEP_SimDevice_t;
+
+// One page of merged writes.  Only the bytes from dirtyStart up to dirtyEnd
+// hold data.
+typedef struct
+{
+    uint32_t pageAddress;
+    uint8_t data[ EEP_PAGE_SIZE ];
+    uint16_t dirtyStart;
+    uint16_t dirtyEnd;
+    bool isValid;
+    uint32_t lastUse;
+} EEP_Line_t;
+
+typedef struct
+{
+    uint32_t writes;            // calls to EEP_Write()
+    uint32_t bytesWritten;
+    uint32_t pageWrites;        // write cycles started on the device
+    uint32_t bytesWrittenBack;
+    uint32_t gapReads;          // reads to fill the gap between merged writes
+    uint32_t readHits;          // page sections read entirely from the cache
+    uint32_t readMisses;
+    uint32_t busyPolls;         // ACK polls the device did not acknowledge
+    uint32_t busyTicks;         // time spent waiting for write cycles
+    uint32_t failures;
+} EEP_Stats_t;
+
+typedef struct
+{
+    EEP_Bus_t bus;
+    uint32_t size;
+    SemaphoreHandle_t mutex;
+    EEP_Line_t lines[ EEP_CACHE_PAGES ];
+    uint32_t useCount;
+    bool isWriteCycleActive;    // a page has been written and not yet acknowledged
+    EEP_Stats_t stats;
+} EEP_Cache_t;
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function EEP_InitTwiBus
+ *
+ * @brief Set up a bus for an AT24C on a TWI port already initialised by
+ *        freertos_twi_master_init().  A port initialised with
+ *        WAIT_TX_COMPLETE and WAIT_RX_COMPLETE is used through the blocking
+ *        API.  A port initialised without them is used through the
+ *        asynchronous API, waiting on notificationSemaphore, since the cache
+ *        reuses its buffers as soon as a transfer returns.
+ *
+ * @param ptrBus - bus to fill in
+ * @param ptrDevice - device description, must be persistent
+ * @param twi - the TWI port
+ * @param chipAddress - TWI address of the AT24C
+ * @param notificationSemaphore - binary semaphore for an asynchronous port,
+ *                                NULL for a blocking one
+ *
+ * @return bool - true if the bus was set up, false otherwise
+ */
+bool EEP_InitTwiBus( EEP_Bus_t *ptrBus,
+                     EEP_TwiDevice_t *ptrDevice,
+                     freertos_twi_if twi,
+                     const uint8_t chipAddress,
+                     SemaphoreHandle_t notificationSemaphore );
+
+/**
+ * @function EEP_InitSimBus
+ *
+ * @brief Set up a bus for a simulated AT24C
+ *
+ * @param ptrBus - bus to fill in
+ * @param ptrDevice - simulated device to initialize, must be persistent
+ * @param ptrMemory - the simulated device's memory, size bytes
+ * @param size - size of the simulated device in bytes
+ * @param writeCycleTicks - how long each page write keeps the device busy
+ *
+ * @return bool - true if the bus was set up, false otherwise
+ */
+bool EEP_InitSimBus( EEP_Bus_t *ptrBus,
+                     EEP_SimDevice_t *ptrDevice,
+                     uint8_t *ptrMemory,
+                     const uint32_t size,
+                     const TickType_t writeCycleTicks );
+
+/**
+ * @function EEP_Init
+ *
+ * @brief Initialize a cache in front of a device
+ *
+ * @param ptrCache - cache to initialize
+ * @param ptrBus - how to reach the device, copied
+ * @param size - size of the device in bytes
+ *
+ * @return bool - true if the cache was initialized, false otherwise
+ */
+bool EEP_Init( EEP_Cache_t *ptrCache, const EEP_Bus_t *ptrBus, const uint32_t size );
+
+/**
+ * @function EEP_Read
+ *
+ * @brief Read from the device, including any writes still held in the cache
+ *
+ * @param ptrCache - the cache
+ * @param address - first byte to read
+ * @param ptrData - where to put the data
+ * @param length - number of bytes to read
+ * @param timeoutTicks - maximum wait for another task using the cache
+ *
+ * @return bool - true if the data was read, false otherwise
+ */
+bool EEP_Read( EEP_Cache_t *ptrCache,
+               const uint32_t address,
+               uint8_t *ptrData,
+               const uint32_t length,
+               const TickType_t timeoutTicks );
+
+/**
+ * @function EEP_Write
+ *
+ * @brief Write to the cache.  The data reaches the device when its page is
+ *        evicted, or on EEP_Flush().
+ *
+ * @param ptrCache - the cache
+ * @param address - first byte to write
+ * @param ptrData - the data, copied
+ * @param length - number of bytes to write
+ * @param timeoutTicks - maximum wait for another task using the cache
+ *
+ * @return bool - true if the data was written, false otherwise
+ */
+bool EEP_Write( EEP_Cache_t *ptrCache,
+                const uint32_t address,
+                const uint8_t *ptrData,
+                const uint32_t length,
+                const TickType_t timeoutTicks );
+
+/**
+ * @function EEP_Flush
+ *
+ * @brief Write every page held in the cache to the device, and wait for the
+ *        last write cycle to finish
+ *
+ * @param ptrCache - the cache
+ * @param timeoutTicks - maximum wait for another task using the cache
+ *
+ * @return bool - true if everything written so far is in the device, false otherwise
+ */
+bool EEP_Flush( EEP_Cache_t *ptrCache, const TickType_t timeoutTicks );
+
+/**
+ * @function EEP_GetStats
+ *
+ * @brief Take a copy of the cache's counters
+ *
+ * @param ptrCache - the cache
+ * @param ptrStats - filled in with the counters
+ * @param doReset - clear the counters once they have been copied
+ *
+ * @return void (no return value)
+ */
+void EEP_GetStats( EEP_Cache_t *ptrCache, EEP_Stats_t *ptrStats, const bool doReset );
+
+#endif /* EEPROM_CACHE_H_ */
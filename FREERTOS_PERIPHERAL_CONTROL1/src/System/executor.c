@@ -0,0 +1,410 @@
+/*
+ * @file executor.c
+ *
+ * @brief Stackless coroutine executor
+ *
+ * A single task runs every coroutine.  It blocks on a FreeRTOS queue set that
+ * contains every registered queue plus a binary semaphore used for
+ * notifications, with a timeout equal to the nearest coroutine deadline.  On
+ * each wake-up it runs, in turn, every coroutine whose wait is satisfied.
+ */
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+#define EXECUTOR_TASK_NAME "Executor"
+#define DONT_BLOCK (0u)
+
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+// this file's header
+#include "executor.h"
+
+
+/*------------------------------------------------------------
+                      Local Variables
+-------------------------------------------------------------*/
+static EXE_Coroutine_t *ptrCoroutineHead = NULL;
+static EXE_Coroutine_t *ptrCoroutineTail = NULL;
+static EXE_Queue_t *ptrQueueHead = NULL;
+
+// Number of queue set slots needed by the registered queues.
+static UBaseType_t queueSetLength = 0u;
+
+static QueueSetHandle_t queueSet = NULL;
+static SemaphoreHandle_t wakeSemaphore = NULL;
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static void prvExecutorTask( void *ptrParameters );
+static void prvDispatchSetMember( QueueSetMemberHandle_t member );
+static bool prvIsReady( EXE_Coroutine_t *ptrCo,
+                        const TickType_t nowTicks,
+                        TickType_t *ptrTicksToWait );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+bool EXE_AddQueue( EXE_Queue_t *ptrQueue, QueueHandle_t queueHandle )
+{
+    // check parameters are valid
+    bool isValid = ( ptrQueue != NULL );
+    isValid = isValid && ( queueHandle != NULL );
+    isValid = isValid && ( queueSet == NULL );
+
+    // The queue set is sized from the queues, so they must be empty here.
+    isValid = isValid && ( uxQueueMessagesWaiting( queueHandle ) == 0u );
+
+    if( isValid )
+    {
+        ptrQueue->handle = queueHandle;
+        ptrQueue->pendingItems = 0u;
+        ptrQueue->ptrNext = ptrQueueHead;
+        ptrQueueHead = ptrQueue;
+
+        queueSetLength += uxQueueSpacesAvailable( queueHandle );
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool EXE_AddCoroutine( EXE_Coroutine_t *ptrCo,
+                       EXE_Handler_t ptrHandler,
+                       void *ptrContext )
+{
+    // check parameters are valid
+    bool isValid = ( ptrCo != NULL );
+    isValid = isValid && ( ptrHandler != NULL );
+
+    if( isValid )
+    {
+        ptrCo->ptrHandler = ptrHandler;
+        ptrCo->ptrContext = ptrContext;
+        ptrCo->resumePoint = 0u;
+        ptrCo->waitType = EXE_WAIT_NONE;
+        ptrCo->waitStartTicks = 0u;
+        ptrCo->waitTimeoutTicks = 0u;
+        ptrCo->ptrWaitQueue = NULL;
+        ptrCo->ptrWaitItem = NULL;
+        ptrCo->waitMask = 0u;
+        ptrCo->isWaitSatisfied = true;
+        ptrCo->pendingBits = 0u;
+        ptrCo->receivedBits = 0u;
+        ptrCo->ptrNext = NULL;
+
+        if( ptrCoroutineTail == NULL )
+        {
+            ptrCoroutineHead = ptrCo;
+        }
+        else
+        {
+            ptrCoroutineTail->ptrNext = ptrCo;
+        }
+        ptrCoroutineTail = ptrCo;
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool EXE_Start( const uint16_t stackDepth, const UBaseType_t priority )
+{
+    BaseType_t xReturned = pdFAIL;
+    EXE_Queue_t *ptrQueue;
+
+    // check the executor has not already been started
+    bool isValid = ( queueSet == NULL );
+
+    if( isValid )
+    {
+        // One extra slot for the notification semaphore.
+        queueSet = xQueueCreateSet( queueSetLength + 1u );
+        wakeSemaphore = xSemaphoreCreateBinary();
+        isValid = ( queueSet != NULL ) && ( wakeSemaphore != NULL );
+    }
+
+    if( isValid )
+    {
+        isValid = ( xQueueAddToSet( wakeSemaphore, queueSet ) == pdPASS );
+
+        for( ptrQueue = ptrQueueHead; isValid && ( ptrQueue != NULL ); ptrQueue = ptrQueue->ptrNext )
+        {
+            isValid = ( xQueueAddToSet( ptrQueue->handle, queueSet ) == pdPASS );
+        }
+    }
+
+    if( isValid )
+    {
+        xReturned = xTaskCreate( prvExecutorTask,
+                                 EXECUTOR_TASK_NAME,
+                                 stackDepth,
+                                 NULL,
+                                 priority,
+                                 NULL );
+    }
+
+    return ( xReturned == pdPASS );
+}
+
+
+/*-----------------------------------------------------------*/
+void EXE_Notify( EXE_Coroutine_t *ptrCo, const uint32_t bits )
+{
+    configASSERT( ptrCo );
+
+    taskENTER_CRITICAL();
+    {
+        ptrCo->pendingBits |= bits;
+    }
+    taskEXIT_CRITICAL();
+
+    // Giving an already given binary semaphore fails harmlessly, so any
+    // number of notifications only ever occupies one queue set slot.
+    if( wakeSemaphore != NULL )
+    {
+        ( void ) xSemaphoreGive( wakeSemaphore );
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+void EXE_NotifyFromISR( EXE_Coroutine_t *ptrCo,
+                        const uint32_t bits,
+                        BaseType_t *ptrHigherPriorityTaskWoken )
+{
+    UBaseType_t savedInterruptStatus;
+
+    configASSERT( ptrCo );
+
+    savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    {
+        ptrCo->pendingBits |= bits;
+    }
+    taskEXIT_CRITICAL_FROM_ISR( savedInterruptStatus );
+
+    if( wakeSemaphore != NULL )
+    {
+        ( void ) xSemaphoreGiveFromISR( wakeSemaphore, ptrHigherPriorityTaskWoken );
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+void EXE_PrepareWait( EXE_Coroutine_t *ptrCo,
+                      const EXE_Wait_t waitType,
+                      EXE_Queue_t *ptrQueue,
+                      void *ptrItem,
+                      const uint32_t mask,
+                      const TickType_t timeoutTicks )
+{
+    configASSERT( ptrCo );
+    configASSERT( ( waitType != EXE_WAIT_QUEUE ) || ( ( ptrQueue != NULL ) && ( ptrItem != NULL ) ) );
+
+    ptrCo->waitType = waitType;
+    ptrCo->waitStartTicks = xTaskGetTickCount();
+    ptrCo->waitTimeoutTicks = timeoutTicks;
+    ptrCo->ptrWaitQueue = ptrQueue;
+    ptrCo->ptrWaitItem = ptrItem;
+    ptrCo->waitMask = mask;
+    ptrCo->isWaitSatisfied = false;
+    ptrCo->receivedBits = 0u;
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static void prvExecutorTask( void *ptrParameters )
+{
+    TickType_t ticksToWait = DONT_BLOCK;
+    TickType_t coroutineTicksToWait;
+    TickType_t nowTicks;
+    QueueSetMemberHandle_t member;
+    EXE_Coroutine_t *ptrCo;
+    EXE_Coroutine_t *ptrPrevious;
+    EXE_Coroutine_t *ptrNext;
+
+    ( void ) ptrParameters;
+
+    for( ;; )
+    {
+        // Sleep until a registered queue receives data, a coroutine is
+        // notified or the nearest deadline passes, then consume every event
+        // that is pending so the queue set never fills up.
+        member = xQueueSelectFromSet( queueSet, ticksToWait );
+        while( member != NULL )
+        {
+            prvDispatchSetMember( member );
+            member = xQueueSelectFromSet( queueSet, DONT_BLOCK );
+        }
+
+        // Run every coroutine whose wait is over, once each, and work out how
+        // long the executor can sleep for.
+        ticksToWait = portMAX_DELAY;
+        nowTicks = xTaskGetTickCount();
+        ptrPrevious = NULL;
+        ptrCo = ptrCoroutineHead;
+
+        while( ptrCo != NULL )
+        {
+            ptrNext = ptrCo->ptrNext;
+            coroutineTicksToWait = portMAX_DELAY;
+
+            if( prvIsReady( ptrCo, nowTicks, &coroutineTicksToWait ) )
+            {
+                if( ptrCo->ptrHandler( ptrCo, ptrCo->ptrContext ) == EXE_STATUS_DONE )
+                {
+                    // unlink the finished coroutine, it may have added others
+                    // to the tail so re-read its next pointer
+                    ptrNext = ptrCo->ptrNext;
+                    if( ptrPrevious == NULL )
+                    {
+                        ptrCoroutineHead = ptrNext;
+                    }
+                    else
+                    {
+                        ptrPrevious->ptrNext = ptrNext;
+                    }
+
+                    if( ptrCoroutineTail == ptrCo )
+                    {
+                        ptrCoroutineTail = ptrPrevious;
+                    }
+
+                    ptrCo = ptrNext;
+                    continue;
+                }
+
+                // Re-check immediately so a wait that is already satisfied
+                // (or a yield) is picked up without blocking.
+                coroutineTicksToWait = DONT_BLOCK;
+            }
+
+            if( coroutineTicksToWait < ticksToWait )
+            {
+                ticksToWait = coroutineTicksToWait;
+            }
+
+            ptrPrevious = ptrCo;
+            ptrCo = ptrCo->ptrNext;
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvDispatchSetMember( QueueSetMemberHandle_t member )
+{
+    EXE_Queue_t *ptrQueue;
+
+    if( member == ( QueueSetMemberHandle_t ) wakeSemaphore )
+    {
+        ( void ) xSemaphoreTake( wakeSemaphore, DONT_BLOCK );
+    }
+    else
+    {
+        // Each queue set event stands for exactly one item in the queue.  The
+        // item is left in the queue until a coroutine awaits it.
+        for( ptrQueue = ptrQueueHead; ptrQueue != NULL; ptrQueue = ptrQueue->ptrNext )
+        {
+            if( member == ( QueueSetMemberHandle_t ) ptrQueue->handle )
+            {
+                ptrQueue->pendingItems++;
+                break;
+            }
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvIsReady( EXE_Coroutine_t *ptrCo,
+                        const TickType_t nowTicks,
+                        TickType_t *ptrTicksToWait )
+{
+    bool isReady = false;
+    const TickType_t elapsedTicks = nowTicks - ptrCo->waitStartTicks;
+    const bool hasTimeout = ( ptrCo->waitTimeoutTicks != portMAX_DELAY );
+    const bool isTimedOut = hasTimeout && ( elapsedTicks >= ptrCo->waitTimeoutTicks );
+
+    switch( ptrCo->waitType )
+    {
+        case EXE_WAIT_NONE:
+            ptrCo->isWaitSatisfied = true;
+            isReady = true;
+            break;
+
+        case EXE_WAIT_QUEUE:
+            if( ptrCo->ptrWaitQueue->pendingItems > 0u )
+            {
+                if( xQueueReceive( ptrCo->ptrWaitQueue->handle, ptrCo->ptrWaitItem, DONT_BLOCK ) == pdPASS )
+                {
+                    ptrCo->ptrWaitQueue->pendingItems--;
+                    ptrCo->isWaitSatisfied = true;
+                    isReady = true;
+                }
+            }
+            break;
+
+        case EXE_WAIT_NOTIFY:
+            taskENTER_CRITICAL();
+            {
+                ptrCo->receivedBits = ptrCo->pendingBits & ptrCo->waitMask;
+                ptrCo->pendingBits &= ~ptrCo->receivedBits;
+            }
+            taskEXIT_CRITICAL();
+
+            if( ptrCo->receivedBits != 0u )
+            {
+                ptrCo->isWaitSatisfied = true;
+                isReady = true;
+            }
+            break;
+
+        case EXE_WAIT_DELAY:
+        default:
+            break;
+    }
+
+    if( !isReady && isTimedOut )
+    {
+        // A delay "succeeds" when it times out; the other waits have failed.
+        ptrCo->isWaitSatisfied = ( ptrCo->waitType == EXE_WAIT_DELAY );
+        isReady = true;
+    }
+
+    if( !isReady && hasTimeout )
+    {
+        *ptrTicksToWait = ptrCo->waitTimeoutTicks - elapsedTicks;
+    }
+
+    if( isReady )
+    {
+        ptrCo->waitType = EXE_WAIT_NONE;
+    }
+
+    return isReady;
+}
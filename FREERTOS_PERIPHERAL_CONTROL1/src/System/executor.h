@@ -0,0 +1,241 @@
+/*
+ * @file executor.h
+ *
+ * @brief Header file for the stackless coroutine executor
+ *
+ * Many small I/O handlers can share the stack of a single executor task.  Each
+ * handler is a function written between EXE_BEGIN() and EXE_END() that gives
+ * up the CPU at explicit await points (queue data, notification bits, delays).
+ * The handler returns at an await point and is re-entered at the same place
+ * once the awaited event occurs, so local variables do NOT survive an await;
+ * keep any state that must persist in the handler's context structure.
+ *
+ * Only one await macro can be used per source line.
+ *
+ * Example:
+ *
+ *     static EXE_Status_t EchoHandler( EXE_Coroutine_t *ptrCo, void *ptrContext )
+ *     {
+ *         Echo_t *ptrEcho = ptrContext;
+ *
+ *         EXE_BEGIN( ptrCo );
+ *         for( ;; )
+ *         {
+ *             EXE_AWAIT_QUEUE( ptrCo, &ptrEcho->rxQueue, &ptrEcho->byte, portMAX_DELAY );
+ *             EXE_AWAIT_DELAY( ptrCo, 2u );
+ *             ...
+ *         }
+ *         EXE_END( ptrCo );
+ *     }
+ */
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before executor.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before executor.h"
+#endif
+
+#ifndef INC_FREERTOS_H
+    #error "Must include FreeRTOS.h before executor.h"
+#endif
+
+#if ( configUSE_QUEUE_SETS != 1 )
+    #error "configUSE_QUEUE_SETS must be set to 1 in FreeRTOSConfig.h to use executor.h"
+#endif
+
+#include "queue.h"
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef enum
+{
+    EXE_STATUS_WAITING = 0,     // stopped at an await point
+    EXE_STATUS_DONE             // reached EXE_END(), the coroutine is removed
+} EXE_Status_t;
+
+typedef enum
+{
+    EXE_WAIT_NONE = 0,          // ready to run (yielded)
+    EXE_WAIT_DELAY,
+    EXE_WAIT_QUEUE,
+    EXE_WAIT_NOTIFY
+} EXE_Wait_t;
+
+// A queue a coroutine can await.  Registered with EXE_AddQueue().
+typedef struct EXE_Queue
+{
+    QueueHandle_t handle;
+    UBaseType_t pendingItems;   // items signalled by the queue set but not yet received
+    struct EXE_Queue *ptrNext;
+} EXE_Queue_t;
+
+struct EXE_Coroutine;
+typedef EXE_Status_t (*EXE_Handler_t)( struct EXE_Coroutine *ptrCo, void *ptrContext );
+
+// Coroutine control block.  Allocated by the caller; the members are private
+// to the executor and the macros below.
+typedef struct EXE_Coroutine
+{
+    EXE_Handler_t ptrHandler;
+    void *ptrContext;
+    uint32_t resumePoint;
+
+    EXE_Wait_t waitType;
+    TickType_t waitStartTicks;
+    TickType_t waitTimeoutTicks;
+    EXE_Queue_t *ptrWaitQueue;
+    void *ptrWaitItem;
+    uint32_t waitMask;
+    bool isWaitSatisfied;
+
+    volatile uint32_t pendingBits;
+    uint32_t receivedBits;
+
+    struct EXE_Coroutine *ptrNext;
+} EXE_Coroutine_t;
+
+
+/*------------------------------------------------------------
+                      Coroutine Macros
+-------------------------------------------------------------*/
+// Must be the first statement of a handler.
+#define EXE_BEGIN( ptrCo )                  switch( ( ptrCo )->resumePoint ) { case 0u:
+
+// Must be the last statement of a handler.
+#define EXE_END( ptrCo )                    } ( ptrCo )->resumePoint = 0u; return EXE_STATUS_DONE
+
+// Internal: describe the wait, record where to resume and return to the
+// executor.  Execution continues after the macro once the wait is over.
+#define EXE_AWAIT_( ptrCo, waitType, ptrQueue, ptrItem, mask, ticks )         \
+    do                                                                        \
+    {                                                                         \
+        EXE_PrepareWait( ( ptrCo ), ( waitType ), ( ptrQueue ), ( ptrItem ),   \
+                         ( mask ), ( ticks ) );                               \
+        ( ptrCo )->resumePoint = ( uint32_t ) __LINE__;                       \
+        return EXE_STATUS_WAITING;                                            \
+        case __LINE__: ;                                                      \
+    } while( 0 )
+
+// Let the other ready coroutines run before continuing.
+#define EXE_YIELD( ptrCo )                                                    \
+    EXE_AWAIT_( ptrCo, EXE_WAIT_NONE, NULL, NULL, 0u, 0u )
+
+// Wait for ticks to pass.
+#define EXE_AWAIT_DELAY( ptrCo, ticks )                                       \
+    EXE_AWAIT_( ptrCo, EXE_WAIT_DELAY, NULL, NULL, 0u, ticks )
+
+// Wait for an item from ptrQueue to be copied to ptrItem, or for ticks to pass.
+// EXE_AWAIT_SUCCEEDED() is false if the wait timed out.
+#define EXE_AWAIT_QUEUE( ptrCo, ptrQueue, ptrItem, ticks )                    \
+    EXE_AWAIT_( ptrCo, EXE_WAIT_QUEUE, ptrQueue, ptrItem, 0u, ticks )
+
+// Wait for any of the bits in mask to be set by EXE_Notify(), or for ticks to
+// pass.  The bits that were set (and are now cleared) are in EXE_RECEIVED_BITS().
+#define EXE_AWAIT_NOTIFY( ptrCo, mask, ticks )                                \
+    EXE_AWAIT_( ptrCo, EXE_WAIT_NOTIFY, NULL, NULL, mask, ticks )
+
+#define EXE_AWAIT_SUCCEEDED( ptrCo )        ( ( ptrCo )->isWaitSatisfied )
+#define EXE_RECEIVED_BITS( ptrCo )          ( ( ptrCo )->receivedBits )
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function EXE_AddQueue
+ *
+ * @brief Register a queue so coroutines can await it.  Must be called before
+ *        EXE_Start(), while the queue is empty.  Once registered, the queue must
+ *        only be read by coroutines using EXE_AWAIT_QUEUE().
+ *
+ * @param ptrQueue - executor queue object to initialize
+ * @param queueHandle - the FreeRTOS queue to register
+ *
+ * @return bool - true if the queue was registered, false otherwise
+ */
+bool EXE_AddQueue( EXE_Queue_t *ptrQueue, QueueHandle_t queueHandle );
+
+/**
+ * @function EXE_AddCoroutine
+ *
+ * @brief Add a coroutine to the executor.  Must be called before EXE_Start()
+ *        or from a coroutine already running on the executor.
+ *
+ * @param ptrCo - coroutine control block to initialize
+ * @param ptrHandler - the coroutine function
+ * @param ptrContext - passed to every call of ptrHandler
+ *
+ * @return bool - true if the coroutine was added, false otherwise
+ */
+bool EXE_AddCoroutine( EXE_Coroutine_t *ptrCo,
+                       EXE_Handler_t ptrHandler,
+                       void *ptrContext );
+
+/**
+ * @function EXE_Start
+ *
+ * @brief Create the executor task that runs every added coroutine
+ *
+ * @param stackDepth - stack size of the executor task in words, shared by all coroutines
+ * @param priority - priority of the executor task
+ *
+ * @return bool - true if the executor task was created, false otherwise
+ */
+bool EXE_Start( const uint16_t stackDepth, const UBaseType_t priority );
+
+/**
+ * @function EXE_Notify
+ *
+ * @brief Set notification bits on a coroutine, waking it if it awaits any of them
+ *
+ * @param ptrCo - the coroutine to notify
+ * @param bits - the bits to set
+ *
+ * @return void (no return value)
+ */
+void EXE_Notify( EXE_Coroutine_t *ptrCo, const uint32_t bits );
+
+/**
+ * @function EXE_NotifyFromISR
+ *
+ * @brief Interrupt safe version of EXE_Notify()
+ *
+ * @param ptrCo - the coroutine to notify
+ * @param bits - the bits to set
+ * @param ptrHigherPriorityTaskWoken - set to pdTRUE if a context switch should be requested
+ *
+ * @return void (no return value)
+ */
+void EXE_NotifyFromISR( EXE_Coroutine_t *ptrCo,
+                        const uint32_t bits,
+                        BaseType_t *ptrHigherPriorityTaskWoken );
+
+/**
+ * @function EXE_PrepareWait
+ *
+ * @brief Used by the await macros to describe what a coroutine is waiting for
+ *
+ * @param ptrCo - the waiting coroutine
+ * @param waitType - the kind of event awaited
+ * @param ptrQueue - the queue for EXE_WAIT_QUEUE, NULL otherwise
+ * @param ptrItem - where to copy the received item for EXE_WAIT_QUEUE, NULL otherwise
+ * @param mask - the notification bits for EXE_WAIT_NOTIFY, 0 otherwise
+ * @param timeoutTicks - maximum wait, portMAX_DELAY to wait forever
+ *
+ * @return void (no return value)
+ */
+void EXE_PrepareWait( EXE_Coroutine_t *ptrCo,
+                      const EXE_Wait_t waitType,
+                      EXE_Queue_t *ptrQueue,
+                      void *ptrItem,
+                      const uint32_t mask,
+                      const TickType_t timeoutTicks );
+
+#endif /* EXECUTOR_H_ */
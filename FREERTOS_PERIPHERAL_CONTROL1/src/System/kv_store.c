@@ -0,0 +1,859 @@
+/*
+ * @file kv_store.c
+ *
+ * @brief Log-structured key-value store
+ *
+ * Each segment starts with a header holding a magic number and a generation,
+ * written only once the segment's records are in the EEPROM.  The segment
+ * with the newest valid header holds the log, so a compaction cut short by a
+ * power failure leaves the previous log in place.
+ *
+ * A record is a six byte header (key, value length, flags, CRC16) followed by
+ * the value.  The log ends at the first erased (0xFF) key, or at the first
+ * record that fails its checks.  A damaged record may be followed by others
+ * written back out of order by the cache, so a log found damaged is compacted
+ * straight away and never appended to.
+ */
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+#include "string.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+// this file's header
+#include "kv_store.h"
+
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+#define COMPACTION_TASK_NAME "KVCompact"
+
+#define SEGMENT_HEADER_SIZE (16u)
+#define SEGMENT_MAGIC (0x3153564Bu)     // "KVS1"
+
+#define RECORD_HEADER_SIZE (6u)
+#define RECORD_FLAG_DELETED (0x01u)
+#define RECORD_FLAGS_MASK (RECORD_FLAG_DELETED)
+
+#define INDEX_EMPTY (0u)
+#define INDEX_USED (1u)
+#define INDEX_DELETED (2u)
+
+// Bytes written at a time when erasing a segment
+#define ERASE_CHUNK_SIZE (16u)
+
+// Stale log bytes that make a background compaction worth doing
+#define COMPACT_MIN_STALE_BYTES ( KVS_SEGMENT_SIZE / 4u )
+
+#define CRC16_INITIAL (0xFFFFu)
+
+#if ( ( KVS_SEGMENT_SIZE % EEP_PAGE_SIZE ) != 0u )
+    #error "KVS_SEGMENT_SIZE must be a multiple of EEP_PAGE_SIZE"
+#endif
+
+#if ( ( KVS_MAX_KEYS & ( KVS_MAX_KEYS - 1u ) ) != 0u )
+    #error "KVS_MAX_KEYS must be a power of two"
+#endif
+
+#if ( SEGMENT_HEADER_SIZE + KVS_MAX_KEYS * ( RECORD_HEADER_SIZE + KVS_MAX_VALUE_SIZE ) ) > KVS_SEGMENT_SIZE
+    #error "A full store does not fit in one segment"
+#endif
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static void prvCompactionTask( void *ptrParameters );
+static bool prvMount( KVS_Store_t *ptrStore );
+static bool prvScan( KVS_Store_t *ptrStore, bool *ptrIsDamaged );
+static bool prvCompact( KVS_Store_t *ptrStore );
+static bool prvEraseSegment( KVS_Store_t *ptrStore, const uint32_t segment );
+static bool prvEraseNextPage( KVS_Store_t *ptrStore, const uint32_t segment, const uint32_t offset );
+static bool prvWriteSegmentHeader( KVS_Store_t *ptrStore, const uint32_t segment, const uint32_t generation );
+static bool prvAppend( KVS_Store_t *ptrStore, const uint16_t key, const uint8_t flags, const uint8_t *ptrValue, const uint32_t length );
+static bool prvIsWorthCompacting( const KVS_Store_t *ptrStore );
+static KVS_IndexEntry_t *prvFind( KVS_Store_t *ptrStore, const uint16_t key );
+static KVS_IndexEntry_t *prvInsert( KVS_Store_t *ptrStore, const uint16_t key );
+static void prvRemove( KVS_Store_t *ptrStore, KVS_IndexEntry_t *ptrEntry );
+static uint32_t prvSegmentAddress( const KVS_Store_t *ptrStore, const uint32_t segment );
+static uint16_t prvCrc16( uint16_t crc, const uint8_t *ptrData, const uint32_t length );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+bool KVS_Init( KVS_Store_t *ptrStore,
+               EEP_Cache_t *ptrCache,
+               const uint32_t baseAddress,
+               const uint32_t size )
+{
+    // check parameters are valid
+    bool isValid = ( ptrStore != NULL );
+    isValid = isValid && ( ptrCache != NULL );
+    isValid = isValid && ( ( baseAddress % EEP_PAGE_SIZE ) == 0u );
+    isValid = isValid && ( ( size / KVS_SEGMENT_SIZE ) >= 2u );
+
+    if( isValid )
+    {
+        memset( ptrStore, 0, sizeof( *ptrStore ) );
+        ptrStore->ptrCache = ptrCache;
+        ptrStore->baseAddress = baseAddress;
+        ptrStore->segmentCount = size / KVS_SEGMENT_SIZE;
+
+        ptrStore->mutex = xSemaphoreCreateMutex();
+        isValid = ( ptrStore->mutex != NULL );
+    }
+
+    if( isValid )
+    {
+        vQueueAddToRegistry( ptrStore->mutex, "KV store" );
+        isValid = prvMount( ptrStore );
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool KVS_StartCompactionTask( KVS_Store_t *ptrStore,
+                              const uint16_t stackDepth,
+                              const UBaseType_t priority )
+{
+    // check parameters are valid
+    bool isValid = ( ptrStore != NULL );
+    isValid = isValid && ( ptrStore->compactionTask == NULL );
+
+    if( isValid )
+    {
+        isValid = ( xTaskCreate( prvCompactionTask,
+                                 COMPACTION_TASK_NAME,
+                                 stackDepth,
+                                 ptrStore,
+                                 priority,
+                                 &ptrStore->compactionTask ) == pdPASS );
+    }
+
+    if( isValid )
+    {
+        // the segment after the log may not have been erased yet
+        xTaskNotifyGive( ptrStore->compactionTask );
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool KVS_Set( KVS_Store_t *ptrStore,
+              const uint16_t key,
+              const void *ptrValue,
+              const uint32_t length,
+              const TickType_t timeoutTicks )
+{
+    uint8_t stored[ KVS_MAX_VALUE_SIZE ];
+    KVS_IndexEntry_t *ptrEntry;
+    bool isStored = false;
+
+    // check parameters are valid
+    bool isValid = ( ptrStore != NULL );
+    isValid = isValid && ( key != KVS_INVALID_KEY );
+    isValid = isValid && ( ( ptrValue != NULL ) || ( length == 0u ) );
+    isValid = isValid && ( length <= KVS_MAX_VALUE_SIZE );
+
+    if( !isValid || ( xSemaphoreTake( ptrStore->mutex, timeoutTicks ) != pdTRUE ) )
+    {
+        return false;
+    }
+
+    ptrEntry = prvFind( ptrStore, key );
+
+    // rewriting the same value would only wear the EEPROM
+    if( ( ptrEntry != NULL ) && ( ptrEntry->length == length ) &&
+        ( ( length == 0u ) ||
+          ( EEP_Read( ptrStore->ptrCache,
+                      prvSegmentAddress( ptrStore, ptrStore->activeSegment ) + ptrEntry->offset + RECORD_HEADER_SIZE,
+                      stored, length, portMAX_DELAY ) &&
+            ( memcmp( stored, ptrValue, length ) == 0 ) ) ) )
+    {
+        ptrStore->unchangedWrites++;
+        isStored = true;
+    }
+    else if( ( ptrEntry != NULL ) || ( ptrStore->keyCount < KVS_MAX_KEYS ) )
+    {
+        isStored = prvAppend( ptrStore, key, 0u, ptrValue, length );
+    }
+
+    ( void ) xSemaphoreGive( ptrStore->mutex );
+
+    return isStored;
+}
+
+
+/*-----------------------------------------------------------*/
+bool KVS_Get( KVS_Store_t *ptrStore,
+              const uint16_t key,
+              void *ptrValue,
+              const uint32_t maxLength,
+              uint32_t *ptrLength,
+              const TickType_t timeoutTicks )
+{
+    KVS_IndexEntry_t *ptrEntry;
+    uint32_t length;
+    bool isFound = false;
+
+    // check parameters are valid
+    bool isValid = ( ptrStore != NULL );
+    isValid = isValid && ( ( ptrValue != NULL ) || ( maxLength == 0u ) );
+
+    if( !isValid || ( xSemaphoreTake( ptrStore->mutex, timeoutTicks ) != pdTRUE ) )
+    {
+        return false;
+    }
+
+    ptrEntry = prvFind( ptrStore, key );
+
+    if( ptrEntry != NULL )
+    {
+        length = ( ptrEntry->length < maxLength ) ? ptrEntry->length : maxLength;
+
+        if( ptrLength != NULL )
+        {
+            *ptrLength = ptrEntry->length;
+        }
+
+        isFound = ( length == 0u ) ||
+                  EEP_Read( ptrStore->ptrCache,
+                            prvSegmentAddress( ptrStore, ptrStore->activeSegment ) + ptrEntry->offset + RECORD_HEADER_SIZE,
+                            ptrValue, length, portMAX_DELAY );
+    }
+
+    ( void ) xSemaphoreGive( ptrStore->mutex );
+
+    return isFound;
+}
+
+
+/*-----------------------------------------------------------*/
+bool KVS_Delete( KVS_Store_t *ptrStore, const uint16_t key, const TickType_t timeoutTicks )
+{
+    bool isDeleted = true;
+
+    if( ( ptrStore == NULL ) || ( xSemaphoreTake( ptrStore->mutex, timeoutTicks ) != pdTRUE ) )
+    {
+        return false;
+    }
+
+    if( prvFind( ptrStore, key ) != NULL )
+    {
+        isDeleted = prvAppend( ptrStore, key, RECORD_FLAG_DELETED, NULL, 0u );
+    }
+
+    ( void ) xSemaphoreGive( ptrStore->mutex );
+
+    return isDeleted;
+}
+
+
+/*-----------------------------------------------------------*/
+bool KVS_Sync( KVS_Store_t *ptrStore, const TickType_t timeoutTicks )
+{
+    bool isSynced;
+
+    if( ( ptrStore == NULL ) || ( xSemaphoreTake( ptrStore->mutex, timeoutTicks ) != pdTRUE ) )
+    {
+        return false;
+    }
+
+    isSynced = EEP_Flush( ptrStore->ptrCache, portMAX_DELAY );
+
+    ( void ) xSemaphoreGive( ptrStore->mutex );
+
+    return isSynced;
+}
+
+
+/*-----------------------------------------------------------*/
+bool KVS_Compact( KVS_Store_t *ptrStore, const TickType_t timeoutTicks )
+{
+    bool isCompacted;
+
+    if( ( ptrStore == NULL ) || ( xSemaphoreTake( ptrStore->mutex, timeoutTicks ) != pdTRUE ) )
+    {
+        return false;
+    }
+
+    isCompacted = prvCompact( ptrStore );
+
+    ( void ) xSemaphoreGive( ptrStore->mutex );
+
+    return isCompacted;
+}
+
+
+/*-----------------------------------------------------------*/
+bool KVS_Close( KVS_Store_t *ptrStore, const TickType_t timeoutTicks )
+{
+    bool isClosed;
+
+    // a store with a compaction task stays open, as the task uses it
+    if( ( ptrStore == NULL ) || ( ptrStore->compactionTask != NULL ) ||
+        ( xSemaphoreTake( ptrStore->mutex, timeoutTicks ) != pdTRUE ) )
+    {
+        return false;
+    }
+
+    isClosed = EEP_Flush( ptrStore->ptrCache, portMAX_DELAY );
+
+    ( void ) xSemaphoreGive( ptrStore->mutex );
+
+    if( isClosed )
+    {
+        vSemaphoreDelete( ptrStore->mutex );
+        ptrStore->mutex = NULL;
+    }
+
+    return isClosed;
+}
+
+
+/*-----------------------------------------------------------*/
+void KVS_GetStats( KVS_Store_t *ptrStore, KVS_Stats_t *ptrStats )
+{
+    configASSERT( ptrStore );
+    configASSERT( ptrStats );
+
+    taskENTER_CRITICAL();
+    {
+        ptrStats->keys = ptrStore->keyCount;
+        ptrStats->liveBytes = ptrStore->liveBytes;
+        ptrStats->usedBytes = ptrStore->appendOffset;
+        ptrStats->segmentCount = ptrStore->segmentCount;
+        ptrStats->activeSegment = ptrStore->activeSegment;
+        ptrStats->generation = ptrStore->generation;
+        ptrStats->appends = ptrStore->appends;
+        ptrStats->unchangedWrites = ptrStore->unchangedWrites;
+        ptrStats->compactions = ptrStore->compactions;
+        ptrStats->crcErrors = ptrStore->crcErrors;
+    }
+    taskEXIT_CRITICAL();
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static void prvCompactionTask( void *ptrParameters )
+{
+    KVS_Store_t *ptrStore = ptrParameters;
+    uint32_t segment;
+    uint32_t offset;
+    bool isErasing;
+
+    for( ;; )
+    {
+        ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+        ( void ) xSemaphoreTake( ptrStore->mutex, portMAX_DELAY );
+        {
+            if( prvIsWorthCompacting( ptrStore ) )
+            {
+                ( void ) prvCompact( ptrStore );
+            }
+
+            segment = ( ptrStore->activeSegment + 1u ) % ptrStore->segmentCount;
+            isErasing = !ptrStore->isNextErased;
+        }
+        ( void ) xSemaphoreGive( ptrStore->mutex );
+
+        // Erase the segment the next compaction will use, one page at a time
+        // so writers are only held up for a page.  A compaction in the
+        // meantime erases the segment itself and moves the log, which stops
+        // this erase.
+        for( offset = 0u; isErasing && ( offset < KVS_SEGMENT_SIZE ); offset += EEP_PAGE_SIZE )
+        {
+            ( void ) xSemaphoreTake( ptrStore->mutex, portMAX_DELAY );
+            {
+                isErasing = ( segment == ( ( ptrStore->activeSegment + 1u ) % ptrStore->segmentCount ) ) &&
+                            !ptrStore->isNextErased &&
+                            prvEraseNextPage( ptrStore, segment, offset );
+
+                if( isErasing && ( ( offset + EEP_PAGE_SIZE ) == KVS_SEGMENT_SIZE ) )
+                {
+                    ptrStore->isNextErased = true;
+                }
+            }
+            ( void ) xSemaphoreGive( ptrStore->mutex );
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvMount( KVS_Store_t *ptrStore )
+{
+    uint8_t header[ SEGMENT_HEADER_SIZE ];
+    uint32_t segment;
+    uint32_t magic;
+    uint32_t generation;
+    bool isFound = false;
+    bool isDamaged = false;
+    bool isMounted;
+
+    // the log is in the segment with the newest valid header
+    for( segment = 0u; segment < ptrStore->segmentCount; segment++ )
+    {
+        if( !EEP_Read( ptrStore->ptrCache, prvSegmentAddress( ptrStore, segment ),
+                       header, SEGMENT_HEADER_SIZE, portMAX_DELAY ) )
+        {
+            return false;
+        }
+
+        memcpy( &magic, &header[ 0 ], sizeof( magic ) );
+        memcpy( &generation, &header[ 4 ], sizeof( generation ) );
+
+        if( ( magic == SEGMENT_MAGIC ) &&
+            ( prvCrc16( CRC16_INITIAL, header, 8u ) == ( uint16_t ) ( header[ 8 ] | ( header[ 9 ] << 8 ) ) ) &&
+            ( !isFound || ( ( int32_t ) ( generation - ptrStore->generation ) > 0 ) ) )
+        {
+            ptrStore->activeSegment = segment;
+            ptrStore->generation = generation;
+            isFound = true;
+        }
+    }
+
+    if( !isFound )
+    {
+        // a new store
+        ptrStore->activeSegment = 0u;
+        ptrStore->generation = 0u;
+        ptrStore->appendOffset = SEGMENT_HEADER_SIZE;
+
+        isMounted = prvEraseSegment( ptrStore, 0u ) &&
+                    EEP_Flush( ptrStore->ptrCache, portMAX_DELAY ) &&
+                    prvWriteSegmentHeader( ptrStore, 0u, 0u ) &&
+                    EEP_Flush( ptrStore->ptrCache, portMAX_DELAY );
+    }
+    else
+    {
+        isMounted = prvScan( ptrStore, &isDamaged );
+
+        if( isMounted && isDamaged )
+        {
+            isMounted = prvCompact( ptrStore );
+        }
+    }
+
+    return isMounted;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvScan( KVS_Store_t *ptrStore, bool *ptrIsDamaged )
+{
+    uint8_t record[ RECORD_HEADER_SIZE + KVS_MAX_VALUE_SIZE ];
+    uint32_t segmentAddress = prvSegmentAddress( ptrStore, ptrStore->activeSegment );
+    uint32_t offset = SEGMENT_HEADER_SIZE;
+    uint16_t key;
+    uint32_t length;
+    uint8_t flags;
+    KVS_IndexEntry_t *ptrEntry;
+    bool isEnd = false;
+
+    *ptrIsDamaged = false;
+
+    while( !isEnd && ( ( offset + RECORD_HEADER_SIZE ) <= KVS_SEGMENT_SIZE ) )
+    {
+        if( !EEP_Read( ptrStore->ptrCache, segmentAddress + offset,
+                       record, RECORD_HEADER_SIZE, portMAX_DELAY ) )
+        {
+            return false;
+        }
+
+        key = ( uint16_t ) ( record[ 0 ] | ( record[ 1 ] << 8 ) );
+        length = record[ 2 ];
+        flags = record[ 3 ];
+
+        if( key == KVS_INVALID_KEY )
+        {
+            // erased, the end of the log
+            isEnd = true;
+        }
+        else if( ( ( flags & ~RECORD_FLAGS_MASK ) != 0u ) ||
+                 ( length > KVS_MAX_VALUE_SIZE ) ||
+                 ( ( offset + RECORD_HEADER_SIZE + length ) > KVS_SEGMENT_SIZE ) )
+        {
+            *ptrIsDamaged = true;
+        }
+        else if( !EEP_Read( ptrStore->ptrCache, segmentAddress + offset + RECORD_HEADER_SIZE,
+                            &record[ RECORD_HEADER_SIZE ], length, portMAX_DELAY ) )
+        {
+            return false;
+        }
+        else if( prvCrc16( prvCrc16( CRC16_INITIAL, record, 4u ), &record[ RECORD_HEADER_SIZE ], length ) !=
+                 ( uint16_t ) ( record[ 4 ] | ( record[ 5 ] << 8 ) ) )
+        {
+            ptrStore->crcErrors++;
+            *ptrIsDamaged = true;
+        }
+        else
+        {
+            ptrEntry = prvFind( ptrStore, key );
+
+            if( ptrEntry != NULL )
+            {
+                ptrStore->liveBytes -= RECORD_HEADER_SIZE + ptrEntry->length;
+            }
+
+            if( ( flags & RECORD_FLAG_DELETED ) != 0u )
+            {
+                if( ptrEntry != NULL )
+                {
+                    prvRemove( ptrStore, ptrEntry );
+                }
+            }
+            else
+            {
+                if( ptrEntry == NULL )
+                {
+                    ptrEntry = prvInsert( ptrStore, key );
+                }
+
+                // more keys than the index holds means the log is not ours
+                if( ptrEntry == NULL )
+                {
+                    *ptrIsDamaged = true;
+                }
+                else
+                {
+                    ptrEntry->offset = ( uint16_t ) offset;
+                    ptrEntry->length = ( uint8_t ) length;
+                    ptrStore->liveBytes += RECORD_HEADER_SIZE + length;
+                }
+            }
+
+            offset += RECORD_HEADER_SIZE + length;
+        }
+
+        isEnd = isEnd || *ptrIsDamaged;
+    }
+
+    ptrStore->appendOffset = offset;
+
+    return true;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvCompact( KVS_Store_t *ptrStore )
+{
+    uint8_t record[ RECORD_HEADER_SIZE + KVS_MAX_VALUE_SIZE ];
+    uint16_t newOffsets[ KVS_MAX_KEYS ];
+    uint32_t fromAddress = prvSegmentAddress( ptrStore, ptrStore->activeSegment );
+    uint32_t target = ( ptrStore->activeSegment + 1u ) % ptrStore->segmentCount;
+    uint32_t toAddress = prvSegmentAddress( ptrStore, target );
+    uint32_t offset = SEGMENT_HEADER_SIZE;
+    uint32_t size;
+    uint32_t slot;
+    KVS_IndexEntry_t *ptrEntry;
+    bool isCompacted = ptrStore->isNextErased || prvEraseSegment( ptrStore, target );
+
+    // copy the latest record of each key, which are known to be intact
+    for( slot = 0u; isCompacted && ( slot < KVS_MAX_KEYS ); slot++ )
+    {
+        ptrEntry = &ptrStore->index[ slot ];
+
+        if( ptrEntry->state == INDEX_USED )
+        {
+            size = RECORD_HEADER_SIZE + ptrEntry->length;
+            newOffsets[ slot ] = ( uint16_t ) offset;
+
+            isCompacted = EEP_Read( ptrStore->ptrCache, fromAddress + ptrEntry->offset,
+                                    record, size, portMAX_DELAY ) &&
+                          EEP_Write( ptrStore->ptrCache, toAddress + offset,
+                                     record, size, portMAX_DELAY );
+
+            offset += size;
+        }
+    }
+
+    // The records must be in the EEPROM before the header that makes the
+    // segment the log, and the header before the old log can be reused.
+    isCompacted = isCompacted &&
+                  EEP_Flush( ptrStore->ptrCache, portMAX_DELAY ) &&
+                  prvWriteSegmentHeader( ptrStore, target, ptrStore->generation + 1u ) &&
+                  EEP_Flush( ptrStore->ptrCache, portMAX_DELAY );
+
+    // the target is no longer erased whether or not this worked
+    ptrStore->isNextErased = false;
+
+    if( isCompacted )
+    {
+        for( slot = 0u; slot < KVS_MAX_KEYS; slot++ )
+        {
+            if( ptrStore->index[ slot ].state == INDEX_USED )
+            {
+                ptrStore->index[ slot ].offset = newOffsets[ slot ];
+            }
+        }
+
+        ptrStore->activeSegment = target;
+        ptrStore->generation++;
+        ptrStore->appendOffset = offset;
+        ptrStore->compactions++;
+
+        // let the compaction task erase the segment after this one
+        if( ptrStore->compactionTask != NULL )
+        {
+            xTaskNotifyGive( ptrStore->compactionTask );
+        }
+    }
+
+    return isCompacted;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvEraseSegment( KVS_Store_t *ptrStore, const uint32_t segment )
+{
+    uint32_t offset;
+    bool isErased = true;
+
+    for( offset = 0u; isErased && ( offset < KVS_SEGMENT_SIZE ); offset += EEP_PAGE_SIZE )
+    {
+        isErased = prvEraseNextPage( ptrStore, segment, offset );
+    }
+
+    return isErased;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvEraseNextPage( KVS_Store_t *ptrStore, const uint32_t segment, const uint32_t offset )
+{
+    uint8_t erased[ ERASE_CHUNK_SIZE ];
+    uint32_t chunk;
+    bool isErased = true;
+
+    memset( erased, 0xFF, sizeof( erased ) );
+
+    // the cache merges the chunks into a single page write
+    for( chunk = 0u; isErased && ( chunk < EEP_PAGE_SIZE ); chunk += ERASE_CHUNK_SIZE )
+    {
+        isErased = EEP_Write( ptrStore->ptrCache,
+                              prvSegmentAddress( ptrStore, segment ) + offset + chunk,
+                              erased, ERASE_CHUNK_SIZE, portMAX_DELAY );
+    }
+
+    return isErased;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvWriteSegmentHeader( KVS_Store_t *ptrStore, const uint32_t segment, const uint32_t generation )
+{
+    uint8_t header[ SEGMENT_HEADER_SIZE ];
+    uint32_t magic = SEGMENT_MAGIC;
+    uint16_t crc;
+
+    memset( header, 0xFF, sizeof( header ) );
+    memcpy( &header[ 0 ], &magic, sizeof( magic ) );
+    memcpy( &header[ 4 ], &generation, sizeof( generation ) );
+
+    crc = prvCrc16( CRC16_INITIAL, header, 8u );
+    header[ 8 ] = ( uint8_t ) ( crc & 0xFFu );
+    header[ 9 ] = ( uint8_t ) ( crc >> 8 );
+
+    return EEP_Write( ptrStore->ptrCache, prvSegmentAddress( ptrStore, segment ),
+                      header, SEGMENT_HEADER_SIZE, portMAX_DELAY );
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvAppend( KVS_Store_t *ptrStore, const uint16_t key, const uint8_t flags, const uint8_t *ptrValue, const uint32_t length )
+{
+    uint8_t record[ RECORD_HEADER_SIZE + KVS_MAX_VALUE_SIZE ];
+    uint32_t size = RECORD_HEADER_SIZE + length;
+    KVS_IndexEntry_t *ptrEntry;
+    uint16_t crc;
+    bool isAppended = true;
+
+    if( ( ptrStore->appendOffset + size ) > KVS_SEGMENT_SIZE )
+    {
+        // the log is full, so compact now rather than in the background
+        isAppended = prvCompact( ptrStore ) &&
+                     ( ( ptrStore->appendOffset + size ) <= KVS_SEGMENT_SIZE );
+    }
+
+    if( isAppended )
+    {
+        record[ 0 ] = ( uint8_t ) ( key & 0xFFu );
+        record[ 1 ] = ( uint8_t ) ( key >> 8 );
+        record[ 2 ] = ( uint8_t ) length;
+        record[ 3 ] = flags;
+        if( length > 0u )
+        {
+            memcpy( &record[ RECORD_HEADER_SIZE ], ptrValue, length );
+        }
+
+        crc = prvCrc16( prvCrc16( CRC16_INITIAL, record, 4u ), &record[ RECORD_HEADER_SIZE ], length );
+        record[ 4 ] = ( uint8_t ) ( crc & 0xFFu );
+        record[ 5 ] = ( uint8_t ) ( crc >> 8 );
+
+        isAppended = EEP_Write( ptrStore->ptrCache,
+                                prvSegmentAddress( ptrStore, ptrStore->activeSegment ) + ptrStore->appendOffset,
+                                record, size, portMAX_DELAY );
+    }
+
+    if( isAppended )
+    {
+        ptrEntry = prvFind( ptrStore, key );
+
+        if( ptrEntry != NULL )
+        {
+            ptrStore->liveBytes -= RECORD_HEADER_SIZE + ptrEntry->length;
+        }
+
+        if( ( flags & RECORD_FLAG_DELETED ) != 0u )
+        {
+            if( ptrEntry != NULL )
+            {
+                prvRemove( ptrStore, ptrEntry );
+            }
+        }
+        else
+        {
+            if( ptrEntry == NULL )
+            {
+                // KVS_Set() has checked there is room
+                ptrEntry = prvInsert( ptrStore, key );
+                configASSERT( ptrEntry );
+            }
+
+            ptrEntry->offset = ( uint16_t ) ptrStore->appendOffset;
+            ptrEntry->length = ( uint8_t ) length;
+            ptrStore->liveBytes += size;
+        }
+
+        ptrStore->appendOffset += size;
+        ptrStore->appends++;
+
+        if( ( ptrStore->compactionTask != NULL ) && prvIsWorthCompacting( ptrStore ) )
+        {
+            xTaskNotifyGive( ptrStore->compactionTask );
+        }
+    }
+
+    return isAppended;
+}
+
+
+/*-----------------------------------------------------------*/
+static bool prvIsWorthCompacting( const KVS_Store_t *ptrStore )
+{
+    // Only once the log is well used, and only if enough of it is stale that
+    // the compaction frees a useful amount of space.
+    return ( ptrStore->appendOffset >= KVS_COMPACT_THRESHOLD ) &&
+           ( ( ptrStore->appendOffset - SEGMENT_HEADER_SIZE - ptrStore->liveBytes ) >= COMPACT_MIN_STALE_BYTES );
+}
+
+
+/*-----------------------------------------------------------*/
+static KVS_IndexEntry_t *prvFind( KVS_Store_t *ptrStore, const uint16_t key )
+{
+    uint32_t slot = key & ( KVS_MAX_KEYS - 1u );
+    uint32_t probes;
+    KVS_IndexEntry_t *ptrEntry;
+
+    // open addressing with linear probing; deleted slots do not end a search
+    for( probes = 0u; probes < KVS_MAX_KEYS; probes++ )
+    {
+        ptrEntry = &ptrStore->index[ ( slot + probes ) & ( KVS_MAX_KEYS - 1u ) ];
+
+        if( ptrEntry->state == INDEX_EMPTY )
+        {
+            break;
+        }
+
+        if( ( ptrEntry->state == INDEX_USED ) && ( ptrEntry->key == key ) )
+        {
+            return ptrEntry;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*-----------------------------------------------------------*/
+static KVS_IndexEntry_t *prvInsert( KVS_Store_t *ptrStore, const uint16_t key )
+{
+    uint32_t slot = key & ( KVS_MAX_KEYS - 1u );
+    uint32_t probes;
+    KVS_IndexEntry_t *ptrEntry;
+
+    // the caller has checked the key is not already present
+    for( probes = 0u; probes < KVS_MAX_KEYS; probes++ )
+    {
+        ptrEntry = &ptrStore->index[ ( slot + probes ) & ( KVS_MAX_KEYS - 1u ) ];
+
+        if( ptrEntry->state != INDEX_USED )
+        {
+            ptrEntry->key = key;
+            ptrEntry->state = INDEX_USED;
+            ptrStore->keyCount++;
+            return ptrEntry;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvRemove( KVS_Store_t *ptrStore, KVS_IndexEntry_t *ptrEntry )
+{
+    ptrEntry->state = INDEX_DELETED;
+    ptrStore->keyCount--;
+}
+
+
+/*-----------------------------------------------------------*/
+static uint32_t prvSegmentAddress( const KVS_Store_t *ptrStore, const uint32_t segment )
+{
+    return ptrStore->baseAddress + ( segment * KVS_SEGMENT_SIZE );
+}
+
+
+/*-----------------------------------------------------------*/
+static uint16_t prvCrc16( uint16_t crc, const uint8_t *ptrData, const uint32_t length )
+{
+    uint32_t index;
+    uint32_t bit;
+
+    // CRC-16/CCITT, polynomial 0x1021
+    for( index = 0u; index < length; index++ )
+    {
+        crc ^= ( uint16_t ) ( ptrData[ index ] << 8 );
+
+        for( bit = 0u; bit < 8u; bit++ )
+        {
+            crc = ( crc & 0x8000u ) ? ( uint16_t ) ( ( crc << 1 ) ^ 0x1021u ) : ( uint16_t ) ( crc << 1 );
+        }
+    }
+
+    return crc;
+}
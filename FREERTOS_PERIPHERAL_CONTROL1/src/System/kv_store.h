@@ -0,0 +1,250 @@
+/*
+ * @file kv_store.h
+ *
+ * @brief Header file for the log-structured key-value store
+ *
+ * Values are kept in an EEPROM region, through an EEP_Cache_t, as an append
+ * only log of CRC protected records.  Setting a key appends a record, deleting
+ * one appends a tombstone, so a hot key never rewrites the same location.  A
+ * RAM index hashed by key holds where the latest record of each key is, so a
+ * lookup costs one EEPROM read.
+ *
+ * The region is split into KVS_SEGMENT_SIZE segments used in turn.  Only one
+ * holds the log.  When it fills up, the live records are copied into the next
+ * segment, which then becomes the log, so every segment is written the same
+ * number of times.  With a compaction task started, this happens in the
+ * background once the log passes KVS_COMPACT_THRESHOLD with enough stale
+ * records to be worth it, and the segment after is erased ahead of time.
+ *
+ * Writes reach the EEPROM when the cache writes them back.  KVS_Sync() makes
+ * everything written so far persistent.  A record torn by a power failure
+ * fails its CRC and ends the log when the store is next initialized.
+ */
+#ifndef KV_STORE_H_
+#define KV_STORE_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before kv_store.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before kv_store.h"
+#endif
+
+#ifndef INC_FREERTOS_H
+    #error "Must include FreeRTOS.h before kv_store.h"
+#endif
+
+#include "eeprom_cache.h"
+
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Size of each segment of the region, a multiple of EEP_PAGE_SIZE
+#define KVS_SEGMENT_SIZE (4096u)
+
+// Most keys the store can hold; also the size of the index, a power of two
+#define KVS_MAX_KEYS (32u)
+
+// Largest value that can be stored under a key
+#define KVS_MAX_VALUE_SIZE (32u)
+
+// Bytes of log after which the compaction task is woken
+#define KVS_COMPACT_THRESHOLD ( ( KVS_SEGMENT_SIZE * 3u ) / 4u )
+
+// Key values 0 to KVS_INVALID_KEY - 1 can be used
+#define KVS_INVALID_KEY (0xFFFFu)
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+// Where the latest record of a key is in the log segment
+typedef struct
+{
+    uint16_t key;
+    uint16_t offset;
+    uint8_t length;
+    uint8_t state;
+} KVS_IndexEntry_t;
+
+typedef struct
+{
+    uint32_t keys;
+    uint32_t liveBytes;         // log bytes used by the latest record of each key
+    uint32_t usedBytes;         // log bytes used, including stale records
+    uint32_t segmentCount;
+    uint32_t activeSegment;
+    uint32_t generation;        // number of compactions over the life of the region
+    uint32_t appends;
+    uint32_t unchangedWrites;   // sets skipped because the value was already stored
+    uint32_t compactions;
+    uint32_t crcErrors;         // records found damaged when initializing
+} KVS_Stats_t;
+
+typedef struct
+{
+    EEP_Cache_t *ptrCache;
+    uint32_t baseAddress;
+    uint32_t segmentCount;
+    uint32_t activeSegment;
+    uint32_t generation;
+    uint32_t appendOffset;
+    uint32_t liveBytes;
+    uint32_t keyCount;
+    bool isNextErased;          // the segment after the active one is ready for a compaction
+    SemaphoreHandle_t mutex;
+    TaskHandle_t compactionTask;
+    KVS_IndexEntry_t index[ KVS_MAX_KEYS ];
+    uint32_t appends;
+    uint32_t unchangedWrites;
+    uint32_t compactions;
+    uint32_t crcErrors;
+} KVS_Store_t;
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function KVS_Init
+ *
+ * @brief Open the store in an EEPROM region, rebuilding the index from the
+ *        log, or create an empty store if the region holds none
+ *
+ * @param ptrStore - store to initialize
+ * @param ptrCache - cache of the EEPROM holding the region
+ * @param baseAddress - start of the region, a multiple of EEP_PAGE_SIZE
+ * @param size - size of the region, at least two segments
+ *
+ * @return bool - true if the store was opened, false otherwise
+ */
+bool KVS_Init( KVS_Store_t *ptrStore,
+               EEP_Cache_t *ptrCache,
+               const uint32_t baseAddress,
+               const uint32_t size );
+
+/**
+ * @function KVS_StartCompactionTask
+ *
+ * @brief Create a task that compacts the log and erases the next segment in
+ *        the background.  Without it compaction only happens when a write
+ *        finds the log full.
+ *
+ * @param ptrStore - the store
+ * @param stackDepth - stack size of the task in words
+ * @param priority - priority of the task, normally low
+ *
+ * @return bool - true if the task was created, false otherwise
+ */
+bool KVS_StartCompactionTask( KVS_Store_t *ptrStore,
+                              const uint16_t stackDepth,
+                              const UBaseType_t priority );
+
+/**
+ * @function KVS_Set
+ *
+ * @brief Store a value under a key.  Nothing is written if the key already
+ *        holds the same value.
+ *
+ * @param ptrStore - the store
+ * @param key - the key, below KVS_INVALID_KEY
+ * @param ptrValue - the value, copied
+ * @param length - length of the value, up to KVS_MAX_VALUE_SIZE
+ * @param timeoutTicks - maximum wait for another task using the store
+ *
+ * @return bool - true if the value was stored, false otherwise
+ */
+bool KVS_Set( KVS_Store_t *ptrStore,
+              const uint16_t key,
+              const void *ptrValue,
+              const uint32_t length,
+              const TickType_t timeoutTicks );
+
+/**
+ * @function KVS_Get
+ *
+ * @brief Read the value stored under a key
+ *
+ * @param ptrStore - the store
+ * @param key - the key
+ * @param ptrValue - where to put the value
+ * @param maxLength - size of ptrValue; a longer value is cut short
+ * @param ptrLength - set to the length of the stored value, may be NULL
+ * @param timeoutTicks - maximum wait for another task using the store
+ *
+ * @return bool - true if the key was found and read, false otherwise
+ */
+bool KVS_Get( KVS_Store_t *ptrStore,
+              const uint16_t key,
+              void *ptrValue,
+              const uint32_t maxLength,
+              uint32_t *ptrLength,
+              const TickType_t timeoutTicks );
+
+/**
+ * @function KVS_Delete
+ *
+ * @brief Remove a key
+ *
+ * @param ptrStore - the store
+ * @param key - the key
+ * @param timeoutTicks - maximum wait for another task using the store
+ *
+ * @return bool - true if the key is no longer stored, false otherwise
+ */
+bool KVS_Delete( KVS_Store_t *ptrStore, const uint16_t key, const TickType_t timeoutTicks );
+
+/**
+ * @function KVS_Sync
+ *
+ * @brief Write everything stored so far through to the EEPROM
+ *
+ * @param ptrStore - the store
+ * @param timeoutTicks - maximum wait for another task using the store
+ *
+ * @return bool - true if the EEPROM is up to date, false otherwise
+ */
+bool KVS_Sync( KVS_Store_t *ptrStore, const TickType_t timeoutTicks );
+
+/**
+ * @function KVS_Compact
+ *
+ * @brief Move the live records to the next segment now
+ *
+ * @param ptrStore - the store
+ * @param timeoutTicks - maximum wait for another task using the store
+ *
+ * @return bool - true if the log was compacted, false otherwise
+ */
+bool KVS_Compact( KVS_Store_t *ptrStore, const TickType_t timeoutTicks );
+
+/**
+ * @function KVS_Close
+ *
+ * @brief Write the store through to the EEPROM and delete its mutex, so it can
+ *        be opened again with KVS_Init().  A store with a compaction task
+ *        cannot be closed.
+ *
+ * @param ptrStore - the store
+ * @param timeoutTicks - maximum wait for another task using the store
+ *
+ * @return bool - true if the store was closed, false otherwise
+ */
+bool KVS_Close( KVS_Store_t *ptrStore, const TickType_t timeoutTicks );
+
+/**
+ * @function KVS_GetStats
+ *
+ * @brief Take a snapshot of the store's usage and counters
+ *
+ * @param ptrStore - the store
+ * @param ptrStats - filled in with the snapshot
+ *
+ * @return void (no return value)
+ */
+void KVS_GetStats( KVS_Store_t *ptrStore, KVS_Stats_t *ptrStats );
+
+#endif /* KV_STORE_H_ */
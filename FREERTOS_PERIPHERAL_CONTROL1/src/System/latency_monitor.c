@@ -0,0 +1,345 @@
+/*
+ * @file latency_monitor.c
+ *
+ * @brief Interrupt-to-task wake-up latency monitor
+ */
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+#define SMALL_VALUE_BUCKETS (4u)
+#define SUB_BUCKET_BITS (2u)
+#define BUCKET_COUNT_LIMIT (0xFFFFu)
+#define P99_NUMERATOR (99u)
+#define P99_DENOMINATOR (100u)
+
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+#include "string.h"
+
+// hardware includes
+#include "compiler.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+// this file's header
+#include "latency_monitor.h"
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint16_t buckets[ LAT_NUM_BUCKETS ];
+} LAT_SegmentData_t;
+
+typedef struct
+{
+    // written by the waiting task and the ISR, guarded by a critical section
+    volatile bool isTaskWaiting;
+    volatile bool isArmed;
+    volatile uint32_t isrEntryCycles;
+    volatile uint32_t giveCycles;
+
+    // only written from task context, guarded by suspending the scheduler
+    LAT_SegmentData_t segments[ LAT_NUM_SEGMENTS ];
+} LAT_PathData_t;
+
+
+/*------------------------------------------------------------
+                      Local Variables
+-------------------------------------------------------------*/
+static LAT_PathData_t pathData[ LAT_NUM_PATHS ];
+
+static const char * const pathNames[ LAT_NUM_PATHS ] =
+{
+    "usart-rx",
+    "usart-tx",
+    "twi",
+    "cdc-rx"
+};
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static uint32_t prvBucketIndex( const uint32_t cycles );
+static uint32_t prvBucketUpperEdge( const uint32_t index );
+static void prvAddSample( LAT_SegmentData_t *ptrSegment, const uint32_t cycles );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+void LAT_Init( void )
+{
+    // The cycle counter is part of the trace block, which must be enabled first.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0u;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    LAT_Reset();
+}
+
+
+/*-----------------------------------------------------------*/
+void LAT_Reset( void )
+{
+    vTaskSuspendAll();
+    {
+        taskENTER_CRITICAL();
+        {
+            memset( pathData, 0x00, sizeof( pathData ) );
+        }
+        taskEXIT_CRITICAL();
+    }
+    ( void ) xTaskResumeAll();
+}
+
+
+/*-----------------------------------------------------------*/
+void LAT_RecordTaskWait( const LAT_Path_t path )
+{
+    if( path < LAT_NUM_PATHS )
+    {
+        taskENTER_CRITICAL();
+        {
+            pathData[ path ].isTaskWaiting = true;
+            pathData[ path ].isArmed = false;
+        }
+        taskEXIT_CRITICAL();
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+void LAT_RecordGiveFromISR( const LAT_Path_t path, const uint32_t isrEntryCycles )
+{
+    const uint32_t giveCycles = LAT_GET_CYCLES();
+    UBaseType_t savedInterruptStatus;
+
+    if( path < LAT_NUM_PATHS )
+    {
+        savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+        {
+            // Only time the first event after the task started waiting; later
+            // events are queued behind it and would under-report the latency.
+            if( pathData[ path ].isTaskWaiting && !pathData[ path ].isArmed )
+            {
+                pathData[ path ].isrEntryCycles = isrEntryCycles;
+                pathData[ path ].giveCycles = giveCycles;
+                pathData[ path ].isArmed = true;
+            }
+        }
+        taskEXIT_CRITICAL_FROM_ISR( savedInterruptStatus );
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+void LAT_RecordTaskRun( const LAT_Path_t path )
+{
+    const uint32_t runCycles = LAT_GET_CYCLES();
+    bool wasArmed = false;
+    uint32_t isrEntryCycles = 0u;
+    uint32_t giveCycles = 0u;
+
+    if( path < LAT_NUM_PATHS )
+    {
+        taskENTER_CRITICAL();
+        {
+            wasArmed = pathData[ path ].isArmed;
+            isrEntryCycles = pathData[ path ].isrEntryCycles;
+            giveCycles = pathData[ path ].giveCycles;
+            pathData[ path ].isArmed = false;
+            pathData[ path ].isTaskWaiting = false;
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    if( wasArmed )
+    {
+        // The statistics are only ever updated from tasks, so locking the
+        // scheduler is enough and interrupts stay enabled.  Unsigned
+        // subtraction handles the 32-bit counter wrapping.
+        vTaskSuspendAll();
+        {
+            prvAddSample( &pathData[ path ].segments[ LAT_SEGMENT_ISR ],
+                          giveCycles - isrEntryCycles );
+            prvAddSample( &pathData[ path ].segments[ LAT_SEGMENT_WAKE ],
+                          runCycles - giveCycles );
+        }
+        ( void ) xTaskResumeAll();
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+bool LAT_GetStats( const LAT_Path_t path,
+                   const LAT_Segment_t segment,
+                   LAT_Stats_t *ptrStats )
+{
+    bool isValid = ( path < LAT_NUM_PATHS );
+    isValid = isValid && ( segment < LAT_NUM_SEGMENTS );
+    isValid = isValid && ( ptrStats != NULL );
+
+    if( isValid )
+    {
+        const LAT_SegmentData_t *ptrSegment = &pathData[ path ].segments[ segment ];
+        uint32_t histogramTotal = 0u;
+        uint32_t runningTotal = 0u;
+        uint32_t index;
+
+        memset( ptrStats, 0x00, sizeof( LAT_Stats_t ) );
+
+        vTaskSuspendAll();
+        {
+            ptrStats->count = ptrSegment->count;
+
+            if( ptrSegment->count > 0u )
+            {
+                ptrStats->minCycles = ptrSegment->minCycles;
+                ptrStats->maxCycles = ptrSegment->maxCycles;
+                ptrStats->avgCycles = ( uint32_t )( ptrSegment->totalCycles / ptrSegment->count );
+
+                // The buckets may have been rescaled, so take the percentile
+                // from their own total rather than from count.
+                for( index = 0u; index < LAT_NUM_BUCKETS; index++ )
+                {
+                    histogramTotal += ptrSegment->buckets[ index ];
+                }
+
+                for( index = 0u; index < LAT_NUM_BUCKETS; index++ )
+                {
+                    runningTotal += ptrSegment->buckets[ index ];
+                    if( ( runningTotal * P99_DENOMINATOR ) >= ( histogramTotal * P99_NUMERATOR ) )
+                    {
+                        break;
+                    }
+                }
+
+                ptrStats->p99Cycles = prvBucketUpperEdge( index );
+                if( ptrStats->p99Cycles > ptrStats->maxCycles )
+                {
+                    ptrStats->p99Cycles = ptrStats->maxCycles;
+                }
+            }
+        }
+        ( void ) xTaskResumeAll();
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+const char * LAT_GetPathName( const LAT_Path_t path )
+{
+    const char *ptrName = "?";
+
+    if( path < LAT_NUM_PATHS )
+    {
+        ptrName = pathNames[ path ];
+    }
+
+    return ptrName;
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static uint32_t prvBucketIndex( const uint32_t cycles )
+{
+    uint32_t index = cycles;
+
+    if( cycles >= SMALL_VALUE_BUCKETS )
+    {
+        // Log-linear: the most significant bit selects the octave, the next
+        // SUB_BUCKET_BITS bits select the bucket within it.
+        const uint32_t msb = 31u - ( uint32_t ) __builtin_clz( cycles );
+        const uint32_t subBucket = ( cycles >> ( msb - SUB_BUCKET_BITS ) ) &
+                                   ( ( 1u << SUB_BUCKET_BITS ) - 1u );
+
+        index = ( ( msb - 1u ) << SUB_BUCKET_BITS ) + subBucket;
+    }
+
+    return index;
+}
+
+
+/*-----------------------------------------------------------*/
+static uint32_t prvBucketUpperEdge( const uint32_t index )
+{
+    uint32_t upperEdge;
+
+    if( index < SMALL_VALUE_BUCKETS )
+    {
+        upperEdge = index;
+    }
+    else if( index >= ( LAT_NUM_BUCKETS - 1u ) )
+    {
+        upperEdge = UINT32_MAX;
+    }
+    else
+    {
+        // One less than the lower edge of the following bucket.
+        const uint32_t next = index + 1u;
+        const uint32_t msb = ( next >> SUB_BUCKET_BITS ) + 1u;
+        const uint32_t subBucket = next & ( ( 1u << SUB_BUCKET_BITS ) - 1u );
+
+        upperEdge = ( ( ( 1u << SUB_BUCKET_BITS ) + subBucket ) << ( msb - SUB_BUCKET_BITS ) ) - 1u;
+    }
+
+    return upperEdge;
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvAddSample( LAT_SegmentData_t *ptrSegment, const uint32_t cycles )
+{
+    const uint32_t index = prvBucketIndex( cycles );
+    uint32_t bucket;
+
+    if( ( ptrSegment->count == 0u ) || ( cycles < ptrSegment->minCycles ) )
+    {
+        ptrSegment->minCycles = cycles;
+    }
+
+    if( cycles > ptrSegment->maxCycles )
+    {
+        ptrSegment->maxCycles = cycles;
+    }
+
+    ptrSegment->count++;
+    ptrSegment->totalCycles += cycles;
+
+    // Halve the whole histogram rather than saturate a bucket, so the shape
+    // of the distribution (and therefore the percentile) is preserved.
+    if( ptrSegment->buckets[ index ] == BUCKET_COUNT_LIMIT )
+    {
+        for( bucket = 0u; bucket < LAT_NUM_BUCKETS; bucket++ )
+        {
+            ptrSegment->buckets[ bucket ] >>= 1;
+        }
+    }
+
+    ptrSegment->buckets[ index ]++;
+}
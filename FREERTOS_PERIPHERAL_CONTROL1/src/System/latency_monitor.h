@@ -0,0 +1,181 @@
+/*
+ * @file latency_monitor.h
+ *
+ * @brief Header file for the interrupt-to-task wake-up latency monitor
+ *
+ * Each monitored path (for example the USART receive interrupt waking the task
+ * blocked in freertos_usart_serial_read_packet()) is stamped with the DWT cycle
+ * counter at three points:
+ *   1. ISR entry
+ *   2. just before the ISR gives the semaphore the task is blocked on
+ *   3. when the woken task runs again
+ * The ISR segment (1 -> 2) and the wake segment (2 -> 3) are accumulated
+ * separately so interrupt handler cost and scheduler latency can be told apart.
+ */
+#ifndef LATENCY_MONITOR_H_
+#define LATENCY_MONITOR_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before latency_monitor.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before latency_monitor.h"
+#endif
+
+#ifndef INC_FREERTOS_H
+    #error "Must include FreeRTOS.h before latency_monitor.h"
+#endif
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Histogram resolution: values below 4 cycles get a bucket each, above that
+// every power of two is split into 4 sub-buckets (25% resolution).
+#define LAT_NUM_BUCKETS (124u)
+
+// The cycle source.  Defaults to the Cortex-M3 DWT cycle counter, but can be
+// overridden (before this header is included) so the statistics code can be
+// driven by a simulated clock.
+#ifndef LAT_GET_CYCLES
+    #define LAT_GET_CYCLES() ( DWT->CYCCNT )
+#endif
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef enum
+{
+    LAT_PATH_USART_RX = 0,  // USART ENDRX/TIMEOUT -> freertos_usart_serial_read_packet()
+    LAT_PATH_USART_TX,      // USART ENDTX -> freertos_usart_write_packet()
+    LAT_PATH_TWI,           // TWI ENDTX/ENDRX -> freertos_twi_write/read_packet()
+    LAT_PATH_CDC_RX,        // cli_cdc_rx_notify() -> usb_cdc_command_console_task()
+    LAT_NUM_PATHS
+} LAT_Path_t;
+
+typedef enum
+{
+    LAT_SEGMENT_ISR = 0,    // ISR entry -> semaphore given
+    LAT_SEGMENT_WAKE,       // semaphore given -> woken task running
+    LAT_NUM_SEGMENTS
+} LAT_Segment_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t avgCycles;
+    uint32_t maxCycles;
+    uint32_t p99Cycles;     // upper edge of the histogram bucket holding the 99th percentile
+} LAT_Stats_t;
+
+
+/*------------------------------------------------------------
+                      Instrumentation Hooks
+-------------------------------------------------------------*/
+// Drivers use these rather than calling the functions directly so the
+// instrumentation compiles away when configUSE_WAKE_LATENCY_TRACE is 0.
+#if ( configUSE_WAKE_LATENCY_TRACE == 1 )
+    #define LAT_ISR_ENTRY_STAMP()                       LAT_GET_CYCLES()
+    #define LAT_ISR_ELAPSED_CYCLES( entry )             ( LAT_GET_CYCLES() - ( entry ) )
+    #define LAT_RECORD_GIVE_FROM_ISR( path, entry )     LAT_RecordGiveFromISR( ( path ), ( entry ) )
+    #define LAT_RECORD_TASK_WAIT( path )                LAT_RecordTaskWait( ( path ) )
+    #define LAT_RECORD_TASK_RUN( path )                 LAT_RecordTaskRun( ( path ) )
+#else
+    #define LAT_ISR_ENTRY_STAMP()                       ( 0UL )
+    #define LAT_ISR_ELAPSED_CYCLES( entry )             ( ( void ) ( entry ), 0UL )
+    #define LAT_RECORD_GIVE_FROM_ISR( path, entry )     ( void ) ( entry )
+    #define LAT_RECORD_TASK_WAIT( path )
+    #define LAT_RECORD_TASK_RUN( path )
+#endif
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function LAT_Init
+ *
+ * @brief Enable the DWT cycle counter and clear all latency statistics
+ *
+ * @param void
+ *
+ * @return void (no return value)
+ */
+void LAT_Init( void );
+
+/**
+ * @function LAT_Reset
+ *
+ * @brief Clear the statistics of every path
+ *
+ * @param void
+ *
+ * @return void (no return value)
+ */
+void LAT_Reset( void );
+
+/**
+ * @function LAT_RecordTaskWait
+ *
+ * @brief Called by a task immediately before it blocks waiting for the ISR of a path
+ *
+ * @param path - the path the task is about to wait on
+ *
+ * @return void (no return value)
+ */
+void LAT_RecordTaskWait( const LAT_Path_t path );
+
+/**
+ * @function LAT_RecordGiveFromISR
+ *
+ * @brief Called by an ISR just before it gives the semaphore a task is blocked on.
+ *        Only the first event after a task started waiting is timed.
+ *
+ * @param path - the path being signalled
+ * @param isrEntryCycles - cycle count captured with LAT_ISR_ENTRY_STAMP() on ISR entry
+ *
+ * @return void (no return value)
+ */
+void LAT_RecordGiveFromISR( const LAT_Path_t path, const uint32_t isrEntryCycles );
+
+/**
+ * @function LAT_RecordTaskRun
+ *
+ * @brief Called by the woken task as soon as its blocking call returns
+ *
+ * @param path - the path the task was waiting on
+ *
+ * @return void (no return value)
+ */
+void LAT_RecordTaskRun( const LAT_Path_t path );
+
+/**
+ * @function LAT_GetStats
+ *
+ * @brief Get a snapshot of the statistics for one segment of a path
+ *
+ * @param path - the path to query
+ * @param segment - the segment of the path to query
+ * @param ptrStats - filled in with the statistics
+ *
+ * @return bool - true if the path and segment were valid, false otherwise
+ */
+bool LAT_GetStats( const LAT_Path_t path,
+                   const LAT_Segment_t segment,
+                   LAT_Stats_t *ptrStats );
+
+/**
+ * @function LAT_GetPathName
+ *
+ * @brief Get a short printable name for a path
+ *
+ * @param path - the path
+ *
+ * @return const char * - the name, or "?" if the path is invalid
+ */
+const char * LAT_GetPathName( const LAT_Path_t path );
+
+#endif /* LATENCY_MONITOR_H_ */
@@ -0,0 +1,228 @@
+/*
+ * @file lockfree_ring.c
+ *
+ * @brief Lock-free multi-producer/multi-consumer ring
+ *
+ * Bounded MPMC queue using a sequence number per slot.  A slot at position pos
+ * is free for a producer when its sequence equals pos, and holds an item for a
+ * consumer when its sequence equals pos + 1.  Producers and consumers claim a
+ * position by advancing enqueuePosition/dequeuePosition with LDREX/STREX, copy
+ * the item, and then publish the slot by writing its next sequence number.
+ *
+ * The positions are free-running 32-bit counters; the signed difference between
+ * a sequence and a position stays correct across the wrap.
+ */
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+#include "string.h"
+
+// hardware includes
+#include "compiler.h"
+
+// this file's header
+#include "lockfree_ring.h"
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static bool prvCompareAndSwap( volatile uint32_t *ptrValue,
+                               const uint32_t expected,
+                               const uint32_t desired );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+bool LFR_Init( LFR_Ring_t *ptrRing,
+               uint32_t *ptrSequence,
+               uint8_t *ptrStorage,
+               const uint32_t capacity,
+               const uint32_t itemSize )
+{
+    uint32_t slot;
+    bool isValid = ( ptrRing != NULL ) && ( ptrSequence != NULL ) && ( ptrStorage != NULL );
+
+    // the capacity must be a power of two so positions map to slots with a mask
+    isValid = isValid && ( capacity >= 2u ) && ( ( capacity & ( capacity - 1u ) ) == 0u );
+    isValid = isValid && ( itemSize > 0u );
+
+    if( isValid )
+    {
+        for( slot = 0u; slot < capacity; slot++ )
+        {
+            ptrSequence[ slot ] = slot;
+        }
+
+        ptrRing->ptrSequence = ptrSequence;
+        ptrRing->ptrStorage = ptrStorage;
+        ptrRing->mask = capacity - 1u;
+        ptrRing->itemSize = itemSize;
+        ptrRing->enqueuePosition = 0u;
+        ptrRing->dequeuePosition = 0u;
+
+        __DMB();
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool LFR_Push( LFR_Ring_t *ptrRing, const void *ptrItem )
+{
+    uint32_t position = ptrRing->enqueuePosition;
+    uint32_t slot;
+    int32_t difference;
+
+    for( ;; )
+    {
+        slot = position & ptrRing->mask;
+        difference = ( int32_t )( ptrRing->ptrSequence[ slot ] - position );
+
+        // read the sequence before anything that depends on it
+        __DMB();
+
+        if( difference == 0 )
+        {
+            // the slot is free, try to claim this position
+            if( prvCompareAndSwap( &ptrRing->enqueuePosition, position, position + 1u ) )
+            {
+                break;
+            }
+
+            position = ptrRing->enqueuePosition;
+        }
+        else if( difference < 0 )
+        {
+            // the slot still holds an item from the previous lap: full
+            return false;
+        }
+        else
+        {
+            // another producer claimed this position first
+            position = ptrRing->enqueuePosition;
+        }
+    }
+
+    memcpy( &ptrRing->ptrStorage[ slot * ptrRing->itemSize ], ptrItem, ptrRing->itemSize );
+
+    // the item must be visible before the slot is published to consumers
+    __DMB();
+    ptrRing->ptrSequence[ slot ] = position + 1u;
+
+    return true;
+}
+
+
+/*-----------------------------------------------------------*/
+bool LFR_Pop( LFR_Ring_t *ptrRing, void *ptrItem )
+{
+    uint32_t position = ptrRing->dequeuePosition;
+    uint32_t slot;
+    int32_t difference;
+
+    for( ;; )
+    {
+        slot = position & ptrRing->mask;
+        difference = ( int32_t )( ptrRing->ptrSequence[ slot ] - ( position + 1u ) );
+
+        // read the sequence before the item it publishes
+        __DMB();
+
+        if( difference == 0 )
+        {
+            // the slot holds an item, try to claim this position
+            if( prvCompareAndSwap( &ptrRing->dequeuePosition, position, position + 1u ) )
+            {
+                break;
+            }
+
+            position = ptrRing->dequeuePosition;
+        }
+        else if( difference < 0 )
+        {
+            // the slot has not been published yet: empty
+            return false;
+        }
+        else
+        {
+            // another consumer claimed this position first
+            position = ptrRing->dequeuePosition;
+        }
+    }
+
+    memcpy( ptrItem, &ptrRing->ptrStorage[ slot * ptrRing->itemSize ], ptrRing->itemSize );
+
+    // finish reading the item before handing the slot to the next lap's producer
+    __DMB();
+    ptrRing->ptrSequence[ slot ] = position + ptrRing->mask + 1u;
+
+    return true;
+}
+
+
+/*-----------------------------------------------------------*/
+uint32_t LFR_GetCount( const LFR_Ring_t *ptrRing )
+{
+    uint32_t dequeuePosition = ptrRing->dequeuePosition;
+    uint32_t enqueuePosition = ptrRing->enqueuePosition;
+    uint32_t count = enqueuePosition - dequeuePosition;
+
+    // a pop between the two reads can make dequeue overtake the stale enqueue
+    if( ( int32_t ) count < 0 )
+    {
+        count = 0u;
+    }
+    else if( count > ( ptrRing->mask + 1u ) )
+    {
+        count = ptrRing->mask + 1u;
+    }
+
+    return count;
+}
+
+
+/*-----------------------------------------------------------*/
+void LFR_AtomicAdd( volatile uint32_t *ptrValue, const uint32_t amount )
+{
+    uint32_t value;
+
+    // STREX fails if another context updated the counter since the LDREX
+    do
+    {
+        value = __LDREXW( ptrValue ) + amount;
+    } while( __STREXW( value, ptrValue ) != 0u );
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static bool prvCompareAndSwap( volatile uint32_t *ptrValue,
+                               const uint32_t expected,
+                               const uint32_t desired )
+{
+    // STREX fails if anything (including an exception entry/return) touched
+    // the monitor since the LDREX, in which case the value is read again.
+    do
+    {
+        if( __LDREXW( ptrValue ) != expected )
+        {
+            __CLREX();
+            return false;
+        }
+    } while( __STREXW( desired, ptrValue ) != 0u );
+
+    return true;
+}
@@ -0,0 +1,127 @@
+/*
+ * @file lockfree_ring.h
+ *
+ * @brief Header file for the lock-free multi-producer/multi-consumer ring
+ *
+ * A bounded ring of fixed size items that never masks interrupts, so it can be
+ * used from tasks and from interrupts of ANY priority, including those above
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY that must not call the FreeRTOS API.
+ * Slots are claimed with the Cortex-M3 exclusive access instructions
+ * (LDREX/STREX) and handed over through a sequence number per slot.
+ *
+ * A push or pop never waits.  If a slot has been claimed by a context that was
+ * then preempted, the preempting context sees the ring as full (push) or empty
+ * (pop) at that slot and returns false rather than spinning on it.
+ *
+ * Nothing is signalled to the kernel; a consumer task has to be woken some
+ * other way (for example by a lower priority interrupt or by polling).
+ */
+#ifndef LOCKFREE_RING_H_
+#define LOCKFREE_RING_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before lockfree_ring.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before lockfree_ring.h"
+#endif
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Bytes of item storage needed for a ring
+#define LFR_STORAGE_SIZE( capacity, itemSize ) ( ( capacity ) * ( itemSize ) )
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+// Ring control block.  Allocated by the caller; the members are private to
+// lockfree_ring.c.
+typedef struct
+{
+    volatile uint32_t *ptrSequence;     // one entry per slot
+    uint8_t *ptrStorage;
+    uint32_t mask;                      // capacity - 1
+    uint32_t itemSize;
+    volatile uint32_t enqueuePosition;
+    volatile uint32_t dequeuePosition;
+} LFR_Ring_t;
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function LFR_Init
+ *
+ * @brief Initialize an empty ring.  Must be called before the ring is shared
+ *        with any other context.
+ *
+ * @param ptrRing - ring control block to initialize
+ * @param ptrSequence - array of capacity words used to hand slots over
+ * @param ptrStorage - LFR_STORAGE_SIZE( capacity, itemSize ) bytes for the items
+ * @param capacity - number of slots, a power of two and at least 2
+ * @param itemSize - size of one item in bytes
+ *
+ * @return bool - true if the ring was initialized, false otherwise
+ */
+bool LFR_Init( LFR_Ring_t *ptrRing,
+               uint32_t *ptrSequence,
+               uint8_t *ptrStorage,
+               const uint32_t capacity,
+               const uint32_t itemSize );
+
+/**
+ * @function LFR_Push
+ *
+ * @brief Copy an item into the ring.  Safe to call from any task or interrupt.
+ *
+ * @param ptrRing - the ring
+ * @param ptrItem - the item to copy in
+ *
+ * @return bool - true if the item was added, false if the ring was full
+ */
+bool LFR_Push( LFR_Ring_t *ptrRing, const void *ptrItem );
+
+/**
+ * @function LFR_Pop
+ *
+ * @brief Copy the oldest item out of the ring.  Safe to call from any task or
+ *        interrupt.
+ *
+ * @param ptrRing - the ring
+ * @param ptrItem - where to copy the item
+ *
+ * @return bool - true if an item was removed, false if the ring was empty
+ */
+bool LFR_Pop( LFR_Ring_t *ptrRing, void *ptrItem );
+
+/**
+ * @function LFR_GetCount
+ *
+ * @brief Get the number of items in the ring.  Only a snapshot when other
+ *        contexts are pushing or popping; includes items still being copied.
+ *
+ * @param ptrRing - the ring
+ *
+ * @return uint32_t - the number of items
+ */
+uint32_t LFR_GetCount( const LFR_Ring_t *ptrRing );
+
+/**
+ * @function LFR_AtomicAdd
+ *
+ * @brief Add to a counter shared by any tasks and interrupts, without masking
+ *        interrupts, such as the statistics kept by the ring's users.
+ *
+ * @param ptrValue - the counter
+ * @param amount - the amount to add
+ *
+ * @return void (no return value)
+ */
+void LFR_AtomicAdd( volatile uint32_t *ptrValue, const uint32_t amount );
+
+#endif /* LOCKFREE_RING_H_ */
@@ -0,0 +1,29 @@
+/*
+ * @file log_formats.h
+ *
+ * @brief Format strings of the binary log
+ *
+ * Each entry gives a format ID, its format string and the record arguments
+ * the string converts.  The IDs are numbered in the order of this list, so this
+ * file is also the ID-to-string table needed to decode binary log records away
+ * from the target.  Add new entries at the end so the IDs of existing ones do
+ * not change.
+ *
+ * Argument n of a record is given to the format string as one of:
+ *   BLOG_UL( n )  - an unsigned long, for %lu, %lx or %c
+ *   BLOG_L( n )   - a long, for %ld
+ *   BLOG_STR( n ) - a const char *, for %s
+ * The entries expand to snprintf() calls, so the compiler checks each format
+ * string against its arguments.  %s may only be used for strings that are never
+ * changed or freed, such as string constants, because the pointer is followed
+ * when the record is formatted, not when it is logged.  At most BLOG_MAX_ARGS
+ * arguments can be given.
+ */
+#ifndef LOG_FORMATS_H_
+#define LOG_FORMATS_H_
+
+#define BLOG_FORMATS( ENTRY ) \
+    ENTRY( BLOG_ID_BENCH,           "blog-bench: message %lu of %lu\r\n",     BLOG_UL( 0 ), BLOG_UL( 1 ) ) \
+    ENTRY( BLOG_ID_RESET_CAUSE,     "Reset cause: %s\r\n",                    BLOG_STR( 0 ) )
+
+#endif /* LOG_FORMATS_H_ */
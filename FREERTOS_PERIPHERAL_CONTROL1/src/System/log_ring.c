@@ -0,0 +1,378 @@
+/*
+ * @file log_ring.c
+ *
+ * @brief Non-blocking log, drained to the UART by the PDC
+ *
+ * Producers only ever push into the lock-free ring and bump counters with
+ * LDREX/STREX, so they never block and never mask interrupts.  The ring is
+ * emptied by a single drain task, which is the only consumer.  The drain task
+ * polls, because a producer running above configMAX_SYSCALL_INTERRUPT_PRIORITY
+ * cannot signal it.
+ */
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+#define LOG_TASK_NAME "Log"
+
+// Text of the line sent when messages have been dropped, around the count
+#define DROP_REPORT_PREFIX "\r\n[log: "
+#define DROP_REPORT_SUFFIX " messages dropped]\r\n"
+
+// Longest drop report: the prefix, ten digits and the suffix
+#define DROP_REPORT_MAX_SIZE ( sizeof( DROP_REPORT_PREFIX ) + 10u + sizeof( DROP_REPORT_SUFFIX ) )
+
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+#include "string.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+// system includes
+#include "lockfree_ring.h"
+
+// this file's header
+#include "log_ring.h"
+
+
+#if ( configUSE_LOG_RING == 1 )
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+// One ring slot
+typedef struct
+{
+    uint8_t length;
+    uint8_t text[ LOG_MESSAGE_SIZE - 1u ];
+} LOG_Message_t;
+
+
+/*------------------------------------------------------------
+                      Local Variables
+-------------------------------------------------------------*/
+static LFR_Ring_t ring;
+static uint32_t ringSequence[ LOG_RING_SLOTS ];
+static uint8_t ringStorage[ LFR_STORAGE_SIZE( LOG_RING_SLOTS, sizeof( LOG_Message_t ) ) ];
+
+// The PDC reads one buffer while the drain task fills the other.
+static uint8_t burstBuffers[ 2 ][ LOG_BURST_SIZE ];
+
+static freertos_uart_if drainUart = NULL;
+static SemaphoreHandle_t burstSentSemaphore = NULL;
+
+// Written by producers in any context, so only changed with LFR_AtomicAdd().
+static volatile uint32_t messagesWritten = 0u;
+static volatile uint32_t messagesDropped = 0u;
+static volatile uint32_t messagesTruncated = 0u;
+static volatile uint32_t bytesWritten = 0u;
+
+// Only written by the drain task.
+static uint32_t bursts = 0u;
+static uint32_t bytesSent = 0u;
+static uint32_t sendErrors = 0u;
+static uint32_t ringHighWater = 0u;
+static uint32_t droppedReported = 0u;
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static void prvDrainTask( void *ptrParameters );
+static uint32_t prvFillBurst( uint8_t *ptrBurst );
+static uint32_t prvAppendDropReport( uint8_t *ptrBurst, const uint32_t dropped );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+void LOG_Init( void )
+{
+    ( void ) LFR_Init( &ring,
+                       ringSequence,
+                       ringStorage,
+                       LOG_RING_SLOTS,
+                       sizeof( LOG_Message_t ) );
+}
+
+
+/*-----------------------------------------------------------*/
+bool LOG_StartDrain( freertos_uart_if uart,
+                     const uint16_t stackDepth,
+                     const UBaseType_t priority )
+{
+    // check the drain has not already been started
+    bool isValid = ( uart != NULL ) && ( drainUart == NULL );
+
+    if( isValid )
+    {
+        burstSentSemaphore = xSemaphoreCreateBinary();
+        isValid = ( burstSentSemaphore != NULL );
+    }
+
+    if( isValid )
+    {
+        drainUart = uart;
+        isValid = ( xTaskCreate( prvDrainTask,
+                                 LOG_TASK_NAME,
+                                 stackDepth,
+                                 NULL,
+                                 priority,
+                                 NULL ) == pdPASS );
+        if( !isValid )
+        {
+            drainUart = NULL;
+        }
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool LOG_Write( const uint8_t *ptrData, const uint32_t length )
+{
+    LOG_Message_t message;
+    const bool isTruncated = ( length > sizeof( message.text ) );
+    bool isAdded = ( ptrData != NULL );
+
+    if( isAdded && ( length > 0u ) )
+    {
+        // the message is kept in one slot, so it is never split
+        message.length = ( uint8_t )( isTruncated ? sizeof( message.text ) : length );
+        memcpy( message.text, ptrData, message.length );
+
+        isAdded = LFR_Push( &ring, &message );
+        if( isAdded )
+        {
+            LFR_AtomicAdd( &messagesWritten, 1u );
+            LFR_AtomicAdd( &bytesWritten, message.length );
+            if( isTruncated )
+            {
+                LFR_AtomicAdd( &messagesTruncated, 1u );
+            }
+        }
+        else
+        {
+            LFR_AtomicAdd( &messagesDropped, 1u );
+        }
+    }
+
+    return isAdded && !isTruncated;
+}
+
+
+/*-----------------------------------------------------------*/
+bool LOG_WriteLong( const uint8_t *ptrData, const uint32_t length )
+{
+    uint32_t offset;
+    uint32_t chunk;
+    bool isAdded = ( ptrData != NULL );
+
+    if( isAdded )
+    {
+        // each piece is added even if an earlier one was dropped
+        for( offset = 0u; offset < length; offset += chunk )
+        {
+            chunk = length - offset;
+            if( chunk > LOG_MAX_MESSAGE_LENGTH )
+            {
+                chunk = LOG_MAX_MESSAGE_LENGTH;
+            }
+
+            isAdded = LOG_Write( &ptrData[ offset ], chunk ) && isAdded;
+        }
+    }
+
+    return isAdded;
+}
+
+
+/*-----------------------------------------------------------*/
+bool LOG_Print( const char *ptrString )
+{
+    bool isAdded = ( ptrString != NULL );
+
+    if( isAdded )
+    {
+        isAdded = LOG_Write( ( const uint8_t * )ptrString, strlen( ptrString ) );
+    }
+
+    return isAdded;
+}
+
+
+/*-----------------------------------------------------------*/
+bool LOG_GetStats( LOG_Stats_t *ptrStats )
+{
+    bool isValid = ( ptrStats != NULL );
+
+    if( isValid )
+    {
+        ptrStats->messagesWritten = messagesWritten;
+        ptrStats->messagesDropped = messagesDropped;
+        ptrStats->messagesTruncated = messagesTruncated;
+        ptrStats->bytesWritten = bytesWritten;
+        ptrStats->bursts = bursts;
+        ptrStats->bytesSent = bytesSent;
+        ptrStats->sendErrors = sendErrors;
+        ptrStats->ringHighWater = ringHighWater;
+        ptrStats->isDraining = ( drainUart != NULL );
+    }
+
+    return isValid;
+}
+
+
+#if defined( __GNUC__ )
+/*-----------------------------------------------------------*/
+int _write( int file, const char *ptr, int len )
+{
+    if( ( file != 1 ) && ( file != 2 ) && ( file != 3 ) )
+    {
+        return -1;
+    }
+
+    // A full stdio buffer is longer than a message.  Bytes dropped because the
+    // log is full are reported as written, so the C library does not retry.
+    ( void ) LOG_WriteLong( ( const uint8_t * )ptr, ( uint32_t )len );
+
+    return len;
+}
+#endif
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static void prvDrainTask( void *ptrParameters )
+{
+    uint32_t active = 0u;
+    uint32_t length;
+    bool isBurstInFlight = false;
+
+    ( void ) ptrParameters;
+
+    for( ;; )
+    {
+        length = prvFillBurst( burstBuffers[ active ] );
+
+        if( length == 0u )
+        {
+            if( isBurstInFlight )
+            {
+                // nothing new yet, so wait for the last burst rather than poll
+                if( xSemaphoreTake( burstSentSemaphore, LOG_TX_TIMEOUT_TICKS ) != pdPASS )
+                {
+                    sendErrors++;
+                }
+                isBurstInFlight = false;
+            }
+            else
+            {
+                vTaskDelay( LOG_DRAIN_PERIOD_TICKS );
+            }
+        }
+        else
+        {
+            // The other buffer may still be in the PDC.  It is free once the
+            // previous burst has been sent, which also releases the UART.
+            if( isBurstInFlight &&
+                ( xSemaphoreTake( burstSentSemaphore, LOG_TX_TIMEOUT_TICKS ) != pdPASS ) )
+            {
+                sendErrors++;
+            }
+
+            isBurstInFlight = ( freertos_uart_write_packet_async( drainUart,
+                                                                  burstBuffers[ active ],
+                                                                  length,
+                                                                  LOG_TX_TIMEOUT_TICKS,
+                                                                  burstSentSemaphore ) == STATUS_OK );
+            if( isBurstInFlight )
+            {
+                bursts++;
+                bytesSent += length;
+                active ^= 1u;
+            }
+            else
+            {
+                sendErrors++;
+            }
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+static uint32_t prvFillBurst( uint8_t *ptrBurst )
+{
+    LOG_Message_t message;
+    uint32_t length = 0u;
+    uint32_t count = LFR_GetCount( &ring );
+    uint32_t dropped = messagesDropped;
+
+    if( count > ringHighWater )
+    {
+        ringHighWater = count;
+    }
+
+    // report any drops since the last burst at the start of this one
+    if( dropped != droppedReported )
+    {
+        length = prvAppendDropReport( ptrBurst, dropped - droppedReported );
+        droppedReported = dropped;
+    }
+
+    while( ( ( length + sizeof( message.text ) ) <= LOG_BURST_SIZE ) &&
+           LFR_Pop( &ring, &message ) )
+    {
+        memcpy( &ptrBurst[ length ], message.text, message.length );
+        length += message.length;
+    }
+
+    return length;
+}
+
+
+/*-----------------------------------------------------------*/
+static uint32_t prvAppendDropReport( uint8_t *ptrBurst, const uint32_t dropped )
+{
+    uint8_t digits[ 10 ];
+    uint32_t digitCount = 0u;
+    uint32_t value = dropped;
+    uint32_t length = sizeof( DROP_REPORT_PREFIX ) - 1u;
+
+    configASSERT( DROP_REPORT_MAX_SIZE <= LOG_BURST_SIZE );
+
+    memcpy( ptrBurst, DROP_REPORT_PREFIX, length );
+
+    do
+    {
+        digits[ digitCount++ ] = ( uint8_t )( '0' + ( value % 10u ) );
+        value /= 10u;
+    } while( value != 0u );
+
+    while( digitCount > 0u )
+    {
+        ptrBurst[ length++ ] = digits[ --digitCount ];
+    }
+
+    memcpy( &ptrBurst[ length ], DROP_REPORT_SUFFIX, sizeof( DROP_REPORT_SUFFIX ) - 1u );
+
+    return length + sizeof( DROP_REPORT_SUFFIX ) - 1u;
+}
+
+#endif /* configUSE_LOG_RING */
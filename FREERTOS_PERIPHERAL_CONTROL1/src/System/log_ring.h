@@ -0,0 +1,193 @@
+/*
+ * @file log_ring.h
+ *
+ * @brief Header file for the non-blocking log, drained to the UART by the PDC
+ *
+ * Messages are appended to a lock-free ring (see lockfree_ring.h) in RAM, so
+ * any task, or any interrupt of any priority, can log without waiting for the
+ * transmitter or taking a mutex.  If the ring is full the message is dropped
+ * and counted instead.
+ *
+ * A low priority drain task empties the ring into a burst buffer and hands the
+ * whole burst to the PDC in one freertos_uart_write_packet_async() call.  Two
+ * burst buffers are used, so the next burst is gathered while the previous one
+ * is still being sent.  Whenever messages have been dropped since the last
+ * burst, a line giving the number dropped is sent ahead of the next messages.
+ *
+ * Each message occupies one slot of LOG_MESSAGE_SIZE bytes, so it is sent
+ * whole, never interleaved with another context's message.  A message longer
+ * than LOG_MAX_MESSAGE_LENGTH is cut short to fit its slot, and counted.
+ *
+ * The weak _write() of the ASF stdio (write.c) is replaced, so printf() to
+ * stdout or stderr is also appended to the log rather than waiting for the
+ * transmitter.  The module, including _write(), is only built when
+ * configUSE_LOG_RING is 1.
+ */
+#ifndef LOG_RING_H_
+#define LOG_RING_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before log_ring.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before log_ring.h"
+#endif
+
+#ifndef INC_FREERTOS_H
+    #error "Must include FreeRTOS.h before log_ring.h"
+#endif
+
+#include "freertos_uart_serial.h"
+
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Size of one ring slot, including its length byte
+#define LOG_MESSAGE_SIZE (128u)
+
+// Longest message kept whole
+#define LOG_MAX_MESSAGE_LENGTH ( LOG_MESSAGE_SIZE - 1u )
+
+// Number of ring slots, a power of two
+#define LOG_RING_SLOTS (32u)
+
+// Size of each of the two buffers handed to the PDC
+#define LOG_BURST_SIZE (512u)
+
+// How often the drain task looks for new messages while the ring is empty
+#define LOG_DRAIN_PERIOD_TICKS ( 20u / portTICK_RATE_MS )
+
+// Longest the drain task waits for the UART, then for a burst to be sent
+#define LOG_TX_TIMEOUT_TICKS ( 500u / portTICK_RATE_MS )
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t messagesWritten;       // messages added to the ring
+    uint32_t messagesDropped;       // messages not added because the ring was full
+    uint32_t messagesTruncated;     // messages added, but cut short to LOG_MAX_MESSAGE_LENGTH
+    uint32_t bytesWritten;          // message bytes added to the ring
+    uint32_t bursts;                // transfers handed to the PDC
+    uint32_t bytesSent;             // bytes handed to the PDC, including drop reports
+    uint32_t sendErrors;            // bursts lost because the UART was busy for too long
+    uint32_t ringHighWater;         // most slots found in use by the drain task
+    bool isDraining;                // true once LOG_StartDrain() has succeeded
+} LOG_Stats_t;
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function LOG_Init
+ *
+ * @brief Initialize the empty log ring.  Must be called before anything is
+ *        logged, and may be called before the scheduler is started.  Messages
+ *        logged before LOG_StartDrain() is called are kept until the ring is
+ *        full.
+ *
+ * @param void
+ *
+ * @return void (no return value)
+ */
+void LOG_Init( void );
+
+/**
+ * @function LOG_StartDrain
+ *
+ * @brief Create the task that sends the log to a UART.  The UART must have
+ *        been initialized with USE_TX_ACCESS_SEM if other tasks also write to
+ *        it, and bursts are sent without waiting for the previous one whether
+ *        or not WAIT_TX_COMPLETE is set.
+ *
+ * @param uart - the FreeRTOS UART port to send the log to
+ * @param stackDepth - stack size of the drain task, in words
+ * @param priority - priority of the drain task, normally tskIDLE_PRIORITY
+ *
+ * @return bool - true if the drain task was created, false if uart was NULL,
+ *                the drain was already started or the task could not be created
+ */
+bool LOG_StartDrain( freertos_uart_if uart,
+                     const uint16_t stackDepth,
+                     const UBaseType_t priority );
+
+/**
+ * @function LOG_Write
+ *
+ * @brief Append a message to the log without blocking.  Safe to call from any
+ *        task or interrupt, including interrupts above
+ *        configMAX_SYSCALL_INTERRUPT_PRIORITY.
+ *
+ * @param ptrData - the message
+ * @param length - the number of bytes; only the first LOG_MAX_MESSAGE_LENGTH
+ *                 are kept
+ *
+ * @return bool - true if the whole message was added, false if it was dropped
+ *                or cut short
+ */
+bool LOG_Write( const uint8_t *ptrData, const uint32_t length );
+
+/**
+ * @function LOG_WriteLong
+ *
+ * @brief Append bytes of any length to the log without blocking, as several
+ *        messages of up to LOG_MAX_MESSAGE_LENGTH bytes.  Another context's
+ *        message may be sent between the pieces.  Safe to call from any task
+ *        or interrupt.
+ *
+ * @param ptrData - the bytes to append
+ * @param length - the number of bytes
+ *
+ * @return bool - true if every piece was added, false if any was dropped
+ */
+bool LOG_WriteLong( const uint8_t *ptrData, const uint32_t length );
+
+/**
+ * @function LOG_Print
+ *
+ * @brief Append a null terminated string to the log without blocking.  Safe to
+ *        call from any task or interrupt.
+ *
+ * @param ptrString - the string to append
+ *
+ * @return bool - true if the whole string was added, false otherwise
+ */
+bool LOG_Print( const char *ptrString );
+
+/**
+ * @function LOG_GetStats
+ *
+ * @brief Get a snapshot of the log statistics
+ *
+ * @param ptrStats - filled in with the statistics
+ *
+ * @return bool - true if ptrStats was valid, false otherwise
+ */
+bool LOG_GetStats( LOG_Stats_t *ptrStats );
+
+#if defined( __GNUC__ )
+/**
+ * @function _write
+ *
+ * @brief Append what the C library writes to stdout or stderr to the log, as
+ *        messages of up to LOG_MAX_MESSAGE_LENGTH bytes.  Replaces the weak
+ *        version in the ASF stdio.  printf() itself may not be called from an
+ *        interrupt.
+ *
+ * @param file - the file number, 1 or 2 (3 is accepted, as by the ASF stdio)
+ * @param ptr - the bytes to write
+ * @param len - the number of bytes
+ *
+ * @return int - len, including bytes dropped because the log was full, or -1
+ *               for any other file
+ */
+int _write( int file, const char *ptr, int len );
+#endif
+
+#endif /* LOG_RING_H_ */
@@ -0,0 +1,621 @@
+/*
+ * @file object_registry.c
+ *
+ * @brief Kernel object registry
+ *
+ * The entries live in a fixed array.  Each hash table slot holds the index of
+ * an entry plus one, 0 for a slot never used, or SLOT_DELETED for a slot whose
+ * entry was removed, so that probing carries on past it.  Once too many slots
+ * are marked deleted both tables are rebuilt from the entries.
+ *
+ * Objects are created and deleted from tasks (or from main() before the
+ * scheduler starts), never from interrupts, so the tables are protected with
+ * critical sections.
+ */
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+#define TABLE_SIZE ( 2u * REG_MAX_OBJECTS )     // keeps the load factor at or below 0.5
+#define TABLE_MASK ( TABLE_SIZE - 1u )
+#define HANDLE_HASH_SHIFT (26u)                 // 32 - log2( TABLE_SIZE )
+#define HASH_MULTIPLIER (2654435761u)
+#define FNV_OFFSET_BASIS (2166136261u)
+#define FNV_PRIME (16777619u)
+
+#define SLOT_EMPTY (0u)
+#define SLOT_DELETED (0xFFu)
+#define NOT_FOUND TABLE_SIZE
+
+#define INIT_CREATOR_NAME "init"
+
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+#include "string.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "stream_buffer.h"
+
+// this file's header
+#include "object_registry.h"
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef struct
+{
+    void *handle;                   // NULL when the entry is unused
+    const char *ptrName;
+    REG_Type_t type;
+    uint32_t capacity;
+    char creatorName[ configMAX_TASK_NAME_LEN ];
+} REG_Entry_t;
+
+
+/*------------------------------------------------------------
+                      Local Variables
+-------------------------------------------------------------*/
+static REG_Entry_t entries[ REG_MAX_OBJECTS ];
+static uint8_t handleTable[ TABLE_SIZE ];
+static uint8_t nameTable[ TABLE_SIZE ];
+static uint32_t deletedSlotCount = 0u;
+
+// Entries are handed out in order until all have been used once, then from
+// the stack of entries freed by deletes.
+static uint32_t nextUnusedEntry = 0u;
+static uint8_t freeEntries[ REG_MAX_OBJECTS ];
+static uint32_t freeEntryCount = 0u;
+
+static uint32_t droppedCount = 0u;
+
+static const char * const typeNames[ REG_NUM_TYPES ] =
+{
+    "queue",
+    "mutex",
+    "rmutex",
+    "binary",
+    "counting",
+    "timer",
+    "events",
+    "stream",
+    "message"
+};
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static void prvAddObject( void *handle, const REG_Type_t type, const uint32_t capacity, const char *ptrName );
+static void prvGetCreatorName( char *ptrCreatorName );
+static uint32_t prvHashHandle( const void *handle );
+static uint32_t prvHashName( const char *ptrName );
+static uint32_t prvFindHandleSlot( const void *handle );
+static uint32_t prvFindNameSlot( const char *ptrName );
+static void prvInsertSlot( uint8_t *ptrTable, const uint32_t hash, const uint32_t entry );
+static void prvAddName( const uint32_t entry, const char *ptrName );
+static void prvRemoveName( const uint32_t entry );
+static void prvMarkDeleted( uint8_t *ptrTable, const uint32_t slot );
+static void prvRebuildTables( void );
+static void prvFillInfo( const REG_Entry_t *ptrEntry, REG_Info_t *ptrInfo );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+void REG_SetName( void *handle, const char *ptrName )
+{
+    uint32_t slot;
+    uint32_t entry;
+
+    taskENTER_CRITICAL();
+    {
+        slot = prvFindHandleSlot( handle );
+
+        if( slot != NOT_FOUND )
+        {
+            entry = handleTable[ slot ] - 1u;
+
+            prvRemoveName( entry );
+            prvAddName( entry, ptrName );
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+
+/*-----------------------------------------------------------*/
+void *REG_FindByName( const char *ptrName )
+{
+    void *handle = NULL;
+    uint32_t slot;
+
+    if( ptrName == NULL )
+    {
+        return NULL;
+    }
+
+    taskENTER_CRITICAL();
+    {
+        slot = prvFindNameSlot( ptrName );
+
+        if( slot != NOT_FOUND )
+        {
+            handle = entries[ nameTable[ slot ] - 1u ].handle;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return handle;
+}
+
+
+/*-----------------------------------------------------------*/
+bool REG_GetInfo( const void *handle, REG_Info_t *ptrInfo )
+{
+    REG_Entry_t entry;
+    uint32_t slot;
+    bool isFound = false;
+
+    if( ( handle == NULL ) || ( ptrInfo == NULL ) )
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    {
+        slot = prvFindHandleSlot( handle );
+
+        if( slot != NOT_FOUND )
+        {
+            entry = entries[ handleTable[ slot ] - 1u ];
+            isFound = true;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    // the depth is read after leaving the critical section
+    if( isFound )
+    {
+        prvFillInfo( &entry, ptrInfo );
+    }
+
+    return isFound;
+}
+
+
+/*-----------------------------------------------------------*/
+bool REG_GetInfoByIndex( const uint32_t index, REG_Info_t *ptrInfo )
+{
+    REG_Entry_t entry;
+    bool isFound = false;
+
+    if( ( index >= REG_MAX_OBJECTS ) || ( ptrInfo == NULL ) )
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    {
+        entry = entries[ index ];
+        isFound = ( entry.handle != NULL );
+    }
+    taskEXIT_CRITICAL();
+
+    if( isFound )
+    {
+        prvFillInfo( &entry, ptrInfo );
+    }
+
+    return isFound;
+}
+
+
+/*-----------------------------------------------------------*/
+const char *REG_GetTypeName( const REG_Type_t type )
+{
+    return ( type < REG_NUM_TYPES ) ? typeNames[ type ] : "?";
+}
+
+
+/*-----------------------------------------------------------*/
+uint32_t REG_GetDroppedCount( void )
+{
+    return droppedCount;
+}
+
+
+/*-----------------------------------------------------------*/
+void REG_TraceQueueCreate( void *handle, const uint8_t queueType, const uint32_t length )
+{
+    REG_Type_t type;
+
+    switch( queueType )
+    {
+        case queueQUEUE_TYPE_MUTEX:
+            type = REG_TYPE_MUTEX;
+            break;
+
+        case queueQUEUE_TYPE_RECURSIVE_MUTEX:
+            type = REG_TYPE_RECURSIVE_MUTEX;
+            break;
+
+        case queueQUEUE_TYPE_BINARY_SEMAPHORE:
+            type = REG_TYPE_BINARY_SEMAPHORE;
+            break;
+
+        case queueQUEUE_TYPE_COUNTING_SEMAPHORE:
+            type = REG_TYPE_COUNTING_SEMAPHORE;
+            break;
+
+        default:
+            // queue sets are queues of handles
+            type = REG_TYPE_QUEUE;
+            break;
+    }
+
+    prvAddObject( handle, type, length, NULL );
+}
+
+
+/*-----------------------------------------------------------*/
+void REG_TraceTimerCreate( void *handle, const char *ptrName )
+{
+    prvAddObject( handle, REG_TYPE_TIMER, 0u, ptrName );
+}
+
+
+/*-----------------------------------------------------------*/
+void REG_TraceEventGroupCreate( void *handle )
+{
+    prvAddObject( handle, REG_TYPE_EVENT_GROUP, 0u, NULL );
+}
+
+
+/*-----------------------------------------------------------*/
+void REG_TraceStreamBufferCreate( void *handle, const uint32_t isMessageBuffer )
+{
+    // the buffer is empty, so all of its space is available
+    prvAddObject( handle,
+                  ( isMessageBuffer != 0u ) ? REG_TYPE_MESSAGE_BUFFER : REG_TYPE_STREAM_BUFFER,
+                  ( uint32_t ) xStreamBufferSpacesAvailable( ( StreamBufferHandle_t ) handle ),
+                  NULL );
+}
+
+
+/*-----------------------------------------------------------*/
+void REG_TraceObjectDelete( void *handle )
+{
+    uint32_t slot;
+    uint32_t entry;
+
+    taskENTER_CRITICAL();
+    {
+        slot = prvFindHandleSlot( handle );
+
+        if( slot != NOT_FOUND )
+        {
+            entry = handleTable[ slot ] - 1u;
+
+            prvRemoveName( entry );
+            prvMarkDeleted( handleTable, slot );
+
+            memset( &entries[ entry ], 0, sizeof( entries[ entry ] ) );
+            freeEntries[ freeEntryCount++ ] = ( uint8_t ) entry;
+
+            if( deletedSlotCount > REG_MAX_OBJECTS )
+            {
+                prvRebuildTables();
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static void prvAddObject( void *handle, const REG_Type_t type, const uint32_t capacity, const char *ptrName )
+{
+    char creatorName[ configMAX_TASK_NAME_LEN ];
+    uint32_t slot;
+    uint32_t entry = NOT_FOUND;
+
+    prvGetCreatorName( creatorName );
+
+    taskENTER_CRITICAL();
+    {
+        slot = prvFindHandleSlot( handle );
+
+        if( slot != NOT_FOUND )
+        {
+            // The memory of an object that was never traced as deleted (a
+            // timer) has been reused, so take over its entry.
+            entry = handleTable[ slot ] - 1u;
+            prvRemoveName( entry );
+        }
+        else if( freeEntryCount > 0u )
+        {
+            entry = freeEntries[ --freeEntryCount ];
+            prvInsertSlot( handleTable, prvHashHandle( handle ), entry );
+        }
+        else if( nextUnusedEntry < REG_MAX_OBJECTS )
+        {
+            entry = nextUnusedEntry++;
+            prvInsertSlot( handleTable, prvHashHandle( handle ), entry );
+        }
+        else
+        {
+            droppedCount++;
+        }
+
+        if( entry != NOT_FOUND )
+        {
+            entries[ entry ].handle = handle;
+            entries[ entry ].type = type;
+            entries[ entry ].capacity = capacity;
+            memcpy( entries[ entry ].creatorName, creatorName, sizeof( creatorName ) );
+
+            prvAddName( entry, ptrName );
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvGetCreatorName( char *ptrCreatorName )
+{
+    // Before the scheduler starts the current task is just the highest
+    // priority task created so far, not the creator.
+    if( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED )
+    {
+        strncpy( ptrCreatorName, INIT_CREATOR_NAME, configMAX_TASK_NAME_LEN );
+    }
+    else
+    {
+        strncpy( ptrCreatorName, pcTaskGetName( NULL ), configMAX_TASK_NAME_LEN );
+    }
+
+    ptrCreatorName[ configMAX_TASK_NAME_LEN - 1 ] = '\0';
+}
+
+
+/*-----------------------------------------------------------*/
+static uint32_t prvHashHandle( const void *handle )
+{
+    return ( ( uint32_t ) handle * HASH_MULTIPLIER ) >> HANDLE_HASH_SHIFT;
+}
+
+
+/*-----------------------------------------------------------*/
+static uint32_t prvHashName( const char *ptrName )
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    while( *ptrName != '\0' )
+    {
+        hash ^= ( uint8_t ) *ptrName++;
+        hash *= FNV_PRIME;
+    }
+
+    return hash & TABLE_MASK;
+}
+
+
+/*-----------------------------------------------------------*/
+static uint32_t prvFindHandleSlot( const void *handle )
+{
+    uint32_t hash = prvHashHandle( handle );
+    uint32_t probe;
+    uint32_t slot;
+    uint8_t value;
+
+    // linear probing, stopping at a slot that has never been used
+    for( probe = 0u; probe < TABLE_SIZE; probe++ )
+    {
+        slot = ( hash + probe ) & TABLE_MASK;
+        value = handleTable[ slot ];
+
+        if( value == SLOT_EMPTY )
+        {
+            break;
+        }
+
+        if( ( value != SLOT_DELETED ) && ( entries[ value - 1u ].handle == handle ) )
+        {
+            return slot;
+        }
+    }
+
+    return NOT_FOUND;
+}
+
+
+/*-----------------------------------------------------------*/
+static uint32_t prvFindNameSlot( const char *ptrName )
+{
+    uint32_t hash = prvHashName( ptrName );
+    uint32_t probe;
+    uint32_t slot;
+    uint8_t value;
+
+    for( probe = 0u; probe < TABLE_SIZE; probe++ )
+    {
+        slot = ( hash + probe ) & TABLE_MASK;
+        value = nameTable[ slot ];
+
+        if( value == SLOT_EMPTY )
+        {
+            break;
+        }
+
+        if( ( value != SLOT_DELETED ) && ( strcmp( entries[ value - 1u ].ptrName, ptrName ) == 0 ) )
+        {
+            return slot;
+        }
+    }
+
+    return NOT_FOUND;
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvInsertSlot( uint8_t *ptrTable, const uint32_t hash, const uint32_t entry )
+{
+    uint32_t probe;
+    uint32_t slot;
+
+    // There are twice as many slots as entries, so there is always room.
+    for( probe = 0u; probe < TABLE_SIZE; probe++ )
+    {
+        slot = ( hash + probe ) & TABLE_MASK;
+
+        if( ptrTable[ slot ] == SLOT_DELETED )
+        {
+            deletedSlotCount--;
+            break;
+        }
+
+        if( ptrTable[ slot ] == SLOT_EMPTY )
+        {
+            break;
+        }
+    }
+
+    configASSERT( probe < TABLE_SIZE );
+    ptrTable[ slot ] = ( uint8_t )( entry + 1u );
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvAddName( const uint32_t entry, const char *ptrName )
+{
+    entries[ entry ].ptrName = ptrName;
+
+    if( ptrName != NULL )
+    {
+        prvInsertSlot( nameTable, prvHashName( ptrName ), entry );
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvRemoveName( const uint32_t entry )
+{
+    const char *ptrName = entries[ entry ].ptrName;
+    uint32_t hash;
+    uint32_t probe;
+    uint32_t slot;
+
+    if( ptrName == NULL )
+    {
+        return;
+    }
+
+    // Other objects can have the same name, so look for this entry's slot
+    // rather than the first slot with a matching name.
+    hash = prvHashName( ptrName );
+
+    for( probe = 0u; probe < TABLE_SIZE; probe++ )
+    {
+        slot = ( hash + probe ) & TABLE_MASK;
+
+        if( nameTable[ slot ] == SLOT_EMPTY )
+        {
+            break;
+        }
+
+        if( nameTable[ slot ] == ( uint8_t )( entry + 1u ) )
+        {
+            prvMarkDeleted( nameTable, slot );
+            break;
+        }
+    }
+
+    entries[ entry ].ptrName = NULL;
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvMarkDeleted( uint8_t *ptrTable, const uint32_t slot )
+{
+    ptrTable[ slot ] = SLOT_DELETED;
+    deletedSlotCount++;
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvRebuildTables( void )
+{
+    uint32_t entry;
+
+    memset( handleTable, SLOT_EMPTY, sizeof( handleTable ) );
+    memset( nameTable, SLOT_EMPTY, sizeof( nameTable ) );
+    deletedSlotCount = 0u;
+
+    for( entry = 0u; entry < nextUnusedEntry; entry++ )
+    {
+        if( entries[ entry ].handle != NULL )
+        {
+            prvInsertSlot( handleTable, prvHashHandle( entries[ entry ].handle ), entry );
+
+            if( entries[ entry ].ptrName != NULL )
+            {
+                prvInsertSlot( nameTable, prvHashName( entries[ entry ].ptrName ), entry );
+            }
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvFillInfo( const REG_Entry_t *ptrEntry, REG_Info_t *ptrInfo )
+{
+    ptrInfo->handle = ptrEntry->handle;
+    ptrInfo->ptrName = ptrEntry->ptrName;
+    ptrInfo->type = ptrEntry->type;
+    ptrInfo->capacity = ptrEntry->capacity;
+    memcpy( ptrInfo->creatorName, ptrEntry->creatorName, sizeof( ptrInfo->creatorName ) );
+    ptrInfo->hasDepth = true;
+    ptrInfo->depth = 0u;
+    ptrInfo->highWaterMark = 0u;
+
+    switch( ptrEntry->type )
+    {
+        case REG_TYPE_QUEUE:
+        case REG_TYPE_MUTEX:
+        case REG_TYPE_RECURSIVE_MUTEX:
+        case REG_TYPE_BINARY_SEMAPHORE:
+        case REG_TYPE_COUNTING_SEMAPHORE:
+            // for a mutex or semaphore this is the count, 1 when a mutex is free
+            ptrInfo->depth = ( uint32_t ) uxQueueMessagesWaiting( ( QueueHandle_t ) ptrEntry->handle );
+            #if ( configUSE_QUEUE_HIGH_WATER_MARK == 1 )
+                ptrInfo->highWaterMark = ( uint32_t ) uxQueueGetHighWaterMark( ( QueueHandle_t ) ptrEntry->handle );
+            #endif
+            break;
+
+        case REG_TYPE_STREAM_BUFFER:
+        case REG_TYPE_MESSAGE_BUFFER:
+            ptrInfo->depth = ( uint32_t ) xStreamBufferBytesAvailable( ( StreamBufferHandle_t ) ptrEntry->handle );
+            break;
+
+        default:
+            ptrInfo->hasDepth = false;
+            break;
+    }
+}
@@ -0,0 +1,157 @@
+/*
+ * @file object_registry.h
+ *
+ * @brief Header file for the kernel object registry
+ *
+ * Every queue, semaphore, mutex, software timer, event group and stream or
+ * message buffer is recorded as it is created, through the kernel trace macros
+ * set up in FreeRTOSConfig.h, and forgotten when it is deleted.  The registry
+ * keeps the type of each object, the name of the task that created it and its
+ * capacity, and can report its current depth and high-water mark for capacity
+ * planning.
+ *
+ * Objects are found through two open addressed hash tables, one keyed by
+ * handle and one by name, so lookups take constant time however many objects
+ * exist.  Queues, semaphores and mutexes are named by vQueueAddToRegistry()
+ * (there is no limit of configQUEUE_REGISTRY_SIZE here), timers by the name
+ * given to xTimerCreate(), and anything else by REG_SetName().
+ *
+ * Software timers have no delete trace macro, so the entry of a deleted timer
+ * stays until the memory is reused for another object.
+ */
+#ifndef OBJECT_REGISTRY_H_
+#define OBJECT_REGISTRY_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before object_registry.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before object_registry.h"
+#endif
+
+#ifndef INC_FREERTOS_H
+    #error "Must include FreeRTOS.h before object_registry.h"
+#endif
+
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Maximum number of objects that can be recorded at once
+#define REG_MAX_OBJECTS (32u)
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef enum
+{
+    REG_TYPE_QUEUE = 0,
+    REG_TYPE_MUTEX,
+    REG_TYPE_RECURSIVE_MUTEX,
+    REG_TYPE_BINARY_SEMAPHORE,
+    REG_TYPE_COUNTING_SEMAPHORE,
+    REG_TYPE_TIMER,
+    REG_TYPE_EVENT_GROUP,
+    REG_TYPE_STREAM_BUFFER,
+    REG_TYPE_MESSAGE_BUFFER,
+
+    REG_NUM_TYPES
+} REG_Type_t;
+
+// Snapshot of one registered object
+typedef struct
+{
+    void *handle;
+    const char *ptrName;                        // NULL if the object was never named
+    REG_Type_t type;
+    char creatorName[ configMAX_TASK_NAME_LEN ];  // "init" if created before the scheduler started
+    bool hasDepth;                              // false for timers and event groups
+    uint32_t capacity;                          // items, or bytes for stream and message buffers
+    uint32_t depth;                             // items (or count, or bytes) held now
+    uint32_t highWaterMark;                     // most ever held, 0 where the kernel does not track it
+} REG_Info_t;
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function REG_SetName
+ *
+ * @brief Give a registered object a name so it can be found by REG_FindByName
+ *
+ * @param handle - handle of the object
+ * @param ptrName - the name, must be persistent; NULL removes the name
+ *
+ * @return void (no return value)
+ *
+ * Declared in FreeRTOSConfig.h, where the kernel trace macros need it.
+ */
+
+/**
+ * @function REG_FindByName
+ *
+ * @brief Look up an object by name.  If several objects share the name one of
+ *        them is returned.
+ *
+ * @param ptrName - the name to look for
+ *
+ * @return void * - handle of the object, NULL if there is none
+ */
+void *REG_FindByName( const char *ptrName );
+
+/**
+ * @function REG_GetInfo
+ *
+ * @brief Take a snapshot of a registered object, including its current depth.
+ *        The object must not be deleted while this runs.
+ *
+ * @param handle - handle of the object
+ * @param ptrInfo - filled in with the snapshot
+ *
+ * @return bool - true if the object is registered, false otherwise
+ */
+bool REG_GetInfo( const void *handle, REG_Info_t *ptrInfo );
+
+/**
+ * @function REG_GetInfoByIndex
+ *
+ * @brief Take a snapshot of the object in a slot of the registry, for walking
+ *        every object with index 0 to REG_MAX_OBJECTS - 1
+ *
+ * @param index - slot of the registry
+ * @param ptrInfo - filled in with the snapshot
+ *
+ * @return bool - true if the slot holds an object, false if it is unused
+ */
+bool REG_GetInfoByIndex( const uint32_t index, REG_Info_t *ptrInfo );
+
+/**
+ * @function REG_GetTypeName
+ *
+ * @brief Get a short printable name for an object type
+ *
+ * @param type - the type
+ *
+ * @return const char * - the name
+ */
+const char *REG_GetTypeName( const REG_Type_t type );
+
+/**
+ * @function REG_GetDroppedCount
+ *
+ * @brief Get the number of objects not recorded because the registry was full
+ *
+ * @param void
+ *
+ * @return uint32_t - the number of objects dropped
+ */
+uint32_t REG_GetDroppedCount( void );
+
+// REG_TraceQueueCreate() and the other REG_Trace functions are called only
+// from the kernel trace macros, and are declared with them in FreeRTOSConfig.h.
+
+#endif /* OBJECT_REGISTRY_H_ */
@@ -0,0 +1,226 @@
+/*
+ * @file rw_lock.c
+ *
+ * @brief Reader-writer lock with writer preference
+ *
+ * A writer takes writeMutex and keeps it for the whole write.  A reader only
+ * takes writeMutex long enough to register itself, so readers never wait for
+ * each other, but any reader arriving after a writer queues behind it.  The
+ * writer then waits on readersDoneSem for the readers already inside to leave.
+ */
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+#include "string.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+// this file's header
+#include "rw_lock.h"
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static void prvBoostReaders( RWL_Lock_t *ptrLock, const UBaseType_t writerPriority );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+bool RWL_Create( RWL_Lock_t *ptrLock )
+{
+    bool isValid = ( ptrLock != NULL );
+
+    if( isValid )
+    {
+        memset( ptrLock, 0, sizeof( *ptrLock ) );
+
+        ptrLock->writeMutex = xSemaphoreCreateMutex();
+        ptrLock->readersDoneSem = xSemaphoreCreateBinary();
+
+        isValid = ( ptrLock->writeMutex != NULL ) && ( ptrLock->readersDoneSem != NULL );
+    }
+
+    return isValid;
+}
+
+
+/*-----------------------------------------------------------*/
+bool RWL_ReadLock( RWL_Lock_t *ptrLock, const TickType_t timeoutTicks )
+{
+    uint32_t slot;
+    bool isLocked = false;
+
+    configASSERT( ptrLock );
+
+    // Queue behind any writer that holds or is waiting for the lock.
+    if( xSemaphoreTake( ptrLock->writeMutex, timeoutTicks ) == pdTRUE )
+    {
+        taskENTER_CRITICAL();
+        {
+            for( slot = 0u; slot < RWL_MAX_READERS; slot++ )
+            {
+                if( ptrLock->readers[ slot ].task == NULL )
+                {
+                    ptrLock->readers[ slot ].task = xTaskGetCurrentTaskHandle();
+                    ptrLock->readers[ slot ].priority = uxTaskPriorityGet( NULL );
+                    ptrLock->readers[ slot ].isBoosted = false;
+                    ptrLock->readerCount++;
+                    isLocked = true;
+                    break;
+                }
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        ( void ) xSemaphoreGive( ptrLock->writeMutex );
+    }
+
+    return isLocked;
+}
+
+
+/*-----------------------------------------------------------*/
+void RWL_ReadUnlock( RWL_Lock_t *ptrLock )
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    uint32_t slot;
+    bool isBoosted = false;
+    bool isLastReader = false;
+    UBaseType_t priority = 0u;
+
+    configASSERT( ptrLock );
+
+    taskENTER_CRITICAL();
+    {
+        for( slot = 0u; slot < RWL_MAX_READERS; slot++ )
+        {
+            if( ptrLock->readers[ slot ].task == self )
+            {
+                isBoosted = ptrLock->readers[ slot ].isBoosted;
+                priority = ptrLock->readers[ slot ].priority;
+                ptrLock->readers[ slot ].task = NULL;
+
+                configASSERT( ptrLock->readerCount > 0u );
+                ptrLock->readerCount--;
+                isLastReader = ( ptrLock->readerCount == 0u ) && ptrLock->isWriterWaiting;
+                break;
+            }
+        }
+
+        // unlocking a lock this task does not hold
+        configASSERT( slot < RWL_MAX_READERS );
+    }
+    taskEXIT_CRITICAL();
+
+    if( isLastReader )
+    {
+        ( void ) xSemaphoreGive( ptrLock->readersDoneSem );
+    }
+
+    // drop back from a writer's priority only once the writer can run
+    if( isBoosted )
+    {
+        vTaskPrioritySet( NULL, priority );
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+bool RWL_WriteLock( RWL_Lock_t *ptrLock, const TickType_t timeoutTicks )
+{
+    TimeOut_t timeOut;
+    TickType_t ticksLeft = timeoutTicks;
+    bool isLocked = false;
+    bool isDrained;
+
+    configASSERT( ptrLock );
+
+    vTaskSetTimeOutState( &timeOut );
+
+    if( xSemaphoreTake( ptrLock->writeMutex, ticksLeft ) != pdTRUE )
+    {
+        return false;
+    }
+
+    // No new reader can get in now.  Clear any give left over from a writer
+    // that timed out, then wait for the readers already inside.
+    ( void ) xSemaphoreTake( ptrLock->readersDoneSem, 0u );
+
+    for( ;; )
+    {
+        taskENTER_CRITICAL();
+        {
+            isDrained = ( ptrLock->readerCount == 0u );
+            ptrLock->isWriterWaiting = !isDrained;
+
+            if( !isDrained )
+            {
+                prvBoostReaders( ptrLock, uxTaskPriorityGet( NULL ) );
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if( isDrained )
+        {
+            isLocked = true;
+            break;
+        }
+
+        if( ( xTaskCheckForTimeOut( &timeOut, &ticksLeft ) != pdFALSE ) ||
+            ( xSemaphoreTake( ptrLock->readersDoneSem, ticksLeft ) != pdTRUE ) )
+        {
+            // Timed out.  Boosted readers drop back when they unlock.
+            ptrLock->isWriterWaiting = false;
+            ( void ) xSemaphoreGive( ptrLock->writeMutex );
+            break;
+        }
+    }
+
+    return isLocked;
+}
+
+
+/*-----------------------------------------------------------*/
+void RWL_WriteUnlock( RWL_Lock_t *ptrLock )
+{
+    configASSERT( ptrLock );
+
+    ( void ) xSemaphoreGive( ptrLock->writeMutex );
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static void prvBoostReaders( RWL_Lock_t *ptrLock, const UBaseType_t writerPriority )
+{
+    uint32_t slot;
+    RWL_Reader_t *ptrReader;
+
+    // Called from a critical section.  FreeRTOS only inherits through a mutex
+    // with a single holder, so the readers are raised by hand.
+    for( slot = 0u; slot < RWL_MAX_READERS; slot++ )
+    {
+        ptrReader = &ptrLock->readers[ slot ];
+
+        if( ( ptrReader->task != NULL ) && ( ptrReader->priority < writerPriority ) )
+        {
+            vTaskPrioritySet( ptrReader->task, writerPriority );
+            ptrReader->isBoosted = true;
+        }
+    }
+}
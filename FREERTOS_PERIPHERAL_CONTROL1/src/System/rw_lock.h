@@ -0,0 +1,130 @@
+/*
+ * @file rw_lock.h
+ *
+ * @brief Header file for the reader-writer lock
+ *
+ * Any number of readers (up to RWL_MAX_READERS at once) can hold the lock
+ * together, or a single writer can hold it alone.  Writers are preferred: once
+ * a writer is waiting no new reader gets in, so a steady stream of readers
+ * cannot starve it.
+ *
+ * Priority inversion is bounded in both directions:
+ *   - a reader or writer waiting for a writer inherits through the FreeRTOS
+ *     mutex the writer holds
+ *   - a writer waiting for readers to finish raises every lower priority
+ *     reader to its own priority until that reader unlocks
+ *
+ * Must not be used from interrupts.  A task must not take the write lock while
+ * it holds the read lock.
+ */
+#ifndef RW_LOCK_H_
+#define RW_LOCK_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before rw_lock.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before rw_lock.h"
+#endif
+
+#ifndef INC_FREERTOS_H
+    #error "Must include FreeRTOS.h before rw_lock.h"
+#endif
+
+#include "task.h"
+#include "semphr.h"
+
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// Maximum number of readers holding one lock at the same time
+#define RWL_MAX_READERS (6u)
+
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef struct
+{
+    TaskHandle_t task;              // NULL when the slot is unused
+    UBaseType_t priority;           // priority of the reader when it took the lock
+    bool isBoosted;                 // raised by a waiting writer
+} RWL_Reader_t;
+
+// Lock control block.  Allocated by the caller; the members are private to
+// rw_lock.c.
+typedef struct
+{
+    SemaphoreHandle_t writeMutex;       // held by the writer, briefly by readers entering
+    SemaphoreHandle_t readersDoneSem;   // given by the last reader out to a waiting writer
+    volatile uint32_t readerCount;
+    volatile bool isWriterWaiting;
+    RWL_Reader_t readers[ RWL_MAX_READERS ];
+} RWL_Lock_t;
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function RWL_Create
+ *
+ * @brief Create a reader-writer lock
+ *
+ * @param ptrLock - lock control block to initialize
+ *
+ * @return bool - true if the lock was created, false otherwise
+ */
+bool RWL_Create( RWL_Lock_t *ptrLock );
+
+/**
+ * @function RWL_ReadLock
+ *
+ * @brief Take the lock for reading
+ *
+ * @param ptrLock - the lock
+ * @param timeoutTicks - maximum time to wait for a writer to finish
+ *
+ * @return bool - true if the lock was taken, false on timeout or if
+ *                RWL_MAX_READERS readers already hold it
+ */
+bool RWL_ReadLock( RWL_Lock_t *ptrLock, const TickType_t timeoutTicks );
+
+/**
+ * @function RWL_ReadUnlock
+ *
+ * @brief Release a read lock taken by the calling task
+ *
+ * @param ptrLock - the lock
+ *
+ * @return void (no return value)
+ */
+void RWL_ReadUnlock( RWL_Lock_t *ptrLock );
+
+/**
+ * @function RWL_WriteLock
+ *
+ * @brief Take the lock for writing, waiting for the current readers to finish
+ *
+ * @param ptrLock - the lock
+ * @param timeoutTicks - maximum time to wait in total
+ *
+ * @return bool - true if the lock was taken, false on timeout
+ */
+bool RWL_WriteLock( RWL_Lock_t *ptrLock, const TickType_t timeoutTicks );
+
+/**
+ * @function RWL_WriteUnlock
+ *
+ * @brief Release the write lock
+ *
+ * @param ptrLock - the lock
+ *
+ * @return void (no return value)
+ */
+void RWL_WriteUnlock( RWL_Lock_t *ptrLock );
+
+#endif /* RW_LOCK_H_ */
@@ -0,0 +1,308 @@
+/*
+ * @file tickless_idle.c
+ *
+ * @brief RTT based tickless idle (portSUPPRESS_TICKS_AND_SLEEP) implementation
+ *
+ * Time is tracked in "scaled" units of RTT counts * configTICK_RATE_HZ, so one
+ * tick is RTT_FREQUENCY_HZ scaled units and one RTT count is configTICK_RATE_HZ
+ * scaled units.  This keeps the conversions between SysTick, RTT and kernel
+ * ticks exact integer arithmetic.  The part of a tick that had already passed
+ * when the MCU went to sleep, and the part that has passed when it wakes, are
+ * carried over through the SysTick count so no time is lost between sleeps.
+ */
+
+/*------------------------------------------------------------
+                         Constants
+-------------------------------------------------------------*/
+// RTT prescaler: 32768 Hz / 4 = 8192 Hz, a resolution of ~122 us.
+#define RTT_PRESCALER (4u)
+#define RTT_FREQUENCY_HZ ( BOARD_FREQ_SLCK_XTAL / RTT_PRESCALER )
+
+// Sleeps shorter than this many RTT counts are not worth the set up time and
+// risk the alarm being programmed in the past.
+#define MIN_SLEEP_RTT_COUNTS (4u)
+
+// Keep every scaled calculation within 32 bits (about one minute of sleep).
+#define MAX_SUPPRESSED_TICKS ( ( TickType_t ) 60000u )
+
+
+/*------------------------------------------------------------
+                          Includes
+-------------------------------------------------------------*/
+// standard includes
+#include "stdbool.h"
+#include "stdint.h"
+#include "stddef.h"
+
+// hardware includes
+#include "compiler.h"
+#include "board.h"
+#include "sysclk.h"
+#include "osc.h"
+#include "sleepmgr.h"
+
+// freeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+// this file's header
+#include "tickless_idle.h"
+
+
+/*------------------------------------------------------------
+                      Local Variables
+-------------------------------------------------------------*/
+static uint32_t sysTickCountsPerTick = 0u;
+
+// written by the RTT interrupt
+static volatile bool isRttAlarmWake = false;
+
+// only written by the idle task with interrupts disabled
+static TLI_Stats_t stats;
+static uint64_t totalWakeLatencyCycles = 0u;
+
+
+/*------------------------------------------------------------
+                  Local Function Prototypes
+-------------------------------------------------------------*/
+static uint32_t prvReadRtt( void );
+static void prvRestartSysTick( const uint32_t countsToNextTick );
+static void prvRecordWakeLatency( const uint32_t latencyCycles );
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+void TLI_Init( void )
+{
+    sysTickCountsPerTick = configCPU_CLOCK_HZ / configTICK_RATE_HZ;
+
+    // The internal slow RC oscillator is too inaccurate to keep the tick
+    // count, so run the slow clock from the 32 kHz crystal.
+    osc_enable( OSC_SLCK_32K_XTAL );
+    osc_wait_ready( OSC_SLCK_32K_XTAL );
+
+    RTT->RTT_MR = RTT_MR_RTPRES( RTT_PRESCALER ) | RTT_MR_RTTRST;
+
+    NVIC_DisableIRQ( RTT_IRQn );
+    NVIC_ClearPendingIRQ( RTT_IRQn );
+    NVIC_SetPriority( RTT_IRQn, configLIBRARY_LOWEST_INTERRUPT_PRIORITY );
+    NVIC_EnableIRQ( RTT_IRQn );
+
+    // The clocks of the drivers are not stopped and restored around a sleep,
+    // so never let the sleep manager go deeper than WFI sleep.
+    sleepmgr_init();
+    sleepmgr_lock_mode( SLEEPMGR_SLEEP_WFI );
+
+    // The wake-up latency is timed with the DWT cycle counter.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+
+/*-----------------------------------------------------------*/
+bool TLI_GetStats( TLI_Stats_t *ptrStats )
+{
+    bool isValid = ( ptrStats != NULL );
+
+    if( isValid )
+    {
+        taskENTER_CRITICAL();
+        {
+            *ptrStats = stats;
+
+            if( stats.wakeLatencyCount > 0u )
+            {
+                ptrStats->avgWakeLatencyCycles = ( uint32_t )( totalWakeLatencyCycles / stats.wakeLatencyCount );
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    return isValid;
+}
+
+
+/*------------------------------------------------------------
+                   Interrupts and Port Hooks
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+void RTT_Handler( void )
+{
+    // Only used to wake the MCU and tell an alarm from any other wake-up
+    // source.  Reading the status register clears the alarm.
+    if( ( RTT->RTT_SR & RTT_SR_ALMS ) != 0u )
+    {
+        isRttAlarmWake = true;
+    }
+}
+
+
+/*-----------------------------------------------------------*/
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+    uint32_t elapsedTickCounts;
+    uint32_t entryScaled;
+    uint32_t sleepRttCounts;
+    uint32_t startRtt;
+    uint32_t endRtt;
+    uint64_t elapsedScaled;
+    uint32_t remainderScaled;
+    uint32_t wakeCycles;
+    TickType_t completeTicks;
+    bool isAbort;
+
+    if( xExpectedIdleTime > MAX_SUPPRESSED_TICKS )
+    {
+        xExpectedIdleTime = MAX_SUPPRESSED_TICKS;
+    }
+
+    // Don't use taskENTER_CRITICAL() as that masks the interrupts that must
+    // wake the MCU.  With PRIMASK set an interrupt still ends the WFI, but its
+    // handler only runs once interrupts are re-enabled below.
+    __disable_irq();
+    __DSB();
+    __ISB();
+
+    // Stop SysTick and work out how much of the current tick has passed.
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    elapsedTickCounts = ( sysTickCountsPerTick - 1u ) - SysTick->VAL;
+    entryScaled = ( uint32_t )( ( ( uint64_t ) elapsedTickCounts * RTT_FREQUENCY_HZ ) / sysTickCountsPerTick );
+
+    // Wake slightly early rather than late: the remainder of the last RTT
+    // count is left to SysTick.
+    sleepRttCounts = ( ( xExpectedIdleTime * RTT_FREQUENCY_HZ ) - entryScaled ) / configTICK_RATE_HZ;
+
+    // Abandon the sleep if a task became ready, a tick is already pending,
+    // the sleep manager forbids sleeping or there is too little time.
+    isAbort = ( eTaskConfirmSleepModeStatus() == eAbortSleep );
+    isAbort = isAbort || ( ( SCB->ICSR & SCB_ICSR_PENDSTSET_Msk ) != 0u );
+    isAbort = isAbort || ( sleepmgr_get_sleep_mode() == SLEEPMGR_ACTIVE );
+    isAbort = isAbort || ( sleepRttCounts < MIN_SLEEP_RTT_COUNTS );
+
+    if( isAbort )
+    {
+        // Restart from whatever is left of this tick period.
+        prvRestartSysTick( SysTick->VAL );
+        stats.abortCount++;
+        __enable_irq();
+        return;
+    }
+
+    // Program the RTT alarm.  The alarm fires when the counter reaches AR + 1.
+    startRtt = prvReadRtt();
+    RTT->RTT_MR &= ~RTT_MR_ALMIEN;
+    RTT->RTT_AR = RTT_AR_ALMV( startRtt + sleepRttCounts - 1u );
+    ( void ) RTT->RTT_SR;
+    NVIC_ClearPendingIRQ( RTT_IRQn );
+    isRttAlarmWake = false;
+    RTT->RTT_MR |= RTT_MR_ALMIEN;
+
+    __DSB();
+    __WFI();
+    __ISB();
+
+    // The cycle counter does not run while the core is asleep, so this marks
+    // the moment the MCU woke.
+    wakeCycles = DWT->CYCCNT;
+
+    // Let the interrupt that woke the MCU run, then stop interrupts again so
+    // they cannot add to the slippage while the tick count is corrected.
+    __enable_irq();
+    __DSB();
+    __ISB();
+    __disable_irq();
+    __DSB();
+    __ISB();
+
+    endRtt = prvReadRtt();
+    RTT->RTT_MR &= ~RTT_MR_ALMIEN;
+
+    // Time asleep plus the part of a tick that had passed before sleeping.
+    elapsedScaled = ( ( uint64_t )( endRtt - startRtt ) * configTICK_RATE_HZ ) + entryScaled;
+
+    if( elapsedScaled >= ( ( uint64_t ) xExpectedIdleTime * RTT_FREQUENCY_HZ ) )
+    {
+        // The whole idle period passed.  Step one tick short and let a pended
+        // tick interrupt take the final tick, which unblocks the waiting task.
+        completeTicks = xExpectedIdleTime - 1u;
+        prvRestartSysTick( sysTickCountsPerTick - 1u );
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+    }
+    else
+    {
+        // Woken early.  Restart SysTick for what is left of the current tick.
+        completeTicks = ( TickType_t )( elapsedScaled / RTT_FREQUENCY_HZ );
+        remainderScaled = ( uint32_t )( elapsedScaled % RTT_FREQUENCY_HZ );
+        prvRestartSysTick( ( uint32_t )( ( ( uint64_t )( RTT_FREQUENCY_HZ - remainderScaled ) *
+                                           sysTickCountsPerTick ) / RTT_FREQUENCY_HZ ) );
+    }
+
+    if( isRttAlarmWake )
+    {
+        prvRecordWakeLatency( DWT->CYCCNT - wakeCycles );
+    }
+    else
+    {
+        stats.earlyWakeCount++;
+    }
+
+    stats.sleepCount++;
+    stats.suppressedTicks += completeTicks;
+
+    vTaskStepTick( completeTicks );
+
+    __enable_irq();
+}
+
+
+/*------------------------------------------------------------
+                      Private Functions
+-------------------------------------------------------------*/
+
+/*-----------------------------------------------------------*/
+static uint32_t prvReadRtt( void )
+{
+    uint32_t value;
+
+    // The RTT is clocked asynchronously, so read until two reads agree.
+    do
+    {
+        value = RTT->RTT_VR;
+    } while( value != RTT->RTT_VR );
+
+    return value;
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvRestartSysTick( const uint32_t countsToNextTick )
+{
+    // The first period is countsToNextTick long.  Writing the normal reload
+    // value after starting the counter only takes effect from the next period.
+    SysTick->LOAD = ( countsToNextTick > 0u ) ? countsToNextTick : 1u;
+    SysTick->VAL = 0u;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = sysTickCountsPerTick - 1u;
+}
+
+
+/*-----------------------------------------------------------*/
+static void prvRecordWakeLatency( const uint32_t latencyCycles )
+{
+    if( ( stats.wakeLatencyCount == 0u ) || ( latencyCycles < stats.minWakeLatencyCycles ) )
+    {
+        stats.minWakeLatencyCycles = latencyCycles;
+    }
+
+    if( latencyCycles > stats.maxWakeLatencyCycles )
+    {
+        stats.maxWakeLatencyCycles = latencyCycles;
+    }
+
+    stats.wakeLatencyCount++;
+    totalWakeLatencyCycles += latencyCycles;
+}
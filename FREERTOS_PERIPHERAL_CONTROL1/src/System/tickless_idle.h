@@ -0,0 +1,67 @@
+/*
+ * @file tickless_idle.h
+ *
+ * @brief Header file for the RTT based tickless idle implementation
+ *
+ * When configUSE_TICKLESS_IDLE is 2 the kernel calls vPortSuppressTicksAndSleep()
+ * from the idle task whenever every task is blocked for at least
+ * configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks.  SysTick is stopped, the Real-Time
+ * Timer (clocked from the 32 kHz crystal) is programmed to wake the MCU when the
+ * next task is due, and the tick count is corrected from the RTT on wake-up.
+ */
+#ifndef TICKLESS_IDLE_H_
+#define TICKLESS_IDLE_H_
+
+#ifndef _STDBOOL_H
+    #error "Must include stdbool.h before tickless_idle.h"
+#endif
+
+#ifndef _SYS__STDINT_H
+    #error "Must include stdint.h before tickless_idle.h"
+#endif
+
+/*------------------------------------------------------------
+                           Types
+-------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t sleepCount;            // number of times the MCU was put to sleep
+    uint32_t abortCount;            // sleeps abandoned because a task became ready or the wait was too short
+    uint32_t earlyWakeCount;        // sleeps ended by an interrupt other than the RTT alarm
+    uint32_t suppressedTicks;       // total tick interrupts not taken
+    uint32_t wakeLatencyCount;      // number of RTT wake-ups timed
+    uint32_t minWakeLatencyCycles;  // RTT alarm wake-up -> tick restarted, in CPU cycles
+    uint32_t avgWakeLatencyCycles;
+    uint32_t maxWakeLatencyCycles;
+} TLI_Stats_t;
+
+
+/*------------------------------------------------------------
+                      Public Functions
+-------------------------------------------------------------*/
+
+/**
+ * @function TLI_Init
+ *
+ * @brief Start the 32 kHz crystal and the Real-Time Timer used to time tickless
+ *        sleeps, and configure the sleep manager.  Must be called before the
+ *        scheduler is started.
+ *
+ * @param void
+ *
+ * @return void (no return value)
+ */
+void TLI_Init( void );
+
+/**
+ * @function TLI_GetStats
+ *
+ * @brief Get a snapshot of the tickless idle statistics
+ *
+ * @param ptrStats - filled in with the statistics
+ *
+ * @return bool - true if ptrStats was valid, false otherwise
+ */
+bool TLI_GetStats( TLI_Stats_t *ptrStats );
+
+#endif /* TICKLESS_IDLE_H_ */
@@ -58,7 +58,7 @@ void assert_triggered( const char * file, uint32_t line );
 
 #define configUSE_PREEMPTION					1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION	1
-#define configUSE_TICKLESS_IDLE					0
+#define configUSE_TICKLESS_IDLE					2	/* 2 = System/tickless_idle.c, RTT based. */
 #define configUSE_IDLE_HOOK						0
 #define configUSE_TICK_HOOK						0
 #define configCPU_CLOCK_HZ						( sysclk_get_cpu_hz() )
@@ -77,6 +77,7 @@ void assert_triggered( const char * file, uint32_t line );
 #define configUSE_MALLOC_FAILED_HOOK			1
 #define configUSE_APPLICATION_TASK_TAG			0
 #define configUSE_COUNTING_SEMAPHORES			1
+#define configUSE_QUEUE_SETS					1
 #define configENABLE_BACKWARD_COMPATIBILITY        1
 
 /* Run time stats gathering definitions. */
@@ -88,6 +89,74 @@ uint32_t get_run_time_counter_value( void );
 #define portGET_RUN_TIME_COUNTER_VALUE() get_run_time_counter_value()
 #endif
 
+/* Set to 1 to time interrupt-to-task wake-ups with the DWT cycle counter (see
+System/latency_monitor.h).  The results are shown by the "wake-latency"
+command. */
+#define configUSE_WAKE_LATENCY_TRACE			1
+
+/* Set to 1 to time every taskENTER_CRITICAL()/taskEXIT_CRITICAL() pair with the
+DWT cycle counter, per call site (see System/critical_profiler.h).  The results
+are shown by the "crit-sections" command.  Adds overhead to every critical
+section, so leave at 0 other than when profiling. */
+#define configUSE_CRITICAL_SECTION_PROFILER		0
+
+/* Set to 1 to gather wait, hold and priority inheritance statistics for every
+mutex and semaphore in queue.c.  Times are in CPU cycles, taken from the DWT
+cycle counter.  The results are shown by the "mutex-stats" command for each
+mutex and semaphore in the queue registry. */
+#define configUSE_MUTEX_PROFILER				1
+#define configMUTEX_PROFILER_GET_TIME()			( *( ( volatile uint32_t * ) 0xE0001004UL ) )	/* DWT_CYCCNT */
+
+/* Set to 1 to record the most items each queue and semaphore has held, read
+with uxQueueGetHighWaterMark(). */
+#define configUSE_QUEUE_HIGH_WATER_MARK			1
+
+/* Set to 1 to have large copies out of the peripheral drivers' circular
+receive buffers made by the DMAC while the reading task is blocked (see
+freertos_dmac_memcpy.h).  The cut over size is measured by the "memcpy-bench"
+command. */
+#define configUSE_DMAC_MEMCPY					1
+
+/* Set to 1 to keep a log that any task or interrupt can append to without
+blocking (see System/log_ring.h).  The log is sent to the UART by a low
+priority task, in bursts handed to the PDC.  MCU_Init() starts it on the
+programming port UART, unless the UART command console is included, which
+starts it on its own port.  printf() and the UART console output function
+write to the log.  The "log-stats" command reports the messages dropped
+because the log was full. */
+#define configUSE_LOG_RING						1
+
+/* Set to 1 to provide a binary log (see System/binary_log.h).  A log call only
+stores a format ID and its arguments, and a low priority task formats the
+records into the log above, so needs configUSE_LOG_RING set to 1.  The format
+strings are listed in System/log_formats.h.  The "blog-bench" command compares
+the cost of a log call with that of sprintf(). */
+#define configUSE_BINARY_LOG					1
+
+/* Set to 1 to record every queue, semaphore, mutex, timer, event group and
+stream buffer in a hashed registry as it is created (see
+System/object_registry.h), through the trace macros below.  The registry is
+listed by the "queue-depths" command and searched by the "object-info" command.
+Needs configUSE_TRACE_FACILITY set to 1 for the queue types. */
+#define configUSE_OBJECT_REGISTRY				1
+
+#if ( configUSE_OBJECT_REGISTRY == 1 ) && ( defined (__GNUC__) || defined (__ICCARM__) )
+void REG_TraceQueueCreate( void *handle, uint8_t queueType, uint32_t length );
+void REG_TraceTimerCreate( void *handle, const char *ptrName );
+void REG_TraceEventGroupCreate( void *handle );
+void REG_TraceStreamBufferCreate( void *handle, uint32_t isMessageBuffer );
+void REG_TraceObjectDelete( void *handle );
+void REG_SetName( void *handle, const char *ptrName );
+#define traceQUEUE_CREATE( pxNewQueue )	REG_TraceQueueCreate( ( void * ) ( pxNewQueue ), ( pxNewQueue )->ucQueueType, ( uint32_t ) ( pxNewQueue )->uxLength )
+#define traceQUEUE_DELETE( pxQueue )	REG_TraceObjectDelete( ( void * ) ( pxQueue ) )
+#define traceQUEUE_REGISTRY_ADD( xQueue, pcQueueName )	REG_SetName( ( void * ) ( xQueue ), ( pcQueueName ) )
+#define traceTIMER_CREATE( pxNewTimer )	REG_TraceTimerCreate( ( void * ) ( pxNewTimer ), ( pxNewTimer )->pcTimerName )
+#define traceEVENT_GROUP_CREATE( xEventGroup )	REG_TraceEventGroupCreate( ( void * ) ( xEventGroup ) )
+#define traceEVENT_GROUP_DELETE( xEventGroup )	REG_TraceObjectDelete( ( void * ) ( xEventGroup ) )
+#define traceSTREAM_BUFFER_CREATE( pxStreamBuffer, xIsMessageBuffer )	REG_TraceStreamBufferCreate( ( void * ) ( pxStreamBuffer ), ( uint32_t ) ( xIsMessageBuffer ) )
+#define traceSTREAM_BUFFER_DELETE( xStreamBuffer )	REG_TraceObjectDelete( ( void * ) ( xStreamBuffer ) )
+#endif
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 					0
 #define configMAX_CO_ROUTINE_PRIORITIES			( 2 )
@@ -107,6 +176,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskSuspend					1
 #define INCLUDE_vTaskDelayUntil					1
 #define INCLUDE_vTaskDelay						1
+#define INCLUDE_xTaskGetCurrentTaskHandle		1
 
 /* FreeRTOS+CLI definitions. */
 
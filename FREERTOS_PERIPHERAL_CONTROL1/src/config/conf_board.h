@@ -41,7 +41,7 @@
 //#define CONSOLE_UART_ID          ID_UART
 
 /* Configure UART pins */
-//#define CONF_BOARD_UART_CONSOLE
+#define CONF_BOARD_UART_CONSOLE
 
 /* Configure ADC example pins */
 //#define CONF_BOARD_ADC
@@ -79,10 +79,10 @@
 /* Configure USART TXD pin */
 #define CONF_BOARD_USART_TXD
 
-/* Configure USART CTS pin */
+/* Configure USART CTS pin (needed by confUSART_ECHO_FLOW_CONTROL) */
 //#define CONF_BOARD_USART_CTS
 
-/* Configure USART RTS pin */
+/* Configure USART RTS pin (needed by confUSART_ECHO_FLOW_CONTROL) */
 //#define CONF_BOARD_USART_RTS
 
 /* Configure USART synchronous communication SCK pin */
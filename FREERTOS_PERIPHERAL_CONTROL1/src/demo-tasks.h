@@ -65,11 +65,12 @@ void cdc_cli_output(const uint8_t const *message_string);
 #endif
 
 #if (defined confINCLUDE_SPI_FLASH_TASK)
-#include "spi.h"
+#include "freertos_spi_master.h"
 void create_spi_flash_test_task(Spi *spi_base, uint16_t stack_depth_words,
 		unsigned portBASE_TYPE task_priority,
 		portBASE_TYPE set_asynchronous_api);
 portBASE_TYPE did_spi_flash_test_pass(void);
+uint32_t get_spi_flash_read_throughput(void);
 
 #endif
 
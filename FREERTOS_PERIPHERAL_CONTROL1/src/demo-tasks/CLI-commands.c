@@ -36,9 +36,11 @@
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
 
 /* Standard includes. */
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -47,6 +49,23 @@
 #include "FreeRTOS_CLI.h"
 
 #include "demo-tasks.h"
+#include "ceiling_mutex.h"
+#include "rw_lock.h"
+#include "critical_profiler.h"
+#include "latency_monitor.h"
+#include "object_registry.h"
+#include "tickless_idle.h"
+#include "freertos_peripheral_control.h"
+#include "eeprom_cache.h"
+#include "kv_store.h"
+#include "executor.h"
+#include "log_ring.h"
+#include "binary_log.h"
+#include "lockfree_ring.h"
+#include "pmc.h"
+#if (configUSE_DMAC_MEMCPY == 1)
+#include "freertos_dmac_memcpy.h"
+#endif
 
 /*
  * Implements the run-time-stats command.
@@ -90,6 +109,164 @@ static portBASE_TYPE delete_task_command(int8_t *pcWriteBuffer,
 		size_t xWriteBufferLen,
 		const int8_t *pcCommandString);
 
+#if (configUSE_WAKE_LATENCY_TRACE == 1)
+/*
+ * Implements the wake-latency command.
+ */
+static portBASE_TYPE wake_latency_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+#endif
+
+#if (configUSE_TICKLESS_IDLE == 2)
+/*
+ * Implements the tickless-stats command.
+ */
+static portBASE_TYPE tickless_stats_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+#endif
+
+#if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+/*
+ * Implements the crit-sections command.
+ */
+static portBASE_TYPE crit_sections_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+#endif
+
+#if (configUSE_MUTEX_PROFILER == 1)
+/*
+ * Implements the mutex-stats command.
+ */
+static portBASE_TYPE mutex_stats_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+#endif
+
+/*
+ * Implements the ceiling-blocking command.
+ */
+static portBASE_TYPE ceiling_blocking_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
+/*
+ * Implements the driver-stats command.
+ */
+static portBASE_TYPE driver_stats_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
+/*
+ * Implements the eeprom-test command.
+ */
+static portBASE_TYPE eeprom_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
+#if (configUSE_DMAC_MEMCPY == 1)
+/*
+ * Implements the memcpy-bench command.
+ */
+static portBASE_TYPE memcpy_bench_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+#endif
+
+#if (configUSE_LOG_RING == 1)
+/*
+ * Implements the log-stats command.
+ */
+static portBASE_TYPE log_stats_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+#endif
+
+#if (configUSE_BINARY_LOG == 1)
+/*
+ * Implements the blog-bench command.
+ */
+static portBASE_TYPE blog_bench_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+#endif
+
+#if (defined confINCLUDE_SPI_FLASH_TASK)
+/*
+ * Implements the spi-flash command.
+ */
+static portBASE_TYPE spi_flash_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
+/*
+ * Implements the spi-flash-dma command.
+ */
+static portBASE_TYPE spi_flash_dma_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+#endif
+
+#if (configUSE_OBJECT_REGISTRY == 1)
+/*
+ * Implements the queue-depths command.
+ */
+static portBASE_TYPE queue_depths_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
+/*
+ * Implements the object-info command.
+ */
+static portBASE_TYPE object_info_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+#endif
+
+/*
+ * Implements the exe-test command.
+ */
+static portBASE_TYPE exe_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
+/*
+ * Implements the queue-batch command.
+ */
+static portBASE_TYPE queue_batch_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
+/*
+ * Implements the ceiling-test command.
+ */
+static portBASE_TYPE ceiling_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
+/*
+ * Implements the rwlock-test command.
+ */
+static portBASE_TYPE rwlock_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
+/*
+ * Implements the kv-test command.
+ */
+static portBASE_TYPE kv_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
+/*
+ * Implements the lfr-test command.
+ */
+static portBASE_TYPE lfr_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString);
+
 /*
  * The task that is created by the create-task command.
  */
@@ -163,6 +340,241 @@ static const CLI_Command_Definition_t delete_task_command_definition =
 	0 /* A single parameter should be entered. */
 };
 
+#if (configUSE_WAKE_LATENCY_TRACE == 1)
+/* Structure that defines the "wake-latency" command line command.  This
+generates a table of interrupt-to-task wake-up latencies, in CPU cycles. */
+static const CLI_Command_Definition_t wake_latency_command_definition =
+{
+	(const int8_t *const) "wake-latency",
+	(const int8_t *const) "wake-latency:\r\n Displays the ISR and task wake-up latency (in CPU cycles) of each driver path\r\n\r\n",
+	wake_latency_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+#endif
+
+#if (configUSE_TICKLESS_IDLE == 2)
+/* Structure that defines the "tickless-stats" command line command.  This
+shows how often the tick was suppressed and how long it took to resume. */
+static const CLI_Command_Definition_t tickless_stats_command_definition =
+{
+	(const int8_t *const) "tickless-stats",
+	(const int8_t *const) "tickless-stats:\r\n Displays tickless idle sleep counts and the wake-up latency (in CPU cycles)\r\n\r\n",
+	tickless_stats_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+#endif
+
+#if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+/* Structure that defines the "crit-sections" command line command.  This lists
+the call sites that held a critical section the longest. */
+static const CLI_Command_Definition_t crit_sections_command_definition =
+{
+	(const int8_t *const) "crit-sections",
+	(const int8_t *const) "crit-sections:\r\n Displays the call sites with the longest critical sections (in CPU cycles)\r\n\r\n",
+	crit_sections_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+#endif
+
+#if (configUSE_MUTEX_PROFILER == 1)
+/* Structure that defines the "mutex-stats" command line command.  This
+generates a table of wait and hold times for each registered mutex and
+semaphore. */
+static const CLI_Command_Definition_t mutex_stats_command_definition =
+{
+	(const int8_t *const) "mutex-stats",
+	(const int8_t *const) "mutex-stats:\r\n Displays contention, wait and hold times (in CPU cycles) of each registered mutex and semaphore\r\n\r\n",
+	mutex_stats_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+#endif
+
+/* Structure that defines the "ceiling-blocking" command line command.  This
+shows the worst-case time each task has been blocked by a lower priority task
+holding a priority ceiling mutex. */
+static const CLI_Command_Definition_t ceiling_blocking_command_definition =
+{
+	(const int8_t *const) "ceiling-blocking",
+	(const int8_t *const) "ceiling-blocking:\r\n Displays the worst-case blocking (in CPU cycles) of each task by priority ceiling mutexes\r\n\r\n",
+	ceiling_blocking_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
+/* Structure that defines the "driver-stats" command line command.  This lists
+the traffic, errors and blocking time counted by each USART, UART and TWI
+driver port. */
+static const CLI_Command_Definition_t driver_stats_command_definition =
+{
+	(const int8_t *const) "driver-stats",
+	(const int8_t *const) "driver-stats:\r\n Displays the bytes, transfers, errors, Rx buffer high-water mark and blocked ticks of each peripheral driver port\r\n\r\n",
+	driver_stats_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
+/* Structure that defines the "eeprom-test" command line command.  This writes,
+reads back and checks a pattern through the EEPROM page cache, using a
+simulated AT24C, and reports the page write rate. */
+static const CLI_Command_Definition_t eeprom_test_command_definition =
+{
+	(const int8_t *const) "eeprom-test",
+	(const int8_t *const) "eeprom-test:\r\n Tests the EEPROM page cache against a simulated AT24C and displays the pages written per second\r\n\r\n",
+	eeprom_test_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
+#if (configUSE_DMAC_MEMCPY == 1)
+/* Structure that defines the "memcpy-bench" command line command.  This times
+copies made with memcpy() and by the DMAC at a range of sizes, then sets the
+size from which the DMAC is used. */
+static const CLI_Command_Definition_t memcpy_bench_command_definition =
+{
+	(const int8_t *const) "memcpy-bench",
+	(const int8_t *const) "memcpy-bench:\r\n Times memcpy() against DMAC copies, and sets the size from which the DMAC is used\r\n\r\n",
+	memcpy_bench_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+#endif
+
+#if (configUSE_LOG_RING == 1)
+/* Structure that defines the "log-stats" command line command.  This shows how
+much has been logged and sent, and how many messages were dropped because the
+log ring was full. */
+static const CLI_Command_Definition_t log_stats_command_definition =
+{
+	(const int8_t *const) "log-stats",
+	(const int8_t *const) "log-stats:\r\n Displays the messages logged, dropped and sent to the UART in bursts\r\n\r\n",
+	log_stats_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+#endif
+
+#if (configUSE_BINARY_LOG == 1)
+/* Structure that defines the "blog-bench" command line command.  This times a
+binary log call against formatting the same message with sprintf(). */
+static const CLI_Command_Definition_t blog_bench_command_definition =
+{
+	(const int8_t *const) "blog-bench",
+	(const int8_t *const) "blog-bench:\r\n Times a binary log call against sprintf(), and displays the records logged, dropped and formatted\r\n\r\n",
+	blog_bench_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+#endif
+
+#if (defined confINCLUDE_SPI_FLASH_TASK)
+/* Structure that defines the "spi-flash" command line command.  The first use
+starts the serial flash test task against a simulated flash, later uses report
+its result and the sequential read throughput it measured. */
+static const CLI_Command_Definition_t spi_flash_command_definition =
+{
+	(const int8_t *const) "spi-flash",
+	(const int8_t *const) "spi-flash:\r\n Starts the SPI flash test task on a simulated flash, then displays its result and read throughput\r\n\r\n",
+	spi_flash_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
+/* Structure that defines the "spi-flash-dma" command line command.  This is
+the same as spi-flash, but tests a real flash on SPI0, with the transfers made
+by the DMAC. */
+static const CLI_Command_Definition_t spi_flash_dma_command_definition =
+{
+	(const int8_t *const) "spi-flash-dma",
+	(const int8_t *const) "spi-flash-dma:\r\n Starts the SPI flash test task on the flash on SPI0 using the DMAC, then displays its result and read throughput\r\n\r\n",
+	spi_flash_dma_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+#endif
+
+#if (configUSE_OBJECT_REGISTRY == 1)
+/* Structure that defines the "queue-depths" command line command.  This lists
+the current depth, capacity and high-water mark of every queue, semaphore and
+stream buffer, for sizing them. */
+static const CLI_Command_Definition_t queue_depths_command_definition =
+{
+	(const int8_t *const) "queue-depths",
+	(const int8_t *const) "queue-depths:\r\n Displays the depth, capacity and high-water mark of each queue, semaphore and stream buffer\r\n\r\n",
+	queue_depths_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
+/* Structure that defines the "object-info" command line command.  This looks
+up a single kernel object by name. */
+static const CLI_Command_Definition_t object_info_command_definition =
+{
+	(const int8_t *const) "object-info",
+	(const int8_t *const) "object-info <name>:\r\n Displays the type, creator and depth of the named kernel object\r\n\r\n",
+	object_info_command, /* The function to run. */
+	1 /* A single parameter should be entered. */
+};
+#endif
+
+/* Structure that defines the "exe-test" command line command.  The first use
+starts coroutines on the stackless executor that await a queue, notification
+bits and delays, later uses report whether every await behaved as expected. */
+static const CLI_Command_Definition_t exe_test_command_definition =
+{
+	(const int8_t *const) "exe-test",
+	(const int8_t *const) "exe-test:\r\n Starts coroutines on the stackless executor, then displays whether their queue, notification and delay awaits worked\r\n\r\n",
+	exe_test_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
+/* Structure that defines the "queue-batch" command line command.  This passes
+items through a queue to another task with xQueueSendMultiple() and
+xQueueReceiveMultiple(), at several batch sizes, and reports the items moved per
+second. */
+static const CLI_Command_Definition_t queue_batch_command_definition =
+{
+	(const int8_t *const) "queue-batch",
+	(const int8_t *const) "queue-batch:\r\n Times moving items between tasks with the batch queue calls, at batch sizes of 1, 8 and 32\r\n\r\n",
+	queue_batch_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
+/* Structure that defines the "ceiling-test" command line command.  This has
+two tasks of different priorities share a priority ceiling mutex, and checks
+each runs at the ceiling while holding it. */
+static const CLI_Command_Definition_t ceiling_test_command_definition =
+{
+	(const int8_t *const) "ceiling-test",
+	(const int8_t *const) "ceiling-test:\r\n Tests a priority ceiling mutex shared by two tasks.  Run ceiling-blocking afterwards to see the blocking measured\r\n\r\n",
+	ceiling_test_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
+/* Structure that defines the "rwlock-test" command line command.  This has
+several reader tasks and a writer task share a reader-writer lock, and checks
+no reader sees a half written value. */
+static const CLI_Command_Definition_t rwlock_test_command_definition =
+{
+	(const int8_t *const) "rwlock-test",
+	(const int8_t *const) "rwlock-test:\r\n Tests a reader-writer lock shared by three reader tasks and a writer task\r\n\r\n",
+	rwlock_test_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
+/* Structure that defines the "kv-test" command line command.  This sets, gets,
+deletes and overwrites keys in a key-value store held in a simulated AT24C,
+then closes and reopens the store and checks what was written survived. */
+static const CLI_Command_Definition_t kv_test_command_definition =
+{
+	(const int8_t *const) "kv-test",
+	(const int8_t *const) "kv-test:\r\n Tests the EEPROM key-value store against a simulated AT24C, including compaction and remounting\r\n\r\n",
+	kv_test_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
+/* Structure that defines the "lfr-test" command line command.  This has
+several producer tasks and a timer interrupt push numbered items into one
+lock-free ring while several consumer tasks pop them, and checks no item is
+lost or delivered twice. */
+static const CLI_Command_Definition_t lfr_test_command_definition =
+{
+	(const int8_t *const) "lfr-test",
+	(const int8_t *const) "lfr-test:\r\n Tests the lock-free ring with three producer tasks, an interrupt producer and two consumer tasks\r\n\r\n",
+	lfr_test_command, /* The function to run. */
+	0 /* No parameters are expected. */
+};
+
 /*-----------------------------------------------------------*/
 
 void vRegisterCLICommands(void)
@@ -174,6 +586,44 @@ void vRegisterCLICommands(void)
 	FreeRTOS_CLIRegisterCommand(&multi_parameter_echo_command_definition);
 	FreeRTOS_CLIRegisterCommand(&create_task_command_definition);
 	FreeRTOS_CLIRegisterCommand(&delete_task_command_definition);
+	FreeRTOS_CLIRegisterCommand(&ceiling_blocking_command_definition);
+	FreeRTOS_CLIRegisterCommand(&driver_stats_command_definition);
+	FreeRTOS_CLIRegisterCommand(&eeprom_test_command_definition);
+#if (configUSE_DMAC_MEMCPY == 1)
+	FreeRTOS_CLIRegisterCommand(&memcpy_bench_command_definition);
+#endif
+#if (configUSE_LOG_RING == 1)
+	FreeRTOS_CLIRegisterCommand(&log_stats_command_definition);
+#endif
+#if (configUSE_BINARY_LOG == 1)
+	FreeRTOS_CLIRegisterCommand(&blog_bench_command_definition);
+#endif
+#if (defined confINCLUDE_SPI_FLASH_TASK)
+	FreeRTOS_CLIRegisterCommand(&spi_flash_command_definition);
+	FreeRTOS_CLIRegisterCommand(&spi_flash_dma_command_definition);
+#endif
+#if (configUSE_WAKE_LATENCY_TRACE == 1)
+	FreeRTOS_CLIRegisterCommand(&wake_latency_command_definition);
+#endif
+#if (configUSE_TICKLESS_IDLE == 2)
+	FreeRTOS_CLIRegisterCommand(&tickless_stats_command_definition);
+#endif
+#if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+	FreeRTOS_CLIRegisterCommand(&crit_sections_command_definition);
+#endif
+#if (configUSE_MUTEX_PROFILER == 1)
+	FreeRTOS_CLIRegisterCommand(&mutex_stats_command_definition);
+#endif
+#if (configUSE_OBJECT_REGISTRY == 1)
+	FreeRTOS_CLIRegisterCommand(&queue_depths_command_definition);
+	FreeRTOS_CLIRegisterCommand(&object_info_command_definition);
+#endif
+	FreeRTOS_CLIRegisterCommand(&exe_test_command_definition);
+	FreeRTOS_CLIRegisterCommand(&queue_batch_command_definition);
+	FreeRTOS_CLIRegisterCommand(&ceiling_test_command_definition);
+	FreeRTOS_CLIRegisterCommand(&rwlock_test_command_definition);
+	FreeRTOS_CLIRegisterCommand(&kv_test_command_definition);
+	FreeRTOS_CLIRegisterCommand(&lfr_test_command_definition);
 }
 
 /*-----------------------------------------------------------*/
@@ -438,6 +888,1810 @@ static portBASE_TYPE delete_task_command(int8_t *pcWriteBuffer,
 
 /*-----------------------------------------------------------*/
 
+/* The number of tasks listed by the ceiling-blocking command. */
+#define CEILING_BLOCKING_MAX_TASKS		12
+
+static portBASE_TYPE ceiling_blocking_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static PCM_Blocking_t report[CEILING_BLOCKING_MAX_TASKS];
+	static uint32_t num_entries = 0;
+	static portBASE_TYPE line_number = 0;
+	portBASE_TYPE return_value;
+	PCM_Blocking_t *entry;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	if (line_number == 0) {
+		/* The first time the function is called the analysis is run and
+		the table header is returned. */
+		num_entries = PCM_GetBlockingReport(report, CEILING_BLOCKING_MAX_TASKS);
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"Task        Priority   Blocking  Mutex   (%lu holds dropped)\r\n"
+				"***********************************************************\r\n",
+				(unsigned long) PCM_GetDroppedHoldCount());
+	} else {
+		/* Subsequent calls return one task each. */
+		entry = &report[line_number - 1];
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"%-10s %9lu %10lu  %s\r\n",
+				entry->ptrTaskName,
+				(unsigned long) entry->priority,
+				(unsigned long) entry->blockingCycles,
+				(entry->ptrCause != NULL) ? entry->ptrCause->ptrName : "-");
+	}
+
+	line_number++;
+	if ((uint32_t) line_number > num_entries) {
+		/* That was the last line, reset for the next time the command is
+		entered. */
+		line_number = 0;
+		return_value = pdFALSE;
+	} else {
+		return_value = pdTRUE;
+	}
+
+	return return_value;
+}
+
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE driver_stats_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static uint32_t port_index = 0;
+	const char *name;
+	freertos_peripheral_stats_t stats;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	if (!freertos_get_peripheral_stats(port_index, &name, &stats, false)) {
+		/* Only reached straight away if no port has been initialised. */
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"No peripheral driver ports are initialised\r\n");
+		port_index = 0;
+		return pdFALSE;
+	}
+
+	/* Each call returns one port. */
+	snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+			"%s:\r\n"
+			" Tx %lu bytes in %lu transfers, %lu ticks blocked\r\n"
+			" Rx %lu bytes in %lu transfers, %lu ticks blocked, buffer high-water mark %lu of %lu\r\n"
+			" Errors: overrun %lu, framing %lu, parity %lu, NACK %lu, arbitration lost %lu, timeout %lu\r\n",
+			name,
+			(unsigned long) stats.tx_bytes,
+			(unsigned long) stats.tx_transfers,
+			(unsigned long) stats.tx_blocked_ticks,
+			(unsigned long) stats.rx_bytes,
+			(unsigned long) stats.rx_transfers,
+			(unsigned long) stats.rx_blocked_ticks,
+			(unsigned long) stats.rx_buffer_high_water_mark,
+			(unsigned long) stats.rx_buffer_size,
+			(unsigned long) stats.overrun_errors,
+			(unsigned long) stats.framing_errors,
+			(unsigned long) stats.parity_errors,
+			(unsigned long) stats.nack_errors,
+			(unsigned long) stats.arbitration_lost_errors,
+			(unsigned long) stats.timeout_errors);
+
+	/* Only drivers that time their interrupt handler count its runs. */
+	if (stats.isr_count > 0) {
+		snprintf((char *) pcWriteBuffer + strlen((char *) pcWriteBuffer),
+				xWriteBufferLen - strlen((char *) pcWriteBuffer),
+				" ISR: %lu runs, %lu cycles per transfer\r\n",
+				(unsigned long) stats.isr_count,
+				(unsigned long) (((stats.tx_transfers + stats.rx_transfers) > 0) ?
+					(stats.isr_cycles / (stats.tx_transfers + stats.rx_transfers)) : 0));
+	}
+
+	port_index++;
+	if (!freertos_get_peripheral_stats(port_index, NULL, &stats, false)) {
+		/* That was the last port, reset for the next time the command is
+		entered. */
+		port_index = 0;
+		return pdFALSE;
+	}
+
+	return pdTRUE;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The size of the simulated AT24C used by the eeprom-test command, and of the
+writes and reads the test makes, which do not line up with the pages. */
+#define EEPROM_TEST_SIZE				(16u * EEP_PAGE_SIZE)
+#define EEPROM_TEST_WRITE_SIZE			(13u)
+#define EEPROM_TEST_READ_SIZE			(32u)
+
+/* The worst-case AT24C write cycle, which the simulated device takes for every
+page, and the fixed delay the cache's ACK polling replaces. */
+#define EEPROM_SIM_WRITE_CYCLE_TICKS	(5u / portTICK_RATE_MS)
+#define EEPROM_FIXED_WRITE_DELAY_MS		(7u)
+
+static portBASE_TYPE eeprom_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static uint8_t sim_memory[EEPROM_TEST_SIZE];
+	static EEP_SimDevice_t sim_device;
+	static EEP_Cache_t cache;
+	static bool is_cache_ready = false;
+	static uint8_t pass = 0;
+	uint8_t data[EEPROM_TEST_READ_SIZE];
+	uint32_t address, length, index;
+	EEP_Bus_t bus;
+	EEP_Stats_t stats;
+	portTickType start_ticks, elapsed_ticks;
+	bool is_passed = true;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	/* The cache owns a mutex, so it is only created the first time. */
+	if (is_cache_ready == false) {
+		is_cache_ready = EEP_InitSimBus(&bus, &sim_device, sim_memory,
+				EEPROM_TEST_SIZE, EEPROM_SIM_WRITE_CYCLE_TICKS) &&
+				EEP_Init(&cache, &bus, EEPROM_TEST_SIZE);
+
+		if (is_cache_ready == false) {
+			snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+					"Could not create the EEPROM cache\r\n");
+			return pdFALSE;
+		}
+	}
+
+	/* Each run writes a different pattern over an erased device. */
+	memset(sim_memory, 0xff, sizeof(sim_memory));
+	pass++;
+	EEP_GetStats(&cache, &stats, true);
+
+	start_ticks = xTaskGetTickCount();
+	for (address = 0; is_passed && (address < EEPROM_TEST_SIZE);
+			address += length) {
+		length = EEPROM_TEST_SIZE - address;
+		if (length > EEPROM_TEST_WRITE_SIZE) {
+			length = EEPROM_TEST_WRITE_SIZE;
+		}
+
+		for (index = 0; index < length; index++) {
+			data[index] = (uint8_t) ((address + index) * 7u + pass);
+		}
+
+		is_passed = EEP_Write(&cache, address, data, length, portMAX_DELAY);
+	}
+	is_passed = is_passed && EEP_Flush(&cache, portMAX_DELAY);
+	elapsed_ticks = xTaskGetTickCount() - start_ticks;
+
+	for (address = 0; is_passed && (address < EEPROM_TEST_SIZE);
+			address += EEPROM_TEST_READ_SIZE) {
+		is_passed = EEP_Read(&cache, address, data, EEPROM_TEST_READ_SIZE,
+				portMAX_DELAY);
+
+		for (index = 0; is_passed && (index < EEPROM_TEST_READ_SIZE); index++) {
+			is_passed = (data[index] == (uint8_t) ((address + index) * 7u + pass));
+		}
+	}
+
+	EEP_GetStats(&cache, &stats, false);
+	if (elapsed_ticks == 0) {
+		elapsed_ticks = 1;
+	}
+
+	snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+			"%s: %lu writes of %u bytes merged into %lu page writes\r\n"
+			" %lu pages/s, %lu busy polls, %lu ticks waiting for write cycles\r\n"
+			" (a fixed %u ms delay per page allows at most %lu pages/s)\r\n",
+			is_passed ? "Passed" : "FAILED",
+			(unsigned long) stats.writes,
+			(unsigned int) EEPROM_TEST_WRITE_SIZE,
+			(unsigned long) stats.pageWrites,
+			(unsigned long) ((stats.pageWrites * configTICK_RATE_HZ) / elapsed_ticks),
+			(unsigned long) stats.busyPolls,
+			(unsigned long) stats.busyTicks,
+			(unsigned int) EEPROM_FIXED_WRITE_DELAY_MS,
+			(unsigned long) (1000u / EEPROM_FIXED_WRITE_DELAY_MS));
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+#if (configUSE_DMAC_MEMCPY == 1)
+
+/* The copy sizes timed by the memcpy-bench command, doubling from the
+smallest. */
+#define MEMCPY_BENCH_MIN_SIZE			(16u)
+#define MEMCPY_BENCH_MAX_SIZE			(2048u)
+
+static portBASE_TYPE memcpy_bench_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static uint32_t size = 0;
+	portBASE_TYPE return_value;
+	uint32_t cpu_cycles, dmac_cycles, threshold;
+	freertos_dmac_memcpy_stats_t stats;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	if (size == 0) {
+		/* The first time the function is called the table header is
+		returned. */
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"Bytes    memcpy cycles    DMAC cycles\r\n"
+				"*************************************\r\n");
+		size = MEMCPY_BENCH_MIN_SIZE;
+		return_value = pdTRUE;
+	} else if (size <= MEMCPY_BENCH_MAX_SIZE) {
+		/* Subsequent calls return one size each. */
+		freertos_dmac_memcpy_measure(size, &cpu_cycles, &dmac_cycles);
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"%5lu  %15lu  %13lu\r\n",
+				(unsigned long) size, (unsigned long) cpu_cycles,
+				(unsigned long) dmac_cycles);
+		size *= 2;
+		return_value = pdTRUE;
+	} else {
+		/* The last call picks the threshold from its own measurements. */
+		threshold = freertos_dmac_memcpy_calibrate();
+		freertos_dmac_memcpy_get_stats(&stats, false);
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"Copies from %lu bytes are now made by the DMAC\r\n"
+				" %lu DMAC copies (%lu bytes), %lu CPU copies (%lu bytes), %lu with no free channel\r\n",
+				(unsigned long) threshold,
+				(unsigned long) stats.dmac_copies,
+				(unsigned long) stats.dmac_bytes,
+				(unsigned long) stats.cpu_copies,
+				(unsigned long) stats.cpu_bytes,
+				(unsigned long) stats.busy_fallbacks);
+		size = 0;
+		return_value = pdFALSE;
+	}
+
+	return return_value;
+}
+
+#endif
+
+/*-----------------------------------------------------------*/
+
+#if (configUSE_LOG_RING == 1)
+
+static portBASE_TYPE log_stats_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	LOG_Stats_t stats;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	(void) LOG_GetStats(&stats);
+	snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+			"Logged %lu messages (%lu bytes), dropped %lu, cut short %lu, most queued %lu of %lu\r\n"
+			"Sent %lu bytes in %lu bursts, %lu send errors, drain %s\r\n",
+			(unsigned long) stats.messagesWritten,
+			(unsigned long) stats.bytesWritten,
+			(unsigned long) stats.messagesDropped,
+			(unsigned long) stats.messagesTruncated,
+			(unsigned long) stats.ringHighWater,
+			(unsigned long) LOG_RING_SLOTS,
+			(unsigned long) stats.bytesSent,
+			(unsigned long) stats.bursts,
+			(unsigned long) stats.sendErrors,
+			stats.isDraining ? "running" : "not started");
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+#endif
+
+/*-----------------------------------------------------------*/
+
+#if (configUSE_BINARY_LOG == 1)
+
+/* The number of times each way of logging is timed by the blog-bench command.
+The fastest time is reported, as the others may include interrupts. */
+#define BLOG_BENCH_REPEATS				(8u)
+
+static portBASE_TYPE blog_bench_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	char local_buffer[60];
+	uint32_t repeat, start_cycles, cycles;
+	uint32_t blog_cycles = UINT32_MAX, sprintf_cycles = UINT32_MAX;
+	BLOG_Stats_t stats;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	/* Both are timed with the DWT cycle counter. */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	for (repeat = 0; repeat < BLOG_BENCH_REPEATS; repeat++) {
+		start_cycles = DWT->CYCCNT;
+		BLOG_2(BLOG_ID_BENCH, BLOG_VALUE(repeat + 1),
+				BLOG_VALUE(BLOG_BENCH_REPEATS));
+		cycles = DWT->CYCCNT - start_cycles;
+		if (cycles < blog_cycles) {
+			blog_cycles = cycles;
+		}
+
+		start_cycles = DWT->CYCCNT;
+		sprintf(local_buffer, "blog-bench: message %lu of %lu\r\n",
+				(unsigned long) (repeat + 1),
+				(unsigned long) BLOG_BENCH_REPEATS);
+		cycles = DWT->CYCCNT - start_cycles;
+		if (cycles < sprintf_cycles) {
+			sprintf_cycles = cycles;
+		}
+	}
+
+	(void) BLOG_GetStats(&stats);
+	snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+			"Log call %lu cycles, sprintf() %lu cycles\r\n"
+			"Records logged %lu, dropped %lu, formatted %lu, most queued %lu of %lu\r\n",
+			(unsigned long) blog_cycles,
+			(unsigned long) sprintf_cycles,
+			(unsigned long) stats.recordsLogged,
+			(unsigned long) stats.recordsDropped,
+			(unsigned long) stats.recordsFormatted,
+			(unsigned long) stats.ringHighWater,
+			(unsigned long) BLOG_RING_SLOTS);
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+#endif
+
+/*-----------------------------------------------------------*/
+
+#if (defined confINCLUDE_SPI_FLASH_TASK)
+
+/* The stack and priority of the serial flash test task. */
+#define SPI_FLASH_TASK_STACK_SIZE		(configMINIMAL_STACK_SIZE * 2)
+#define SPI_FLASH_TASK_PRIORITY			(tskIDLE_PRIORITY + 1)
+
+/* There is only one serial flash test task, so whichever of the spi-flash and
+spi-flash-dma commands is used first decides what it tests.  This names the
+flash being tested once the task has been started. */
+static const char *spi_flash_tested = NULL;
+
+/*
+ * Start the serial flash test task on the SPI port passed in, or on the
+ * simulated flash if it is NULL, the first time either command is used, and
+ * report the result of the test after that.
+ */
+static void start_or_report_spi_flash_test(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen, Spi *spi_base,
+		portBASE_TYPE set_asynchronous_api, const char *flash_name)
+{
+	if (spi_flash_tested == NULL) {
+		create_spi_flash_test_task(spi_base, SPI_FLASH_TASK_STACK_SIZE,
+				SPI_FLASH_TASK_PRIORITY, set_asynchronous_api);
+		spi_flash_tested = flash_name;
+
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"SPI flash test task started on the %s\r\n",
+				spi_flash_tested);
+	} else {
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"%s: %s, sequential reads at %lu bytes/s\r\n",
+				(did_spi_flash_test_pass() == pdPASS) ? "Passed" : "FAILED",
+				spi_flash_tested,
+				(unsigned long) get_spi_flash_read_throughput());
+	}
+}
+
+static portBASE_TYPE spi_flash_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	/* No SPI port is passed, so the task tests the simulated flash. */
+	start_or_report_spi_flash_test(pcWriteBuffer, xWriteBufferLen, NULL,
+			pdFALSE, "simulated flash");
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+static portBASE_TYPE spi_flash_dma_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	/* The flash on NPCS0 of SPI0 is tested through the DMAC driver, using the
+	fully asynchronous API so each chunk is checked while the DMAC reads the
+	next one. */
+	start_or_report_spi_flash_test(pcWriteBuffer, xWriteBufferLen, SPI0,
+			pdTRUE, "SPI0 flash using the DMAC");
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+#endif
+
+/*-----------------------------------------------------------*/
+
+#if (configUSE_WAKE_LATENCY_TRACE == 1)
+
+static portBASE_TYPE wake_latency_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static const char *const segment_names[LAT_NUM_SEGMENTS] = {"isr", "wake"};
+	static portBASE_TYPE line_number = 0;
+	portBASE_TYPE return_value;
+	LAT_Stats_t stats;
+	LAT_Path_t path;
+	LAT_Segment_t segment;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	if (line_number == 0) {
+		/* The first time the function is called the table header is
+		returned. */
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"Path      Segment  Count       Min       Avg       Max       P99\r\n"
+				"*****************************************************************\r\n");
+		line_number++;
+		return_value = pdTRUE;
+	} else {
+		/* Subsequent calls return one path/segment line each. */
+		path = (LAT_Path_t) ((line_number - 1) / LAT_NUM_SEGMENTS);
+		segment = (LAT_Segment_t) ((line_number - 1) % LAT_NUM_SEGMENTS);
+
+		(void) LAT_GetStats(path, segment, &stats);
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"%-9s %-7s %6lu %9lu %9lu %9lu %9lu\r\n",
+				LAT_GetPathName(path), segment_names[segment],
+				(unsigned long) stats.count,
+				(unsigned long) stats.minCycles,
+				(unsigned long) stats.avgCycles,
+				(unsigned long) stats.maxCycles,
+				(unsigned long) stats.p99Cycles);
+
+		line_number++;
+		if (line_number > (LAT_NUM_PATHS * LAT_NUM_SEGMENTS)) {
+			/* That was the last line, reset for the next time the command
+			is entered. */
+			line_number = 0;
+			return_value = pdFALSE;
+		} else {
+			return_value = pdTRUE;
+		}
+	}
+
+	return return_value;
+}
+
+#endif /* configUSE_WAKE_LATENCY_TRACE */
+
+/*-----------------------------------------------------------*/
+
+#if (configUSE_TICKLESS_IDLE == 2)
+
+static portBASE_TYPE tickless_stats_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	TLI_Stats_t stats;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	(void) TLI_GetStats(&stats);
+	snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+			"Sleeps %lu, aborted %lu, woken early %lu, ticks suppressed %lu\r\n"
+			"Wake-up latency (cycles): min %lu, avg %lu, max %lu over %lu wake-ups\r\n",
+			(unsigned long) stats.sleepCount,
+			(unsigned long) stats.abortCount,
+			(unsigned long) stats.earlyWakeCount,
+			(unsigned long) stats.suppressedTicks,
+			(unsigned long) stats.minWakeLatencyCycles,
+			(unsigned long) stats.avgWakeLatencyCycles,
+			(unsigned long) stats.maxWakeLatencyCycles,
+			(unsigned long) stats.wakeLatencyCount);
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+#endif /* configUSE_TICKLESS_IDLE */
+
+/*-----------------------------------------------------------*/
+
+#if (configUSE_CRITICAL_SECTION_PROFILER == 1)
+
+/* The number of call sites listed by the crit-sections command. */
+#define CRIT_SECTIONS_TOP_COUNT		10
+
+static portBASE_TYPE crit_sections_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static CSP_Site_t sites[CRIT_SECTIONS_TOP_COUNT];
+	static uint32_t num_sites = 0;
+	static portBASE_TYPE line_number = 0;
+	portBASE_TYPE return_value;
+	CSP_Site_t *site;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	if (line_number == 0) {
+		/* The first time the function is called the profile is captured
+		and the table header is returned. */
+		num_sites = CSP_GetTopSites(sites, CRIT_SECTIONS_TOP_COUNT);
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"Call site       Count       Avg       Max   (%lu dropped)\r\n"
+				"*******************************************************\r\n",
+				(unsigned long) CSP_GetDroppedCount());
+		line_number++;
+	} else {
+		/* Subsequent calls return one call site each.  Clear the Thumb bit
+		so the address can be given straight to addr2line. */
+		site = &sites[line_number - 1];
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"0x%08lx %10lu %9lu %9lu\r\n",
+				(unsigned long) (site->callSite & ~1UL),
+				(unsigned long) site->count,
+				(unsigned long) site->avgCycles,
+				(unsigned long) site->maxCycles);
+		line_number++;
+	}
+
+	if ((uint32_t) line_number > num_sites) {
+		/* That was the last line, reset for the next time the command is
+		entered. */
+		line_number = 0;
+		return_value = pdFALSE;
+	} else {
+		return_value = pdTRUE;
+	}
+
+	return return_value;
+}
+
+#endif /* configUSE_CRITICAL_SECTION_PROFILER */
+
+/*-----------------------------------------------------------*/
+
+#if (configUSE_MUTEX_PROFILER == 1)
+
+static portBASE_TYPE mutex_stats_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static UBaseType_t registry_index = 0;
+	static bool is_header_written = false;
+	QueueHandle_t queue;
+	const char *name = NULL;
+	MutexProfile_t profile;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	if (!is_header_written) {
+		/* The first time the function is called the table header is
+		returned. */
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"Name        Takes  Contended  Timeouts  PI   Avg wait   Max wait   Avg hold   Max hold\r\n"
+				"*****************************************************************************************\r\n");
+		is_header_written = true;
+		return pdTRUE;
+	}
+
+	/* Subsequent calls return the next registered mutex or semaphore.  Other
+	queues in the registry are skipped. */
+	pcWriteBuffer[0] = 0x00;
+	while (registry_index < configQUEUE_REGISTRY_SIZE) {
+		queue = xQueueGetRegistryEntry(registry_index, &name);
+		registry_index++;
+
+		if ((queue != NULL) &&
+				(xQueueGetMutexProfile(queue, &profile) == pdPASS)) {
+			snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+					"%-10s %6lu %10lu %9lu %3lu %10lu %10lu %10lu %10lu\r\n",
+					name,
+					(unsigned long) profile.ulTakes,
+					(unsigned long) profile.ulContendedTakes,
+					(unsigned long) profile.ulTimeouts,
+					(unsigned long) profile.ulInheritances,
+					(unsigned long) ((profile.ulContendedTakes > 0) ?
+						(profile.ullTotalWaitTime / profile.ulContendedTakes) : 0),
+					(unsigned long) profile.ulMaxWaitTime,
+					(unsigned long) ((profile.ulHolds > 0) ?
+						(profile.ullTotalHoldTime / profile.ulHolds) : 0),
+					(unsigned long) profile.ulMaxHoldTime);
+			break;
+		}
+	}
+
+	if (registry_index >= configQUEUE_REGISTRY_SIZE) {
+		/* That was the last registry slot, reset for the next time the
+		command is entered. */
+		registry_index = 0;
+		is_header_written = false;
+		return pdFALSE;
+	}
+
+	return pdTRUE;
+}
+
+#endif /* configUSE_MUTEX_PROFILER */
+
+/*-----------------------------------------------------------*/
+
+#if (configUSE_OBJECT_REGISTRY == 1)
+
+static portBASE_TYPE queue_depths_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static uint32_t object_index = 0;
+	static bool is_header_written = false;
+	REG_Info_t info;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	if (!is_header_written) {
+		/* The first time the function is called the table header is
+		returned. */
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"Name        Type      Creator     Depth  Capacity    HWM\r\n"
+				"*********************************************************\r\n");
+		is_header_written = true;
+		return pdTRUE;
+	}
+
+	/* Subsequent calls return the next object that has a depth.  Timers and
+	event groups are skipped. */
+	pcWriteBuffer[0] = 0x00;
+	while (object_index < REG_MAX_OBJECTS) {
+		if (REG_GetInfoByIndex(object_index++, &info) && info.hasDepth) {
+			snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+					"%-10s  %-8s  %-10s %6lu %9lu %6lu\r\n",
+					(info.ptrName != NULL) ? info.ptrName : "-",
+					REG_GetTypeName(info.type),
+					info.creatorName,
+					(unsigned long) info.depth,
+					(unsigned long) info.capacity,
+					(unsigned long) info.highWaterMark);
+			break;
+		}
+	}
+
+	if (object_index >= REG_MAX_OBJECTS) {
+		/* That was the last registry slot, reset for the next time the
+		command is entered. */
+		object_index = 0;
+		is_header_written = false;
+
+		if (REG_GetDroppedCount() > 0) {
+			snprintf((char *) pcWriteBuffer + strlen((char *) pcWriteBuffer),
+					xWriteBufferLen - strlen((char *) pcWriteBuffer),
+					"(%lu objects not recorded, registry full)\r\n",
+					(unsigned long) REG_GetDroppedCount());
+		}
+
+		return pdFALSE;
+	}
+
+	return pdTRUE;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Longest object name that can be looked up. */
+#define OBJECT_INFO_MAX_NAME_LEN		24
+
+static portBASE_TYPE object_info_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	int8_t *parameter_string;
+	portBASE_TYPE parameter_string_length;
+	char name[OBJECT_INFO_MAX_NAME_LEN + 1];
+	REG_Info_t info;
+
+	configASSERT(pcWriteBuffer);
+
+	/* Obtain the parameter string.  It is not terminated, so copy it out. */
+	parameter_string = (int8_t *) FreeRTOS_CLIGetParameter(
+									pcCommandString,		/* The command string itself. */
+									1,						/* Return the first parameter. */
+									&parameter_string_length	/* Store the parameter string length. */
+								);
+
+	if (parameter_string_length >= (portBASE_TYPE) sizeof(name)) {
+		parameter_string_length = sizeof(name) - 1;
+	}
+	memcpy(name, parameter_string, parameter_string_length);
+	name[parameter_string_length] = 0x00;
+
+	if (!REG_GetInfo(REG_FindByName(name), &info)) {
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"No object named %s\r\n", name);
+	} else if (info.hasDepth) {
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"%s: %s created by %s, depth %lu of %lu, high-water mark %lu\r\n",
+				name,
+				REG_GetTypeName(info.type),
+				info.creatorName,
+				(unsigned long) info.depth,
+				(unsigned long) info.capacity,
+				(unsigned long) info.highWaterMark);
+	} else {
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"%s: %s created by %s\r\n",
+				name,
+				REG_GetTypeName(info.type),
+				info.creatorName);
+	}
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+#endif /* configUSE_OBJECT_REGISTRY */
+
+/*-----------------------------------------------------------*/
+
+/* The stack and priority of the executor task started by the exe-test command,
+the number of items its producer coroutine sends, and the notification bit
+sent when the last has been sent. */
+#define EXE_TEST_STACK_SIZE				(configMINIMAL_STACK_SIZE)
+#define EXE_TEST_PRIORITY				(tskIDLE_PRIORITY + 1)
+#define EXE_TEST_ITEMS					(20u)
+#define EXE_TEST_DONE_BIT				(0x01u)
+#define EXE_TEST_UNUSED_BIT				(0x02u)
+
+/* State shared by the exe-test coroutines.  Coroutine locals do not survive an
+await, so everything they keep lives here. */
+typedef struct exe_test_state {
+	EXE_Queue_t queue;
+	EXE_Coroutine_t producer;
+	EXE_Coroutine_t consumer;
+	EXE_Coroutine_t timeout;
+	uint32_t next_item;				/* Sent by the producer. */
+	uint32_t received_item;			/* Written by the executor on a queue await. */
+	uint32_t expected_item;			/* Next item the consumer should receive. */
+	uint32_t items_in_order;
+	bool is_notify_ok;
+	bool is_timeout_ok;
+	bool is_consumer_done;
+	bool is_timeout_done;
+} exe_test_state_t;
+
+static exe_test_state_t exe_test;
+
+/* Sends EXE_TEST_ITEMS items, one every tick, then tells the consumer. */
+static EXE_Status_t exe_test_producer(EXE_Coroutine_t *co, void *context)
+{
+	exe_test_state_t *state = (exe_test_state_t *) context;
+
+	EXE_BEGIN(co);
+	for (state->next_item = 0; state->next_item < EXE_TEST_ITEMS;
+			state->next_item++) {
+		EXE_AWAIT_DELAY(co, 1);
+		xQueueSend(state->queue.handle, &state->next_item, 0);
+	}
+	EXE_Notify(&state->consumer, EXE_TEST_DONE_BIT);
+	EXE_END(co);
+}
+
+/* Receives the items, checking their order, then waits for the notification. */
+static EXE_Status_t exe_test_consumer(EXE_Coroutine_t *co, void *context)
+{
+	exe_test_state_t *state = (exe_test_state_t *) context;
+
+	EXE_BEGIN(co);
+	while (state->expected_item < EXE_TEST_ITEMS) {
+		EXE_AWAIT_QUEUE(co, &state->queue, &state->received_item,
+				100 / portTICK_RATE_MS);
+		if (!EXE_AWAIT_SUCCEEDED(co)) {
+			break;
+		}
+		if (state->received_item == state->expected_item) {
+			state->items_in_order++;
+		}
+		state->expected_item++;
+	}
+	EXE_AWAIT_NOTIFY(co, EXE_TEST_DONE_BIT, 100 / portTICK_RATE_MS);
+	state->is_notify_ok = EXE_AWAIT_SUCCEEDED(co) &&
+			(EXE_RECEIVED_BITS(co) == EXE_TEST_DONE_BIT);
+	state->is_consumer_done = true;
+	EXE_END(co);
+}
+
+/* Waits for a bit nothing sets, so the wait must time out. */
+static EXE_Status_t exe_test_timeout(EXE_Coroutine_t *co, void *context)
+{
+	exe_test_state_t *state = (exe_test_state_t *) context;
+
+	EXE_BEGIN(co);
+	EXE_AWAIT_NOTIFY(co, EXE_TEST_UNUSED_BIT, 5);
+	state->is_timeout_ok = !EXE_AWAIT_SUCCEEDED(co);
+	state->is_timeout_done = true;
+	EXE_END(co);
+}
+
+static portBASE_TYPE exe_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static bool is_started = false;
+	QueueHandle_t queue;
+	bool is_passed;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	if (is_started == false) {
+		/* Queues and coroutines can only be added before the executor is
+		started, so the test can only be started once. */
+		queue = xQueueCreate(4, sizeof(uint32_t));
+		is_started = (queue != NULL) &&
+				EXE_AddQueue(&exe_test.queue, queue) &&
+				EXE_AddCoroutine(&exe_test.producer, exe_test_producer, &exe_test) &&
+				EXE_AddCoroutine(&exe_test.consumer, exe_test_consumer, &exe_test) &&
+				EXE_AddCoroutine(&exe_test.timeout, exe_test_timeout, &exe_test) &&
+				EXE_Start(EXE_TEST_STACK_SIZE, EXE_TEST_PRIORITY);
+
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen, "%s\r\n",
+				is_started ? "Executor test started, enter exe-test again for the result" :
+				"Could not start the executor");
+	} else if ((exe_test.is_consumer_done == false) ||
+			(exe_test.is_timeout_done == false)) {
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"Executor test running, %lu of %lu items received\r\n",
+				(unsigned long) exe_test.items_in_order,
+				(unsigned long) EXE_TEST_ITEMS);
+	} else {
+		is_passed = (exe_test.items_in_order == EXE_TEST_ITEMS) &&
+				exe_test.is_notify_ok && exe_test.is_timeout_ok;
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"%s: %lu of %lu items in order, notification %s, timeout %s\r\n",
+				is_passed ? "Passed" : "FAILED",
+				(unsigned long) exe_test.items_in_order,
+				(unsigned long) EXE_TEST_ITEMS,
+				exe_test.is_notify_ok ? "ok" : "missed",
+				exe_test.is_timeout_ok ? "ok" : "missed");
+	}
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The number of items passed at each batch size by the queue-batch command, and
+the length of the queue they pass through. */
+#define QUEUE_BATCH_ITEMS				(1024u)
+#define QUEUE_BATCH_LENGTH				(32u)
+
+static const uint32_t queue_batch_sizes[] = {1, 8, 32};
+static QueueHandle_t queue_batch_queue = NULL;
+static xSemaphoreHandle queue_batch_done = NULL;
+static volatile uint32_t queue_batch_size = 1;
+static volatile uint32_t queue_batch_errors = 0;
+
+/* Receives the items sent by the queue-batch command, up to queue_batch_size
+at a time, checks they arrive in order, and gives queue_batch_done after each
+QUEUE_BATCH_ITEMS items. */
+static void queue_batch_receive_task(void *pvParameters)
+{
+	uint32_t items[QUEUE_BATCH_LENGTH];
+	uint32_t expected = 0, received, index;
+
+	(void) pvParameters;
+
+	for (;;) {
+		received = xQueueReceiveMultiple(queue_batch_queue, items,
+				queue_batch_size, portMAX_DELAY);
+
+		for (index = 0; index < received; index++) {
+			if (items[index] != expected) {
+				queue_batch_errors++;
+			}
+			expected++;
+		}
+
+		if (expected >= QUEUE_BATCH_ITEMS) {
+			expected = 0;
+			xSemaphoreGive(queue_batch_done);
+		}
+	}
+}
+
+static portBASE_TYPE queue_batch_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static portBASE_TYPE line_number = 0;
+	portBASE_TYPE return_value;
+	uint32_t items[QUEUE_BATCH_LENGTH];
+	uint32_t batch, sent, index, start_cycles, cycles;
+	bool is_done;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	if (line_number == 0) {
+		/* The receiving task runs at the priority of the command console,
+		so each side runs while the other waits.  It is only created the
+		first time. */
+		if (queue_batch_queue == NULL) {
+			queue_batch_queue = xQueueCreate(QUEUE_BATCH_LENGTH, sizeof(uint32_t));
+			queue_batch_done = xSemaphoreCreateBinary();
+			if ((queue_batch_queue == NULL) || (queue_batch_done == NULL) ||
+					(xTaskCreate(queue_batch_receive_task, "QBatch",
+					configMINIMAL_STACK_SIZE, NULL, uxTaskPriorityGet(NULL),
+					NULL) != pdPASS)) {
+				snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+						"Could not create the queue-batch receive task\r\n");
+				return pdFALSE;
+			}
+		}
+
+		/* The transfers are timed with the DWT cycle counter. */
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"Batch     Items/s  Cycles/item  Errors\r\n"
+				"**************************************\r\n");
+		line_number++;
+		return_value = pdTRUE;
+	} else {
+		/* Subsequent calls time one batch size each. */
+		batch = queue_batch_sizes[line_number - 1];
+		queue_batch_size = batch;
+		queue_batch_errors = 0;
+
+		start_cycles = DWT->CYCCNT;
+		for (sent = 0; sent < QUEUE_BATCH_ITEMS; sent += batch) {
+			for (index = 0; index < batch; index++) {
+				items[index] = sent + index;
+			}
+			xQueueSendMultiple(queue_batch_queue, items, batch, portMAX_DELAY);
+		}
+		is_done = (xSemaphoreTake(queue_batch_done, 1000 / portTICK_RATE_MS) == pdPASS);
+		cycles = DWT->CYCCNT - start_cycles;
+
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"%5lu  %10lu  %11lu  %6lu%s\r\n",
+				(unsigned long) batch,
+				(unsigned long) (((uint64_t) QUEUE_BATCH_ITEMS * configCPU_CLOCK_HZ) / cycles),
+				(unsigned long) (cycles / QUEUE_BATCH_ITEMS),
+				(unsigned long) queue_batch_errors,
+				is_done ? "" : " (not all received)");
+
+		line_number++;
+		if ((uint32_t) line_number > (sizeof(queue_batch_sizes) / sizeof(queue_batch_sizes[0]))) {
+			/* That was the last line, reset for the next time the command
+			is entered. */
+			line_number = 0;
+			return_value = pdFALSE;
+		} else {
+			return_value = pdTRUE;
+		}
+	}
+
+	return return_value;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The ceiling-test tasks run below the ceiling of the mutex they share.  The
+low priority task sometimes blocks while holding the mutex, so the high
+priority task has to wait for it. */
+#define CEILING_TEST_STACK_SIZE			(configMINIMAL_STACK_SIZE)
+#define CEILING_TEST_LOW_PRIORITY		(tskIDLE_PRIORITY + 1)
+#define CEILING_TEST_HIGH_PRIORITY		(tskIDLE_PRIORITY + 2)
+#define CEILING_TEST_CEILING			(tskIDLE_PRIORITY + 3)
+#define CEILING_TEST_TAKES				(10u)
+#define CEILING_TEST_HOLD_CYCLES		(2000u)
+#define CEILING_TEST_TIMEOUT			(100 / portTICK_RATE_MS)
+
+/* The results of one of the ceiling-test tasks. */
+typedef struct ceiling_test_user {
+	const char *name;
+	UBaseType_t priority;
+	TaskHandle_t task;
+	uint32_t takes;			/* Times the mutex was taken. */
+	uint32_t at_ceiling;	/* Takes that ran at the ceiling priority. */
+	uint32_t restored;		/* Gives that restored the task's own priority. */
+	uint32_t overlaps;		/* Takes that found the other task inside. */
+	volatile bool is_done;
+} ceiling_test_user_t;
+
+static PCM_Mutex_t ceiling_test_mutex;
+static TaskHandle_t ceiling_test_holder = NULL;
+static ceiling_test_user_t ceiling_test_users[] = {
+	{"PcmLo", CEILING_TEST_LOW_PRIORITY},
+	{"PcmHi", CEILING_TEST_HIGH_PRIORITY}
+};
+
+/* Each time it is notified, takes the mutex CEILING_TEST_TAKES times and
+records what it saw. */
+static void ceiling_test_task(void *pvParameters)
+{
+	ceiling_test_user_t *user = (ceiling_test_user_t *) pvParameters;
+	uint32_t take, start_cycles;
+
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		for (take = 0; take < CEILING_TEST_TAKES; take++) {
+			if (PCM_Take(&ceiling_test_mutex, CEILING_TEST_TIMEOUT)) {
+				if (ceiling_test_holder != NULL) {
+					user->overlaps++;
+				}
+				ceiling_test_holder = xTaskGetCurrentTaskHandle();
+
+				if (uxTaskPriorityGet(NULL) == CEILING_TEST_CEILING) {
+					user->at_ceiling++;
+				}
+
+				start_cycles = DWT->CYCCNT;
+				while ((DWT->CYCCNT - start_cycles) < CEILING_TEST_HOLD_CYCLES) {
+				}
+
+				if ((user->priority == CEILING_TEST_LOW_PRIORITY) &&
+						((take & 1) != 0)) {
+					vTaskDelay(1);
+				}
+
+				ceiling_test_holder = NULL;
+				PCM_Give(&ceiling_test_mutex);
+
+				if (uxTaskPriorityGet(NULL) == user->priority) {
+					user->restored++;
+				}
+				user->takes++;
+			}
+
+			vTaskDelay(1);
+		}
+
+		user->is_done = true;
+	}
+}
+
+static portBASE_TYPE ceiling_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static portBASE_TYPE line_number = 0;
+	portBASE_TYPE return_value;
+	ceiling_test_user_t *user;
+	uint32_t index, wait;
+	bool is_passed;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	if (line_number == 0) {
+		/* The mutex and tasks are only created the first time, and are
+		kept so ceiling-blocking can report on them afterwards. */
+		if (ceiling_test_users[0].task == NULL) {
+			if (!PCM_Create(&ceiling_test_mutex, "Test", CEILING_TEST_CEILING)) {
+				snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+						"Could not create the ceiling-test mutex\r\n");
+				return pdFALSE;
+			}
+
+			for (index = 0; index < 2; index++) {
+				user = &ceiling_test_users[index];
+				if (xTaskCreate(ceiling_test_task, user->name,
+						CEILING_TEST_STACK_SIZE, user, user->priority,
+						&user->task) != pdPASS) {
+					snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+							"Could not create the ceiling-test tasks\r\n");
+					return pdFALSE;
+				}
+			}
+		}
+
+		for (index = 0; index < 2; index++) {
+			user = &ceiling_test_users[index];
+			user->takes = 0;
+			user->at_ceiling = 0;
+			user->restored = 0;
+			user->overlaps = 0;
+			user->is_done = false;
+			xTaskNotifyGive(user->task);
+		}
+
+		/* Wait for both tasks to finish. */
+		for (wait = 0; wait < 100; wait++) {
+			if (ceiling_test_users[0].is_done && ceiling_test_users[1].is_done) {
+				break;
+			}
+			vTaskDelay(10 / portTICK_RATE_MS);
+		}
+
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"Task    Takes  At ceiling  Restored  Overlaps  Result\r\n"
+				"*****************************************************\r\n");
+		line_number++;
+		return_value = pdTRUE;
+	} else {
+		/* Subsequent calls return one task each. */
+		user = &ceiling_test_users[line_number - 1];
+		is_passed = user->is_done &&
+				(user->takes == CEILING_TEST_TAKES) &&
+				(user->at_ceiling == CEILING_TEST_TAKES) &&
+				(user->restored == CEILING_TEST_TAKES) &&
+				(user->overlaps == 0);
+
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"%-6s %6lu %11lu %9lu %9lu  %s\r\n",
+				user->name,
+				(unsigned long) user->takes,
+				(unsigned long) user->at_ceiling,
+				(unsigned long) user->restored,
+				(unsigned long) user->overlaps,
+				is_passed ? "Passed" : "FAILED");
+
+		line_number++;
+		if (line_number > 2) {
+			/* That was the last line, reset for the next time the command
+			is entered. */
+			line_number = 0;
+			return_value = pdFALSE;
+		} else {
+			return_value = pdTRUE;
+		}
+	}
+
+	return return_value;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The rwlock-test readers and writer each hold the lock across a tick, so
+readers overlap each other and the writer has to wait for them. */
+#define RWLOCK_TEST_STACK_SIZE			(configMINIMAL_STACK_SIZE)
+#define RWLOCK_TEST_READER_PRIORITY		(tskIDLE_PRIORITY + 1)
+#define RWLOCK_TEST_WRITER_PRIORITY		(tskIDLE_PRIORITY + 2)
+#define RWLOCK_TEST_READERS				(3u)
+#define RWLOCK_TEST_READS				(20u)
+#define RWLOCK_TEST_WRITES				(10u)
+#define RWLOCK_TEST_TIMEOUT				(500 / portTICK_RATE_MS)
+
+static RWL_Lock_t rwlock_test_lock;
+static TaskHandle_t rwlock_test_tasks[RWLOCK_TEST_READERS + 1] = {NULL};
+
+/* The value protected by the lock.  The writer changes the two halves a tick
+apart, so a reader that got in while it was writing would see them differ. */
+static volatile uint32_t rwlock_test_value[2];
+
+static volatile uint32_t rwlock_test_reads, rwlock_test_writes;
+static volatile uint32_t rwlock_test_torn, rwlock_test_timeouts;
+static volatile uint32_t rwlock_test_readers_inside, rwlock_test_most_readers;
+static volatile uint32_t rwlock_test_writer_overlaps, rwlock_test_done;
+
+static void rwlock_test_reader_task(void *pvParameters)
+{
+	uint32_t read, first;
+
+	(void) pvParameters;
+
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		for (read = 0; read < RWLOCK_TEST_READS; read++) {
+			if (RWL_ReadLock(&rwlock_test_lock, RWLOCK_TEST_TIMEOUT)) {
+				taskENTER_CRITICAL();
+				rwlock_test_readers_inside++;
+				if (rwlock_test_readers_inside > rwlock_test_most_readers) {
+					rwlock_test_most_readers = rwlock_test_readers_inside;
+				}
+				rwlock_test_reads++;
+				taskEXIT_CRITICAL();
+
+				first = rwlock_test_value[0];
+				vTaskDelay(1);
+				if (rwlock_test_value[1] != first) {
+					rwlock_test_torn++;
+				}
+
+				taskENTER_CRITICAL();
+				rwlock_test_readers_inside--;
+				taskEXIT_CRITICAL();
+
+				RWL_ReadUnlock(&rwlock_test_lock);
+			} else {
+				rwlock_test_timeouts++;
+			}
+
+			vTaskDelay(1);
+		}
+
+		taskENTER_CRITICAL();
+		rwlock_test_done++;
+		taskEXIT_CRITICAL();
+	}
+}
+
+static void rwlock_test_writer_task(void *pvParameters)
+{
+	uint32_t write;
+
+	(void) pvParameters;
+
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		for (write = 0; write < RWLOCK_TEST_WRITES; write++) {
+			if (RWL_WriteLock(&rwlock_test_lock, RWLOCK_TEST_TIMEOUT)) {
+				if (rwlock_test_readers_inside != 0) {
+					rwlock_test_writer_overlaps++;
+				}
+
+				rwlock_test_value[0]++;
+				vTaskDelay(1);
+				rwlock_test_value[1]++;
+				rwlock_test_writes++;
+
+				RWL_WriteUnlock(&rwlock_test_lock);
+			} else {
+				rwlock_test_timeouts++;
+			}
+
+			vTaskDelay(2);
+		}
+
+		taskENTER_CRITICAL();
+		rwlock_test_done++;
+		taskEXIT_CRITICAL();
+	}
+}
+
+static portBASE_TYPE rwlock_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	uint32_t index, wait;
+	bool is_passed;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	/* The lock and tasks are only created the first time. */
+	if (rwlock_test_tasks[0] == NULL) {
+		if (!RWL_Create(&rwlock_test_lock)) {
+			snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+					"Could not create the rwlock-test lock\r\n");
+			return pdFALSE;
+		}
+
+		for (index = 0; index < RWLOCK_TEST_READERS; index++) {
+			if (xTaskCreate(rwlock_test_reader_task, "RwlRead",
+					RWLOCK_TEST_STACK_SIZE, NULL, RWLOCK_TEST_READER_PRIORITY,
+					&rwlock_test_tasks[index]) != pdPASS) {
+				break;
+			}
+		}
+
+		if ((index < RWLOCK_TEST_READERS) ||
+				(xTaskCreate(rwlock_test_writer_task, "RwlWrite",
+				RWLOCK_TEST_STACK_SIZE, NULL, RWLOCK_TEST_WRITER_PRIORITY,
+				&rwlock_test_tasks[RWLOCK_TEST_READERS]) != pdPASS)) {
+			snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+					"Could not create the rwlock-test tasks\r\n");
+			return pdFALSE;
+		}
+	}
+
+	rwlock_test_reads = 0;
+	rwlock_test_writes = 0;
+	rwlock_test_torn = 0;
+	rwlock_test_timeouts = 0;
+	rwlock_test_most_readers = 0;
+	rwlock_test_writer_overlaps = 0;
+	rwlock_test_done = 0;
+
+	for (index = 0; index <= RWLOCK_TEST_READERS; index++) {
+		xTaskNotifyGive(rwlock_test_tasks[index]);
+	}
+
+	/* Wait for every task to finish. */
+	for (wait = 0; (wait < 100) && (rwlock_test_done <= RWLOCK_TEST_READERS); wait++) {
+		vTaskDelay(10 / portTICK_RATE_MS);
+	}
+
+	/* Readers must have overlapped, or the test did not test sharing. */
+	is_passed = (rwlock_test_done > RWLOCK_TEST_READERS) &&
+			(rwlock_test_reads == (RWLOCK_TEST_READERS * RWLOCK_TEST_READS)) &&
+			(rwlock_test_writes == RWLOCK_TEST_WRITES) &&
+			(rwlock_test_torn == 0) &&
+			(rwlock_test_writer_overlaps == 0) &&
+			(rwlock_test_most_readers > 1);
+
+	snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+			"Reads %lu, writes %lu, torn reads %lu, writer overlaps %lu, "
+			"timeouts %lu, most readers at once %lu\r\n%s\r\n",
+			(unsigned long) rwlock_test_reads,
+			(unsigned long) rwlock_test_writes,
+			(unsigned long) rwlock_test_torn,
+			(unsigned long) rwlock_test_writer_overlaps,
+			(unsigned long) rwlock_test_timeouts,
+			(unsigned long) rwlock_test_most_readers,
+			is_passed ? "Passed" : "FAILED");
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The kv-test store fills the simulated AT24C with the smallest number of
+segments a store can have.  Key 0 counts the runs of the command, so it is
+kept from one run to the next, keys 1 to KV_TEST_KEYS - 1 are rewritten each
+run, and key KV_TEST_UPDATED_KEY is overwritten enough times to fill a segment,
+which forces at least one compaction. */
+#define KV_TEST_SIZE					(2u * KVS_SEGMENT_SIZE)
+#define KV_TEST_RUNS_KEY				(0u)
+#define KV_TEST_KEYS					(8u)
+#define KV_TEST_DELETED_KEY				(3u)
+#define KV_TEST_UPDATED_KEY				(KV_TEST_KEYS)
+#define KV_TEST_UPDATES					(500u)
+#define KV_TEST_TIMEOUT					(500 / portTICK_RATE_MS)
+
+/* The value a run writes to one of the keys 1 to KV_TEST_KEYS - 1. */
+#define KV_TEST_VALUE(key, run)			(((uint32_t) (key) << 24) | (run))
+
+static portBASE_TYPE kv_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	static uint8_t sim_memory[KV_TEST_SIZE];
+	static EEP_SimDevice_t sim_device;
+	static EEP_Cache_t cache;
+	static KVS_Store_t store;
+	static bool is_cache_ready = false;
+	uint32_t runs = 0, value, length, key, update;
+	KVS_Stats_t stats;
+	uint32_t compactions;
+	EEP_Bus_t bus;
+	bool is_passed;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	/* The cache owns a mutex, so it is only created the first time.  The
+	simulated device starts erased, and afterwards keeps the store written by
+	the last run. */
+	if (is_cache_ready == false) {
+		memset(sim_memory, 0xff, sizeof(sim_memory));
+		is_cache_ready = EEP_InitSimBus(&bus, &sim_device, sim_memory,
+				KV_TEST_SIZE, EEPROM_SIM_WRITE_CYCLE_TICKS) &&
+				EEP_Init(&cache, &bus, KV_TEST_SIZE);
+
+		if (is_cache_ready == false) {
+			snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+					"Could not create the EEPROM cache\r\n");
+			return pdFALSE;
+		}
+	}
+
+	is_passed = KVS_Init(&store, &cache, 0, KV_TEST_SIZE);
+
+	/* Count this run.  The key is missing the first time. */
+	if (is_passed && (KVS_Get(&store, KV_TEST_RUNS_KEY, &runs,
+			sizeof(runs), &length, KV_TEST_TIMEOUT) == false)) {
+		runs = 0;
+	}
+	runs++;
+	is_passed = is_passed && KVS_Set(&store, KV_TEST_RUNS_KEY,
+			&runs, sizeof(runs), KV_TEST_TIMEOUT);
+
+	/* Set, get back, then delete one of the keys. */
+	for (key = 1; is_passed && (key < KV_TEST_KEYS); key++) {
+		value = KV_TEST_VALUE(key, runs);
+		is_passed = KVS_Set(&store, key, &value, sizeof(value),
+				KV_TEST_TIMEOUT);
+	}
+
+	for (key = 1; is_passed && (key < KV_TEST_KEYS); key++) {
+		is_passed = KVS_Get(&store, key, &value, sizeof(value),
+				&length, KV_TEST_TIMEOUT) && (length == sizeof(value)) &&
+				(value == KV_TEST_VALUE(key, runs));
+	}
+
+	is_passed = is_passed && KVS_Delete(&store, KV_TEST_DELETED_KEY,
+			KV_TEST_TIMEOUT) && (KVS_Get(&store, KV_TEST_DELETED_KEY,
+			&value, sizeof(value), &length,
+			KV_TEST_TIMEOUT) == false);
+
+	/* Overwrite one key until the log has been compacted at least once. */
+	KVS_GetStats(&store, &stats);
+	compactions = stats.compactions;
+	for (update = 1; is_passed && (update <= KV_TEST_UPDATES); update++) {
+		is_passed = KVS_Set(&store, KV_TEST_UPDATED_KEY, &update,
+				sizeof(update), KV_TEST_TIMEOUT);
+	}
+
+	KVS_GetStats(&store, &stats);
+	compactions = stats.compactions - compactions;
+	is_passed = is_passed && (compactions > 0);
+
+	/* Close the store, then open it again from what reached the EEPROM. */
+	if (store.mutex != NULL) {
+		is_passed = KVS_Close(&store, KV_TEST_TIMEOUT) && is_passed;
+	}
+	is_passed = is_passed && KVS_Init(&store, &cache, 0, KV_TEST_SIZE);
+
+	is_passed = is_passed && KVS_Get(&store, KV_TEST_RUNS_KEY,
+			&value, sizeof(value), &length, KV_TEST_TIMEOUT) &&
+			(value == runs);
+
+	for (key = 1; is_passed && (key < KV_TEST_KEYS); key++) {
+		if (key == KV_TEST_DELETED_KEY) {
+			is_passed = (KVS_Get(&store, key, &value,
+					sizeof(value), &length, KV_TEST_TIMEOUT) == false);
+		} else {
+			is_passed = KVS_Get(&store, key, &value,
+					sizeof(value), &length, KV_TEST_TIMEOUT) &&
+					(value == KV_TEST_VALUE(key, runs));
+		}
+	}
+
+	is_passed = is_passed && KVS_Get(&store, KV_TEST_UPDATED_KEY,
+			&value, sizeof(value), &length, KV_TEST_TIMEOUT) &&
+			(value == KV_TEST_UPDATES);
+
+	KVS_GetStats(&store, &stats);
+	if (store.mutex != NULL) {
+		is_passed = KVS_Close(&store, KV_TEST_TIMEOUT) && is_passed;
+	}
+
+	snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+			"%s: run %lu, %lu keys, %lu of %lu bytes live after remounting\r\n"
+			" %lu compactions, segment %lu of %lu, generation %lu, %lu CRC errors\r\n",
+			is_passed ? "Passed" : "FAILED",
+			(unsigned long) runs,
+			(unsigned long) stats.keys,
+			(unsigned long) stats.liveBytes,
+			(unsigned long) stats.usedBytes,
+			(unsigned long) compactions,
+			(unsigned long) stats.activeSegment,
+			(unsigned long) stats.segmentCount,
+			(unsigned long) stats.generation,
+			(unsigned long) stats.crcErrors);
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The lfr-test ring is kept small so producers find it full and consumers
+find it empty, and every task runs at the same priority so time slicing and
+the TC0 interrupt preempt them part way through a push or pop. */
+#define LFR_TEST_STACK_SIZE				(configMINIMAL_STACK_SIZE)
+#define LFR_TEST_PRIORITY				(tskIDLE_PRIORITY + 1)
+#define LFR_TEST_TASK_PRODUCERS			(3u)
+#define LFR_TEST_PRODUCERS				(LFR_TEST_TASK_PRODUCERS + 1u)
+#define LFR_TEST_ISR_PRODUCER			(LFR_TEST_TASK_PRODUCERS)
+#define LFR_TEST_CONSUMERS				(2u)
+#define LFR_TEST_ITEMS					(1024u)
+#define LFR_TEST_RING_SLOTS				(16u)
+#define LFR_TEST_ISR_RATE_HZ			(20000u)
+
+/* An item is the producer number in the top byte and the producer's own
+sequence number below it. */
+#define LFR_TEST_ITEM(producer, sequence)	(((uint32_t) (producer) << 24) | (sequence))
+#define LFR_TEST_PRODUCER(item)			((item) >> 24)
+#define LFR_TEST_SEQUENCE(item)			((item) & 0x00FFFFFFul)
+
+static LFR_Ring_t lfr_test_ring;
+static uint32_t lfr_test_sequence[LFR_TEST_RING_SLOTS];
+static uint8_t lfr_test_storage[LFR_STORAGE_SIZE(LFR_TEST_RING_SLOTS, sizeof(uint32_t))];
+static TaskHandle_t lfr_test_tasks[LFR_TEST_TASK_PRODUCERS + LFR_TEST_CONSUMERS] = {NULL};
+
+/* One bitmap of the sequence numbers seen from each producer per consumer, so
+consumers never share a word; the command merges them once the test is done. */
+static uint32_t lfr_test_seen[LFR_TEST_CONSUMERS][LFR_TEST_PRODUCERS][LFR_TEST_ITEMS / 32u];
+static uint32_t lfr_test_last[LFR_TEST_CONSUMERS][LFR_TEST_PRODUCERS];
+
+/* Changed from tasks and the interrupt, so only with LFR_AtomicAdd(). */
+static volatile uint32_t lfr_test_producers_done, lfr_test_consumers_done;
+static volatile uint32_t lfr_test_full, lfr_test_empty;
+static volatile uint32_t lfr_test_duplicates, lfr_test_out_of_order, lfr_test_bad;
+
+static volatile uint32_t lfr_test_isr_pushed;
+
+static void lfr_test_producer_task(void *pvParameters)
+{
+	uint32_t producer = (uint32_t) pvParameters;
+	uint32_t item, pushed;
+
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		for (pushed = 0; pushed < LFR_TEST_ITEMS; pushed++) {
+			item = LFR_TEST_ITEM(producer, pushed);
+
+			while (!LFR_Push(&lfr_test_ring, &item)) {
+				LFR_AtomicAdd(&lfr_test_full, 1u);
+				taskYIELD();
+			}
+		}
+
+		LFR_AtomicAdd(&lfr_test_producers_done, 1u);
+	}
+}
+
+static void lfr_test_consumer_task(void *pvParameters)
+{
+	uint32_t consumer = (uint32_t) pvParameters;
+	uint32_t item, producer, sequence, bit;
+
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		/* Only stop once every producer has finished and the ring has been
+		emptied, as a pop can fail while an item is still being pushed. */
+		for (;;) {
+			if (LFR_Pop(&lfr_test_ring, &item)) {
+				producer = LFR_TEST_PRODUCER(item);
+				sequence = LFR_TEST_SEQUENCE(item);
+
+				if ((producer >= LFR_TEST_PRODUCERS) ||
+						(sequence >= LFR_TEST_ITEMS)) {
+					LFR_AtomicAdd(&lfr_test_bad, 1u);
+					continue;
+				}
+
+				bit = 1ul << (sequence % 32u);
+				if (lfr_test_seen[consumer][producer][sequence / 32u] & bit) {
+					LFR_AtomicAdd(&lfr_test_duplicates, 1u);
+				}
+				lfr_test_seen[consumer][producer][sequence / 32u] |= bit;
+
+				/* The ring is FIFO, so one consumer must see each producer's
+				items in the order they were pushed. */
+				if (sequence < lfr_test_last[consumer][producer]) {
+					LFR_AtomicAdd(&lfr_test_out_of_order, 1u);
+				}
+				lfr_test_last[consumer][producer] = sequence + 1u;
+			} else if ((lfr_test_producers_done == LFR_TEST_PRODUCERS) &&
+					(LFR_GetCount(&lfr_test_ring) == 0u)) {
+				break;
+			} else {
+				LFR_AtomicAdd(&lfr_test_empty, 1u);
+				taskYIELD();
+			}
+		}
+
+		LFR_AtomicAdd(&lfr_test_consumers_done, 1u);
+	}
+}
+
+/* The interrupt producer.  A push that finds the ring full is tried again on
+the next interrupt, and the timer is stopped once every item has been pushed.
+Nothing here calls the FreeRTOS API. */
+void TC0_Handler(void)
+{
+	uint32_t item;
+
+	(void) TC0->TC_CHANNEL[0].TC_SR;
+
+	if (lfr_test_isr_pushed < LFR_TEST_ITEMS) {
+		item = LFR_TEST_ITEM(LFR_TEST_ISR_PRODUCER, lfr_test_isr_pushed);
+
+		if (!LFR_Push(&lfr_test_ring, &item)) {
+			LFR_AtomicAdd(&lfr_test_full, 1u);
+		} else if (++lfr_test_isr_pushed == LFR_TEST_ITEMS) {
+			TC0->TC_CHANNEL[0].TC_IDR = TC_IDR_CPCS;
+			TC0->TC_CHANNEL[0].TC_CCR = TC_CCR_CLKDIS;
+			LFR_AtomicAdd(&lfr_test_producers_done, 1u);
+		}
+	}
+}
+
+static void lfr_test_start_timer(void)
+{
+	pmc_enable_periph_clk(ID_TC0);
+
+	/* TIMER_CLOCK1 is MCK / 2, reset on an RC compare. */
+	TC0->TC_CHANNEL[0].TC_CCR = TC_CCR_CLKDIS;
+	TC0->TC_CHANNEL[0].TC_CMR = TC_CMR_TCCLKS_TIMER_CLOCK1 | TC_CMR_WAVE |
+			TC_CMR_WAVSEL_UP_RC;
+	TC0->TC_CHANNEL[0].TC_RC = configCPU_CLOCK_HZ / 2u / LFR_TEST_ISR_RATE_HZ;
+	(void) TC0->TC_CHANNEL[0].TC_SR;
+	TC0->TC_CHANNEL[0].TC_IER = TC_IER_CPCS;
+
+	NVIC_ClearPendingIRQ(TC0_IRQn);
+	NVIC_SetPriority(TC0_IRQn, configLIBRARY_LOWEST_INTERRUPT_PRIORITY);
+	NVIC_EnableIRQ(TC0_IRQn);
+
+	TC0->TC_CHANNEL[0].TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+}
+
+static portBASE_TYPE lfr_test_command(int8_t *pcWriteBuffer,
+		size_t xWriteBufferLen,
+		const int8_t *pcCommandString)
+{
+	uint32_t index, producer, word, wait;
+	uint32_t received = 0, lost = 0, across = 0;
+	bool is_passed;
+
+	/* Remove compile time warnings about unused parameters, and check the
+	write buffer is not NULL. */
+	(void) pcCommandString;
+	configASSERT(pcWriteBuffer);
+
+	/* The ring cannot be reset while a timed out run is still using it. */
+	if ((lfr_test_tasks[0] != NULL) &&
+			(lfr_test_consumers_done < LFR_TEST_CONSUMERS)) {
+		snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+				"The last lfr-test has not finished\r\n");
+		return pdFALSE;
+	}
+
+	/* The tasks are only created the first time. */
+	if (lfr_test_tasks[0] == NULL) {
+		for (index = 0; index < LFR_TEST_TASK_PRODUCERS; index++) {
+			if (xTaskCreate(lfr_test_producer_task, "LfrPush",
+					LFR_TEST_STACK_SIZE, (void *) index, LFR_TEST_PRIORITY,
+					&lfr_test_tasks[index]) != pdPASS) {
+				break;
+			}
+		}
+
+		for (; index < LFR_TEST_TASK_PRODUCERS + LFR_TEST_CONSUMERS; index++) {
+			if (xTaskCreate(lfr_test_consumer_task, "LfrPop",
+					LFR_TEST_STACK_SIZE,
+					(void *) (index - LFR_TEST_TASK_PRODUCERS),
+					LFR_TEST_PRIORITY, &lfr_test_tasks[index]) != pdPASS) {
+				break;
+			}
+		}
+
+		if (index < LFR_TEST_TASK_PRODUCERS + LFR_TEST_CONSUMERS) {
+			snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+					"Could not create the lfr-test tasks\r\n");
+			return pdFALSE;
+		}
+	}
+
+	/* Every task is waiting for its notification, so the ring can be
+	initialized again without anything else using it. */
+	(void) LFR_Init(&lfr_test_ring, lfr_test_sequence, lfr_test_storage,
+			LFR_TEST_RING_SLOTS, sizeof(uint32_t));
+	memset(lfr_test_seen, 0, sizeof(lfr_test_seen));
+	memset(lfr_test_last, 0, sizeof(lfr_test_last));
+	lfr_test_producers_done = 0;
+	lfr_test_consumers_done = 0;
+	lfr_test_full = 0;
+	lfr_test_empty = 0;
+	lfr_test_duplicates = 0;
+	lfr_test_out_of_order = 0;
+	lfr_test_bad = 0;
+	lfr_test_isr_pushed = 0;
+
+	for (index = 0; index < LFR_TEST_TASK_PRODUCERS + LFR_TEST_CONSUMERS; index++) {
+		xTaskNotifyGive(lfr_test_tasks[index]);
+	}
+	lfr_test_start_timer();
+
+	/* Wait for every consumer to finish. */
+	for (wait = 0; (wait < 200) && (lfr_test_consumers_done < LFR_TEST_CONSUMERS); wait++) {
+		vTaskDelay(10 / portTICK_RATE_MS);
+	}
+
+	/* An item missing from every consumer's bitmap was lost, and an item in
+	more than one was delivered twice. */
+	for (producer = 0; producer < LFR_TEST_PRODUCERS; producer++) {
+		for (word = 0; word < (LFR_TEST_ITEMS / 32u); word++) {
+			uint32_t seen = 0, twice = 0;
+
+			for (index = 0; index < LFR_TEST_CONSUMERS; index++) {
+				twice |= seen & lfr_test_seen[index][producer][word];
+				seen |= lfr_test_seen[index][producer][word];
+			}
+
+			received += __builtin_popcount(seen);
+			across += __builtin_popcount(twice);
+		}
+	}
+	lost = (LFR_TEST_PRODUCERS * LFR_TEST_ITEMS) - received;
+
+	is_passed = (lfr_test_consumers_done == LFR_TEST_CONSUMERS) &&
+			(lost == 0) && (across == 0) && (lfr_test_duplicates == 0) &&
+			(lfr_test_out_of_order == 0) && (lfr_test_bad == 0);
+
+	snprintf((char *) pcWriteBuffer, xWriteBufferLen,
+			"Received %lu of %lu, lost %lu, duplicated %lu, out of order %lu, "
+			"corrupt %lu, ring full %lu, ring empty %lu\r\n%s\r\n",
+			(unsigned long) received,
+			(unsigned long) (LFR_TEST_PRODUCERS * LFR_TEST_ITEMS),
+			(unsigned long) lost,
+			(unsigned long) (across + lfr_test_duplicates),
+			(unsigned long) lfr_test_out_of_order,
+			(unsigned long) lfr_test_bad,
+			(unsigned long) lfr_test_full,
+			(unsigned long) lfr_test_empty,
+			is_passed ? "Passed" : "FAILED");
+
+	/* There is no more data to return after this single string, so return
+	pdFALSE. */
+	return pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
 void created_task(void *pvParameters)
 {
 	int32_t parameter_value;